@@ -0,0 +1,93 @@
+#include "utils.h"
+
+#include "Analyzer/Analyzers.h"
+#include "Data/TimeSeries.h"
+
+using namespace NEUROBIO_NAMESPACE;
+
+// The live data window of the data collectors, sampled as the Delsys analog
+static size_t LIVE_WINDOW_SIZE(1000);
+static std::chrono::microseconds SAMPLING_PERIOD(500);
+
+// The live analyses are made every 25 ms
+static size_t SAMPLES_PER_PREDICTION(50);
+
+static void addAnalyzers(analyzer::Analyzers &analyzers) {
+  // A gait analyzer for each foot, as used during the experiments
+  for (const auto &[name, channels] :
+       std::vector<std::pair<std::string, std::pair<int, int>>>{
+           {"Left Foot", {0, 1}}, {"Right Foot", {2, 3}}}) {
+    auto json = nlohmann::json::parse(R"({
+        "analyzer_type" : "cyclic_timed_events",
+        "time_reference_device" : "DelsysAnalogDataCollector",
+        "learning_rate" : 0.5,
+        "initial_phase_durations" : [400, 600],
+        "events" : [
+          {
+            "name" : "heel_strike",
+            "previous" : "toe_off",
+            "start_when" : [
+              {
+                "type": "threshold",
+                "device" : "DelsysAnalogDataCollector",
+                "channel" : 0,
+                "comparator" : ">=",
+                "value" : 0.2
+              }
+            ]
+          },
+          {
+            "name" : "toe_off",
+            "previous" : "heel_strike",
+            "start_when" : [
+              {
+                "type": "threshold",
+                "device" : "DelsysAnalogDataCollector",
+                "channel" : 1,
+                "comparator" : ">=",
+                "value" : 0.2
+              }
+            ]
+          }
+        ]
+      })");
+    json["name"] = name;
+    json["events"][0]["start_when"][0]["channel"] = channels.first;
+    json["events"][1]["start_when"][0]["channel"] = channels.second;
+    analyzers.add(json);
+  }
+}
+
+BENCHMARK(Analyzers, predict) {
+  analyzer::Analyzers analyzers;
+  addAnalyzers(analyzers);
+
+  // The live data keep rolling between the predictions, as on the server
+  data::TimeSeries analogs;
+  analogs.setRollingVectorMaxSize(LIVE_WINDOW_SIZE);
+  std::vector<double> sample(state.channelCount());
+  size_t sampleIndex = 0;
+  auto addSamples = [&](size_t count) {
+    for (size_t i = 0; i < count; i++, sampleIndex++) {
+      for (size_t j = 0; j < sample.size(); j++) {
+        sample[j] = std::sin(static_cast<double>(sampleIndex) / 2000.0 * 2 *
+                                 M_PI +
+                             static_cast<double>(j) * M_PI / 2);
+      }
+      analogs.add(SAMPLING_PERIOD * static_cast<int64_t>(sampleIndex), sample);
+    }
+  };
+  addSamples(LIVE_WINDOW_SIZE);
+
+  state.setItemsPerIteration(LIVE_WINDOW_SIZE);
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    addSamples(SAMPLES_PER_PREDICTION);
+    std::map<std::string, data::TimeSeries> data = {
+        {"DelsysAnalogDataCollector", analogs}};
+    state.resumeTiming();
+
+    auto predictions = analyzers.predict(data);
+    doNotOptimize(predictions);
+  }
+}
@@ -0,0 +1,191 @@
+#include "utils.h"
+
+#include <random>
+
+#include "Data/EmgFeaturesStage.h"
+#include "Data/FilterBankStage.h"
+#include "Data/TimeSeries.h"
+#include "Data/TimeSeriesCodec.h"
+#include "Data/TrialFile.h"
+
+using namespace NEUROBIO_NAMESPACE;
+
+// The live data window of the data collectors, sampled as the Delsys EMG
+static size_t LIVE_WINDOW_SIZE(1000);
+static std::chrono::microseconds SAMPLING_PERIOD(500);
+
+// The live data sent to the clients every 100 ms
+static std::chrono::milliseconds LIVE_DATA_PERIOD(100);
+
+static data::TimeSeries generateTimeSeries(size_t channelCount) {
+  std::mt19937 generator(42);
+  std::normal_distribution<double> noise(0.0, 1.0);
+
+  data::TimeSeries timeSeries;
+  timeSeries.setRollingVectorMaxSize(LIVE_WINDOW_SIZE);
+  std::vector<double> sample(channelCount);
+  for (size_t i = 0; i < LIVE_WINDOW_SIZE; i++) {
+    for (auto &value : sample) {
+      value = noise(generator);
+    }
+    timeSeries.add(SAMPLING_PERIOD * static_cast<int64_t>(i), sample);
+  }
+  return timeSeries;
+}
+
+BENCHMARK(TimeSeries, add) {
+  data::TimeSeries timeSeries;
+  timeSeries.setRollingVectorMaxSize(LIVE_WINDOW_SIZE);
+  std::vector<double> sample(state.channelCount(), 1.0);
+  std::chrono::microseconds timeStamp(0);
+  state.setItemsPerIteration(1);
+  while (state.keepRunning()) {
+    timeSeries.add(timeStamp, sample);
+    timeStamp += SAMPLING_PERIOD;
+  }
+  doNotOptimize(timeSeries.back());
+}
+
+BENCHMARK(TimeSeries, since) {
+  auto timeSeries = generateTimeSeries(state.channelCount());
+  auto time = timeSeries.getStartingTime() + timeSeries.back().getTimeStamp() -
+              LIVE_DATA_PERIOD;
+  while (state.keepRunning()) {
+    auto recent = timeSeries.since(time);
+    doNotOptimize(recent);
+  }
+  state.setItemsPerIteration(timeSeries.since(time).size());
+}
+
+BENCHMARK(TimeSeries, serialize) {
+  auto timeSeries = generateTimeSeries(state.channelCount());
+  state.setItemsPerIteration(timeSeries.size());
+  while (state.keepRunning()) {
+    auto json = timeSeries.serialize();
+    doNotOptimize(json);
+  }
+}
+
+// The samples compressed at once, a second of the Delsys EMG
+static size_t CODEC_SAMPLE_COUNT(2000);
+
+// The samples the codec is measured on: those of the data collector of the
+// recorded trial (see --trial) with as many channels, or else synthetic ones
+// shaped as the Delsys data (float32 values of EMG-like bursts over noise)
+static data::TimeSeries codecTimeSeries(size_t channelCount) {
+  if (!benchmarkTrialPath().empty()) {
+    static auto trial = data::TrialFile::load(benchmarkTrialPath());
+    for (const auto &[name, timeSeries] : trial) {
+      if (timeSeries.size() > 0 && timeSeries[0].size() == channelCount) {
+        return timeSeries;
+      }
+    }
+  }
+
+  std::mt19937 generator(42);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  data::TimeSeries timeSeries;
+  std::vector<double> sample(channelCount);
+  for (size_t i = 0; i < CODEC_SAMPLE_COUNT; i++) {
+    float envelope = (i / 400) % 2 == 0 ? 1e-4f : 1e-5f;
+    for (auto &value : sample) {
+      value = envelope * noise(generator);
+    }
+    timeSeries.add(SAMPLING_PERIOD * static_cast<int64_t>(i), sample);
+  }
+  return timeSeries;
+}
+
+// The size of the samples as the trial files store them without compression
+static size_t rawSize(const data::TimeSeries &timeSeries) {
+  size_t channelCount = timeSeries.size() > 0 ? timeSeries[0].size() : 0;
+  return timeSeries.size() * (channelCount + 1) * sizeof(double);
+}
+
+BENCHMARK(TimeSeriesCodec, encode) {
+  auto timeSeries = codecTimeSeries(state.channelCount());
+  std::vector<char> buffer;
+  data::TimeSeriesCodec::encode(timeSeries, buffer);
+  state.setItemsPerIteration(timeSeries.size());
+  state.setBytesPerIteration(rawSize(timeSeries));
+  state.setCompressionRatio(static_cast<double>(rawSize(timeSeries)) /
+                            static_cast<double>(buffer.size()));
+  while (state.keepRunning()) {
+    buffer.clear();
+    data::TimeSeriesCodec::encode(timeSeries, buffer);
+    doNotOptimize(buffer.data());
+  }
+}
+
+BENCHMARK(TimeSeriesCodec, decode) {
+  auto timeSeries = codecTimeSeries(state.channelCount());
+  std::vector<char> buffer;
+  data::TimeSeriesCodec::encode(timeSeries, buffer);
+  state.setItemsPerIteration(timeSeries.size());
+  state.setBytesPerIteration(rawSize(timeSeries));
+  state.setCompressionRatio(static_cast<double>(rawSize(timeSeries)) /
+                            static_cast<double>(buffer.size()));
+  while (state.keepRunning()) {
+    size_t position = 0;
+    auto decoded = data::TimeSeriesCodec::decode(buffer, position,
+                                                 timeSeries.getStartingTime());
+    doNotOptimize(decoded);
+  }
+}
+
+// The samples processed by each run of the processing stages, a second of the
+// Delsys EMG
+static size_t STAGE_SAMPLE_COUNT(2000);
+static double SAMPLING_FREQUENCY(2000.0);
+
+// Run a processing stage on a second of EMG-like noise. The stages may filter
+// the samples in place, so they are restored before each run, off the clock,
+// so the filters are not measured on values decayed to denormals
+static void benchmarkStage(BenchmarkState &state,
+                           data::ProcessingStage &stage) {
+  std::mt19937 generator(42);
+  std::normal_distribution<double> noise(0.0, 1e-4);
+  std::vector<std::vector<double>> samples(STAGE_SAMPLE_COUNT);
+  for (auto &sample : samples) {
+    sample.resize(state.channelCount());
+    for (auto &value : sample) {
+      value = noise(generator);
+    }
+  }
+
+  auto processed = samples;
+  state.setItemsPerIteration(STAGE_SAMPLE_COUNT);
+  while (state.keepRunning()) {
+    state.pauseTiming();
+    processed = samples;
+    state.resumeTiming();
+
+    for (auto &sample : processed) {
+      stage.process(sample);
+    }
+    doNotOptimize(processed.back().data());
+  }
+}
+
+BENCHMARK(FilterBankStage, bandPassNotch) {
+  data::FilterBankStage stage("Filters", state.channelCount(), true);
+  stage.addFilter(data::Biquad::highPass(20.0, SAMPLING_FREQUENCY));
+  stage.addFilter(data::Biquad::lowPass(450.0, SAMPLING_FREQUENCY));
+  stage.addFilter(data::Biquad::notch(60.0, SAMPLING_FREQUENCY));
+  benchmarkStage(state, stage);
+}
+
+BENCHMARK(FilterBankStage, envelope) {
+  data::FilterBankStage stage("EmgEnvelope", state.channelCount(), false, 20);
+  stage.addFilter(data::Biquad::highPass(20.0, SAMPLING_FREQUENCY));
+  stage.addFilter(data::Biquad::lowPass(450.0, SAMPLING_FREQUENCY));
+  stage.addFilter(data::Biquad::notch(60.0, SAMPLING_FREQUENCY));
+  stage.addRectification();
+  stage.addFilter(data::Biquad::lowPass(6.0, SAMPLING_FREQUENCY));
+  benchmarkStage(state, stage);
+}
+
+BENCHMARK(EmgFeaturesStage, process) {
+  data::EmgFeaturesStage stage(state.channelCount());
+  benchmarkStage(state, stage);
+}
@@ -0,0 +1,110 @@
+#include "utils.h"
+
+#include <cstring>
+#include <random>
+
+#include "Devices/Devices.h"
+#include "Devices/Generic/DelsysBaseDevice.h"
+
+using namespace NEUROBIO_NAMESPACE;
+
+// The geometry of the Delsys frames (27 samples of 4 bytes per channel)
+static size_t DELSYS_SAMPLE_COUNT(27);
+static std::chrono::microseconds DELSYS_FRAME_RATE(500);
+
+// The live data window of the data collectors
+static size_t LIVE_WINDOW_SIZE(1000);
+
+/// @brief A data device that returns the same frame over and over, so only
+/// the decoding of the frames is measured
+class FrameDataTcpDevice : public devices::DelsysBaseDevice::DataTcpDevice {
+public:
+  FrameDataTcpDevice(size_t channelCount)
+      : DataTcpDevice("localhost", 0),
+        m_Frame(channelCount * DELSYS_SAMPLE_COUNT * 4) {
+    std::mt19937 generator(42);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (size_t i = 0; i < m_Frame.size(); i += sizeof(float)) {
+      float value = noise(generator);
+      std::memcpy(m_Frame.data() + i, &value, sizeof(float));
+    }
+  }
+
+  bool read(std::vector<char> &buffer) override {
+    std::memcpy(buffer.data(), m_Frame.data(), m_Frame.size());
+    return true;
+  }
+
+protected:
+  std::vector<char> m_Frame;
+};
+
+/// @brief A Delsys device reading from a [FrameDataTcpDevice]. The data check
+/// is called by the benchmark instead of the data worker
+class FrameDelsysDevice : public devices::DelsysBaseDevice {
+public:
+  FrameDelsysDevice(const std::string &name, size_t channelCount)
+      : DelsysBaseDevice(
+            std::make_unique<FrameDataTcpDevice>(channelCount),
+            std::make_shared<
+                devices::DelsysBaseDeviceMock::CommandTcpDeviceMock>(
+                "localhost", 0),
+            channelCount, DELSYS_FRAME_RATE, DELSYS_SAMPLE_COUNT),
+        m_Name(name) {
+    m_IsStreamingData = true;
+  }
+
+  ~FrameDelsysDevice() override {
+    // The streaming was never started, so there is nothing to stop
+    m_IsStreamingData = false;
+  }
+
+  std::string deviceName() const override { return m_Name + "Device"; }
+  std::string dataCollectorName() const override {
+    return m_Name + "DataCollector";
+  }
+
+protected:
+  std::string m_Name;
+};
+
+BENCHMARK(DelsysBaseDevice, dataCheck) {
+  FrameDelsysDevice device("Delsys", state.channelCount());
+  state.setItemsPerIteration(DELSYS_SAMPLE_COUNT);
+  while (state.keepRunning()) {
+    device.dataCheck();
+  }
+}
+
+static std::unique_ptr<devices::Devices> generateDevices(size_t channelCount) {
+  // An EMG and an analog device, with their live data window filled
+  auto devices = std::make_unique<devices::Devices>();
+  for (const auto &name : {"DelsysEmg", "DelsysAnalog"}) {
+    auto device = std::make_unique<FrameDelsysDevice>(name, channelCount);
+    for (size_t i = 0; i < LIVE_WINDOW_SIZE / DELSYS_SAMPLE_COUNT + 1; i++) {
+      device->dataCheck();
+    }
+    devices->add(std::move(device));
+  }
+  return devices;
+}
+
+BENCHMARK(Devices, getLiveDataSerialized) {
+  auto devices = generateDevices(state.channelCount());
+  state.setItemsPerIteration(2 * LIVE_WINDOW_SIZE);
+  while (state.keepRunning()) {
+    auto json = devices->getLiveDataSerialized();
+    doNotOptimize(json);
+  }
+}
+
+BENCHMARK(Devices, getLiveDataSerializedDump) {
+  // What the server does every time it sends the live data
+  auto devices = generateDevices(state.channelCount());
+  state.setItemsPerIteration(2 * LIVE_WINDOW_SIZE);
+  state.setBytesPerIteration(devices->getLiveDataSerialized().dump().size());
+  while (state.keepRunning()) {
+    auto dump = devices->getLiveDataSerialized().dump();
+    doNotOptimize(dump);
+  }
+}
@@ -0,0 +1,59 @@
+#include "utils.h"
+
+#include <random>
+
+#include "Server/TcpServer.h"
+
+using namespace NEUROBIO_NAMESPACE;
+
+// The live data window of the data collectors
+static size_t LIVE_WINDOW_SIZE(1000);
+
+static std::string generateLiveDataDump(size_t channelCount) {
+  // The live data of an EMG and an analog device, as sent to the clients
+  std::mt19937 generator(42);
+  std::normal_distribution<double> noise(0.0, 1.0);
+
+  nlohmann::json json;
+  size_t deviceIndex = 0;
+  for (const auto &name :
+       {"DelsysEmgDataCollector", "DelsysAnalogDataCollector"}) {
+    data::TimeSeries timeSeries;
+    std::vector<double> sample(channelCount);
+    for (size_t i = 0; i < LIVE_WINDOW_SIZE; i++) {
+      for (auto &value : sample) {
+        value = noise(generator);
+      }
+      timeSeries.add(std::chrono::microseconds(500 * i), sample);
+    }
+    json[std::to_string(deviceIndex++)] = {{"name", name},
+                                           {"data", timeSeries.serialize()}};
+  }
+  return json.dump();
+}
+
+BENCHMARK(TcpServer, constructMessagePacket) {
+  auto dump = generateLiveDataDump(state.channelCount());
+  state.setBytesPerIteration(dump.size());
+  while (state.keepRunning()) {
+    auto packet = server::constructMessagePacket(
+        server::TcpServerCommand::NONE, server::TcpServerMessage::SENDING_DATA,
+        server::TcpServerDataType::LIVE_DATA, dump);
+    doNotOptimize(packet);
+  }
+}
+
+BENCHMARK(TcpServer, MessagePacket) {
+  // What the server does every time it sends the live data: the dump is
+  // shared by the packets of all the clients instead of copied in each
+  auto dump = std::make_shared<const std::string>(
+      generateLiveDataDump(state.channelCount()));
+  state.setBytesPerIteration(dump->size());
+  while (state.keepRunning()) {
+    auto packet = server::MessagePacket(server::TcpServerCommand::NONE,
+                                        server::TcpServerMessage::SENDING_DATA,
+                                        server::TcpServerDataType::LIVE_DATA,
+                                        dump);
+    doNotOptimize(packet);
+  }
+}
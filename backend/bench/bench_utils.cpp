@@ -0,0 +1,48 @@
+#include "utils.h"
+
+#include <random>
+
+#include "Utils/RollingVector.h"
+
+using namespace NEUROBIO_NAMESPACE;
+
+// The size of the live data window of the data collectors
+static size_t LIVE_WINDOW_SIZE(1000);
+
+static std::vector<double> generateSample(size_t channelCount) {
+  std::mt19937 generator(42);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::vector<double> sample(channelCount);
+  for (auto &value : sample) {
+    value = noise(generator);
+  }
+  return sample;
+}
+
+BENCHMARK(RollingVector, pushBack) {
+  utils::RollingVector<std::vector<double>> vector(LIVE_WINDOW_SIZE);
+  auto sample = generateSample(state.channelCount());
+  state.setItemsPerIteration(1);
+  while (state.keepRunning()) {
+    vector.push_back(sample);
+  }
+  doNotOptimize(vector.back());
+}
+
+BENCHMARK(RollingVector, randomAccess) {
+  // Read the whole window of a vector that has already rolled, as the
+  // readers of the live data do
+  utils::RollingVector<std::vector<double>> vector(LIVE_WINDOW_SIZE);
+  auto sample = generateSample(state.channelCount());
+  for (size_t i = 0; i < LIVE_WINDOW_SIZE + LIVE_WINDOW_SIZE / 2; i++) {
+    vector.push_back(sample);
+  }
+  state.setItemsPerIteration(LIVE_WINDOW_SIZE);
+  while (state.keepRunning()) {
+    double sum = 0;
+    for (size_t i = 0; i < LIVE_WINDOW_SIZE; i++) {
+      sum += vector[i][0];
+    }
+    doNotOptimize(sum);
+  }
+}
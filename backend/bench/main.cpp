@@ -0,0 +1,115 @@
+#include "utils.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <nlohmann/json.hpp>
+
+#include "Utils/Logger.h"
+
+using namespace NEUROBIO_NAMESPACE;
+
+// Usage:
+//   neurobio_benchmarks [--filter=TimeSeries] [--channels=16,144]
+//                       [--minTime=0.5] [--output=results.json]
+//                       [--trial=trial.bin]
+// Run each benchmark whose name contains [filter] once per channel count (the
+// Delsys EMG has 16 channels, the Delsys analog 144), for at least [minTime]
+// seconds each. The results are also written as json to [output], so they can
+// be compared before and after an optimization. The benchmarks of the
+// compression run on the data collectors of the recorded [trial] (a binary
+// trial file) that have as many channels, if any
+
+struct Arguments {
+  std::string filter;
+  std::vector<size_t> channelCounts = {16, 144};
+  double minTime = 0.5;
+  std::string outputPath;
+  std::string trialPath;
+};
+
+Arguments parseArgs(int argc, char *argv[]) {
+  Arguments arguments;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t pos = arg.find("=");
+    std::string key = arg.substr(0, pos);
+    std::string value = pos != std::string::npos ? arg.substr(pos + 1) : "";
+    if (key == "--filter") {
+      arguments.filter = value;
+    } else if (key == "--channels") {
+      arguments.channelCounts.clear();
+      std::stringstream stream(value);
+      std::string count;
+      while (std::getline(stream, count, ',')) {
+        arguments.channelCounts.push_back(std::stoul(count));
+      }
+    } else if (key == "--minTime") {
+      arguments.minTime = std::stod(value);
+    } else if (key == "--output") {
+      arguments.outputPath = value;
+    } else if (key == "--trial") {
+      arguments.trialPath = value;
+    } else {
+      throw std::invalid_argument("Unknown argument: " + arg);
+    }
+  }
+  return arguments;
+}
+
+int main(int argc, char *argv[]) {
+  auto &logger = utils::Logger::getInstance();
+  logger.setLogLevel(utils::Logger::WARNING);
+
+  Arguments arguments;
+  try {
+    arguments = parseArgs(argc, argv);
+  } catch (const std::exception &e) {
+    logger.fatal(e.what());
+    logger.fatal("Usage: neurobio_benchmarks [--filter=NAME] "
+                 "[--channels=16,144] [--minTime=0.5] [--output=results.json] "
+                 "[--trial=trial.bin]");
+    return EXIT_FAILURE;
+  }
+  benchmarkTrialPath() = arguments.trialPath;
+  auto minDuration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(arguments.minTime));
+
+  std::printf("%-40s %8s %12s %14s %14s %10s %7s\n", "Benchmark", "Channels",
+              "Iterations", "ns/iteration", "items/s", "MB/s", "ratio");
+  nlohmann::json results = nlohmann::json::array();
+  for (const auto &benchmark : registeredBenchmarks()) {
+    if (benchmark.name.find(arguments.filter) == std::string::npos) {
+      continue;
+    }
+    for (auto channelCount : arguments.channelCounts) {
+      BenchmarkState state(channelCount, minDuration);
+      benchmark.function(state);
+
+      double nanoseconds = static_cast<double>(state.elapsed().count()) /
+                           static_cast<double>(state.iterationCount());
+      double itemsPerSecond = state.itemsPerIteration() / nanoseconds * 1e9;
+      double megabytesPerSecond =
+          state.bytesPerIteration() / nanoseconds * 1e9 / 1e6;
+      std::printf("%-40s %8zu %12zu %14.1f %14.0f %10.1f %7.2f\n",
+                  benchmark.name.c_str(), channelCount, state.iterationCount(),
+                  nanoseconds, itemsPerSecond, megabytesPerSecond,
+                  state.compressionRatio());
+
+      results.push_back({{"name", benchmark.name},
+                         {"channels", channelCount},
+                         {"iterations", state.iterationCount()},
+                         {"ns_per_iteration", nanoseconds},
+                         {"items_per_second", itemsPerSecond},
+                         {"bytes_per_iteration", state.bytesPerIteration()},
+                         {"compression_ratio", state.compressionRatio()}});
+    }
+  }
+
+  if (!arguments.outputPath.empty()) {
+    std::ofstream file(arguments.outputPath);
+    file << results.dump(2);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+#ifndef __NEUROBIO_UTILS_BENCH_UTILS_H__
+#define __NEUROBIO_UTILS_BENCH_UTILS_H__
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// @brief The state of a running benchmark. The body of a benchmark is a loop
+/// on [keepRunning], which runs the body in batches of doubling size until the
+/// minimum duration is reached, so the clock is only read between batches
+class BenchmarkState {
+public:
+  /// @brief Constructor
+  /// @param channelCount The number of channels the benchmark runs at
+  /// @param minDuration The minimum time to spend in the body of the
+  /// benchmark
+  BenchmarkState(size_t channelCount, std::chrono::nanoseconds minDuration)
+      : m_ChannelCount(channelCount), m_MinDuration(minDuration),
+        m_IterationCount(0), m_BatchSize(1), m_RemainingInBatch(0),
+        m_ItemsPerIteration(0), m_BytesPerIteration(0),
+        m_CompressionRatio(0.0), m_Elapsed(0) {}
+
+  /// @brief The number of channels the benchmark runs at
+  size_t channelCount() const { return m_ChannelCount; }
+
+  /// @brief If the body of the benchmark should run once more
+  /// @return True while the minimum duration is not reached
+  bool keepRunning() {
+    if (m_RemainingInBatch > 0) {
+      m_RemainingInBatch--;
+      m_IterationCount++;
+      return true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (m_IterationCount > 0) {
+      m_Elapsed += now - m_BatchStart;
+      if (m_Elapsed >= m_MinDuration) {
+        return false;
+      }
+      m_BatchSize *= 2;
+    }
+    m_RemainingInBatch = m_BatchSize - 1;
+    m_IterationCount++;
+    m_BatchStart = std::chrono::steady_clock::now();
+    return true;
+  }
+
+  /// @brief Stop the clock, for a setup that is not part of the measurement
+  void pauseTiming() {
+    m_Elapsed += std::chrono::steady_clock::now() - m_BatchStart;
+  }
+
+  /// @brief Restart the clock stopped by [pauseTiming]
+  void resumeTiming() { m_BatchStart = std::chrono::steady_clock::now(); }
+
+  /// @brief Set the number of items (e.g. samples) processed by each run of
+  /// the body, so the throughput is reported
+  /// @param count The number of items
+  void setItemsPerIteration(size_t count) { m_ItemsPerIteration = count; }
+
+  /// @brief Set the number of bytes produced by each run of the body, so the
+  /// bandwidth is reported
+  /// @param count The number of bytes
+  void setBytesPerIteration(size_t count) { m_BytesPerIteration = count; }
+
+  /// @brief Set the ratio of the size of the data to their compressed size,
+  /// for the benchmarks of a compression
+  /// @param ratio The compression ratio
+  void setCompressionRatio(double ratio) { m_CompressionRatio = ratio; }
+
+  /// @brief The number of runs of the body
+  size_t iterationCount() const { return m_IterationCount; }
+
+  /// @brief The time spent in the body of the benchmark
+  std::chrono::nanoseconds elapsed() const { return m_Elapsed; }
+
+  /// @brief The number of items processed by each run of the body
+  size_t itemsPerIteration() const { return m_ItemsPerIteration; }
+
+  /// @brief The number of bytes produced by each run of the body
+  size_t bytesPerIteration() const { return m_BytesPerIteration; }
+
+  /// @brief The compression ratio (0 if the benchmark does not compress)
+  double compressionRatio() const { return m_CompressionRatio; }
+
+protected:
+  size_t m_ChannelCount;
+  std::chrono::nanoseconds m_MinDuration;
+  size_t m_IterationCount;
+  size_t m_BatchSize;
+  size_t m_RemainingInBatch;
+  size_t m_ItemsPerIteration;
+  size_t m_BytesPerIteration;
+  double m_CompressionRatio;
+  std::chrono::nanoseconds m_Elapsed;
+  std::chrono::steady_clock::time_point m_BatchStart;
+};
+
+/// @brief Prevent the compiler from optimizing away the computation of a value
+/// @param value The value to keep
+template <typename T> inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+/// @brief The recorded trial the benchmarks may run on instead of synthetic
+/// data (see the --trial argument), empty if none was given
+inline std::string &benchmarkTrialPath() {
+  static std::string path;
+  return path;
+}
+
+struct RegisteredBenchmark {
+  std::string name;
+  std::function<void(BenchmarkState &)> function;
+};
+
+/// @brief All the benchmarks, in the order they were registered
+inline std::vector<RegisteredBenchmark> &registeredBenchmarks() {
+  static std::vector<RegisteredBenchmark> benchmarks;
+  return benchmarks;
+}
+
+inline bool registerBenchmark(const std::string &name,
+                              std::function<void(BenchmarkState &)> function) {
+  registeredBenchmarks().push_back({name, std::move(function)});
+  return true;
+}
+
+/// @brief Declare a benchmark, in the same fashion as the TEST of gtest. Each
+/// benchmark is run once per channel count
+#define BENCHMARK(group, name)                                                 \
+  static void group##_##name(BenchmarkState &state);                           \
+  static bool group##_##name##_isRegistered =                                  \
+      registerBenchmark(#group "." #name, group##_##name);                     \
+  static void group##_##name(BenchmarkState &state)
+
+#endif // __NEUROBIO_UTILS_BENCH_UTILS_H__
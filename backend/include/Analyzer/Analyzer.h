@@ -39,6 +39,11 @@ protected:
   DECLARE_PROTECTED_MEMBER(std::chrono::system_clock::time_point,
                            ReferenceTime);
 
+  /// @brief The configuration of the time alignment (see [data::TimeAligner])
+  /// to apply to the data before they are sent to [predict]. If it is null,
+  /// the analyzer receives the data as collected by the devices
+  DECLARE_PROTECTED_MEMBER(nlohmann::json, AlignmentConfiguration);
+
 public:
   /// @brief Set the reference time
   /// @param time The reference time
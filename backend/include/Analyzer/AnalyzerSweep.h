@@ -0,0 +1,112 @@
+#ifndef __NEUROBIO_ANALYZER_ANALYZER_SWEEP_H__
+#define __NEUROBIO_ANALYZER_ANALYZER_SWEEP_H__
+
+#include "neurobioConfig.h"
+
+#include "Analyzer/BatchAnalysis.h"
+
+namespace NEUROBIO_NAMESPACE::analyzer {
+
+/// @brief The outcome of one configuration of a sweep
+struct SweepEntry {
+  /// @brief The name given to the configuration
+  std::string name;
+
+  /// @brief The swept parameters of the configuration, by json pointer
+  nlohmann::json parameters;
+
+  /// @brief The number of new predictions made over the trial
+  size_t predictionCount = 0;
+
+  /// @brief The number of these predictions that started a new phase
+  size_t phaseChangeCount = 0;
+
+  /// @brief The number of frames for which the analyzer of the configuration
+  /// failed
+  size_t failedFrameCount = 0;
+
+  /// @brief The timestamp of the last prediction, relative to the starting
+  /// time of the trial
+  std::chrono::microseconds lastPredictionTime{0};
+
+  /// @brief Serialize the entry
+  /// @return The entry in a json format
+  nlohmann::json serialize() const;
+};
+
+/// @brief The result of a sweep over a trial
+struct SweepResult {
+  /// @brief The statistics of the trial. The failed frames are counted once
+  /// per configuration that failed on them, and the prediction streams are
+  /// only filled if the sweep is asked to keep them
+  TrialAnalysis analysis;
+
+  /// @brief The outcome of each configuration, in the order of the sweep
+  std::vector<SweepEntry> entries;
+
+  /// @brief Serialize the result
+  /// @return The result in a json format
+  nlohmann::json serialize() const;
+};
+
+/// @brief Run many variations of an analyzer configuration over the same
+/// trial. The trial is replayed once, whatever the number of configurations:
+/// each frame cut from the trial is fed to all the configurations, split in
+/// one group per thread. Each configuration has its own analyzers, so one that
+/// fails on a frame does not fail the others
+class AnalyzerSweep : public BatchAnalysis {
+public:
+  /// @brief Constructor
+  /// @param baseConfiguration The configuration of the analyzer (as for
+  /// ADD_ANALYZER) the variations are made from
+  /// @param parameters The values to sweep, by json pointer in the base
+  /// configuration (e.g. {"/learning_rate": [0.1, 0.5]}). All the combinations
+  /// of the values are swept
+  /// @param framePeriod The time between two frames
+  /// @param historySize The number of samples before the new ones of a frame
+  /// that are also given to the analyzers
+  /// @param threadCount The number of worker threads running the groups of
+  /// configurations
+  AnalyzerSweep(const nlohmann::json &baseConfiguration,
+                const nlohmann::json &parameters,
+                const std::chrono::microseconds &framePeriod =
+                    std::chrono::microseconds(25000),
+                size_t historySize = 1,
+                size_t threadCount = utils::ThreadPool::defaultThreadCount());
+
+  /// @brief Run all the configurations over a trial. This does not throw, the
+  /// failures are reported in the [error] of the analysis
+  /// @param name The name of the trial
+  /// @param trial The data of each device, by device name
+  /// @param keepPredictions If the prediction streams of each configuration
+  /// must be kept in the analysis (this can take a lot of memory)
+  /// @return The result of the sweep
+  SweepResult sweep(const std::string &name,
+                    const std::map<std::string, data::TimeSeries> &trial,
+                    bool keepPredictions = false);
+
+  /// @brief Get all the combinations of the values of swept parameters
+  /// @param parameters The values to sweep, by json pointer
+  /// @return The combinations, each one being a json object of a value by json
+  /// pointer. The parameters vary in the alphabetical order of their pointers,
+  /// the first one varying the slowest
+  static std::vector<nlohmann::json>
+  combineParameters(const nlohmann::json &parameters);
+
+  /// @brief Get the configurations of a sweep
+  /// @param baseConfiguration The configuration the variations are made from
+  /// @param parameterSets The combinations of parameters (see
+  /// [combineParameters])
+  /// @return The configurations, named after the base one and their index
+  static nlohmann::json
+  makeConfigurations(const nlohmann::json &baseConfiguration,
+                     const std::vector<nlohmann::json> &parameterSets);
+
+protected:
+  /// @brief The combination of parameters of each configuration
+  DECLARE_PROTECTED_MEMBER(std::vector<nlohmann::json>, ParameterSets);
+};
+
+} // namespace NEUROBIO_NAMESPACE::analyzer
+
+#endif // __NEUROBIO_ANALYZER_ANALYZER_SWEEP_H__
@@ -4,6 +4,10 @@
 #include "neurobioConfig.h"
 
 #include "Analyzer/Predictions.h"
+#include "Data/TimeAligner.h"
+#include "Utils/Metrics.h"
+#include "Utils/ThreadPool.h"
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
 
@@ -17,17 +21,30 @@ class Analyzer;
 class Analyzers {
 public:
   /// @brief Constructor of the Analyzers
-  Analyzers() = default;
+  /// @param threadCount The number of worker threads used to run the
+  /// analyzers in parallel (0 runs them serially on the calling thread)
+  Analyzers(size_t threadCount = utils::ThreadPool::defaultThreadCount());
 
   /// @brief Destructor of the Analyzers
   ~Analyzers() = default;
 
 public:
-  /// @brief Predict using all the analyzers
+  /// @brief Predict using all the analyzers. The analyzers that share the same
+  /// alignment configuration share the same aligned data, which are updated
+  /// only once per call. The analyzers are independent, so they are run in
+  /// parallel, each one writing in its own slot. The slots are then merged in
+  /// the order of the analyzer ids, so the results are the same as if the
+  /// analyzers were run one after the other
   /// @param data The data to predict
   /// @return The predictions
   Predictions predict(const std::map<std::string, data::TimeSeries> &data);
 
+  /// @brief Set the time the predictions are relative to, for all the current
+  /// analyzers and the ones added later. By default, this is the time the
+  /// collection was created
+  /// @param time The reference time
+  void setReferenceTime(const std::chrono::system_clock::time_point &time);
+
   /// @brief Get an analyzer id from its name
   /// @param analyzerName The name of the analyzer
   /// @return The id of the analyzer
@@ -45,11 +62,13 @@ public:
   /// removed later
   size_t add(const nlohmann::json &json);
 
-  /// @brief Remove the analyzer from the collection
+  /// @brief Remove the analyzer from the collection. Raises an
+  /// std::invalid_argument if there is no such analyzer
   /// @param analyzerName The name of the analyzer to remove
   void remove(const std::string &analyzerName);
 
-  /// @brief Remove the analyzer from the collection
+  /// @brief Remove the analyzer from the collection. Raises an
+  /// std::out_of_range if there is no such analyzer
   /// @param analyzerId The id of the analyzer (the one returned by the add
   /// method)
   void remove(size_t analyzerId);
@@ -81,10 +100,41 @@ public:
   /// @return The configuration in a json format
   nlohmann::json getSerializedConfigurations() const;
 
+  /// @brief Get the configuration of each analyzer in a json format, by name
+  /// of analyzer
+  /// @return The configurations in a json format
+  nlohmann::json getSerializedConfigurationsByName() const;
+
 protected:
   /// @brief The collection of analyzers
   std::map<size_t, std::shared_ptr<Analyzer>> m_Analyzers;
 
+  /// @brief The id of the next analyzer added. Each collection numbers its
+  /// own analyzers, so they can be filled from different threads
+  size_t m_NextId;
+
+  /// @brief The time aligners required by the analyzers, indexed by their
+  /// serialized configuration
+  std::map<std::string, std::unique_ptr<data::TimeAligner>> m_TimeAligners;
+
+  /// @brief Remove the time aligners that are not required by any analyzer
+  /// anymore. This must be called with [m_MutexAnalyzers] locked
+  void removeUnusedTimeAligners();
+
+  /// @brief Remove an analyzer, its last prediction and the time aligners it
+  /// was the last to require. This must be called with [m_MutexAnalyzers]
+  /// locked
+  /// @param analyzer The analyzer in [m_Analyzers]
+  void remove(std::map<size_t, std::shared_ptr<Analyzer>>::iterator analyzer);
+
+  /// @brief The worker threads running the analyzers
+  utils::ThreadPool m_ThreadPool;
+
+  /// @brief The duration of [predict] and of each analyzer predicting (see
+  /// [utils::Metrics])
+  std::shared_ptr<utils::Histogram> m_PredictDurationMetric;
+  std::shared_ptr<utils::Histogram> m_AnalyzerPredictDurationMetric;
+
   /// @brief The predictions made by the analyzers
   Predictions m_LastPredictions;
   Predictions getLastPredictions() const { return m_LastPredictions; }
@@ -92,6 +142,10 @@ protected:
 private:
   /// @brief The mutex to lock certain operations
   DECLARE_PRIVATE_MEMBER_NOGET(std::shared_mutex, MutexAnalyzers);
+
+  /// @brief The mutex to make one prediction at a time. It is taken before
+  /// [MutexAnalyzers]
+  DECLARE_PRIVATE_MEMBER_NOGET(std::mutex, MutexPredict);
 };
 
 } // namespace NEUROBIO_NAMESPACE::analyzer
@@ -0,0 +1,146 @@
+#ifndef __NEUROBIO_ANALYZER_BATCH_ANALYSIS_H__
+#define __NEUROBIO_ANALYZER_BATCH_ANALYSIS_H__
+
+#include "neurobioConfig.h"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "Data/DataPoint.h"
+#include "Data/TimeSeries.h"
+#include "Utils/CppMacros.h"
+#include "Utils/ThreadPool.h"
+
+namespace NEUROBIO_NAMESPACE::analyzer {
+class Analyzers;
+
+/// @brief The result of the analysis of a recorded trial
+struct TrialAnalysis {
+  /// @brief The name of the trial
+  std::string name;
+
+  /// @brief The time the timestamps of the predictions are relative to (the
+  /// earliest starting time of the devices of the trial)
+  std::chrono::system_clock::time_point startingTime;
+
+  /// @brief The stream of predictions of each analyzer, by analyzer name. A
+  /// prediction is only added when the analyzer made a new one
+  std::map<std::string, std::vector<data::DataPoint>> predictions;
+
+  /// @brief The number of frames fed to the analyzers
+  size_t frameCount = 0;
+
+  /// @brief The number of frames for which the analyzers failed (e.g. not
+  /// enough data yet). The live server skips these frames too
+  size_t failedFrameCount = 0;
+
+  /// @brief The number of samples fed to the analyzers, all devices included
+  size_t sampleCount = 0;
+
+  /// @brief The duration of the trial
+  std::chrono::microseconds trialDuration{0};
+
+  /// @brief The time it took to analyze the trial
+  std::chrono::microseconds processingTime{0};
+
+  /// @brief The reason the trial could not be analyzed, or the first failure
+  /// of a frame. Empty if everything went fine
+  std::string error;
+
+  /// @brief Serialize the analysis
+  /// @return The analysis in a json format
+  nlohmann::json serialize() const;
+};
+
+/// @brief Run analyzers over recorded trials as fast as possible. Each trial
+/// is cut in frames, as the live server would do, and each frame is fed to a
+/// fresh set of analyzers created from the same configurations. The trials are
+/// independent and are therefore analyzed in parallel
+class BatchAnalysis {
+public:
+  /// @brief Constructor
+  /// @param analyzerConfigurations The configuration of an analyzer (as for
+  /// ADD_ANALYZER) or an array of them
+  /// @param framePeriod The time between two frames. The default is the period
+  /// of the live analyses of the server
+  /// @param historySize The number of samples before the new ones of a frame
+  /// that are also given to the analyzers
+  /// @param threadCount The number of worker threads analyzing the trials
+  BatchAnalysis(const nlohmann::json &analyzerConfigurations,
+                const std::chrono::microseconds &framePeriod =
+                    std::chrono::microseconds(25000),
+                size_t historySize = 1,
+                size_t threadCount = utils::ThreadPool::defaultThreadCount());
+
+  /// @brief Analyze a trial. This does not throw, the failures are reported
+  /// in the [error] of the analysis
+  /// @param name The name of the trial
+  /// @param trial The data of each device, by device name
+  /// @return The analysis of the trial
+  TrialAnalysis
+  analyze(const std::string &name,
+          const std::map<std::string, data::TimeSeries> &trial) const;
+
+  /// @brief Analyze several trials in parallel
+  /// @param trials The trials, by name
+  /// @return The analysis of each trial, in the order of their names
+  std::vector<TrialAnalysis>
+  analyze(const std::map<std::string, std::map<std::string, data::TimeSeries>>
+              &trials);
+
+protected:
+  /// @brief Cut a trial in frames, as the live server would do. The
+  /// statistics of the replay are added to [result], while the failures of
+  /// the trial itself throw
+  /// @param trial The data of each device, by device name
+  /// @param result The analysis to fill
+  /// @param onFrame Called with each frame, in order. The frame is cut once,
+  /// whatever the number of analyzers it is fed to
+  void replay(const std::map<std::string, data::TimeSeries> &trial,
+              TrialAnalysis &result,
+              const std::function<
+                  void(const std::map<std::string, data::TimeSeries> &)>
+                  &onFrame) const;
+
+  /// @brief Feed a frame to analyzers and report their new predictions. This
+  /// throws if any of the analyzers fails on the frame
+  /// @param analyzers The analyzers to feed
+  /// @param frame The data of each device, by device name
+  /// @param lastTimeStamps The timestamp of the last prediction of each
+  /// analyzer, by id, so only the new ones are reported
+  /// @param onPrediction Called with the id of the analyzer (as returned by
+  /// [Analyzers::add]) each time it makes a new prediction
+  static void
+  predict(Analyzers &analyzers,
+          const std::map<std::string, data::TimeSeries> &frame,
+          std::map<size_t, std::chrono::microseconds> &lastTimeStamps,
+          const std::function<void(size_t, const data::DataPoint &)>
+              &onPrediction);
+
+  /// @brief Get the time the predictions of a trial are relative to
+  /// @param trial The data of each device, by device name
+  /// @return The earliest starting time of the devices of the trial
+  static std::chrono::system_clock::time_point
+  getStartingTime(const std::map<std::string, data::TimeSeries> &trial);
+
+  /// @brief The configurations of the analyzers (always an array)
+  DECLARE_PROTECTED_MEMBER(nlohmann::json, AnalyzerConfigurations);
+
+  /// @brief The time between two frames
+  DECLARE_PROTECTED_MEMBER(std::chrono::microseconds, FramePeriod);
+
+  /// @brief The number of samples before the new ones of a frame that are
+  /// also given to the analyzers
+  DECLARE_PROTECTED_MEMBER(size_t, HistorySize);
+
+  /// @brief The worker threads analyzing the trials
+  DECLARE_PROTECTED_MEMBER_NOGET(utils::ThreadPool, ThreadPool);
+};
+
+} // namespace NEUROBIO_NAMESPACE::analyzer
+
+#endif // __NEUROBIO_ANALYZER_BATCH_ANALYSIS_H__
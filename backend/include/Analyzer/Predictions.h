@@ -64,11 +64,16 @@ public:
 protected:
 protected:
   /// @brief The timestamp of the starting point.
-  DECLARE_PROTECTED_MEMBER(std::chrono::system_clock::time_point, StartingTime);
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(std::chrono::system_clock::time_point,
+                                       StartingTime);
 
   /// @brief The predictions made by the analyzers
   std::map<std::string, data::DataPoint> m_Predictions;
-  std::map<std::string, data::DataPoint> getPredictions() const {
+
+public:
+  /// @brief Get all the predictions, by name
+  /// @return The predictions
+  const std::map<std::string, data::DataPoint> &getPredictions() const {
     return m_Predictions;
   }
 };
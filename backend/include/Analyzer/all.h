@@ -2,7 +2,9 @@
 #define __NEUROBIO_ANALYZER_ALL_H__
 
 #include "Analyzer/Analyzer.h"
+#include "Analyzer/AnalyzerSweep.h"
 #include "Analyzer/Analyzers.h"
+#include "Analyzer/BatchAnalysis.h"
 #include "Analyzer/CyclicTimedEventsAnalyzer.h"
 #include "Analyzer/EventConditions.h"
 #include "Analyzer/TimedEventsAnalyzer.h"
@@ -0,0 +1,124 @@
+#ifndef __NEUROBIO_DATA_CLOCK_MODEL_H__
+#define __NEUROBIO_DATA_CLOCK_MODEL_H__
+
+#include "neurobioConfig.h"
+
+#include <chrono>
+#include <optional>
+
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::data {
+
+/// @brief Model of a device clock, mapping the sample counter of a device to
+/// the host time. The mapping is a line (offset + period * counter) which is
+/// estimated online by an exponentially weighted least squares regression on
+/// the arrival times of the samples. This removes the host jitter (thread
+/// scheduling, TCP buffering) from the timestamps while following the drift
+/// between the device and the host clocks
+class ClockModel {
+public:
+  /// @brief Constructor of a disabled clock model (no nominal period)
+  ClockModel();
+
+  /// @brief Constructor
+  /// @param nominalPeriod The period between two samples announced by the
+  /// device. This is used as a prior until enough samples are observed
+  /// @param forgettingFactor The weight kept by the previous observations each
+  /// time a new one is added. The closer to 1, the longer the memory
+  ClockModel(const std::chrono::microseconds &nominalPeriod,
+             double forgettingFactor = 0.999);
+
+  /// @brief If the model has a nominal period and can therefore be used
+  /// @return True if the model can be used, false otherwise
+  bool isEnabled() const;
+
+  /// @brief Forget all the observations
+  void reset();
+
+  /// @brief Add an observation to the model
+  /// @param sampleIndex The counter of the sample that was received
+  /// @param arrivalTime The host time at which the sample was received
+  void observe(size_t sampleIndex,
+               const std::chrono::high_resolution_clock::time_point
+                   &arrivalTime);
+
+  /// @brief Get the reconstructed host time of a sample. The model must have
+  /// observed at least one sample
+  /// @param sampleIndex The counter of the sample
+  /// @return The reconstructed host time of the sample
+  std::chrono::high_resolution_clock::time_point
+  timeOf(size_t sampleIndex) const;
+
+  /// @brief Get the timestamp of a newly received sample. Contrary to
+  /// [timeOf], the corrections of the model are spread over the following
+  /// samples (by at most 5% of the period for each sample), so consecutive
+  /// timestamps stay on a regular grid and never go backward
+  /// @param sampleIndex The counter of the sample
+  /// @return The timestamp of the sample
+  std::chrono::high_resolution_clock::time_point stamp(size_t sampleIndex);
+
+  /// @brief Get the estimated skew of the device clock relative to the host
+  /// clock. A positive value means the device samples slower than announced
+  /// @return The skew in parts per million
+  double getSkew() const;
+
+protected:
+  /// @brief The period between two samples announced by the device
+  DECLARE_PROTECTED_MEMBER(std::chrono::microseconds, NominalPeriod);
+
+  /// @brief The weight kept by the previous observations
+  DECLARE_PROTECTED_MEMBER(double, ForgettingFactor);
+
+  /// @brief The number of observations since the last reset
+  DECLARE_PROTECTED_MEMBER(size_t, ObservationCount);
+
+  /// @brief The period between two samples as estimated by the model (in
+  /// microseconds)
+  DECLARE_PROTECTED_MEMBER(double, EstimatedPeriod);
+
+protected:
+  /// @brief The sample index of the first observation, used as origin of the
+  /// regression to preserve the precision
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, FirstIndex);
+
+  /// @brief The arrival time of the first observation, used as origin of the
+  /// regression to preserve the precision
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::high_resolution_clock::time_point,
+                                 FirstArrivalTime);
+
+  /// @brief The sum of the weights of the observations
+  DECLARE_PROTECTED_MEMBER_NOGET(double, WeightSum);
+
+  /// @brief The weighted mean of the sample indices (relative to [FirstIndex])
+  DECLARE_PROTECTED_MEMBER_NOGET(double, MeanIndex);
+
+  /// @brief The weighted mean of the arrival times in microseconds (relative
+  /// to [FirstArrivalTime])
+  DECLARE_PROTECTED_MEMBER_NOGET(double, MeanTime);
+
+  /// @brief The weighted sum of squared deviations of the sample indices
+  DECLARE_PROTECTED_MEMBER_NOGET(double, IndexVariance);
+
+  /// @brief The weighted sum of the cross deviations of indices and times
+  DECLARE_PROTECTED_MEMBER_NOGET(double, Covariance);
+
+  /// @brief The counter of the last sample that was stamped
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, LastStampedIndex);
+
+  /// @brief The timestamp given to the last sample that was stamped. This is
+  /// not set if no sample was stamped since the last reset
+  DECLARE_PROTECTED_MEMBER_NOGET(
+      std::optional<std::chrono::high_resolution_clock::time_point>,
+      LastStamp);
+
+  /// @brief Compute the time of a sample relative to [FirstArrivalTime] using
+  /// the current estimation
+  /// @param sampleIndex The counter of the sample
+  /// @return The time in microseconds
+  double predict(size_t sampleIndex) const;
+};
+
+} // namespace NEUROBIO_NAMESPACE::data
+
+#endif // __NEUROBIO_DATA_CLOCK_MODEL_H__
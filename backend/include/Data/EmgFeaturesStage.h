@@ -0,0 +1,92 @@
+#ifndef __NEUROBIO_DATA_EMG_FEATURES_STAGE_H__
+#define __NEUROBIO_DATA_EMG_FEATURES_STAGE_H__
+
+#include "neurobioConfig.h"
+
+#include "Data/ProcessingStage.h"
+
+namespace NEUROBIO_NAMESPACE::data {
+
+/// @brief The features computed by the [EmgFeaturesStage]
+enum class EmgFeature : size_t {
+  /// @brief Root mean square
+  RMS = 0,
+  /// @brief Mean absolute value
+  MAV = 1,
+  /// @brief Waveform length (sum of the absolute differences)
+  WL = 2,
+  /// @brief Number of zero crossings
+  ZC = 3,
+  /// @brief Number of slope sign changes
+  SSC = 4,
+  /// @brief The number of features
+  COUNT = 5
+};
+
+/// @brief Processing stage that computes the classic EMG features of each
+/// channel on a sliding window. The features are updated incrementally (the
+/// contribution of the new sample is added and the one of the sample leaving
+/// the window is removed), so the cost is constant per sample whatever the
+/// window size. The stage does not modify the samples. Its output holds all
+/// the features of all the channels, grouped by feature (see [outputIndex])
+class EmgFeaturesStage : public ProcessingStage {
+public:
+  /// @brief Constructor
+  /// @param channelCount The number of channels of the samples
+  /// @param windowSize The number of samples in the sliding window
+  /// @param decimation A new output is produced every [decimation] samples
+  /// @param threshold The minimal amplitude to count a zero crossing or a slope
+  /// sign change (to reject the noise)
+  EmgFeaturesStage(size_t channelCount, size_t windowSize = 200,
+                   size_t decimation = 50, double threshold = 0.0);
+
+  bool process(std::vector<double> &sample) override;
+
+  void reset() override;
+
+  /// @brief Get the index of a feature of a channel in [Output]
+  /// @param feature The feature
+  /// @param channel The channel
+  /// @return The index in [Output]
+  size_t outputIndex(EmgFeature feature, size_t channel) const;
+
+protected:
+  /// @brief The number of samples in the sliding window
+  DECLARE_PROTECTED_MEMBER(size_t, WindowSize);
+
+  /// @brief A new output is produced every [Decimation] samples
+  DECLARE_PROTECTED_MEMBER(size_t, Decimation);
+
+  /// @brief The minimal amplitude to count a zero crossing or a slope sign
+  /// change
+  DECLARE_PROTECTED_MEMBER(double, Threshold);
+
+  /// @brief The number of samples processed since the last reset
+  DECLARE_PROTECTED_MEMBER(size_t, SampleCount);
+
+protected:
+  /// @brief The contribution of each sample of the window to each feature.
+  /// This is a ring of [WindowSize] slots, each slot being laid out as
+  /// [Output] so the same loop updates all the features of all the channels
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, Contributions);
+
+  /// @brief The contribution of the sample being processed
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, CurrentContribution);
+
+  /// @brief The sum of the contributions of the window
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, Sums);
+
+  /// @brief The previous sample
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, Previous);
+
+  /// @brief The sample before the previous one
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, BeforePrevious);
+
+  /// @brief Recompute [Sums] from [Contributions] so the rounding errors of
+  /// the incremental updates do not accumulate
+  void recomputeSums();
+};
+
+} // namespace NEUROBIO_NAMESPACE::data
+
+#endif // __NEUROBIO_DATA_EMG_FEATURES_STAGE_H__
@@ -0,0 +1,123 @@
+#ifndef __NEUROBIO_DATA_FILTER_BANK_STAGE_H__
+#define __NEUROBIO_DATA_FILTER_BANK_STAGE_H__
+
+#include "neurobioConfig.h"
+
+#include <nlohmann/json.hpp>
+
+#include "Data/ProcessingStage.h"
+
+namespace NEUROBIO_NAMESPACE::data {
+
+/// @brief The coefficients of a second order IIR filter (biquad), normalized
+/// so the first denominator coefficient is 1. The designs follow the "Audio EQ
+/// cookbook" (bilinear transform with frequency prewarping)
+struct Biquad {
+  double b0;
+  double b1;
+  double b2;
+  double a1;
+  double a2;
+
+  /// @brief Design a low-pass filter
+  /// @param cutoff The cutoff frequency (in Hz)
+  /// @param samplingFrequency The sampling frequency (in Hz)
+  /// @param q The quality factor (the default gives a Butterworth response)
+  /// @return The coefficients of the filter
+  static Biquad lowPass(double cutoff, double samplingFrequency,
+                        double q = 0.7071067811865476);
+
+  /// @brief Design a high-pass filter
+  /// @param cutoff The cutoff frequency (in Hz)
+  /// @param samplingFrequency The sampling frequency (in Hz)
+  /// @param q The quality factor (the default gives a Butterworth response)
+  /// @return The coefficients of the filter
+  static Biquad highPass(double cutoff, double samplingFrequency,
+                         double q = 0.7071067811865476);
+
+  /// @brief Design a notch filter
+  /// @param frequency The rejected frequency (in Hz)
+  /// @param samplingFrequency The sampling frequency (in Hz)
+  /// @param q The quality factor (the higher, the narrower the notch)
+  /// @return The coefficients of the filter
+  static Biquad notch(double frequency, double samplingFrequency,
+                      double q = 30.0);
+};
+
+/// @brief Processing stage that runs a chain of cascaded biquads (and
+/// rectifications) on all the channels of the samples. The filters either
+/// replace the samples (e.g. to remove the noise before storing the data) or
+/// leave them untouched and publish the result as the output of the stage
+/// (e.g. the envelope of an EMG). The states of the filters are stored
+/// channel by channel, so the channels are independent lanes of the same
+/// computation that the compiler vectorizes
+class FilterBankStage : public ProcessingStage {
+public:
+  /// @brief Constructor of an empty chain (see [addFilter] and
+  /// [addRectification])
+  /// @param name The name of the stage
+  /// @param channelCount The number of channels of the samples
+  /// @param isInPlace If the filtered samples replace the collected ones. If
+  /// false, they are published as the output of the stage instead
+  /// @param decimation If not in place, a new output is produced every
+  /// [decimation] samples
+  FilterBankStage(const std::string &name, size_t channelCount,
+                  bool isInPlace = true, size_t decimation = 1);
+
+  /// @brief Constructor from a json object. The expected keys are "name",
+  /// "sampling_frequency" (in Hz), "steps" (see below), and optionally
+  /// "in_place" (defaults to true) and "decimation" (defaults to 1). Each step
+  /// has a "type" which is one of "low_pass" or "high_pass" ("frequency" and
+  /// optionally "q"), "band_pass" ("low" and "high" frequencies), "notch"
+  /// ("frequency" and optionally "q") or "rectify"
+  /// @param channelCount The number of channels of the samples
+  /// @param json The json object to create the stage from
+  FilterBankStage(size_t channelCount, const nlohmann::json &json);
+
+  /// @brief Append a filter to the chain
+  /// @param filter The coefficients of the filter
+  void addFilter(const Biquad &filter);
+
+  /// @brief Append a full-wave rectification (absolute value) to the chain
+  void addRectification();
+
+  bool process(std::vector<double> &sample) override;
+
+  void reset() override;
+
+protected:
+  /// @brief If the filtered samples replace the collected ones
+  DECLARE_PROTECTED_MEMBER(bool, IsInPlace);
+
+  /// @brief If not in place, a new output is produced every [Decimation]
+  /// samples
+  DECLARE_PROTECTED_MEMBER(size_t, Decimation);
+
+  /// @brief The number of samples processed since the last reset
+  DECLARE_PROTECTED_MEMBER(size_t, SampleCount);
+
+protected:
+  /// @brief A step of the chain. A step without filter is a rectification
+  struct Step {
+    bool isRectification;
+    Biquad filter;
+  };
+
+  /// @brief The steps of the chain, in order
+  std::vector<Step> m_Steps;
+
+  /// @brief The first state of the transposed direct form II of each step,
+  /// [ChannelCount] contiguous values per step
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, FirstStates);
+
+  /// @brief The second state of the transposed direct form II of each step,
+  /// [ChannelCount] contiguous values per step
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, SecondStates);
+
+  /// @brief The values being filtered when the stage is not in place
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, Buffer);
+};
+
+} // namespace NEUROBIO_NAMESPACE::data
+
+#endif // __NEUROBIO_DATA_FILTER_BANK_STAGE_H__
@@ -0,0 +1,53 @@
+#ifndef __NEUROBIO_DATA_PROCESSING_STAGE_H__
+#define __NEUROBIO_DATA_PROCESSING_STAGE_H__
+
+#include "neurobioConfig.h"
+
+#include <string>
+#include <vector>
+
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::data {
+
+/// @brief Abstract class for a processing stage run on each sample when it is
+/// collected. A stage can transform the sample in place (e.g. filtering), so
+/// the following stages and the time series receive the transformed data,
+/// and/or it can produce an output (e.g. features) that is published as a
+/// derived time series
+class ProcessingStage {
+public:
+  /// @brief Constructor
+  /// @param name The name of the stage. This is used to name the derived time
+  /// series
+  /// @param channelCount The number of channels of the samples
+  ProcessingStage(const std::string &name, size_t channelCount)
+      : m_Name(name), m_ChannelCount(channelCount) {}
+
+  /// @brief Destructor
+  virtual ~ProcessingStage() = default;
+
+  /// @brief Process a new sample
+  /// @param sample The sample to process. It can be modified in place
+  /// @return True if a new [Output] is available, false otherwise
+  virtual bool process(std::vector<double> &sample) = 0;
+
+  /// @brief Forget all the previous samples. This is called each time the
+  /// data collector starts streaming
+  virtual void reset() = 0;
+
+protected:
+  /// @brief The name of the stage
+  DECLARE_PROTECTED_MEMBER(std::string, Name);
+
+  /// @brief The number of channels of the samples
+  DECLARE_PROTECTED_MEMBER(size_t, ChannelCount);
+
+  /// @brief The last output of the stage. This is empty if the stage does not
+  /// produce any output
+  DECLARE_PROTECTED_MEMBER(std::vector<double>, Output);
+};
+
+} // namespace NEUROBIO_NAMESPACE::data
+
+#endif // __NEUROBIO_DATA_PROCESSING_STAGE_H__
@@ -0,0 +1,121 @@
+#ifndef __NEUROBIO_DATA_TIME_ALIGNER_H__
+#define __NEUROBIO_DATA_TIME_ALIGNER_H__
+
+#include "neurobioConfig.h"
+
+#include <deque>
+#include <limits>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "Data/TimeSeries.h"
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::data {
+
+/// @brief Resample the data of several devices on a common time base, so all
+/// the devices have a value at the exact same instants. The resampling is
+/// incremental: each call to [update] only processes the samples that arrived
+/// since the previous call and appends the new aligned frames
+class TimeAligner {
+public:
+  /// @brief The interpolation used to compute the value of a device between
+  /// two of its samples
+  enum class Interpolation {
+    /// @brief Linear interpolation between the surrounding samples
+    LINEAR,
+    /// @brief Value of the last sample at or before the instant
+    ZERO_ORDER_HOLD
+  };
+
+public:
+  /// @brief Constructor
+  /// @param period The time between two aligned frames
+  /// @param interpolation The interpolation to use
+  /// @param maxSize The number of aligned frames to keep for each device
+  TimeAligner(const std::chrono::microseconds &period,
+              Interpolation interpolation = Interpolation::LINEAR,
+              size_t maxSize = 1000);
+
+  /// @brief Constructor from a json object. The expected keys are "frequency"
+  /// (in Hz) and optionally "interpolation" ("linear" or "zero_order_hold")
+  /// @param json The json object to create the aligner from
+  TimeAligner(const nlohmann::json &json);
+
+  /// @brief Get the configuration of the aligner in a json format
+  /// @return The configuration of the aligner in a json format
+  nlohmann::json getSerializedConfiguration() const;
+
+  /// @brief Add the new samples of the devices and compute all the aligned
+  /// frames up to the most recent instant covered by all of the devices. The
+  /// samples that were already processed by a previous call are ignored
+  /// @param data The data of the devices
+  /// @return The number of new aligned frames
+  size_t update(const std::map<std::string, TimeSeries> &data);
+
+  /// @brief Forget all the samples and aligned frames
+  void reset();
+
+protected:
+  /// @brief The time between two aligned frames
+  DECLARE_PROTECTED_MEMBER(std::chrono::microseconds, Period);
+
+  /// @brief The interpolation to use
+  DECLARE_PROTECTED_MEMBER(Interpolation, Interpolation);
+
+  /// @brief The number of aligned frames to keep for each device
+  DECLARE_PROTECTED_MEMBER(size_t, MaxSize);
+
+  /// @brief The number of aligned frames computed since the last reset. The
+  /// next frame is at [StartingTime] + [AlignedCount] * [Period]
+  DECLARE_PROTECTED_MEMBER(size_t, AlignedCount);
+
+public:
+  /// @brief Get the aligned data of each device. All the time series share the
+  /// same starting time (the first instant covered by all the devices) and
+  /// the same timestamps
+  /// @return The aligned data
+  const std::map<std::string, TimeSeries> &getAlignedData() const {
+    return m_AlignedData;
+  }
+
+protected:
+  /// @brief The aligned data of each device
+  std::map<std::string, TimeSeries> m_AlignedData;
+
+protected:
+  /// @brief The samples of a device that are still needed for the next
+  /// aligned frames, with their absolute time (in ticks of the system clock
+  /// since epoch)
+  struct PendingSamples {
+    std::deque<std::pair<int64_t, std::vector<double>>> samples;
+    int64_t lastTime = std::numeric_limits<int64_t>::min();
+  };
+
+  /// @brief The pending samples of each device
+  std::map<std::string, PendingSamples> m_PendingSamples;
+
+  /// @brief The absolute time of the first aligned frame (in ticks of the
+  /// system clock since epoch)
+  DECLARE_PROTECTED_MEMBER_NOGET(int64_t, StartingTime);
+
+  /// @brief Append the samples of [data] that are newer than what was already
+  /// processed to [pending]
+  /// @param data The time series of the device
+  /// @param pending The pending samples of the device
+  void appendNewSamples(const TimeSeries &data, PendingSamples &pending) const;
+
+  /// @brief Compute the value of a device at a given instant. The samples
+  /// before the instant that are not needed anymore are discarded
+  /// @param time The absolute time of the instant (in ticks of the system clock
+  /// since epoch)
+  /// @param pending The pending samples of the device
+  /// @return The value of the device at [time]
+  std::vector<double> valueAt(int64_t time, PendingSamples &pending) const;
+};
+
+} // namespace NEUROBIO_NAMESPACE::data
+
+#endif // __NEUROBIO_DATA_TIME_ALIGNER_H__
@@ -11,10 +11,15 @@
 #include <nlohmann/json.hpp>
 #include <vector>
 
+namespace NEUROBIO_NAMESPACE::devices {
+class DataCollector;
+} // namespace NEUROBIO_NAMESPACE::devices
+
 namespace NEUROBIO_NAMESPACE::data {
 
 /// @brief Class to store data
 class TimeSeries {
+  friend devices::DataCollector;
 
 public:
   TimeSeries()
@@ -101,6 +106,14 @@ protected:
   /// @return The zero levelled data
   std::vector<double> zeroLevelData(const std::vector<double> &data) const;
 
+  /// @brief Add data that are already zero levelled (see [zeroLevelData]) to
+  /// the collection. The data collectors use it to store the samples their
+  /// processing stages transformed
+  /// @param timeStamp The time stamp of the data
+  /// @param data The zero levelled data to add
+  void addZeroLevelled(const std::chrono::microseconds &timeStamp,
+                       const std::vector<double> &data);
+
 protected:
   /// @brief The timestamp of the starting point.
   DECLARE_PROTECTED_MEMBER(std::chrono::system_clock::time_point, StartingTime);
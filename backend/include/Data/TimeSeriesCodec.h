@@ -0,0 +1,63 @@
+#ifndef __NEUROBIO_DATA_TIME_SERIES_CODEC_H__
+#define __NEUROBIO_DATA_TIME_SERIES_CODEC_H__
+
+#include "neurobioConfig.h"
+
+#include <chrono>
+#include <vector>
+
+#include "Data/TimeSeries.h"
+
+namespace NEUROBIO_NAMESPACE::data {
+
+/// @brief The part of the samples of a [TimeSeries] to compress
+struct TimeSeriesSelection {
+  /// @brief The indices of the values kept in each sample, in that order. All
+  /// the values are kept if it is empty
+  std::vector<size_t> channels;
+
+  /// @brief Only one sample out of [decimation] is kept
+  size_t decimation = 1;
+};
+
+/// @brief A lossless compression of the samples of a [TimeSeries], in the
+/// fashion of the Gorilla time series database. The physiological signals
+/// change little from one sample to the next, so:
+///   - the timestamps are stored as the change of the interval between two
+///     samples, in 1 bit when the sampling rate is constant and in 9, 12 or
+///     16 bits when the change is small (68 bits otherwise);
+///   - each value is XORed with the previous value of its channel and only its
+///     meaningful bits (those between the leading and the trailing zeros) are
+///     stored: 1 bit if the value did not change, and the position of the
+///     meaningful bits is only stored when they do not fit in the previous
+///     ones of the channel.
+/// A block starts with the number of samples and of channels (unsigned LEB128
+/// varints), followed by the bits of the samples, most significant first, in
+/// as many bytes as needed. The starting time of the time series is not part
+/// of the block
+class TimeSeriesCodec {
+public:
+  /// @brief Append the compressed samples to a buffer. All the samples must
+  /// have the same number of channels, or an std::invalid_argument is raised
+  /// @param data The samples to compress
+  /// @param buffer The buffer to append the block to
+  /// @param selection The part of the samples to compress. The channels that
+  /// the samples do not have are left out
+  static void encode(const TimeSeries &data, std::vector<char> &buffer,
+                     const TimeSeriesSelection &selection = {});
+
+  /// @brief Read a block of compressed samples. Raises an std::runtime_error
+  /// if the block is truncated
+  /// @param buffer The buffer to read the block from
+  /// @param position The position of the block in the buffer, moved to the
+  /// end of the block
+  /// @param startingTime The starting time of the time series
+  /// @return The samples
+  static TimeSeries
+  decode(const std::vector<char> &buffer, size_t &position,
+         const std::chrono::system_clock::time_point &startingTime);
+};
+
+} // namespace NEUROBIO_NAMESPACE::data
+
+#endif // __NEUROBIO_DATA_TIME_SERIES_CODEC_H__
@@ -0,0 +1,52 @@
+#ifndef __NEUROBIO_DATA_TRIAL_FILE_H__
+#define __NEUROBIO_DATA_TRIAL_FILE_H__
+
+#include "neurobioConfig.h"
+
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+
+#include "Data/TimeSeries.h"
+
+namespace NEUROBIO_NAMESPACE::data {
+
+/// @brief Read and write recorded trials (the data of several devices) in a
+/// compact binary format, which is much faster to load than the json sent by
+/// GET_LAST_TRIAL_DATA. All the values are little-endian:
+///   - the magic "NBTR" (4 bytes) and the format version (uint32)
+///   - the number of devices (uint32), then for each device:
+///     - the length of its name (uint32) and the name itself
+///     - the starting time in microseconds since epoch (int64)
+///     - the number of samples (uint64) and of channels (uint32)
+///     - for each sample, its timestamp in microseconds since the starting
+///       time (int64) followed by the value of each channel (float64)
+/// The compressed trial files (format version 2) hold, after the starting time
+/// of each device, its samples compressed by [TimeSeriesCodec] instead
+class TrialFile {
+public:
+  /// @brief Write a trial to a file
+  /// @param path The path of the file (overwritten if it exists)
+  /// @param trial The data of each device, by device name
+  /// @param isCompressed If the samples are compressed (see [TimeSeriesCodec])
+  static void save(const std::string &path,
+                   const std::map<std::string, TimeSeries> &trial,
+                   bool isCompressed = false);
+
+  /// @brief Read a trial from a file, either the json sent by
+  /// GET_LAST_TRIAL_DATA (.json extension) or a trial file. Throws if the file
+  /// cannot be read or is not a trial
+  /// @param path The path of the file
+  /// @return The data of each device, by device name
+  static std::map<std::string, TimeSeries> load(const std::string &path);
+
+  /// @brief Read a trial in the json format sent by GET_LAST_TRIAL_DATA
+  /// @param json The serialized data of each device
+  /// @return The data of each device, by device name
+  static std::map<std::string, TimeSeries>
+  deserialize(const nlohmann::json &json);
+};
+
+} // namespace NEUROBIO_NAMESPACE::data
+
+#endif // __NEUROBIO_DATA_TRIAL_FILE_H__
@@ -1,7 +1,14 @@
 #ifndef __NEUROBIO_DATA_ALL_H__
 #define __NEUROBIO_DATA_ALL_H__
 
+#include "Data/ClockModel.h"
 #include "Data/DataPoint.h"
+#include "Data/EmgFeaturesStage.h"
+#include "Data/FilterBankStage.h"
+#include "Data/ProcessingStage.h"
+#include "Data/TimeAligner.h"
 #include "Data/TimeSeries.h"
+#include "Data/TimeSeriesCodec.h"
+#include "Data/TrialFile.h"
 
 #endif // __NEUROBIO_DATA_ALL_H__
\ No newline at end of file
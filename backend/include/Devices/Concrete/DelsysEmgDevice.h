@@ -36,6 +36,13 @@ public:
 public:
   std::string deviceName() const override;
   std::string dataCollectorName() const override;
+
+  /// @brief Add the processing stages of the EMG (the features and the linear
+  /// envelope) to a data collector, so it derives the same data as the device
+  /// @param collector The data collector
+  /// @param channelCount The number of channels of its samples
+  static void addProcessingStages(DataCollector &collector,
+                                  size_t channelCount);
 };
 
 /// ------------ ///
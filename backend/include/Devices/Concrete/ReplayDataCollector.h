@@ -0,0 +1,131 @@
+#ifndef __NEUROBIO_DEVICES_REPLAY_DATA_COLLECTOR_H__
+#define __NEUROBIO_DEVICES_REPLAY_DATA_COLLECTOR_H__
+
+#include "neurobioConfig.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include "Devices/Generic/AsyncDataCollector.h"
+#include "Devices/Generic/Device.h"
+
+namespace NEUROBIO_NAMESPACE::devices {
+
+/// @brief A device streaming the recorded data of a data collector, as if it
+/// was collecting them live. The data collector keeps the name it had when the
+/// data were recorded and the samples keep their recorded timestamps, so the
+/// rest of the pipeline (analyzers, server, clients) cannot tell the difference
+/// with the actual device. The processing stages of the actual device are run
+/// as well, so the derived data are the same. The data can be replayed in real
+/// time, faster, or as fast as possible
+class ReplayDataCollector : public Device, public AsyncDataCollector {
+public:
+  /// @brief Constructor
+  /// @param dataCollectorName The name of the data collector that recorded
+  /// the data
+  /// @param data The recorded data
+  /// @param speed How many times faster than real time the data are replayed.
+  /// 0 replays them as fast as possible
+  /// @param isLooping If the data are replayed again once they are all sent
+  /// @param startingOffset The time between the start of the trial and the
+  /// starting time of [data], so the devices of a trial stay synchronized
+  ReplayDataCollector(const std::string &dataCollectorName,
+                      data::TimeSeries data, double speed = 1.0,
+                      bool isLooping = false,
+                      const std::chrono::microseconds &startingOffset =
+                          std::chrono::microseconds(0));
+
+  ReplayDataCollector(const ReplayDataCollector &) = delete;
+  ReplayDataCollector &operator=(const ReplayDataCollector &) = delete;
+
+  ~ReplayDataCollector() override;
+
+  /// @brief Create the replay of one of the data collectors of a trial
+  /// @param trial The data of each data collector, by data collector name
+  /// @param dataCollectorName The name of the data collector to replay
+  /// @param speed How many times faster than real time the data are replayed.
+  /// 0 replays them as fast as possible
+  /// @param isLooping If the data are replayed again once they are all sent
+  /// @return The replay of the data collector
+  static std::unique_ptr<ReplayDataCollector>
+  fromTrial(const std::map<std::string, data::TimeSeries> &trial,
+            const std::string &dataCollectorName, double speed = 1.0,
+            bool isLooping = false);
+
+  /// @brief Get the name of the device a data collector belongs to, following
+  /// the naming of the devices (e.g. DelsysEmgDataCollector is collected by
+  /// DelsysEmgDevice)
+  /// @param dataCollectorName The name of the data collector
+  /// @return The name of the device
+  static std::string
+  deviceNameFromDataCollectorName(const std::string &dataCollectorName);
+
+  std::string deviceName() const override;
+  std::string dataCollectorName() const override;
+
+  /// @brief Reset the live data. As the timestamps of the samples are relative
+  /// to the starting time of the live data, the replay restarts from the
+  /// beginning (this happens when [Devices] synchronizes its data collectors)
+  void resetLiveData() override;
+
+protected:
+  /// @brief The name of the data collector that recorded the data
+  DECLARE_PROTECTED_MEMBER_NOGET(std::string, DataCollectorName);
+
+  /// @brief The recorded data
+  DECLARE_PROTECTED_MEMBER_NOGET(data::TimeSeries, Data);
+
+  /// @brief The time of each sample relative to the start of the replay
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<std::chrono::microseconds>,
+                                 ReplayTimes);
+
+  /// @brief How many times faster than real time the data are replayed (0 is
+  /// as fast as possible)
+  DECLARE_PROTECTED_MEMBER(double, Speed);
+
+  /// @brief If the data are replayed again once they are all sent
+  DECLARE_PROTECTED_MEMBER(bool, IsLooping);
+
+  /// @brief If all the data were sent (never true when looping)
+  DECLARE_PROTECTED_MEMBER(bool, HasFinished);
+
+  /// @brief The index of the next sample to send
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, NextIndex);
+
+  /// @brief The time added to the recorded times at each loop
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::microseconds, LoopOffset);
+
+  /// @brief When the replay started
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::steady_clock::time_point,
+                                 ReplayStart);
+
+  /// @brief If [ReplayStart] is set
+  DECLARE_PROTECTED_MEMBER_NOGET(bool, HasReplayStarted);
+
+  /// @brief If the live data were reset since the last data check
+  std::atomic<bool> m_HasLiveDataBeenReset;
+
+  bool handleConnect() override;
+  bool handleDisconnect() override;
+  bool handleStartDataStreaming() override;
+  bool handleStopDataStreaming() override;
+  void handleNewData(const data::DataPoint &data) override;
+
+  DeviceResponses parseSendCommand(const DeviceCommands &command,
+                                   const std::any &data) override;
+
+  /// @brief Send the samples whose time has come. When replaying as fast as
+  /// possible, send them all, chunk after chunk, until the streaming stops
+  void dataCheck() override;
+
+  /// @brief Send the next samples to the live data
+  /// @param dueTime The replay time up to which the samples are sent
+  /// @param maxSampleCount The most samples sent
+  void sendSamples(const std::chrono::microseconds &dueTime,
+                   size_t maxSampleCount);
+};
+
+} // namespace NEUROBIO_NAMESPACE::devices
+
+#endif // __NEUROBIO_DEVICES_REPLAY_DATA_COLLECTOR_H__
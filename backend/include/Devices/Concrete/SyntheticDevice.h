@@ -0,0 +1,202 @@
+#ifndef __NEUROBIO_DEVICES_SYNTHETIC_DEVICE_H__
+#define __NEUROBIO_DEVICES_SYNTHETIC_DEVICE_H__
+
+#include "neurobioConfig.h"
+
+#include <atomic>
+#include <nlohmann/json.hpp>
+#include <random>
+
+#include "Devices/Generic/AsyncDataCollector.h"
+#include "Devices/Generic/Device.h"
+
+namespace NEUROBIO_NAMESPACE::devices {
+
+/// @brief The geometry and the content of the data generated by a
+/// [SyntheticDevice]. The waveform of each channel is the sum of the enabled
+/// components (an amplitude of 0 disables a component)
+struct SyntheticDeviceConfiguration {
+  SyntheticDeviceConfiguration() = default;
+
+  /// @brief Constructor from a json. The missing fields keep their default
+  /// value
+  /// @param json The configuration in a json format (see [serialize])
+  SyntheticDeviceConfiguration(const nlohmann::json &json);
+
+  /// @brief The number of channels
+  size_t channelCount = 16;
+
+  /// @brief The number of samples per second of each channel
+  double sampleRate = 2000.0;
+
+  /// @brief The number of samples sent at once
+  size_t frameSize = 27;
+
+  /// @brief The amplitude of the sine of each channel (the channels are phase
+  /// shifted)
+  double sineAmplitude = 1.0;
+
+  /// @brief The frequency of the sine, in Hz
+  double sineFrequency = 1.0;
+
+  /// @brief The standard deviation of the white noise added to each channel
+  double noiseAmplitude = 0.0;
+
+  /// @brief The standard deviation of the EMG-like bursts (noise modulated by
+  /// a smooth envelope)
+  double burstAmplitude = 0.0;
+
+  /// @brief The time between the start of two bursts
+  std::chrono::microseconds burstPeriod{1000000};
+
+  /// @brief The portion of [burstPeriod] during which a burst is active
+  double burstDutyCycle = 0.3;
+
+  /// @brief The height of the step events (a square wave)
+  double stepAmplitude = 0.0;
+
+  /// @brief The time between two step events
+  std::chrono::microseconds stepPeriod{2000000};
+
+  /// @brief The maximum delay added to the delivery of a frame. Each frame is
+  /// delayed by a random time between 0 and this value
+  std::chrono::microseconds jitter{0};
+
+  /// @brief The probability of a frame to be dropped instead of sent
+  double dropRate = 0.0;
+
+  /// @brief The seed of the random generators, so a configuration always
+  /// produces the same data
+  unsigned int seed = 42;
+
+  /// @brief The time between two frames
+  /// @return The time between two frames
+  std::chrono::microseconds framePeriod() const;
+
+  /// @brief Throw an invalid_argument exception if the configuration cannot
+  /// be generated
+  void validate() const;
+
+  /// @brief Serialize the configuration
+  /// @return The configuration in a json format
+  nlohmann::json serialize() const;
+
+  /// @brief The configuration mimicking the geometry of the Delsys EMG device
+  /// (EMG-like bursts over noise)
+  /// @param rateFactor How many times faster than the actual device the
+  /// samples are generated
+  /// @return The configuration
+  static SyntheticDeviceConfiguration delsysEmg(double rateFactor = 1.0);
+
+  /// @brief The configuration mimicking the geometry of the Delsys analog
+  /// device (sines with step events)
+  /// @param rateFactor How many times faster than the actual device the
+  /// samples are generated
+  /// @return The configuration
+  static SyntheticDeviceConfiguration delsysAnalog(double rateFactor = 1.0);
+};
+
+/// @brief A device generating synthetic data at a configurable rate, mainly to
+/// load the live pipeline (data collectors, analyzers, server and clients)
+/// beyond what the actual devices produce. The waveforms are precomputed in
+/// tables, so generating a sample only costs a few lookups and the generator
+/// is never the bottleneck of the pipeline it loads
+class SyntheticDevice : public Device, public AsyncDataCollector {
+public:
+  /// @brief Constructor
+  /// @param deviceName The name of the device
+  /// @param dataCollectorName The name of the data collector
+  /// @param configuration The data to generate
+  SyntheticDevice(const std::string &deviceName,
+                  const std::string &dataCollectorName,
+                  const SyntheticDeviceConfiguration &configuration);
+
+  SyntheticDevice(const SyntheticDevice &) = delete;
+  SyntheticDevice &operator=(const SyntheticDevice &) = delete;
+
+  ~SyntheticDevice() override;
+
+  /// @brief Get the name of the data collector of a device, following the
+  /// naming of the devices (e.g. DelsysEmgDevice collects with
+  /// DelsysEmgDataCollector)
+  /// @param deviceName The name of the device
+  /// @return The name of the data collector
+  static std::string
+  dataCollectorNameFromDeviceName(const std::string &deviceName);
+
+  std::string deviceName() const override;
+  std::string dataCollectorName() const override;
+
+  /// @brief The data generated by the device
+  DECLARE_PROTECTED_MEMBER(SyntheticDeviceConfiguration, Configuration);
+
+  /// @brief The number of frames sent since the data streaming started. It can
+  /// be read while streaming
+  DECLARE_PROTECTED_MEMBER(std::atomic<size_t>, SentFrameCount);
+
+  /// @brief The number of frames dropped since the data streaming started. It
+  /// can be read while streaming
+  DECLARE_PROTECTED_MEMBER(std::atomic<size_t>, DroppedFrameCount);
+
+protected:
+  /// @brief The name of the device
+  DECLARE_PROTECTED_MEMBER_NOGET(std::string, DeviceName);
+
+  /// @brief The name of the data collector
+  DECLARE_PROTECTED_MEMBER_NOGET(std::string, DataCollectorName);
+
+  /// @brief One period of the sine
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, SineTable);
+
+  /// @brief Gaussian noise of unit standard deviation, read at a different
+  /// offset by each channel. Its size is a power of 2
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, NoiseTable);
+
+  /// @brief The envelope of the bursts over one [burstPeriod]
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, BurstTable);
+
+  /// @brief The level of the steps over one [stepPeriod]
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<double>, StepTable);
+
+  /// @brief The frame being filled, allocated once
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<std::vector<double>>, Frame);
+
+  /// @brief The index of the next frame to deliver
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, NextFrameIndex);
+
+  /// @brief When the next frame is delivered, relative to [StreamingStart]
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::microseconds,
+                                 NextFrameDelivery);
+
+  /// @brief When the data streaming started
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::steady_clock::time_point,
+                                 StreamingStart);
+
+  /// @brief The random generator of the jitter and the dropped frames
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mt19937, RandomGenerator);
+
+  bool handleConnect() override;
+  bool handleDisconnect() override;
+  bool handleStartDataStreaming() override;
+  bool handleStopDataStreaming() override;
+  void handleNewData(const data::DataPoint &data) override;
+
+  DeviceResponses parseSendCommand(const DeviceCommands &command,
+                                   const std::any &data) override;
+
+  /// @brief Deliver the frames whose time has come
+  void dataCheck() override;
+
+  /// @brief Fill [Frame] with the samples of a frame
+  /// @param frameIndex The index of the frame
+  void generateFrame(size_t frameIndex);
+
+  /// @brief Draw the delivery time of a frame
+  /// @param frameIndex The index of the frame
+  /// @return When the frame is delivered, relative to [StreamingStart]
+  std::chrono::microseconds drawDelivery(size_t frameIndex);
+};
+
+} // namespace NEUROBIO_NAMESPACE::devices
+
+#endif // __NEUROBIO_DEVICES_SYNTHETIC_DEVICE_H__
@@ -5,5 +5,7 @@
 #include "Devices/Concrete/LokomatDevice.h"
 #include "Devices/Concrete/MagstimRapidDevice.h"
 #include "Devices/Concrete/NidaqDevice.h"
+#include "Devices/Concrete/ReplayDataCollector.h"
+#include "Devices/Concrete/SyntheticDevice.h"
 
 #endif // __NEUROBIO_DEVICES_CONCRETE_ALL_H__
\ No newline at end of file
@@ -4,12 +4,14 @@
 #include "neurobioConfig.h"
 
 #include "Utils/CppMacros.h"
+#include "Utils/NeurobioEvent.h"
 #include <nlohmann/json.hpp>
 #include <shared_mutex>
 
 namespace NEUROBIO_NAMESPACE {
 namespace data {
 class TimeSeries;
+struct TimeSeriesSelection;
 } // namespace data
 
 namespace devices {
@@ -79,6 +81,15 @@ public:
   /// @return The requested data collector
   const DataCollector &getDataCollector(size_t deviceId) const;
 
+  /// @brief Get the devices of the collection. They are shared, so they stay
+  /// valid if another thread removes them from the collection meanwhile
+  /// @return The devices, by id
+  std::map<size_t, std::shared_ptr<const Device>> getDevices() const;
+
+  /// @brief The event triggered when a device of the collection gets connected
+  /// or disconnected, with the id of the device
+  utils::NeurobioEvent<size_t> onDeviceConnectionChanged;
+
   /// DRIVING THE DEVICES METHODS ///
 public:
   /// @brief Connect all the devices in a blocking way (wait for all the devices
@@ -112,14 +123,33 @@ public:
 
   /// DATA SPECIFIC METHODS ///
 public:
-  /// @brief Get the live data
+  /// @brief Get the live data. This includes the derived live data of the
+  /// processing stages of the data collectors
   /// @return The live data
   std::map<std::string, data::TimeSeries> getLiveData() const;
 
-  /// @brief Get the live data in serialized form
+  /// @brief Get the live data in serialized form. The data of each data
+  /// collector come with the sequence number of their next sample (see
+  /// [DataCollector::getSerializedLiveData])
   /// @return The live datain serialized form
   nlohmann::json getLiveDataSerialized() const;
 
+  /// @brief Get the sequence number of the next sample of each data collector
+  /// (see [DataCollector::getLiveDataSequence]). As long as they are the same,
+  /// the live data did not change
+  /// @return The sequence numbers, by device id
+  std::map<size_t, size_t> getLiveDataSequences() const;
+
+  /// @brief Get the samples of some data collectors, still in their replay
+  /// history, from a sequence number onwards, in the same form as
+  /// [getLiveDataSerialized]. The data of each data collector also come with
+  /// the sequence number of their first sample ("first_sequence")
+  /// @param fromSequences The sequence number of the first sample wanted, by
+  /// data collector name. The other data collectors are left out
+  /// @return The samples in serialized form
+  nlohmann::json getReplayDataSerialized(
+      const std::map<std::string, size_t> &fromSequences) const;
+
   /// @brief Get the data of the last recorded trial in serialized form
   /// @return The data of the last recorded trial in serialized form
   nlohmann::json getLastTrialDataSerialized() const;
@@ -132,6 +162,35 @@ public:
   static std::map<std::string, data::TimeSeries>
   deserializeData(const nlohmann::json &json);
 
+  /// @brief Get the live data compressed, so they take a fraction of the bytes
+  /// of their json. They are encoded straight from the live data of the data
+  /// collectors (raw and derived). All the values are little-endian: the
+  /// number of data collectors (uint32), then for each of them the length of
+  /// its name (uint32) and the name itself, the sequence number of its next
+  /// sample (uint64, the largest value if the data are derived and not
+  /// numbered), its starting time in microseconds since epoch (int64) and its
+  /// samples compressed by [data::TimeSeriesCodec]
+  /// @return The compressed live data
+  std::vector<char> getLiveDataCompressed() const;
+
+  /// @brief Get part of the live data compressed (see [getLiveDataCompressed])
+  /// @param selections The part of the samples compressed, by data collector
+  /// name (raw or derived). The other data collectors are left out
+  /// @return The compressed live data
+  std::vector<char> getLiveDataCompressed(
+      const std::map<std::string, data::TimeSeriesSelection> &selections)
+      const;
+
+  /// @brief Decompress the live data compressed by [getLiveDataCompressed].
+  /// Raises an std::runtime_error if they are truncated
+  /// @param buffer The compressed live data
+  /// @param sequences The sequence number of the next sample of the numbered
+  /// data collectors, by name, filled from the data
+  /// @return The live data, by data collector name
+  static std::map<std::string, data::TimeSeries>
+  decompressLiveData(const std::vector<char> &buffer,
+                     std::map<std::string, size_t> &sequences);
+
   /// INTERNAL ///
 protected:
   /// @brief If the devices are connected
@@ -147,6 +206,23 @@ protected:
   /// @brief The collection of devices
   std::map<size_t, std::shared_ptr<Device>> m_Devices;
 
+  /// @brief The id of the listener of [Device::onConnectionChanged] of each
+  /// device, so it can be cleared when the device is removed
+  std::map<size_t, size_t> m_ConnectionListenerIds;
+
+  /// @brief Copy the collection of devices, so they can be driven without
+  /// keeping it locked
+  /// @return The devices, by id
+  std::map<size_t, std::shared_ptr<Device>> copyDevices() const;
+
+  /// @brief Compress the live data (see [getLiveDataCompressed])
+  /// @param selections The part of the samples compressed, by data collector
+  /// name, or nullptr for all of them
+  /// @return The compressed live data
+  std::vector<char> compressLiveData(
+      const std::map<std::string, data::TimeSeriesSelection> *selections)
+      const;
+
 public:
   /// @brief The collection of data collectors
   const std::map<size_t, std::shared_ptr<DataCollector>> &
@@ -156,6 +232,10 @@ public:
   std::map<size_t, std::shared_ptr<DataCollector>> m_DataCollectors;
 
 private:
+  /// @brief The mutex to lock the collection of devices. It is taken before
+  /// [MutexDataCollectors] when both are needed
+  DECLARE_PRIVATE_MEMBER_NOGET(std::shared_mutex, MutexDevices)
+
   /// @brief The mutex to lock certain operations
   DECLARE_PRIVATE_MEMBER_NOGET(std::shared_mutex, MutexDataCollectors)
 };
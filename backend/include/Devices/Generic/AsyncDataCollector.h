@@ -6,6 +6,44 @@
 
 namespace NEUROBIO_NAMESPACE::devices {
 
+/// @brief The limits a [dataCheck] must hold to meet its deadline
+struct DeadlineBudget {
+  /// @brief How late the [dataCheck] may start compared to when it was
+  /// scheduled. Being late means the worker did not get the CPU in time
+  std::chrono::microseconds maxLateness;
+
+  /// @brief How long the [dataCheck] may take to execute
+  std::chrono::microseconds maxExecutionTime;
+
+  /// @brief How many [dataCheck] in a row must miss their deadline before it
+  /// is reported (see [AsyncDataCollector::onDeadlineMiss])
+  size_t maxConsecutiveMisses;
+};
+
+/// @brief A [dataCheck] that missed its deadline, after [maxConsecutiveMisses]
+/// others did
+struct DeadlineMiss {
+  /// @brief The name of the data collector
+  std::string dataCollectorName;
+
+  /// @brief When the [dataCheck] started
+  std::chrono::system_clock::time_point time;
+
+  /// @brief The number of samples received by the data collector so far, to
+  /// find the gap in the data
+  size_t sampleCounter;
+
+  /// @brief How late the [dataCheck] started compared to when it was scheduled
+  std::chrono::microseconds lateness;
+
+  /// @brief How long the [dataCheck] took to execute
+  std::chrono::microseconds executionTime;
+
+  /// @brief The number of [dataCheck] in a row that missed their deadline,
+  /// this one included
+  size_t consecutiveMisses;
+};
+
 /// @brief Abstract class for data collectors
 class AsyncDataCollector : public DataCollector {
 public:
@@ -86,6 +124,50 @@ protected:
   /// class to ignore the warning that is displayed when the [dataCheck] method
   /// takes too long to execute compared to the [KeepWorkerAliveInterval]
   DECLARE_PROTECTED_MEMBER(bool, IgnoreTooSlowWarning)
+
+public:
+  /// @brief Get the limits a [dataCheck] must hold to meet its deadline
+  DeadlineBudget getDeadlineBudget() const;
+
+  /// @brief Set the limits a [dataCheck] must hold to meet its deadline. By
+  /// default, it may neither start late nor execute for more than the
+  /// [KeepDataWorkerAliveInterval] (but at least 1 ms), three times in a row
+  /// @param budget The limits
+  void setDeadlineBudget(const DeadlineBudget &budget);
+
+  /// @brief Raised (on the worker thread) by each [dataCheck] that misses its
+  /// deadline once [DeadlineBudget::maxConsecutiveMisses] did in a row
+  utils::NeurobioEvent<DeadlineMiss> onDeadlineMiss;
+
+protected:
+  /// @brief Update the statistics of the deadlines with the last [dataCheck]
+  /// and raise [onDeadlineMiss] if needed
+  /// @param startingTime When the [dataCheck] started
+  /// @param lateness How late it started compared to when it was scheduled
+  /// @param executionTime How long it took to execute
+  void
+  monitorDeadline(const std::chrono::system_clock::time_point &startingTime,
+                  const std::chrono::microseconds &lateness,
+                  const std::chrono::microseconds &executionTime);
+
+  /// @brief The limits a [dataCheck] must hold to meet its deadline
+  DECLARE_PROTECTED_MEMBER_NOGET(DeadlineBudget, DeadlineBudget)
+
+  /// @brief When the next [dataCheck] is scheduled
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::steady_clock::time_point,
+                                 NextDataCheckTime)
+
+  /// @brief The number of [dataCheck] in a row that missed their deadline
+  DECLARE_PROTECTED_MEMBER(size_t, ConsecutiveDeadlineMisses)
+
+  /// @brief The distributions of the lateness and execution time of the
+  /// [dataCheck], and the number of missed deadlines (see [utils::Metrics])
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Histogram>,
+                                 LatenessMetric)
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Histogram>,
+                                 ExecutionTimeMetric)
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Counter>,
+                                 DeadlineMissesMetric)
 };
 
 } // namespace NEUROBIO_NAMESPACE::devices
@@ -3,16 +3,24 @@
 
 #include "neurobioConfig.h"
 #include <functional>
+#include <map>
 #include <shared_mutex>
 #include <vector>
 
+#include "Data/ClockModel.h"
+#include "Data/ProcessingStage.h"
 #include "Data/TimeSeries.h"
 #include "Devices/Generic/Device.h"
 #include "Utils/CppMacros.h"
+#include "Utils/Metrics.h"
 #include "Utils/NeurobioEvent.h"
 
 namespace NEUROBIO_NAMESPACE::devices {
 
+/// @brief The default number of samples kept so they can be sent again to the
+/// clients that missed them (a few seconds of EMG)
+static const size_t DEFAULT_REPLAY_HISTORY_SIZE = 10000;
+
 /// @brief Abstract class for data collectors
 class DataCollector {
 public:
@@ -85,13 +93,44 @@ protected:
   DECLARE_PROTECTED_MEMBER_NOGET(std::unique_ptr<data::TimeSeries>,
                                  TrialTimeSeries)
 
+  /// @brief The number of samples received since the data streaming started.
+  /// This is the sample counter of the device as seen by the collector
+  DECLARE_PROTECTED_MEMBER(size_t, SampleCounter)
+
+  /// @brief The model of the device clock used to reconstruct the timestamp of
+  /// each sample from [SampleCounter]. If it is not enabled (the default), the
+  /// time series are responsible for timestamping the data
+  DECLARE_PROTECTED_MEMBER_NOGET(data::ClockModel, ClockModel)
+
+  /// @brief The processing stages run, in order, on each sample before it is
+  /// added to the time series
+  std::vector<std::unique_ptr<data::ProcessingStage>> m_ProcessingStages;
+
+  /// @brief The live time series of the outputs of each processing stage (in
+  /// the same order as [m_ProcessingStages]). They are reset with the live
+  /// data and share its starting time
+  std::vector<data::TimeSeries> m_DerivedLiveTimeSeries;
+
+  /// @brief The last [ReplayHistorySize] samples, so they can be sent again to
+  /// a client that missed them. The sample [i] of the history has the sequence
+  /// number [SampleCounter] - size + [i]. It is reset with the live data and
+  /// shares its starting time
+  DECLARE_PROTECTED_MEMBER_NOGET(data::TimeSeries, ReplayTimeSeries)
+
+  /// @brief The number of samples kept in [ReplayTimeSeries]
+  DECLARE_PROTECTED_MEMBER(size_t, ReplayHistorySize)
+
+  /// @brief Reset the [SampleCounter], the [ClockModel] and the processing
+  /// stages. This must be called each time the device (re)starts streaming
+  void resetStreamingState();
+
 public:
   /// @brief Set the zero level
   /// @param duration The duration to set the zero level
   void setZeroLevel(const std::chrono::milliseconds &duration);
 
   /// @brief Reset the live data
-  void resetLiveData();
+  virtual void resetLiveData();
 
   /// @brief Get the live data
   /// @return The live data
@@ -102,6 +141,74 @@ public:
   /// @return The live data in a serialized form
   nlohmann::json getSerializedLiveData() const;
 
+  /// @brief Get the live data in a serialized form, along with the sequence
+  /// number of the next sample. Each sample is numbered from 0 as it is
+  /// received since the data streaming started ([SampleCounter])
+  /// @param sequence The sequence number of the sample that follows the data
+  /// @return The live data in a serialized form
+  nlohmann::json getSerializedLiveData(size_t &sequence) const;
+
+  /// @brief Read the live data without copying them, along with the sequence
+  /// number of the next sample (see [getSerializedLiveData]). The live data
+  /// are locked meanwhile, so the reader must be quick
+  /// @param reader The function called with the live data and the sequence
+  void readLiveData(
+      const std::function<void(const data::TimeSeries &, size_t)> &reader)
+      const;
+
+  /// @brief Get the sequence number of the next sample, that is the number of
+  /// samples received since the data streaming started ([SampleCounter])
+  /// @return The sequence number of the next sample
+  size_t getLiveDataSequence() const;
+
+  /// @brief Get the samples, still in the replay history, from a sequence
+  /// number onwards, in a serialized form (see [getSerializedLiveData])
+  /// @param fromSequence The sequence number of the first sample wanted
+  /// @param firstSequence The sequence number of the first sample returned.
+  /// It is after [fromSequence] if some of the samples wanted are no longer
+  /// in the history
+  /// @param sequence The sequence number of the sample that follows the data
+  /// @return The samples in a serialized form
+  nlohmann::json getSerializedReplayData(size_t fromSequence,
+                                         size_t &firstSequence,
+                                         size_t &sequence) const;
+
+  /// @brief Set the number of samples kept in the replay history. This clears
+  /// the history
+  /// @param size The number of samples
+  void setReplayHistorySize(size_t size);
+
+  /// @brief Add a processing stage run on each sample before it is added to
+  /// the time series. The stages are run in the order they were added. If the
+  /// stage produces an output, it is published as a derived live time series
+  /// named "<dataCollectorName>.<stageName>"
+  /// @param stage The stage to add. It must expect [DataChannelCount] channels
+  void addProcessingStage(std::unique_ptr<data::ProcessingStage> stage);
+
+  /// @brief Get a copy of the derived live data of the processing stages. This
+  /// uses a mutex to ensure that the data is not modified while being copied
+  /// @return The derived live data, by name of derived time series
+  std::map<std::string, data::TimeSeries> getDerivedLiveData() const;
+
+  /// @brief Read the derived live data of the processing stages without
+  /// copying them (see [readLiveData])
+  /// @param reader The function called with the name and the data of each
+  /// derived time series
+  void readDerivedLiveData(
+      const std::function<void(const std::string &, const data::TimeSeries &)>
+          &reader) const;
+
+  /// @brief Get the derived live data of the processing stages in a serialized
+  /// form. This uses a mutex to ensure that the data is not modified while
+  /// being serialized
+  /// @return The derived live data in a serialized form, by stage name
+  std::map<std::string, nlohmann::json> getSerializedDerivedLiveData() const;
+
+  /// @brief Get the estimated skew of the device clock relative to the host
+  /// clock. This is always 0 if the collector does not model its clock
+  /// @return The skew in parts per million
+  double getClockSkew() const;
+
   /// @brief Get a reference to trial data. Throws an exception if the data is
   /// currently being recorded (for thread safe purposes)
   /// @return The trial data
@@ -120,13 +227,33 @@ protected:
   virtual void
   addDataPoints(const std::vector<std::vector<double>> &dataPoints);
 
+  /// @brief Add a vector of data points whose acquisition time is already
+  /// known, instead of stamping them on arrival (or with the [ClockModel])
+  /// @param dataPoints The data points to add
+  /// @param timeStamps The timestamp of each data point, relative to the
+  /// starting time of the live data
+  void addDataPoints(const std::vector<std::vector<double>> &dataPoints,
+                     const std::vector<std::chrono::microseconds> &timeStamps);
+
   /// @brief This method is useless and only serves as a reminder that the
   /// inherited class should call [addDataPoint] when new data are ready
   virtual void handleNewData(const data::DataPoint &data) = 0;
 
 private:
+  /// @brief Implementation of [addDataPoints]
+  /// @param dataPoints The data points to add
+  /// @param timeStamps The timestamps of the data points, or nullptr to stamp
+  /// them on arrival
+  void addDataPoints(const std::vector<std::vector<double>> &dataPoints,
+                     const std::vector<std::chrono::microseconds> *timeStamps);
+
   /// @brief Mutex for adding/reading the data
   DECLARE_PRIVATE_MEMBER_NOGET(std::shared_mutex, LiveDataMutex);
+
+  /// @brief The number of samples received (see [utils::Metrics]). It is
+  /// fetched on the first data, once [dataCollectorName] can be called
+  DECLARE_PRIVATE_MEMBER_NOGET(std::shared_ptr<utils::Counter>,
+                               IngestedSamplesMetric);
 };
 
 } // namespace NEUROBIO_NAMESPACE::devices
@@ -14,6 +14,7 @@
 #include "Devices/Generic/AsyncDevice.h"
 #include "Devices/Generic/TcpDevice.h"
 #include "Utils/CppMacros.h"
+#include "Utils/Metrics.h"
 
 namespace NEUROBIO_NAMESPACE::devices {
 class DelsysEmgDeviceMock;
@@ -160,6 +161,23 @@ protected:
 
   /// @brief The buffer to read the data from the device
   DECLARE_PROTECTED_MEMBER(std::vector<char>, DataBuffer)
+
+  /// @brief Allow the [dataCheck] to wait for a frame in its [DeadlineBudget]
+  void setFrameDeadlineBudget();
+
+  /// @brief The duration of [dataCheck], reading excluded (see
+  /// [utils::Metrics])
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Histogram>,
+                                 DataCheckDurationMetric)
+
+  /// @brief The number of frames lost because the read failed
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Counter>,
+                                 DroppedFramesMetric)
+
+  /// @brief The number of samples skipped because they were all zeros
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Counter>,
+                                 SkippedSamplesMetric)
+
   void handleNewData(const data::DataPoint &data) override;
 };
 
@@ -4,6 +4,7 @@
 #include "neurobioConfig.h"
 
 #include "Utils/CppMacros.h"
+#include "Utils/NeurobioEvent.h"
 #include <any>
 #include <iostream>
 #include <vector>
@@ -113,6 +114,10 @@ public:
   /// @return True if the device is disconnected, false otherwise
   virtual bool disconnect();
 
+  /// @brief The event triggered when the device gets connected (true) or
+  /// disconnected (false)
+  utils::NeurobioEvent<bool> onConnectionChanged;
+
 protected:
   /// @brief Handle the actual connexion to the device
   /// @return True if the connection was successful, false otherwise
@@ -0,0 +1,50 @@
+#ifndef __NEUROBIO_SERVER_LIVE_STREAM_RATE_H__
+#define __NEUROBIO_SERVER_LIVE_STREAM_RATE_H__
+
+#include "neurobioConfig.h"
+
+#include <chrono>
+
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::server {
+
+/// @brief The interval between two packets of a live stream (the live data or
+/// the live analyses) to a client. It starts at [Interval] and adapts to how
+/// fast the client reads: as the writes block once the socket buffers of the
+/// client are full, a stream that takes more than half of its interval to be
+/// written backs off to twice the interval (up to [MaxInterval]), and one that
+/// takes less than a quarter of it tightens back by a quarter (down to
+/// [Interval])
+class LiveStreamRate {
+public:
+  /// @brief Constructor
+  /// @param interval The shortest interval between two packets
+  /// @param maxInterval The longest interval between two packets, when the
+  /// clients do not keep up. It is set to [interval] if it is shorter
+  LiveStreamRate(std::chrono::milliseconds interval,
+                 std::chrono::milliseconds maxInterval);
+
+  /// @brief Adapt the interval to the time it took to write the last packet
+  /// to the client
+  /// @param sendDuration The time it took to write the last packet
+  void update(std::chrono::steady_clock::duration sendDuration);
+
+  /// @brief Go back to the shortest interval
+  void reset();
+
+protected:
+  /// @brief The shortest interval between two packets
+  DECLARE_PROTECTED_MEMBER(std::chrono::milliseconds, Interval);
+
+  /// @brief The longest interval between two packets
+  DECLARE_PROTECTED_MEMBER(std::chrono::milliseconds, MaxInterval);
+
+  /// @brief The interval until the next packet
+  DECLARE_PROTECTED_MEMBER(std::chrono::steady_clock::duration,
+                           CurrentInterval);
+};
+
+} // namespace NEUROBIO_NAMESPACE::server
+
+#endif // __NEUROBIO_SERVER_LIVE_STREAM_RATE_H__
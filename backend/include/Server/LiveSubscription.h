@@ -0,0 +1,86 @@
+#ifndef __NEUROBIO_SERVER_LIVE_SUBSCRIPTION_H__
+#define __NEUROBIO_SERVER_LIVE_SUBSCRIPTION_H__
+
+#include "neurobioConfig.h"
+
+#include <chrono>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "Data/TimeSeriesCodec.h"
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::server {
+
+/// @brief The part of the live data of a data collector a client subscribed
+/// to. The compressed live data are filtered while they are encoded
+using LiveSubscriptionStream = data::TimeSeriesSelection;
+
+/// @brief What a client receives of the live stream. By default a client
+/// receives everything; a subscription narrows it down to some data
+/// collectors (raw or derived, e.g. "DelsysEmgDataCollector" or
+/// "DelsysEmgDataCollector.EmgEnvelope"), some of their channels, one frame
+/// out of a few, at most a few times per second, in json or compressed, and
+/// with or without the live analyses (in json, or as the binary predictions of
+/// [PredictionHistory]). The clients subscribed to the same data share the same
+/// packet
+class LiveSubscription {
+public:
+  /// @brief The subscription to everything
+  LiveSubscription();
+
+  /// @brief Constructor from a json (see [serialize]). Raises an
+  /// std::invalid_argument if it is invalid
+  /// @param json The subscription in a json format
+  LiveSubscription(const nlohmann::json &json);
+
+  /// @brief Keep the part of the live data that is subscribed to
+  /// @param liveData The live data, as serialized by
+  /// [devices::Devices::getLiveDataSerialized]
+  /// @return The live data subscribed to, in the same format
+  nlohmann::json filter(const nlohmann::json &liveData) const;
+
+  /// @brief Get the subscription in a json format
+  nlohmann::json serialize() const;
+
+  /// @brief Get the subscribed data collectors, by name (see [IsEveryStream])
+  const std::map<std::string, LiveSubscriptionStream> &getStreams() const {
+    return m_Streams;
+  }
+
+protected:
+  /// @brief The subscribed data collectors, by name. Every data collector is
+  /// subscribed to if [IsEveryStream]
+  std::map<std::string, LiveSubscriptionStream> m_Streams;
+
+  /// @brief If all the data collectors are subscribed to, with all their
+  /// channels
+  DECLARE_PROTECTED_MEMBER(bool, IsEveryStream);
+
+  /// @brief The largest number of live packets per second (0 for as many as
+  /// the server sends)
+  DECLARE_PROTECTED_MEMBER(double, MaxRate);
+
+  /// @brief If the live data are sent compressed (see
+  /// [devices::Devices::getLiveDataCompressed]) instead of in json
+  DECLARE_PROTECTED_MEMBER(bool, IsCompressedData);
+
+  /// @brief If the live analyses are subscribed to
+  DECLARE_PROTECTED_MEMBER(bool, HasAnalyses);
+
+  /// @brief If the live analyses are sent as the binary predictions made
+  /// since the last packet (see [PredictionHistory]) instead of the json of
+  /// the last predictions
+  DECLARE_PROTECTED_MEMBER(bool, IsBinaryAnalyses);
+
+  /// @brief Identify the live data subscribed to, and their format, so the
+  /// clients subscribed to the same data are sent the same packet. It is empty
+  /// if [IsEveryStream] in json
+  DECLARE_PROTECTED_MEMBER(std::string, Key);
+};
+
+} // namespace NEUROBIO_NAMESPACE::server
+
+#endif // __NEUROBIO_SERVER_LIVE_SUBSCRIPTION_H__
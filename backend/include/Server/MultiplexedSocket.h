@@ -0,0 +1,192 @@
+#ifndef __NEUROBIO_SERVER_MULTIPLEXED_SOCKET_H__
+#define __NEUROBIO_SERVER_MULTIPLEXED_SOCKET_H__
+
+#include "neurobioConfig.h"
+
+#include <array>
+#include <asio.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::server {
+
+/// @brief The logical channels between a client and the server. They are
+/// either a socket each, or the streams of a [MultiplexedSocket]
+enum class TcpServerChannel : uint32_t {
+  COMMAND = 0,
+  MESSAGE = 1,
+  LIVE_DATA = 2,
+  LIVE_ANALYSES = 3,
+};
+
+static const size_t TCP_SERVER_CHANNEL_COUNT = 4;
+static const size_t BYTES_IN_MULTIPLEXED_FRAME_HEADER = 12;
+static const size_t MAX_BYTES_IN_MULTIPLEXED_FRAME = 64 * 1024;
+
+/// @brief A single TCP connection that carries all the channels of a client.
+/// Each write is cut in frames of at most [MAX_BYTES_IN_MULTIPLEXED_FRAME]
+/// bytes, each preceded by the channel it belongs to and its size. The frames
+/// of the live data (the bulk of the traffic) yield to the frames of the other
+/// channels, so a command response or a live analysis never waits for a whole
+/// live data packet to be written. The bytes read are dispatched to their
+/// channel, whichever thread reads them
+class MultiplexedSocket {
+public:
+  /// @brief Constructor
+  /// @param socket The connected socket to carry the channels on
+  /// @param readChannels The channels read on this side. A frame of another
+  /// channel makes the reading fail, as nobody would ever consume it
+  /// @param maxPendingBytes The most bytes kept for the readers of a channel,
+  /// 0 for no limit. Receiving more makes the reading fail
+  MultiplexedSocket(std::shared_ptr<asio::ip::tcp::socket> socket,
+                    const std::vector<TcpServerChannel> &readChannels =
+                        {TcpServerChannel::COMMAND, TcpServerChannel::MESSAGE,
+                         TcpServerChannel::LIVE_DATA,
+                         TcpServerChannel::LIVE_ANALYSES},
+                    size_t maxPendingBytes = 0);
+
+  MultiplexedSocket(const MultiplexedSocket &) = delete;
+  MultiplexedSocket &operator=(const MultiplexedSocket &) = delete;
+
+  /// @brief Write to a channel. This blocks until everything is written
+  /// @param channel The channel to write to
+  /// @param buffers The bytes to write, one buffer after the other
+  /// @param error The error of the write, if any
+  /// @return The number of bytes written (frame headers excluded)
+  size_t write(TcpServerChannel channel,
+               const std::array<asio::const_buffer, 2> &buffers,
+               asio::error_code &error);
+
+  /// @brief Write to a channel. This blocks until everything is written
+  /// @param channel The channel to write to
+  /// @param buffer The bytes to write
+  /// @param error The error of the write, if any
+  /// @return The number of bytes written (frame headers excluded)
+  size_t write(TcpServerChannel channel, asio::const_buffer buffer,
+               asio::error_code &error);
+
+  /// @brief Fill the buffer with the next bytes of a channel, reading the
+  /// frames from the socket until there are enough. The frames of the other
+  /// channels are kept for their readers
+  /// @param channel The channel to read from
+  /// @param buffer The buffer to fill
+  /// @param error The error of the read, if any
+  /// @return The number of bytes read (the size of the buffer, or 0 on error)
+  size_t read(TcpServerChannel channel, asio::mutable_buffer buffer,
+              asio::error_code &error);
+
+  /// @brief Fill the buffer with the next bytes of a channel if they were
+  /// already received, without reading the socket
+  /// @param channel The channel to read from
+  /// @param buffer The buffer to fill
+  /// @return True if the buffer was filled, false otherwise
+  bool tryRead(TcpServerChannel channel, asio::mutable_buffer buffer);
+
+  /// @brief Read the next frame from the socket without blocking. Its bytes
+  /// can then be fetched with [tryRead]
+  /// @param handler Called once the frame is received, or with the error
+  void asyncReadFrame(std::function<void(const asio::error_code &)> handler);
+
+  /// @brief If the socket is open
+  bool isOpen() const;
+
+  /// @brief Shut the socket down, without closing it. The pending and later
+  /// reads and writes fail
+  void shutdown();
+
+  /// @brief Close the socket. The pending reads and writes fail
+  void close();
+
+  /// @brief Get the socket the channels are carried on
+  asio::ip::tcp::socket &getSocket() { return *m_Socket; }
+
+protected:
+  /// @brief Write the header of a frame
+  /// @param header The buffer to write to, of
+  /// [BYTES_IN_MULTIPLEXED_FRAME_HEADER] bytes
+  /// @param channel The channel of the frame
+  /// @param size The size of the payload of the frame
+  static void writeFrameHeader(char *header, TcpServerChannel channel,
+                               size_t size);
+
+  /// @brief Parse the header of a frame
+  /// @param header The header to parse
+  /// @param channel The channel of the frame
+  /// @param size The size of the payload of the frame
+  /// @return False if the header is invalid (unknown channel, channel not read
+  /// on this side or frame too large)
+  bool parseFrameHeader(const char *header, TcpServerChannel &channel,
+                        size_t &size) const;
+
+  /// @brief Wait for the socket to be free to write a frame. The live data
+  /// also wait for the frames of the other channels waiting to be written
+  /// @param isBulk If the frame is of live data
+  void lockForFrame(bool isBulk);
+
+  /// @brief Free the socket for the next frame
+  void unlockForFrame();
+
+  /// @brief Read a frame from the socket, blocking
+  /// @param error The error of the read, if any
+  void readFrame(asio::error_code &error);
+
+  /// @brief Keep the bytes of a received frame for the readers of its
+  /// channel, and wake them up. [ReadMutex] must be locked
+  /// @param channel The channel of the frame
+  /// @param payload The bytes of the frame
+  /// @return False if the channel would then hold more than [MaxPendingBytes]
+  /// bytes, in which case the frame is dropped
+  bool receiveFrame(TcpServerChannel channel, const std::vector<char> &payload);
+
+  /// @brief Move the next bytes of a channel to the buffer if there are
+  /// enough. [ReadMutex] must be locked
+  /// @param channel The channel to read from
+  /// @param buffer The buffer to fill
+  /// @return True if the buffer was filled, false otherwise
+  bool consume(TcpServerChannel channel, asio::mutable_buffer buffer);
+
+  /// @brief The socket the channels are carried on
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<asio::ip::tcp::socket>,
+                                 Socket);
+
+  /// @brief The mutex to lock the writing of the frames
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, WriteMutex);
+
+  /// @brief Notified each time a frame is written
+  DECLARE_PROTECTED_MEMBER_NOGET(std::condition_variable, WriteCondition);
+
+  /// @brief If a frame is being written
+  DECLARE_PROTECTED_MEMBER_NOGET(bool, IsWritingFrame);
+
+  /// @brief The number of frames, other than live data, waiting to be written
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, PriorityFrameCount);
+
+  /// @brief The mutex to lock the reading of the frames
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, ReadMutex);
+
+  /// @brief Notified each time a frame is received (or the reading failed)
+  DECLARE_PROTECTED_MEMBER_NOGET(std::condition_variable, ReadCondition);
+
+  /// @brief If a thread (or an asynchronous read) is reading a frame
+  DECLARE_PROTECTED_MEMBER_NOGET(bool, IsReadingFrame);
+
+  /// @brief The error that stopped the reading, if any
+  DECLARE_PROTECTED_MEMBER_NOGET(asio::error_code, ReadError);
+
+  /// @brief If the channels are read on this side, by channel
+  std::array<bool, TCP_SERVER_CHANNEL_COUNT> m_IsChannelRead;
+
+  /// @brief The most bytes kept for the readers of a channel (0 for no limit)
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, MaxPendingBytes);
+
+  /// @brief The bytes received and not read yet, by channel
+  std::array<std::vector<char>, TCP_SERVER_CHANNEL_COUNT> m_PendingBytes;
+};
+
+} // namespace NEUROBIO_NAMESPACE::server
+
+#endif // __NEUROBIO_SERVER_MULTIPLEXED_SOCKET_H__
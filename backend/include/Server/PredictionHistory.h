@@ -0,0 +1,110 @@
+#ifndef __NEUROBIO_SERVER_PREDICTION_HISTORY_H__
+#define __NEUROBIO_SERVER_PREDICTION_HISTORY_H__
+
+#include "neurobioConfig.h"
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Analyzer/Predictions.h"
+#include "Data/DataPoint.h"
+#include "Utils/CppMacros.h"
+#include "Utils/RollingVector.h"
+
+namespace NEUROBIO_NAMESPACE::server {
+
+/// @brief A prediction made by an analyzer, as sent in the live predictions
+struct LivePrediction {
+  /// @brief The number of the prediction, counted over all the analyzers
+  /// (starting at 1)
+  uint64_t sequence = 0;
+
+  /// @brief The name of the analyzer that made the prediction
+  std::string analyzer;
+
+  /// @brief The prediction. Of its extra info, only "current_phase" and
+  /// "has_changed_phase" are kept
+  data::DataPoint prediction;
+};
+
+/// @brief A packet of live predictions, as received by a client
+struct LivePredictions {
+  /// @brief The starting time of the time stamps of the predictions
+  std::chrono::system_clock::time_point startingTime;
+
+  /// @brief If some of the predictions made since the last packet were
+  /// dropped from the history before being sent, so [predictions] misses them
+  bool isTruncated = false;
+
+  /// @brief The predictions, in the order they were made
+  std::vector<LivePrediction> predictions;
+};
+
+/// @brief The last predictions of each analyzer, numbered in the order they
+/// were made, so a client can be sent all the predictions made since the last
+/// one it was sent instead of only the latest ones. They are sent in a compact
+/// binary format (little endian):
+///   - the starting time of the time stamps (int64, microseconds since epoch)
+///   - the flags of the packet (uint8, bit 0 if some of the predictions asked
+///     for were already dropped from the history, so the packet misses them)
+///   - the number of analyzers (uint32), and for each of them its id (uint32),
+///     the length of its name (uint32) and its name
+///   - the number of predictions (uint32), and for each of them its sequence
+///     (uint64), the id of its analyzer (uint32), its time stamp (int64,
+///     microseconds), its phase index (uint32), its flags (uint8, bit 0 if it
+///     has a phase index, bit 1 if it changed phase), the number of values
+///     (uint32) and the values (float64)
+/// Only the analyzers of the predictions of the packet are in it
+class PredictionHistory {
+public:
+  /// @brief Constructor
+  /// @param capacity The number of predictions kept for each analyzer
+  PredictionHistory(size_t capacity = 256);
+
+  /// @brief Add the predictions that are new, i.e. whose time stamp differs
+  /// from the last one of their analyzer (the analyzers repeat their last
+  /// prediction until they make a new one)
+  /// @param predictions The last predictions of all the analyzers
+  /// @return The number of predictions added
+  size_t add(const analyzer::Predictions &predictions);
+
+  /// @brief Serialize the predictions made after a given one that are still
+  /// kept (see the class description). The packet is flagged as truncated if
+  /// some of them were already dropped
+  /// @param afterSequence The sequence of the last prediction not to send
+  /// @return The predictions in the binary format
+  std::string serialize(uint64_t afterSequence) const;
+
+  /// @brief Deserialize the predictions (see the class description). Raises
+  /// an std::runtime_error if the data are truncated or invalid
+  /// @param data The predictions in the binary format
+  /// @return The predictions
+  static LivePredictions deserialize(const std::vector<char> &data);
+
+protected:
+  /// @brief The number of predictions kept for each analyzer
+  DECLARE_PROTECTED_MEMBER(size_t, Capacity);
+
+  /// @brief The sequence of the last prediction added (0 if none was)
+  DECLARE_PROTECTED_MEMBER(uint64_t, LastSequence);
+
+  /// @brief The sequence of the last prediction dropped to make room for a
+  /// new one (0 if none was)
+  DECLARE_PROTECTED_MEMBER(uint64_t, LastDroppedSequence);
+
+  /// @brief The starting time of the time stamps of the last predictions
+  DECLARE_PROTECTED_MEMBER(std::chrono::system_clock::time_point,
+                           StartingTime);
+
+  /// @brief The id of each analyzer in the packets, by name
+  std::map<std::string, uint32_t> m_AnalyzerIds;
+
+  /// @brief The last predictions of each analyzer, by id
+  std::vector<utils::RollingVector<LivePrediction>> m_Predictions;
+};
+
+} // namespace NEUROBIO_NAMESPACE::server
+
+#endif // __NEUROBIO_SERVER_PREDICTION_HISTORY_H__
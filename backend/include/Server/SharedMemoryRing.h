@@ -0,0 +1,164 @@
+#ifndef __NEUROBIO_SERVER_SHARED_MEMORY_RING_H__
+#define __NEUROBIO_SERVER_SHARED_MEMORY_RING_H__
+
+#include "neurobioConfig.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::server {
+
+/// @brief A message read from a [SharedMemoryRing]
+struct SharedMemoryMessage {
+  /// @brief The type of the message (a [TcpServerDataType])
+  uint32_t dataType = 0;
+
+  /// @brief When the message was published
+  std::chrono::system_clock::time_point publishedAt;
+
+  /// @brief The content of the message
+  std::string data;
+};
+
+/// @brief A message viewed in place in a [SharedMemoryRing], without copying
+/// it. The writer may overwrite it at any time, so whatever is computed from
+/// [data] must be dropped unless [SharedMemoryRing::isValid] confirms the
+/// message was not overwritten in the meantime
+struct SharedMemoryView {
+  /// @brief The sequence of the message
+  uint64_t sequence = 0;
+
+  /// @brief The type of the message (a [TcpServerDataType])
+  uint32_t dataType = 0;
+
+  /// @brief When the message was published
+  std::chrono::system_clock::time_point publishedAt;
+
+  /// @brief The content of the message, in the shared memory
+  std::string_view data;
+};
+
+/// @brief A ring of messages in a POSIX shared-memory segment, so the server
+/// publishes each live message once and any number of clients on the same
+/// host read it without going through the sockets. There is a single writer
+/// (the process that created the segment) and the readers never block it:
+/// each slot is protected by a sequence number (a seqlock), so a reader
+/// detects when a message was overwritten while it copied it and skips to
+/// the newest one instead. Only available on Linux and macOS (see
+/// [isSupported])
+class SharedMemoryRing {
+public:
+  /// @brief The number of slots of the ring, by default
+  static constexpr size_t DefaultSlotCount = 8;
+
+  /// @brief The largest message that fits in a slot, by default
+  static constexpr size_t DefaultSlotSize = 4 * 1024 * 1024;
+
+  /// @brief Create the segment and become its writer. A stale segment with
+  /// the same name (e.g. left by a server that crashed) is replaced
+  /// @param name The name of the segment (e.g. "/neurobio_5000")
+  /// @param slotCount The number of messages kept in the ring
+  /// @param slotSize The largest message that can be published
+  SharedMemoryRing(const std::string &name, size_t slotCount,
+                   size_t slotSize);
+
+  /// @brief Open a segment created by another process, as a reader
+  /// @param name The name of the segment
+  SharedMemoryRing(const std::string &name);
+
+  /// @brief Destructor. The writer removes the segment, the readers that
+  /// still map it keep reading the last messages
+  ~SharedMemoryRing();
+
+  SharedMemoryRing(const SharedMemoryRing &) = delete;
+  SharedMemoryRing &operator=(const SharedMemoryRing &) = delete;
+
+  /// @brief If the shared memory is available on this platform
+  static bool isSupported();
+
+  /// @brief Publish a message in the next slot, overwriting the oldest one.
+  /// Only the writer can publish
+  /// @param dataType The type of the message
+  /// @param data The content of the message
+  /// @return True if the message was published, false if it is too large for
+  /// a slot (it should then be sent by other means)
+  bool publish(uint32_t dataType, const std::string &data);
+
+  /// @brief Read the message [sequence] if it is available. If the reader
+  /// fell behind and the message was overwritten, the newest message is read
+  /// instead
+  /// @param sequence The sequence of the message to read (0 for the first one
+  /// ever published), which is moved past the message read
+  /// @param message The message read, if any. Its buffer is reused
+  /// @return True if a message was read, false if there is no new message
+  bool read(uint64_t &sequence, SharedMemoryMessage &message) const;
+
+  /// @brief Same as [read], but the message is not copied out of the shared
+  /// memory. It must be checked with [isValid] once it was used
+  /// @param sequence The sequence of the message to view, which is moved past
+  /// the message viewed
+  /// @param message The message viewed, if any
+  /// @return True if a message was viewed, false if there is no new message
+  bool view(uint64_t &sequence, SharedMemoryView &message) const;
+
+  /// @brief If a message viewed with [view] was not overwritten since, so
+  /// what was read from it is consistent
+  /// @param message The message viewed
+  bool isValid(const SharedMemoryView &message) const;
+
+  /// @brief Get the number of messages published since the segment was
+  /// created, which is the sequence of the next message
+  uint64_t getWriteSequence() const;
+
+  /// @brief Get the random number drawn when the segment was created, so a
+  /// reader can tell it opened the segment of a given writer and not a stale
+  /// one
+  uint64_t getToken() const;
+
+protected:
+  /// @brief The layout of the beginning of the segment
+  struct Header;
+
+  /// @brief The layout of the beginning of each slot
+  struct SlotHeader;
+
+  /// @brief The size of [Header], padded to a cache line
+  static size_t headerSize();
+
+  /// @brief The distance between two slots, padded to a cache line
+  /// @param slotSize The largest message a slot can hold
+  static size_t slotStride(size_t slotSize);
+
+  /// @brief Map [m_MappedSize] bytes of the file descriptor
+  /// @param fileDescriptor The descriptor of the segment
+  void map(int fileDescriptor);
+
+  /// @brief Get the header of a slot
+  SlotHeader &slot(uint64_t sequence) const;
+
+  /// @brief The name of the segment
+  DECLARE_PROTECTED_MEMBER(std::string, Name);
+
+  /// @brief The number of slots of the ring
+  DECLARE_PROTECTED_MEMBER(size_t, SlotCount);
+
+  /// @brief The largest message a slot can hold
+  DECLARE_PROTECTED_MEMBER(size_t, SlotSize);
+
+  /// @brief If this process created the segment (and is its writer)
+  DECLARE_PROTECTED_MEMBER(bool, IsWriter);
+
+  /// @brief The size of the segment
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, MappedSize);
+
+  /// @brief Where the segment is mapped in this process
+  DECLARE_PROTECTED_MEMBER_NOGET(char *, Memory);
+};
+
+} // namespace NEUROBIO_NAMESPACE::server
+
+#endif // __NEUROBIO_SERVER_SHARED_MEMORY_RING_H__
@@ -3,17 +3,26 @@
 
 #include "neurobioConfig.h"
 
+#include "Analyzer/Predictions.h"
 #include "Data/TimeSeries.h"
 #include "Server/TcpServer.h"
 #include "Utils/CppMacros.h"
+#include "Utils/NeurobioEvent.h"
 #include <asio.hpp>
+#include <condition_variable>
 
 namespace NEUROBIO_NAMESPACE::server {
 
 class ServerResponse {
 public:
+  /// @brief A function that fills the buffer with the next bytes from the
+  /// server, returning the number of bytes read
+  using ReadFunction =
+      std::function<size_t(asio::mutable_buffer, asio::error_code &)>;
+
   ServerResponse();
   ServerResponse(asio::ip::tcp::socket &socket, std::shared_mutex &mutex);
+  ServerResponse(const ReadFunction &read, std::shared_mutex &mutex);
   virtual ~ServerResponse() = default;
 
 protected:
@@ -24,6 +33,13 @@ protected:
   DECLARE_PROTECTED_MEMBER(std::chrono::system_clock::time_point, Timestamp);
   DECLARE_PROTECTED_MEMBER(std::vector<char>, Data);
 
+  /// @brief If the packet responds to a pipelined request (see
+  /// [PIPELINED_PROTOCOL_VERSION]), in which case it carries its id
+  DECLARE_PROTECTED_MEMBER(bool, HasRequestId);
+
+  /// @brief The id of the request the packet responds to, if [HasRequestId]
+  DECLARE_PROTECTED_MEMBER(uint32_t, RequestId);
+
 protected:
   /// @brief Check the version from the packet
   /// @param buffer The buffer to check
@@ -50,19 +66,35 @@ protected:
   std::chrono::system_clock::time_point
   parseTimeStampFromPacket(const std::vector<char> &buffer);
 
-  /// @brief Read the header from the socket
-  /// @param socket The socket to read from
+  /// @brief Read the header from the socket, including the id of the request
+  /// if the packet responds to a pipelined one
+  /// @param read The function that reads from the socket
   /// @return The header read from the socket
-  std::vector<char> readHeaderFromSocket(asio::ip::tcp::socket &socket);
+  std::vector<char> readHeaderFromSocket(const ReadFunction &read);
 
   /// @brief Read and fill the data from the socket
-  /// @param socket The socket to read from
+  /// @param read The function that reads from the socket
   /// @param type The data type to read
   /// @return The data read from the socket
-  std::vector<char> readDataFromSocket(asio::ip::tcp::socket &socket,
+  std::vector<char> readDataFromSocket(const ReadFunction &read,
                                        TcpServerDataType type);
 };
 
+/// @brief A packet of live data (or live analyses) received by a client
+template <typename T> struct LiveReception {
+  /// @brief When the server sent the packet (the timestamp of its header)
+  std::chrono::system_clock::time_point sentAt;
+
+  /// @brief When the client finished receiving the packet
+  std::chrono::system_clock::time_point receivedAt;
+
+  /// @brief The size of the packet data
+  size_t byteCount = 0;
+
+  /// @brief The content of the packet
+  T content;
+};
+
 class TcpClient {
 public:
   /// @brief Constructor
@@ -129,12 +161,69 @@ public:
   /// @return True if the data is received, false otherwise
   std::map<std::string, data::TimeSeries> getLastTrialData();
 
+  /// @brief Get the zones of code recently traced by the server
+  /// @return The trace in the Chrome trace event format, or an empty json if
+  /// it could not be received
+  nlohmann::json getTrace();
+
+  /// @brief Get a snapshot of the counters and histograms of the server
+  /// @return The metrics, or an empty json if they could not be received
+  nlohmann::json getMetrics();
+
+  /// @brief Receive the live data and analyses from the shared memory of the
+  /// server instead of the live sockets. This only works if the server runs on
+  /// the same host and has its shared memory enabled; otherwise the live data
+  /// keep coming through the sockets
+  /// @return True if the live data are now read from the shared memory, false
+  /// otherwise
+  bool useSharedMemory();
+
+  /// @brief Narrow down what the client receives of the live stream (see
+  /// [LiveSubscription] for the format). The clients using the shared memory
+  /// keep receiving everything
+  /// @param subscription The subscription, or an empty json for everything
+  /// @return True if the server accepted the subscription, false otherwise
+  bool subscribe(const nlohmann::json &subscription);
+
+  /// @brief Ask the server for the live data missed since the last ones
+  /// received, e.g. after reconnecting with the same state ID. The server
+  /// sends them from its replay history, as a single reception given to
+  /// [onNewLiveData]. The samples older than the history are lost
+  /// @return True if the missed live data were received, false otherwise
+  bool resumeLiveData();
+
   /// @brief Add an analyzer to the collection
   bool addAnalyzer(const nlohmann::json &analyzer);
 
   /// @brief Remove an analyzer from the collection
   bool removeAnalyzer(const std::string &analyzerName);
 
+  /// @brief Get the states of the server (see GET_STATES)
+  /// @return The states, or an empty json if they could not be received
+  nlohmann::json getStates();
+
+  /// @brief Get the states of the server without asking for them. Once they
+  /// were received (see [getStates]), a pipelined client keeps them up to date
+  /// with the changes the server sends. The clock skews are those of the last
+  /// [getStates]
+  /// @return The states, or an empty json if they were never received or a
+  /// change was missed (they must then be received again)
+  nlohmann::json getCachedStates();
+
+  /// @brief Called each time live data are received, by data collector name
+  utils::NeurobioEvent<
+      LiveReception<std::map<std::string, data::TimeSeries>>>
+      onNewLiveData;
+
+  /// @brief Called each time live analyses are received. If the client
+  /// subscribed to the binary analyses (see [LiveSubscription]), they are the
+  /// last prediction of each analyzer in the packet
+  utils::NeurobioEvent<LiveReception<analyzer::Predictions>> onNewLiveAnalyses;
+
+  /// @brief Called each time binary analyses are received, with all the
+  /// predictions made since the previous packet
+  utils::NeurobioEvent<LiveReception<LivePredictions>> onNewLivePredictions;
+
 protected:
   /// @brief The data received from the server
   DECLARE_PROTECTED_MEMBER(data::TimeSeries, Data);
@@ -155,6 +244,17 @@ protected:
   /// @brief The port to communicate the live analyses
   DECLARE_PROTECTED_MEMBER(int, LiveAnalysesPort);
 
+  /// @brief The port of the server that carries all the channels on a single
+  /// connexion (see [MultiplexedSocket]). If it is set (not 0) before
+  /// connecting, the client connects to it instead of the four other ports
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(int, MultiplexedPort);
+
+  /// @brief If the client tags its commands with the id of the request (see
+  /// [PIPELINED_PROTOCOL_VERSION]), so it can send commands from many threads
+  /// without waiting for the responses of the others. It must be set before
+  /// connecting
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(bool, IsPipelined);
+
   /// @brief If the client is connected to the server
   DECLARE_PROTECTED_MEMBER(bool, IsConnected);
 
@@ -164,12 +264,66 @@ protected:
   /// @brief Receive and update the live data
   void updateLiveData();
 
+  /// @brief Remember the sequence number of the next sample of each data
+  /// collector, as received with the live data
+  /// @param liveData The live data, as serialized by the server
+  void updateLiveSequences(const nlohmann::json &liveData);
+
+  /// @brief Remember the sequence number of the next sample of each data
+  /// collector, as received with the compressed live data
+  /// @param sequences The sequence numbers, by data collector name
+  void updateLiveSequences(const std::map<std::string, size_t> &sequences);
+
+  /// @brief The sequence number of the next sample to receive, by data
+  /// collector name. It is kept when reconnecting, so [resumeLiveData] knows
+  /// what was missed
+  std::map<std::string, size_t> m_LiveSequences;
+
+  /// @brief The mutex to protect [m_LiveSequences]
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, LiveSequencesMutex);
+
   /// @brief Main loop for the live analyses streaming
   void startUpdatingLiveAnalyses();
 
   /// @brief Receive and update the live analyses
   void updateLiveAnalyses();
 
+  /// @brief Main loop for the live data and analyses read from the shared
+  /// memory
+  /// @param sequence The sequence of the first message to read
+  void startUpdatingFromSharedMemory(uint64_t sequence);
+
+  /// @brief Parse in place and dispatch the new message of the shared memory.
+  /// The message is dropped if the server overwrote it while it was parsed
+  /// @param sequence The sequence of the next message to read
+  /// @return True if any message was read, false otherwise
+  bool updateFromSharedMemory(uint64_t &sequence);
+
+  /// @brief Write a command to the server
+  /// @param command The command to write
+  /// @param requestId The id given to the request, if the client is pipelined
+  /// @return True if the command was written, false otherwise (the client is
+  /// then disconnected)
+  bool writeCommand(TcpServerCommand command, uint32_t &requestId);
+
+  /// @brief Wait for the response of the server on the command channel
+  /// @param requestId The id of the request, if the client is pipelined
+  /// @return The response of the server
+  ServerResponse readCommandResponse(uint32_t requestId);
+
+  /// @brief Wait for the packet responding to a pipelined request
+  /// @param channel The channel the packet is sent on
+  /// @param requestId The id of the request
+  /// @return The packet, or an empty response if the client disconnected
+  ServerResponse waitForResponse(TcpServerChannel channel, uint32_t requestId);
+
+  /// @brief Keep a packet responding to a pipelined request for the thread
+  /// waiting for it
+  /// @param channel The channel the packet was sent on
+  /// @param response The packet
+  void dispatchResponse(TcpServerChannel channel,
+                        const ServerResponse &response);
+
   /// @brief The Send a command to the server and wait for the confirmation
   /// @param command The command to send
   /// @return The acknowledgment from the server
@@ -178,9 +332,12 @@ protected:
   /// @brief The Send a command to the server and wait for the confirmation
   /// @param command The command to send
   /// @param data The data to send with the command
+  /// @param responseData If not null, filled with the data the server responds
+  /// with on the message channel
   /// @return The acknowledgment from the server
   ServerResponse sendCommandWithData(TcpServerCommand command,
-                                     const nlohmann::json &data);
+                                     const nlohmann::json &data,
+                                     std::vector<char> *responseData = nullptr);
   /// @brief The Send a command to the server and wait for the confirmation
   /// @param command The command to send
   /// @param data The data to send with the command
@@ -197,15 +354,82 @@ protected:
   DECLARE_PROTECTED_MEMBER_NOGET(ServerResponse, PreviousMessage);
   DECLARE_PROTECTED_MEMBER_NOGET(bool, HasPreviousMessage);
 
+  /// @brief The id of the next pipelined request
+  std::atomic<uint32_t> m_NextRequestId;
+
+  /// @brief The packets responding to the pipelined requests, by channel and
+  /// id of the request, until the thread waiting for them takes them
+  std::map<std::pair<TcpServerChannel, uint32_t>, ServerResponse>
+      m_PipelinedResponses;
+
+  /// @brief The mutex to protect [m_PipelinedResponses]
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, PipelinedResponsesMutex);
+
+  /// @brief Notified each time a packet responding to a pipelined request is
+  /// received (or the client disconnects)
+  DECLARE_PROTECTED_MEMBER_NOGET(std::condition_variable,
+                                 PipelinedResponsesCondition);
+
+  /// @brief The mutex to keep the commands written from many threads from
+  /// interleaving
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, WriteMutex);
+
+  /// @brief Update the cached states with a packet of the message channel
+  /// holding the states (GET_STATES) or their changes (STATES_CHANGED)
+  /// @param response The packet
+  void updateCachedStates(const ServerResponse &response);
+
+  /// @brief The last states received from the server, without their version
+  DECLARE_PROTECTED_MEMBER_NOGET(nlohmann::json, CachedStates);
+
+  /// @brief The version of [CachedStates]
+  DECLARE_PROTECTED_MEMBER_NOGET(uint64_t, CachedStatesVersion);
+
+  /// @brief The latest version of the states the server told about. Older
+  /// states are not cached, as they may reach the client after their changes
+  DECLARE_PROTECTED_MEMBER_NOGET(uint64_t, LatestStatesVersion);
+
+  /// @brief If [CachedStates] are up to date with the server
+  DECLARE_PROTECTED_MEMBER_NOGET(bool, HasCachedStates);
+
+  /// @brief The mutex to protect [CachedStates]
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, CachedStatesMutex);
+
+  /// @brief Shut the sockets down, so the workers blocked reading them wake
+  /// up, without closing them
+  void shutdownSockets();
+
   /// @brief Close the sockets
   void closeSockets();
 
+  /// @brief Write to one of the channels of the server
+  /// @param channel The channel to write to
+  /// @param buffer The bytes to write
+  /// @param error The error of the write, if any
+  /// @return The number of bytes written
+  size_t write(TcpServerChannel channel, asio::const_buffer buffer,
+               asio::error_code &error);
+
+  /// @brief Read the next packet the server sent on one of the channels
+  /// @param channel The channel to read from
+  /// @param mutex The mutex to lock while the response is filled
+  /// @return The packet
+  ServerResponse readResponse(TcpServerChannel channel,
+                              std::shared_mutex &mutex);
+
   /// @brief Construct a command packet to send to the server
   /// @param command The command to send
   /// @return The corresponding packet
   std::array<char, BYTES_IN_CLIENT_PACKET_HEADER>
   constructCommandPacket(TcpServerCommand command);
 
+  /// @brief Construct a pipelined command packet to send to the server
+  /// @param command The command to send
+  /// @param requestId The id of the request
+  /// @return The corresponding packet
+  std::array<char, BYTES_IN_CLIENT_PACKET_HEADER + BYTES_IN_REQUEST_ID>
+  constructCommandPacket(TcpServerCommand command, uint32_t requestId);
+
 private:
   DECLARE_PROTECTED_MEMBER_NOGET(std::thread, ContextWorker);
 
@@ -218,6 +442,10 @@ private:
 
   DECLARE_PROTECTED_MEMBER_NOGET(std::thread, MessageWorker);
 
+  /// @brief The worker thread that dispatches the responses to the pipelined
+  /// requests
+  DECLARE_PROTECTED_MEMBER_NOGET(std::thread, CommandWorker);
+
   /// @brief The socket that is connected to the server for response messages
   DECLARE_PRIVATE_MEMBER_NOGET(std::unique_ptr<asio::ip::tcp::socket>,
                                MessageSocket);
@@ -236,6 +464,17 @@ private:
   /// @brief The worker thread for the live analyses streaming
   DECLARE_PRIVATE_MEMBER_NOGET(std::thread, LiveAnalysesWorker);
 
+  /// @brief The socket that carries all the channels instead, if the client
+  /// connected to the multiplexed port
+  DECLARE_PRIVATE_MEMBER_NOGET(std::unique_ptr<MultiplexedSocket>,
+                               MultiplexedSocket);
+
+  /// @brief The shared memory of the server, if the client reads it
+  DECLARE_PRIVATE_MEMBER_NOGET(std::unique_ptr<SharedMemoryRing>, SharedMemory);
+
+  /// @brief The worker thread reading the shared memory
+  DECLARE_PRIVATE_MEMBER_NOGET(std::thread, SharedMemoryWorker);
+
 private:
   DECLARE_PRIVATE_MEMBER_NOGET(std::shared_mutex, PreviousMessageMutex);
 };
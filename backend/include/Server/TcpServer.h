@@ -4,9 +4,19 @@
 #include "neurobioConfig.h"
 
 #include "Analyzer/Analyzers.h"
+#include "Data/TimeSeries.h"
+#include "Devices/Concrete/SyntheticDevice.h"
 #include "Devices/Devices.h"
+#include "Server/LiveStreamRate.h"
+#include "Server/LiveSubscription.h"
+#include "Server/MultiplexedSocket.h"
+#include "Server/PredictionHistory.h"
+#include "Server/SharedMemoryRing.h"
 #include "Utils/CppMacros.h"
+#include "Utils/Metrics.h"
+#include <array>
 #include <asio.hpp>
+#include <atomic>
 #include <shared_mutex>
 
 namespace NEUROBIO_NAMESPACE::server {
@@ -17,6 +27,13 @@ static const uint32_t COMMUNICATION_PROTOCOL_VERSION = 2;
 static const size_t BYTES_IN_CLIENT_PACKET_HEADER = 8;
 static const size_t BYTES_IN_SERVER_PACKET_HEADER = 24;
 
+/// @brief The version of the protocol in which the commands carry the id of
+/// the request, so a client can send commands without waiting for the
+/// previous responses. The responses are tagged with the same id, and may
+/// come out of order (see [TcpServerRequest])
+static const uint32_t PIPELINED_PROTOCOL_VERSION = 3;
+static const size_t BYTES_IN_REQUEST_ID = 4;
+
 enum class TcpServerCommand : uint32_t {
   HANDSHAKE = 0,
   GET_STATES = 1,
@@ -33,6 +50,11 @@ enum class TcpServerCommand : uint32_t {
   GET_LAST_TRIAL_DATA = 32,
   ADD_ANALYZER = 50,
   REMOVE_ANALYZER = 51,
+  GET_TRACE = 60,
+  GET_METRICS = 61,
+  USE_SHARED_MEMORY = 62,
+  SUBSCRIBE = 63,
+  RESUME_LIVE_DATA = 64,
   FAILED = 100,
   NONE = 0xFFFFFFFF,
 };
@@ -48,21 +70,132 @@ enum class TcpServerMessage : uint32_t {
 enum class TcpServerDataType : uint32_t {
   STATES = 0,
   FULL_TRIAL = 1,
+  TRACE = 2,
+  METRICS = 3,
+  SHARED_MEMORY = 4,
   LIVE_DATA = 10,
   LIVE_ANALYSES = 11,
+  LIVE_PREDICTIONS = 12,
+  LIVE_DATA_COMPRESSED = 13,
   NONE = 0xFFFFFFFF,
 };
 
-class ClientSession {
+/// @brief A command received from a client. If the client pipelines its
+/// commands (see [PIPELINED_PROTOCOL_VERSION]), it comes with the id of the
+/// request, which the packets responding to it carry
+struct TcpServerRequest {
+  /// @brief A request that is not pipelined
+  /// @param command The command requested
+  TcpServerRequest(TcpServerCommand command)
+      : command(command), id(0), isPipelined(false) {}
+
+  /// @brief A pipelined request
+  /// @param command The command requested
+  /// @param id The id the client gave to the request
+  TcpServerRequest(TcpServerCommand command, uint32_t id)
+      : command(command), id(id), isPipelined(true) {}
+
+  /// @brief The command requested
+  TcpServerCommand command;
+
+  /// @brief The id the client gave to the request, if it is pipelined
+  uint32_t id;
+
+  /// @brief If the request is pipelined
+  bool isPipelined;
+};
+
+/// @brief Construct a packet sent by the server that carries no extra data
+/// @param request The request the packet responds to (NONE if it does not
+/// respond to a command)
+/// @param message The message of the server
+/// @return The packet, as written to the socket
+std::vector<char> constructMessagePacket(const TcpServerRequest &request,
+                                         TcpServerMessage message);
+
+/// @brief Construct a packet sent by the server that carries extra data
+/// @param request The request the packet responds to (NONE if it does not
+/// respond to a command)
+/// @param message The message of the server
+/// @param dataType The type of the extra data
+/// @param data The extra data
+/// @return The packet, as written to the socket
+std::vector<char> constructMessagePacket(const TcpServerRequest &request,
+                                         TcpServerMessage message,
+                                         TcpServerDataType dataType,
+                                         const std::string &data);
+
+/// @brief A packet sent by the server, kept as its header and its extra data
+/// so they are written together (scatter-gather) without copying the data
+/// into the packet. The extra data are shared and immutable, so the same
+/// packet can be written to all the clients. The header is stored in the
+/// packet itself, so constructing a packet does not allocate
+class MessagePacket {
+public:
+  /// @brief Construct a packet that carries no extra data
+  /// @param request The request the packet responds to (NONE if it does not
+  /// respond to a command)
+  /// @param message The message of the server
+  MessagePacket(const TcpServerRequest &request, TcpServerMessage message);
+
+  /// @brief Construct a packet that carries extra data
+  /// @param request The request the packet responds to (NONE if it does not
+  /// respond to a command)
+  /// @param message The message of the server
+  /// @param dataType The type of the extra data
+  /// @param data The extra data
+  MessagePacket(const TcpServerRequest &request, TcpServerMessage message,
+                TcpServerDataType dataType,
+                std::shared_ptr<const std::string> data);
+
+  /// @brief Get the buffers to write to the socket, the header then the extra
+  /// data
+  std::array<asio::const_buffer, 2> buffers() const;
+
+  /// @brief Get the size of the packet, as written to the socket
+  size_t size() const;
+
+  /// @brief Get the extra data, if any
+  const std::shared_ptr<const std::string> &data() const { return m_Data; }
+
+protected:
+  /// @brief The header of the packet, followed by the id of the request if it
+  /// is pipelined and the size of the extra data if there are any
+  std::array<char, BYTES_IN_SERVER_PACKET_HEADER + BYTES_IN_REQUEST_ID + 8>
+      m_Header;
+
+  /// @brief The number of bytes used in [m_Header]
+  size_t m_HeaderSize;
+
+  /// @brief The extra data, if any
+  std::shared_ptr<const std::string> m_Data;
+};
+
+/// @brief Get the name of the shared memory of a server (see
+/// [TcpServer::setIsSharedMemoryEnabled]), so the clients on the same host can
+/// open it
+/// @param commandPort The command port of the server
+/// @return The name of the shared memory
+std::string sharedMemoryName(int commandPort);
+
+/// @brief A client connected to the server. Everything the session does on its
+/// own (reading and handling the commands, connecting its sockets and timing
+/// out) runs in order on its [Strand], while the sessions run in parallel on
+/// the thread pool of the server
+class ClientSession : public std::enable_shared_from_this<ClientSession> {
 public:
   ClientSession(
       std::shared_ptr<asio::io_context> context, uint32_t id,
-      std::function<bool(TcpServerCommand command, const ClientSession &client)>
+      std::function<bool(const TcpServerRequest &request,
+                         const ClientSession &client)>
           handleHandshake,
-      std::function<bool(TcpServerCommand command, const ClientSession &client)>
+      std::function<bool(const TcpServerRequest &request,
+                         const ClientSession &client)>
           handleCommand,
       std::function<void(const ClientSession &client)> onDisconnect,
-      std::chrono::milliseconds timeoutPeriod);
+      std::chrono::milliseconds timeoutPeriod,
+      const LiveStreamRate &liveDataRate,
+      const LiveStreamRate &liveAnalysesRate);
 
   ~ClientSession();
 
@@ -91,6 +224,11 @@ public:
   /// @param socket The socket to connect the live analyses socket to
   void connectLiveAnalysesSocket(std::shared_ptr<asio::ip::tcp::socket> socket);
 
+  /// @brief Connect all the channels at once to a socket that multiplexes
+  /// them (see [MultiplexedSocket]), instead of a socket each
+  /// @param socket The socket that carries all the channels
+  void connectMultiplexedSocket(std::shared_ptr<asio::ip::tcp::socket> socket);
+
   /// @brief Returns if the session is connected
   /// @return True if the session is connected, false otherwise
   bool isConnected() const;
@@ -98,19 +236,110 @@ public:
   /// @brief Disconnects the session
   void disconnect();
 
+  /// @brief Shut the sockets of the session down, without closing them. The
+  /// reads and writes pending on any thread fail, and so do the next ones
+  void shutdown() const;
+
+  /// @brief Write a packet to one of the channels of the session. The time it
+  /// took and the bytes sent to the live channels are recorded (see
+  /// [utils::Metrics])
+  /// @param channel The channel to write to
+  /// @param packet The packet to write
+  /// @param error The error of the write, if any
+  /// @return The number of bytes written
+  size_t write(TcpServerChannel channel, const MessagePacket &packet,
+               asio::error_code &error) const;
+
+  /// @brief Fill the buffer with the next bytes the client sent on one of the
+  /// channels of the session
+  /// @param channel The channel to read from
+  /// @param buffer The buffer to fill
+  /// @param error The error of the read, if any
+  /// @return The number of bytes read
+  size_t read(TcpServerChannel channel, asio::mutable_buffer buffer,
+              asio::error_code &error) const;
+
+  /// @brief Returns if the client is on the same host as the server, which it
+  /// must be to read the shared memory
+  bool isLocal() const;
+
+  /// @brief If the client reads the live data and analyses from the shared
+  /// memory of the server instead of its live sockets
+  bool getIsUsingSharedMemory() const { return m_IsUsingSharedMemory; }
+
+  /// @brief Set if the client reads the live data and analyses from the
+  /// shared memory of the server instead of its live sockets
+  void setIsUsingSharedMemory(bool value) { m_IsUsingSharedMemory = value; }
+
+  /// @brief Get what the client receives of the live stream
+  std::shared_ptr<const LiveSubscription> getLiveSubscription() const;
+
+  /// @brief Set what the client receives of the live stream (set by the
+  /// command loop, read by the live loops)
+  /// @param subscription The new subscription of the client
+  void
+  setLiveSubscription(std::shared_ptr<const LiveSubscription> subscription);
+
+  /// @brief Check if a live packet is due to the client, given the maximum
+  /// rate of its subscription and how fast it reads the channel. If it is, the
+  /// next one is scheduled
+  /// @param channel The live channel of the packet
+  /// @return True if the packet should be sent, false if it should be skipped
+  bool isLiveDue(TcpServerChannel channel);
+
+  /// @brief Adapt the rate of a live channel to the time it took to write the
+  /// last packet of the channel to the client (see [LiveStreamRate])
+  /// @param channel The live channel of the packet
+  /// @param writeDuration The time it took to write the packet
+  void updateLiveRate(TcpServerChannel channel,
+                      std::chrono::steady_clock::duration writeDuration);
+
 protected:
   /// @brief The asio contexts used for async methods of the server
   DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<asio::io_context>, Context);
 
+  /// @brief The strand the session runs on, so its handlers never run
+  /// concurrently
+  DECLARE_PROTECTED_MEMBER(asio::strand<asio::io_context::executor_type>,
+                           Strand);
+
   /// @brief The sessions id of the client
   DECLARE_PROTECTED_MEMBER(uint32_t, Id);
 
   /// @brief Whether the handshake has been completed
   DECLARE_PROTECTED_MEMBER(bool, IsHandshakeDone);
 
+  /// @brief If the client made its handshake in [PIPELINED_PROTOCOL_VERSION],
+  /// in which case it is sent the changes of the states along the
+  /// STATES_CHANGED events
+  DECLARE_PROTECTED_MEMBER(bool, IsPipelined);
+
   /// @brief The internal variable to prevent from disconnecting more
   /// than once
-  DECLARE_PRIVATE_MEMBER_NOGET(bool, HasDisconnected);
+  DECLARE_PRIVATE_MEMBER_NOGET(std::atomic<bool>, HasDisconnected);
+
+  /// @brief If the client reads the live data and analyses from the shared
+  /// memory (set by the command loop, read by the live loops)
+  std::atomic<bool> m_IsUsingSharedMemory;
+
+  /// @brief What the client receives of the live stream
+  std::shared_ptr<const LiveSubscription> m_LiveSubscription;
+
+  /// @brief The mutex to protect the subscription of the client
+  mutable std::mutex m_LiveSubscriptionMutex;
+
+  /// @brief When the next live packet is due to the client, by channel
+  std::array<std::chrono::steady_clock::time_point, TCP_SERVER_CHANNEL_COUNT>
+      m_NextLiveTimes;
+
+  /// @brief The interval between two packets of each live channel, adapted to
+  /// how fast this client reads them. Only the live loops touch them
+  std::map<TcpServerChannel, LiveStreamRate> m_LiveRates;
+
+  /// @brief The sequence of the last prediction sent to the client, if it
+  /// subscribed to the binary analyses (0 if none was). Only the live analyses
+  /// loop touches it
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(uint64_t, LastPredictionSequence);
 
   /// @brief The command socket used to communicate with the client
   DECLARE_PROTECTED_MEMBER(std::shared_ptr<asio::ip::tcp::socket>,
@@ -124,20 +353,29 @@ protected:
   /// @brief The live analyses socket used to communicate with the client
   DECLARE_PROTECTED_MEMBER(std::shared_ptr<asio::ip::tcp::socket>,
                            LiveAnalysesSocket);
+  /// @brief The socket that carries all the channels instead, if the client
+  /// connected to the multiplexed port
+  DECLARE_PROTECTED_MEMBER(std::shared_ptr<MultiplexedSocket>,
+                           MultiplexedSocket);
+
+  /// @brief Get the socket of a channel, when they are not multiplexed
+  /// @param channel The channel
+  const std::shared_ptr<asio::ip::tcp::socket> &
+  socket(TcpServerChannel channel) const;
 
   /// @brief The function to call when a handshake is received
-  /// @param command The command received
+  /// @param request The request received
   /// @param id The session ID
   DECLARE_PROTECTED_MEMBER_NOGET(
-      std::function<bool(TcpServerCommand command,
+      std::function<bool(const TcpServerRequest &request,
                          const ClientSession &client)>,
       HandleHandshake);
 
   /// @brief The function to call when a command is received
-  /// @param command The command received
+  /// @param request The request received
   /// @param id The session ID
   DECLARE_PROTECTED_MEMBER_NOGET(
-      std::function<bool(TcpServerCommand command,
+      std::function<bool(const TcpServerRequest &request,
                          const ClientSession &client)>,
       HandleCommand);
 
@@ -145,6 +383,19 @@ protected:
   DECLARE_PROTECTED_MEMBER_NOGET(
       std::function<void(const ClientSession &client)>, OnDisconnect);
 
+  /// @brief The time taken to write to the client
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Histogram>,
+                                 SendDurationMetric);
+
+  /// @brief The number of bytes written to the client
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Counter>,
+                                 SentBytesMetric);
+
+  /// @brief The number of bytes waiting for the client to be written. It stays
+  /// up when the client does not read fast enough
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Gauge>,
+                                 QueuedBytesMetric);
+
   /// @brief Start the timer for the timeout
   void startTimerForTimeout();
 
@@ -154,6 +405,20 @@ protected:
 
   /// @brief The session loop that handles the command socket
   void commandSocketLoop();
+
+  /// @brief The session loop that handles the multiplexed socket
+  void multiplexedSocketLoop();
+
+  /// @brief Handle a command packet received from the client. The id of the
+  /// request, if it is pipelined, is read from the command channel
+  /// @param buffer The command packet
+  /// @return False if the client should be disconnected
+  bool handleCommandPacket(
+      const std::array<char, BYTES_IN_CLIENT_PACKET_HEADER> &buffer);
+
+  /// @brief The mutexes that keep the packets written to each channel from
+  /// interleaving, as the commands are handled on more than one thread
+  mutable std::array<std::mutex, TCP_SERVER_CHANNEL_COUNT> m_WriteMutexes;
 };
 
 class TcpServer {
@@ -169,7 +434,7 @@ public:
             int liveDataPort = 5002, int liveAnalysesPort = 5003);
 
   /// @brief Destructor
-  ~TcpServer();
+  virtual ~TcpServer();
   TcpServer(const TcpServer &) = delete;
 
   // ----------------------- //
@@ -205,11 +470,14 @@ protected:
   /// @return The session for the given id
   std::shared_ptr<ClientSession> getOrCreateSession(uint32_t id);
 
-  /// @brief Read the session id from the socket
+  /// @brief Read the session id from the socket, then connect the socket to
+  /// the session (on the strand of the session). The socket is closed if the
+  /// id is invalid, already connected or not sent in time
   /// @param socket The socket to read the session id from
-  /// @return The session id read from the socket
-  uint32_t
-  readSessionIdFromSocket(std::shared_ptr<asio::ip::tcp::socket> socket);
+  /// @param connect The function that connects the socket to the session
+  void readSessionIdFromSocket(
+      std::shared_ptr<asio::ip::tcp::socket> socket,
+      std::function<void(ClientSession &session)> connect);
 
   /// @brief The mutex used to protect the sessions
   DECLARE_PROTECTED_MEMBER_NOGET(std::shared_mutex, SessionMutex);
@@ -243,6 +511,10 @@ protected:
   /// @param socket The socket that has answered the connexion
   void handleLiveAnalysesSocket(std::shared_ptr<asio::ip::tcp::socket> socket);
 
+  /// @brief Handle a multiplexed socket connexion
+  /// @param socket The socket that has answered the connexion
+  void handleMultiplexedSocket(std::shared_ptr<asio::ip::tcp::socket> socket);
+
   /// @brief Handle a client that has disconnected
   /// @param session The client session that has disconnected
   void handleClientHasDisconnected(const ClientSession &session);
@@ -257,33 +529,107 @@ protected:
   /// @brief The id of the connected devices
   std::map<std::string, size_t> m_ConnectedDeviceIds;
 
+  /// @brief The mutex that lets only one command at a time change the devices.
+  /// The other commands do not wait for it: [Devices] locks its own collection
+  /// and gives away shared devices
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, DevicesMutex);
+
+  /// @brief The states of the server (as sent by GET_STATES, without the clock
+  /// skews), as of the last change
+  DECLARE_PROTECTED_MEMBER_NOGET(nlohmann::json, States);
+
+  /// @brief The version of [States], incremented each time they change
+  DECLARE_PROTECTED_MEMBER_NOGET(uint64_t, StatesVersion);
+
+  /// @brief The mutex to protect [States]. It is never held while writing to
+  /// the clients, so a slow client does not hold the others
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, StatesMutex);
+
+  /// @brief If [States] may be out of date, that is if a command changed the
+  /// states or if a device got connected or disconnected since they were
+  /// serialized
+  DECLARE_PROTECTED_MEMBER_NOGET(std::atomic<bool>, AreStatesDirty);
+
+  /// @brief The id of the listener of [Devices::onDeviceConnectionChanged]
+  DECLARE_PROTECTED_MEMBER_NOGET(size_t, DevicesConnectionListenerId);
+
+  /// @brief Serialize the states of the devices and of the analyzers
+  /// @return The states, without the clock skews of the devices (which change
+  /// all the time and are only added to the GET_STATES responses)
+  nlohmann::json serializeStates() const;
+
+  /// @brief Get the states in the GET_STATES format, that is [States] with
+  /// their version and the current clock skews of the devices. [StatesMutex]
+  /// must be locked
+  /// @return The states
+  nlohmann::json getStatesWithVersion();
+
   // ----------------------------- //
   // --- COMMUNICATION METHODS --- //
   // ----------------------------- //
 protected:
   /// @brief Handle the handshake command
-  /// @param command The command to handle (this should be HANDSHAKE)
+  /// @param request The request to handle (this should be HANDSHAKE)
   /// @param session The client session that sent the command
   /// @return True if the handshake is successful, false otherwise
-  bool handleHandshake(TcpServerCommand command, const ClientSession &session);
+  bool handleHandshake(const TcpServerRequest &request,
+                       const ClientSession &session);
 
-  /// @brief Handle a command
-  /// @param command The command to handle
+  /// @brief Handle a command. The commands on the devices are handled by
+  /// [DevicesContext] instead, so the other commands do not wait for them
+  /// @param request The request to handle
   /// @param session The client session that sent the command
   /// @return True if the command is successful, false otherwise
-  bool handleCommand(TcpServerCommand command, const ClientSession &session);
+  bool handleCommand(const TcpServerRequest &request,
+                     const ClientSession &session);
 
-  /// @brief Send clients that the internal states has changed
+  /// @brief Handle a command that connects, disconnects or zeroes a device.
+  /// These can take long (e.g. the handshake with the Trigno), so they are
+  /// handled one at a time, on the thread of [DevicesContext]
+  /// @param command The command to handle
+  /// @return The response to the command
+  TcpServerMessage handleDeviceCommand(TcpServerCommand command);
+
+  /// @brief Respond to a command once it is handled
+  /// @param request The request handled
+  /// @param message The response to the command
+  /// @param shouldNotifyClients If all the clients should be told that the
+  /// states changed
+  /// @param session The client session that sent the command
+  /// @return True if the response was sent, false otherwise
+  bool respondToCommand(const TcpServerRequest &request,
+                        TcpServerMessage message, bool shouldNotifyClients,
+                        const ClientSession &session);
+
+  /// @brief Send clients that the internal states has changed. [States] are
+  /// refreshed first, and the pipelined clients are sent what changed, so they
+  /// do not have to get all the states again
   /// @param command The command that triggered the state change
   void notifyClientsOfStateChange(TcpServerCommand command);
 
-  /// @brief Handle extra information from a command
-  /// @param command The command that sent the extra data
+  /// @brief Serialize the states again and update [States] and their version
+  /// if they changed. Nothing is done unless [AreStatesDirty]. [StatesMutex]
+  /// must be locked
+  /// @return What changed since the previous version (as a JSON patch), empty
+  /// if nothing did
+  nlohmann::json refreshStates();
+
+  /// @brief Send a change of the states to all the clients. This writes to
+  /// the clients, so [StatesMutex] must not be locked
+  /// @param command The command that triggered the state change
+  /// @param version The version of the states after the change
+  /// @param changes What changed (see [refreshStates])
+  void sendStateChange(TcpServerCommand command, uint64_t version,
+                       const nlohmann::json &changes);
+
+  /// @brief Handle extra information from a command. The client is
+  /// disconnected if it does not send it within [TimeoutPeriod]
+  /// @param request The request that sent the extra data
   /// @param error The error code to set if an error occurs
   /// @param session The client session that sent the command
   /// @return The response to send by the client (raises an exception if an
   /// error occurs)
-  nlohmann::json handleExtraData(TcpServerCommand command,
+  nlohmann::json handleExtraData(const TcpServerRequest &request,
                                  asio::error_code &error,
                                  const ClientSession &session);
 
@@ -306,6 +652,33 @@ protected:
   /// @brief The timeout period for the server
   DECLARE_PROTECTED_MEMBER(std::chrono::milliseconds, TimeoutPeriod);
 
+  /// @brief The number of threads the server runs on (the acceptors, the
+  /// sessions and the live loops share them). It is the number of cores by
+  /// default, and at least 2. It must be set before the server starts
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(size_t, ThreadCount);
+
+  /// @brief The port to listen to for the clients that carry all their
+  /// channels on a single connexion (see [MultiplexedSocket]), or 0 to not
+  /// listen to it. It must be set before the server starts
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(int, MultiplexedPort);
+
+  /// @brief If the live data and analyses are also published in a shared
+  /// memory (see [SharedMemoryRing]) for the clients on the same host. It must
+  /// be set before the server starts
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(bool, IsSharedMemoryEnabled);
+
+  /// @brief The number of live messages kept in the shared memory
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(size_t, SharedMemorySlotCount);
+
+  /// @brief The largest live message the shared memory can hold. The larger
+  /// ones are sent through the sockets
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(size_t, SharedMemorySlotSize);
+
+  /// @brief The shared memory the live data and analyses are published in, if
+  /// it is enabled. It is named "/neurobio_<command port>"
+  DECLARE_PROTECTED_MEMBER_NOGET(std::unique_ptr<SharedMemoryRing>,
+                                 SharedMemory);
+
   /// @brief The acceptor that listens to the command port
   DECLARE_PROTECTED_MEMBER_NOGET(std::unique_ptr<asio::ip::tcp::acceptor>,
                                  CommandAcceptor);
@@ -322,6 +695,10 @@ protected:
   DECLARE_PROTECTED_MEMBER_NOGET(std::unique_ptr<asio::ip::tcp::acceptor>,
                                  LiveAnalysesAcceptor);
 
+  /// @brief The acceptor that listens to the multiplexed port, if any
+  DECLARE_PROTECTED_MEMBER_NOGET(std::unique_ptr<asio::ip::tcp::acceptor>,
+                                 MultiplexedAcceptor);
+
   /// @brief The current status of the server
   DECLARE_PROTECTED_MEMBER(TcpServerStatus, Status);
 
@@ -355,6 +732,11 @@ protected:
   DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<asio::steady_timer>,
                                  LiveDataTimer);
 
+  /// @brief The interval at which the live data are sent (100 ms, backing off
+  /// up to 1 s for a client that does not keep up, by default). It must be set
+  /// before the server starts
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(LiveStreamRate, LiveDataRate);
+
   /// @brief The session loop that handles the live data socket
   void liveDataLoop();
 
@@ -362,20 +744,61 @@ protected:
   DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<asio::steady_timer>,
                                  LiveAnalysesTimer);
 
+  /// @brief The interval at which the live analyses are sent (25 ms, backing
+  /// off up to 250 ms for a client that does not keep up, by default). It must
+  /// be set before the server starts
+  DECLARE_PROTECTED_MEMBER_WITH_SETTER(LiveStreamRate, LiveAnalysesRate);
+
   /// @brief Handle the analysis of the live data
   void liveAnalysesLoop();
 
+  /// @brief The sequence numbers of the live data last sent and last analyzed
+  /// (see [devices::Devices::getLiveDataSequences]), so the loops skip the
+  /// ticks where no new sample was collected
+  std::map<size_t, size_t> m_LiveDataSequences;
+  std::map<size_t, size_t> m_LiveAnalysesSequences;
+
+  /// @brief The last predictions of the analyzers, so each client subscribed
+  /// to the binary analyses is sent the ones made since its last packet. Only
+  /// the live analyses loop touches it
+  PredictionHistory m_PredictionHistory;
+
+  /// @brief If the live loops stopped waking up because no client is
+  /// connected. They are started again by [wakeUpLiveLoops]
+  std::atomic<bool> m_IsLiveDataLoopPaused;
+  std::atomic<bool> m_IsLiveAnalysesLoopPaused;
+
+  /// @brief Pause a live loop if no client is connected. This is called by
+  /// the loop itself, which must then not be rescheduled
+  /// @param isPaused If the loop is paused, set to true if it is
+  /// @return True if the loop is paused
+  bool pauseLiveLoopIfIdle(std::atomic<bool> &isPaused);
+
+  /// @brief Start the live loops again if they were paused
+  void wakeUpLiveLoops();
+
+  /// @brief The time taken to serialize the live data and the live analyses
+  /// (see [utils::Metrics])
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Histogram>,
+                                 LiveDataSerializeDurationMetric);
+  DECLARE_PROTECTED_MEMBER_NOGET(std::shared_ptr<utils::Histogram>,
+                                 LiveAnalysesSerializeDurationMetric);
+
 private:
   /// @brief The asio contexts used for async methods of the server
   DECLARE_PRIVATE_MEMBER_NOGET(std::shared_ptr<asio::io_context>, Context);
 
-  /// @brief The asio contexts used for live data streaming
-  DECLARE_PRIVATE_MEMBER_NOGET(std::shared_ptr<asio::io_context>,
-                               LiveDataContext);
+  /// @brief The strands the live data and the live analyses loops run on, in
+  /// the thread pool of the server
+  DECLARE_PRIVATE_MEMBER_NOGET(asio::strand<asio::io_context::executor_type>,
+                               LiveDataStrand);
+  DECLARE_PRIVATE_MEMBER_NOGET(asio::strand<asio::io_context::executor_type>,
+                               LiveAnalysesStrand);
 
-  /// @brief The asio contexts used for live analyses streaming
+  /// @brief The asio context used for the commands on the devices. It runs on
+  /// a thread of its own, as the devices may block for a while
   DECLARE_PRIVATE_MEMBER_NOGET(std::shared_ptr<asio::io_context>,
-                               LiveAnalysesContext);
+                               DevicesContext);
 
   /// @brief The worker thread for the [startServerAsync] method
   DECLARE_PRIVATE_MEMBER_NOGET(std::thread, ServerWorker);
@@ -397,7 +820,8 @@ public:
       int commandPort = 5000, int messagePort = 5001, int liveDataPort = 5002,
       int liveAnalysesPort = 5003,
       std::chrono::milliseconds timeoutPeriod = std::chrono::milliseconds(5000))
-      : TcpServer(commandPort, messagePort, liveDataPort, liveAnalysesPort) {
+      : TcpServer(commandPort, messagePort, liveDataPort, liveAnalysesPort),
+        m_DeviceConnexionDelay(0) {
     m_TimeoutPeriod = timeoutPeriod;
   };
 
@@ -407,12 +831,86 @@ public:
     m_TimeoutPeriod = timeoutPeriod;
   }
 
+  /// @brief Generate the data of a device with a [devices::SyntheticDevice]
+  /// instead of its mock, for instance to load the server with more data than
+  /// the actual device produces
+  /// @param deviceName The name of the device (e.g. DelsysEmgDevice)
+  /// @param configuration The data to generate
+  void setSyntheticDevice(
+      const std::string &deviceName,
+      const devices::SyntheticDeviceConfiguration &configuration) {
+    m_SyntheticDevices[deviceName] = configuration;
+  }
+
+  /// @brief Make the devices take some time to connect, as the actual ones
+  /// do (e.g. the handshake with the Trigno)
+  /// @param delay The time each device takes to connect
+  void setDeviceConnexionDelay(std::chrono::milliseconds delay) {
+    m_DeviceConnexionDelay = delay;
+  }
+
+  /// @brief If both the live loops are paused, as no client is connected
+  bool areLiveLoopsPaused() const {
+    return m_IsLiveDataLoopPaused && m_IsLiveAnalysesLoopPaused;
+  }
+
   /// @brief Destructor
   ~TcpServerMock() = default;
   TcpServerMock(const TcpServerMock &) = delete;
 
 protected:
   void makeAndAddDevice(const std::string &deviceName) override;
+
+  /// @brief The configuration of the devices generated synthetically, by
+  /// device name
+  std::map<std::string, devices::SyntheticDeviceConfiguration>
+      m_SyntheticDevices;
+
+  /// @brief The time each device takes to connect
+  std::chrono::milliseconds m_DeviceConnexionDelay;
+};
+
+/// @brief A server streaming a recorded trial instead of the actual devices.
+/// Connecting a device replays the data it recorded during the trial, under
+/// its original name. The devices absent from the trial are mocked
+class TcpServerReplay : public TcpServerMock {
+
+public:
+  /// @brief Constructor
+  /// @param trial The data of each data collector, by data collector name
+  /// @param speed How many times faster than real time the data are replayed
+  /// (0 replays them as fast as possible)
+  /// @param isLooping If the data are replayed again once they are all sent
+  /// @param commandPort The port to communicate the commands (default is 5000)
+  /// @param messagePort The port to communicate the messages (default is 5001)
+  /// @param liveDataPort The port to communicate the live data (default is
+  /// 5002)
+  /// @param liveAnalysesPort The port to communicate the live analyses (default
+  /// is 5003)
+  TcpServerReplay(const std::map<std::string, data::TimeSeries> &trial,
+                  double speed = 1.0, bool isLooping = false,
+                  int commandPort = 5000, int messagePort = 5001,
+                  int liveDataPort = 5002, int liveAnalysesPort = 5003)
+      : TcpServerMock(commandPort, messagePort, liveDataPort,
+                      liveAnalysesPort),
+        m_ReplayTrial(trial), m_ReplaySpeed(speed),
+        m_IsReplayLooping(isLooping) {}
+
+  /// @brief Destructor
+  ~TcpServerReplay() = default;
+  TcpServerReplay(const TcpServerReplay &) = delete;
+
+protected:
+  void makeAndAddDevice(const std::string &deviceName) override;
+
+  /// @brief The recorded data of each data collector
+  std::map<std::string, data::TimeSeries> m_ReplayTrial;
+
+  /// @brief How many times faster than real time the data are replayed
+  DECLARE_PROTECTED_MEMBER(double, ReplaySpeed);
+
+  /// @brief If the data are replayed again once they are all sent
+  DECLARE_PROTECTED_MEMBER(bool, IsReplayLooping);
 };
 
 } // namespace NEUROBIO_NAMESPACE::server
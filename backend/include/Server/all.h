@@ -1,6 +1,10 @@
 #ifndef __NEUROBIO_SERVER_ALL_H__
 #define __NEUROBIO_SERVER_ALL_H__
 
+#include "Server/LiveSubscription.h"
+#include "Server/MultiplexedSocket.h"
+#include "Server/PredictionHistory.h"
+#include "Server/SharedMemoryRing.h"
 #include "Server/TcpClient.h"
 #include "Server/TcpServer.h"
 
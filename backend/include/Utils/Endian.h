@@ -0,0 +1,28 @@
+#ifndef __NEUROBIO_UTILS_ENDIAN_H__
+#define __NEUROBIO_UTILS_ENDIAN_H__
+
+// The bytes sent on the wire are little-endian. This provides htole32(),
+// htole64(), le32toh() and le64toh() on every platform
+
+#if defined(_WIN32) // Windows-specific byte swap functions
+// Windows is little-endian by default
+#define htole32(x) (x)
+#define htole64(x) (x)
+#define le32toh(x) (x)
+#define le64toh(x) (x)
+
+#elif defined(__APPLE__) // macOS
+#include <libkern/OSByteOrder.h>
+#define htole32(x) OSSwapHostToLittleInt32(x)
+#define le32toh(x) OSSwapLittleToHostInt32(x)
+#define htole64(x) OSSwapHostToLittleInt64(x)
+#define le64toh(x) OSSwapLittleToHostInt64(x)
+
+#elif defined(__linux__) // Linux
+#include <endian.h>
+
+#else
+#error "Unsupported platform"
+#endif
+
+#endif // __NEUROBIO_UTILS_ENDIAN_H__
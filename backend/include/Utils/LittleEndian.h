@@ -0,0 +1,71 @@
+#ifndef __NEUROBIO_UTILS_LITTLE_ENDIAN_H__
+#define __NEUROBIO_UTILS_LITTLE_ENDIAN_H__
+
+#include "neurobioConfig.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace NEUROBIO_NAMESPACE::utils {
+
+/// @brief Append the lowest bytes of a value to a buffer, the least
+/// significant first, whatever the byte order of the platform
+/// @param buffer The buffer to append to (a std::vector<char> or a std::string)
+/// @param value The value to append
+/// @param byteCount The number of bytes of [value] to append
+template <typename Buffer>
+void appendLittleEndian(Buffer &buffer, uint64_t value, size_t byteCount) {
+  for (size_t i = 0; i < byteCount; i++) {
+    buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+  }
+}
+
+/// @brief Read a value appended by [appendLittleEndian]
+/// @param buffer The buffer to read from
+/// @param position The position of the value in [buffer], moved past it
+/// @param byteCount The number of bytes of the value
+/// @param truncatedMessage The message of the std::runtime_error thrown if
+/// [buffer] ends before the value
+/// @return The value
+inline uint64_t readLittleEndian(const std::vector<char> &buffer,
+                                 size_t &position, size_t byteCount,
+                                 const char *truncatedMessage) {
+  if (position + byteCount > buffer.size()) {
+    throw std::runtime_error(truncatedMessage);
+  }
+  uint64_t value = 0;
+  for (size_t i = 0; i < byteCount; i++) {
+    auto byte = static_cast<unsigned char>(buffer[position++]);
+    value |= static_cast<uint64_t>(byte) << (8 * i);
+  }
+  return value;
+}
+
+/// @brief Append the bits of a double to a buffer (see [appendLittleEndian])
+/// @param buffer The buffer to append to
+/// @param value The value to append
+template <typename Buffer> void appendDouble(Buffer &buffer, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  appendLittleEndian(buffer, bits, 8);
+}
+
+/// @brief Read a double appended by [appendDouble]
+/// @param buffer The buffer to read from
+/// @param position The position of the value in [buffer], moved past it
+/// @param truncatedMessage The message of the std::runtime_error thrown if
+/// [buffer] ends before the value
+/// @return The value
+inline double readDouble(const std::vector<char> &buffer, size_t &position,
+                         const char *truncatedMessage) {
+  uint64_t bits = readLittleEndian(buffer, position, 8, truncatedMessage);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+} // namespace NEUROBIO_NAMESPACE::utils
+
+#endif // __NEUROBIO_UTILS_LITTLE_ENDIAN_H__
@@ -0,0 +1,192 @@
+#ifndef __NEUROBIO_UTILS_METRICS_H__
+#define __NEUROBIO_UTILS_METRICS_H__
+
+#include "neurobioConfig.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::utils {
+
+/// @brief A value that only goes up (e.g. the number of samples received)
+class Counter {
+public:
+  Counter();
+
+  /// @brief Increase the counter
+  /// @param value The value to add
+  void add(uint64_t value = 1) {
+    m_Value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /// @brief Get the current value of the counter
+  uint64_t value() const { return m_Value.load(std::memory_order_relaxed); }
+
+protected:
+  std::atomic<uint64_t> m_Value;
+};
+
+/// @brief A value that goes up and down (e.g. the number of bytes waiting to
+/// be sent)
+class Gauge {
+public:
+  Gauge();
+
+  /// @brief Set the gauge
+  /// @param value The new value
+  void set(int64_t value) { m_Value.store(value, std::memory_order_relaxed); }
+
+  /// @brief Move the gauge up (or down, if [value] is negative)
+  /// @param value The value to add
+  void add(int64_t value) {
+    m_Value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  /// @brief Get the current value of the gauge
+  int64_t value() const { return m_Value.load(std::memory_order_relaxed); }
+
+protected:
+  std::atomic<int64_t> m_Value;
+};
+
+/// @brief The distribution of a value (e.g. a duration), in log-linear buckets
+/// as in HdrHistogram: each power of two is split in [SubBucketCount] buckets,
+/// so any value is known within 1/[SubBucketCount] of itself. Recording is
+/// wait-free, so it can be done from the hot paths of any thread
+class Histogram {
+public:
+  /// @brief Constructor
+  /// @param unit The unit of the recorded values (e.g. "ns" or "bytes")
+  Histogram(const std::string &unit);
+
+  /// @brief The number of buckets each power of two is split in
+  static constexpr size_t SubBucketCount = 16;
+
+  /// @brief The total number of buckets, enough for any uint64_t value. The
+  /// values under 2 * [SubBucketCount] (32) have a bucket each, then each
+  /// power of two from 2^5 to 2^63 has [SubBucketCount] buckets
+  static constexpr size_t BucketCount =
+      2 * SubBucketCount + (64 - 5) * SubBucketCount;
+
+  /// @brief Record a value
+  /// @param value The value
+  void record(uint64_t value);
+
+  /// @brief Record a duration, in nanoseconds
+  /// @param duration The duration
+  void record(const std::chrono::nanoseconds &duration);
+
+  /// @brief Get the number of recorded values
+  uint64_t count() const;
+
+  /// @brief Get the value under which the given fraction of the recorded
+  /// values are
+  /// @param quantile The fraction (e.g. 0.99 for the 99th percentile)
+  /// @return The value, or 0 if nothing was recorded
+  uint64_t valueAtQuantile(double quantile) const;
+
+  /// @brief Get the count, min, max, mean and percentiles of the values
+  nlohmann::json serialize() const;
+
+protected:
+  /// @brief Get the bucket a value falls in
+  static size_t bucketIndex(uint64_t value);
+
+  /// @brief Get the largest value that falls in a bucket
+  static uint64_t bucketUpperBound(size_t index);
+
+  /// @brief The unit of the recorded values
+  DECLARE_PROTECTED_MEMBER(std::string, Unit);
+
+  /// @brief The number of values recorded in each bucket
+  std::array<std::atomic<uint64_t>, BucketCount> m_Buckets;
+
+  /// @brief The sum, smallest and largest of the recorded values
+  std::atomic<uint64_t> m_Sum;
+  std::atomic<uint64_t> m_Min;
+  std::atomic<uint64_t> m_Max;
+};
+
+/// @brief Record the time between its construction and its destruction in a
+/// [Histogram]
+class HistogramScope {
+public:
+  HistogramScope(Histogram &histogram)
+      : m_Histogram(histogram), m_Start(std::chrono::steady_clock::now()) {}
+
+  ~HistogramScope() {
+    m_Histogram.record(std::chrono::steady_clock::now() - m_Start);
+  }
+
+  HistogramScope(const HistogramScope &) = delete;
+  HistogramScope &operator=(const HistogramScope &) = delete;
+
+protected:
+  Histogram &m_Histogram;
+  std::chrono::steady_clock::time_point m_Start;
+};
+
+/// @brief The counters, gauges and histograms of the running process, so the
+/// acquisition can be monitored without parsing the logs. The metrics are
+/// created on first request; the hot paths should keep the returned pointer
+/// rather than looking the metric up each time
+class Metrics {
+public:
+  /// @brief Get the singleton instance of the Metrics
+  static Metrics &getInstance();
+
+  /// @brief Get a counter, creating it if needed
+  /// @param name The name of the counter
+  std::shared_ptr<Counter> counter(const std::string &name);
+
+  /// @brief Get a gauge, creating it if needed
+  /// @param name The name of the gauge
+  std::shared_ptr<Gauge> gauge(const std::string &name);
+
+  /// @brief Get a histogram, creating it if needed
+  /// @param name The name of the histogram
+  /// @param unit The unit of the recorded values, if the histogram is created
+  std::shared_ptr<Histogram> histogram(const std::string &name,
+                                       const std::string &unit = "ns");
+
+  /// @brief Stop reporting the metrics whose name starts with [prefix] (e.g.
+  /// the metrics of a client that disconnected). The metrics still in use
+  /// stay valid
+  /// @param prefix The beginning of the names
+  void remove(const std::string &prefix);
+
+  /// @brief Get a snapshot of all the metrics
+  nlohmann::json serialize();
+
+protected:
+  // Private constructor to prevent direct instantiation
+  Metrics();
+
+  /// @brief When the metrics started to be collected
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::steady_clock::time_point,
+                                 StartingTime);
+
+  /// @brief The mutex to lock the metrics
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, MetricsMutex);
+
+  /// @brief The counters by name
+  std::map<std::string, std::shared_ptr<Counter>> m_Counters;
+
+  /// @brief The gauges by name
+  std::map<std::string, std::shared_ptr<Gauge>> m_Gauges;
+
+  /// @brief The histograms by name
+  std::map<std::string, std::shared_ptr<Histogram>> m_Histograms;
+};
+
+} // namespace NEUROBIO_NAMESPACE::utils
+
+#endif // __NEUROBIO_UTILS_METRICS_H__
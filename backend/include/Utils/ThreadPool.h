@@ -0,0 +1,100 @@
+#ifndef __NEUROBIO_UTILS_THREAD_POOL_H__
+#define __NEUROBIO_UTILS_THREAD_POOL_H__
+
+#include "neurobioConfig.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Utils/CppMacros.h"
+
+namespace NEUROBIO_NAMESPACE::utils {
+
+/// @brief A fixed set of worker threads used to run independent tasks in
+/// parallel. The thread calling [parallelFor] takes part in the work, so a
+/// pool without worker threads simply runs the tasks serially
+class ThreadPool {
+public:
+  /// @brief Constructor
+  /// @param threadCount The number of worker threads (in addition to the
+  /// calling thread)
+  ThreadPool(size_t threadCount = defaultThreadCount());
+
+  /// @brief Destructor. This waits for the worker threads to finish
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// @brief Run [task] for each index from 0 to [count] - 1 and wait for all of
+  /// them to complete. The tasks must be independent as they are run in no
+  /// particular order. All the tasks are run even if some of them throw, in
+  /// which case the exception of the task with the lowest index is rethrown
+  /// @param count The number of tasks
+  /// @param task The task to run, receiving the index of the task
+  void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+  /// @brief Get the default number of worker threads, which leaves one
+  /// hardware thread to the calling thread
+  /// @return The default number of worker threads
+  static size_t defaultThreadCount();
+
+protected:
+  /// @brief The number of worker threads
+  DECLARE_PROTECTED_MEMBER(size_t, ThreadCount);
+
+private:
+  /// @brief Claim and run the tasks of the current [parallelFor] until there
+  /// are none left
+  void runTasks();
+
+  /// @brief The main loop of the worker threads
+  void workerLoop();
+
+  /// @brief The worker threads
+  std::vector<std::thread> m_Workers;
+
+  /// @brief Serialize the concurrent calls to [parallelFor]
+  std::mutex m_ParallelForMutex;
+
+  /// @brief Protect the state shared with the workers
+  std::mutex m_Mutex;
+
+  /// @brief Notified when a new [parallelFor] starts or the pool stops
+  std::condition_variable m_WorkAvailable;
+
+  /// @brief Notified when a worker is done with the current [parallelFor]
+  std::condition_variable m_WorkDone;
+
+  /// @brief The task of the current [parallelFor]
+  const std::function<void(size_t)> *m_Task = nullptr;
+
+  /// @brief The number of tasks of the current [parallelFor]
+  size_t m_TaskCount = 0;
+
+  /// @brief The index of the next task to claim
+  std::atomic<size_t> m_NextIndex{0};
+
+  /// @brief The exception thrown by each task, if any
+  std::vector<std::exception_ptr> m_Exceptions;
+
+  /// @brief The number of workers still running tasks of the current
+  /// [parallelFor]
+  size_t m_BusyWorkers = 0;
+
+  /// @brief Incremented at each [parallelFor] so the workers know there is new
+  /// work
+  size_t m_Generation = 0;
+
+  /// @brief If the workers must stop
+  bool m_IsStopping = false;
+};
+
+} // namespace NEUROBIO_NAMESPACE::utils
+
+#endif // __NEUROBIO_UTILS_THREAD_POOL_H__
@@ -0,0 +1,164 @@
+#ifndef __NEUROBIO_UTILS_TRACER_H__
+#define __NEUROBIO_UTILS_TRACER_H__
+
+#include "neurobioConfig.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <vector>
+
+#include "Utils/CppMacros.h"
+#include "Utils/RollingVector.h"
+
+namespace NEUROBIO_NAMESPACE::utils {
+
+/// @brief A zone of code that ran on a thread
+struct TraceEvent {
+  /// @brief The name of the zone. It must outlive the tracer (e.g. a literal)
+  const char *name;
+
+  /// @brief When the zone started, relative to the creation of the tracer
+  std::chrono::nanoseconds start;
+
+  /// @brief How long the zone lasted
+  std::chrono::nanoseconds duration;
+};
+
+/// @brief Record the zones of code (see [NEUROBIO_TRACE_SCOPE]) that ran on
+/// each thread, so the time spent in the hot paths can be inspected in Chrome
+/// (chrome://tracing) or Perfetto (ui.perfetto.dev). Each thread records in
+/// its own buffer, which only keeps its [BufferSize] last zones, so recording
+/// never allocates nor waits for the other threads
+class Tracer {
+public:
+  /// @brief Get the singleton instance of the Tracer
+  static Tracer &getInstance();
+
+  /// @brief The number of zones kept for each thread
+  static constexpr size_t BufferSize = 8192;
+
+  /// @brief Start or stop recording the zones. The zones are recorded by
+  /// default, unless the tracing is removed at compile time (ENABLE_TRACING)
+  /// @param isEnabled If the zones are recorded
+  void setIsEnabled(bool isEnabled);
+
+  /// @brief If the zones are recorded
+  bool isEnabled() const;
+
+  /// @brief Record a zone that ran on the calling thread
+  /// @param name The name of the zone. It must outlive the tracer
+  /// @param start When the zone started
+  /// @param end When the zone ended
+  void record(const char *name,
+              const std::chrono::steady_clock::time_point &start,
+              const std::chrono::steady_clock::time_point &end);
+
+  /// @brief Forget all the recorded zones
+  void clear();
+
+  /// @brief Get the recorded zones in the Chrome trace event format, which
+  /// Perfetto also reads
+  /// @return The trace
+  nlohmann::json serialize();
+
+protected:
+  /// @brief The zones recorded by a thread
+  struct ThreadBuffer {
+    ThreadBuffer(uint32_t threadId);
+
+    /// @brief Only the thread writes, but the tracer reads when serializing
+    std::mutex mutex;
+
+    /// @brief The last zones of the thread
+    RollingVector<TraceEvent> events;
+
+    /// @brief The id of the thread in the trace
+    uint32_t threadId;
+
+    /// @brief If the thread has exited
+    std::atomic<bool> hasExited;
+  };
+
+  /// @brief Removes the buffer of a thread from the tracer when the thread
+  /// exits
+  struct ThreadBufferHandle {
+    ~ThreadBufferHandle();
+    std::shared_ptr<ThreadBuffer> buffer;
+  };
+
+  // Private constructor to prevent direct instantiation
+  Tracer();
+
+  /// @brief Get the buffer of the calling thread, creating it if needed
+  ThreadBuffer &threadBuffer();
+
+  /// @brief If the zones are recorded
+  std::atomic<bool> m_IsEnabled;
+
+  /// @brief The time all the zones are relative to
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::steady_clock::time_point, Epoch);
+
+  /// @brief The date of [Epoch], so the trace can be related to the data
+  DECLARE_PROTECTED_MEMBER_NOGET(std::chrono::system_clock::time_point,
+                                 SystemEpoch);
+
+  /// @brief The mutex to lock [Buffers]
+  DECLARE_PROTECTED_MEMBER_NOGET(std::mutex, BuffersMutex);
+
+  /// @brief The buffers of all the threads that recorded zones. The buffers
+  /// of the threads that exited are dropped once serialized
+  DECLARE_PROTECTED_MEMBER_NOGET(std::vector<std::shared_ptr<ThreadBuffer>>,
+                                 Buffers);
+
+  /// @brief The id of the next thread to record a zone
+  DECLARE_PROTECTED_MEMBER_NOGET(uint32_t, NextThreadId);
+};
+
+/// @brief Record the time between its construction and its destruction as a
+/// zone of the [Tracer]. Use it through [NEUROBIO_TRACE_SCOPE]
+class TraceScope {
+public:
+  /// @brief Start a zone
+  /// @param name The name of the zone. It must outlive the tracer (e.g. a
+  /// literal)
+  TraceScope(const char *name)
+      : m_Name(Tracer::getInstance().isEnabled() ? name : nullptr) {
+    if (m_Name) {
+      m_Start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~TraceScope() {
+    if (m_Name) {
+      Tracer::getInstance().record(m_Name, m_Start,
+                                   std::chrono::steady_clock::now());
+    }
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+protected:
+  const char *m_Name;
+  std::chrono::steady_clock::time_point m_Start;
+};
+
+} // namespace NEUROBIO_NAMESPACE::utils
+
+#define NEUROBIO_TRACE_CONCAT_IMPL(a, b) a##b
+#define NEUROBIO_TRACE_CONCAT(a, b) NEUROBIO_TRACE_CONCAT_IMPL(a, b)
+
+/// @brief Record the rest of the enclosing scope as a zone of the [Tracer].
+/// It compiles to nothing when the tracing is disabled (ENABLE_TRACING)
+#ifdef ENABLE_TRACING
+#define NEUROBIO_TRACE_SCOPE(name)                                             \
+  ::NEUROBIO_NAMESPACE::utils::TraceScope NEUROBIO_TRACE_CONCAT(               \
+      neurobioTraceScope, __LINE__)(name)
+#else
+#define NEUROBIO_TRACE_SCOPE(name)
+#endif
+
+#endif // __NEUROBIO_UTILS_TRACER_H__
@@ -3,6 +3,9 @@
 
 #include "Utils/CppMacros.h"
 #include "Utils/Logger.h"
+#include "Utils/Metrics.h"
 #include "Utils/NeurobioEvent.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Tracer.h"
 
 #endif // __NEUROBIO_UTILS_ALL_H__
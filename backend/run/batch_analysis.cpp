@@ -0,0 +1,178 @@
+#include "neurobio.h"
+
+#include <fstream>
+
+using namespace NEUROBIO_NAMESPACE;
+
+// Usage:
+//   batch_analysis <analyzers.json> <trial files...> [--output=results.json]
+//                  [--threads=N] [--period=25] [--history=1]
+//   batch_analysis <analyzer.json> <trial files...> --sweep=parameters.json
+//                  [--output=results.json] [--threads=N] [--period=25]
+//                  [--history=1]
+//   batch_analysis --convert [--compress] <trial.json> <trial.bin>
+// A trial file is either the json sent by GET_LAST_TRIAL_DATA (.json) or a
+// binary trial file (anything else, see data::TrialFile), whose samples are
+// compressed with --compress
+
+nlohmann::json readJson(const std::string &path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Could not open " + path);
+  }
+  return nlohmann::json::parse(file);
+}
+
+int main(int argc, char *argv[]) {
+  auto &logger = utils::Logger::getInstance();
+  logger.setLogLevel(utils::Logger::INFO);
+
+  std::vector<std::string> paths;
+  std::string outputPath;
+  std::string sweepPath;
+  size_t threadCount = utils::ThreadPool::defaultThreadCount();
+  int framePeriod = 25;
+  size_t historySize = 1;
+  bool isConverting = false;
+  bool isCompressed = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t pos = arg.find("=");
+    std::string key = arg.substr(0, pos);
+    std::string value = pos != std::string::npos ? arg.substr(pos + 1) : "";
+    if (key == "--convert") {
+      isConverting = true;
+    } else if (key == "--compress") {
+      isCompressed = true;
+    } else if (key == "--sweep") {
+      sweepPath = value;
+    } else if (key == "--output") {
+      outputPath = value;
+    } else if (key == "--threads") {
+      threadCount = std::stoul(value);
+    } else if (key == "--period") {
+      framePeriod = std::stoi(value);
+    } else if (key == "--history") {
+      historySize = std::stoul(value);
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  try {
+    if (isConverting) {
+      if (paths.size() != 2) {
+        logger.fatal("Usage: batch_analysis --convert [--compress] "
+                     "<trial.json> <trial.bin>");
+        return 1;
+      }
+      data::TrialFile::save(paths[1], data::TrialFile::load(paths[0]),
+                            isCompressed);
+      logger.info("Converted " + paths[0] + " to " + paths[1]);
+      return 0;
+    }
+
+    if (paths.size() < 2) {
+      logger.fatal("Usage: batch_analysis <analyzers.json> <trial files...> "
+                   "[--output=results.json] [--threads=N] [--period=25] "
+                   "[--history=1]");
+      return 1;
+    }
+
+    auto loadingStart = std::chrono::steady_clock::now();
+    std::map<std::string, std::map<std::string, data::TimeSeries>> trials;
+    for (size_t i = 1; i < paths.size(); i++) {
+      trials[paths[i]] = data::TrialFile::load(paths[i]);
+    }
+    auto loadingTime = std::chrono::steady_clock::now() - loadingStart;
+    logger.info("Loaded " + std::to_string(trials.size()) + " trials in " +
+                std::to_string(std::chrono::duration<double, std::milli>(
+                                   loadingTime)
+                                   .count()) +
+                " ms");
+
+    if (!sweepPath.empty()) {
+      analyzer::AnalyzerSweep sweep(readJson(paths[0]), readJson(sweepPath),
+                                    std::chrono::milliseconds(framePeriod),
+                                    historySize, threadCount);
+      auto output = nlohmann::json::object();
+      output["sweeps"] = nlohmann::json::array();
+      for (const auto &[name, trial] : trials) {
+        auto result = sweep.sweep(name, trial);
+        logger.info(name + ": " + std::to_string(result.entries.size()) +
+                    " configurations in " +
+                    std::to_string(result.analysis.processingTime.count() /
+                                   1000.0) +
+                    " ms");
+        if (!result.analysis.error.empty()) {
+          logger.warning(name + ": " + result.analysis.error);
+        }
+        for (const auto &entry : result.entries) {
+          logger.info("  " + entry.name + " " + entry.parameters.dump() +
+                      ": " + std::to_string(entry.predictionCount) +
+                      " predictions, " +
+                      std::to_string(entry.phaseChangeCount) +
+                      " phase changes, " +
+                      std::to_string(entry.failedFrameCount) +
+                      " failed frames");
+        }
+        output["sweeps"].push_back(result.serialize());
+      }
+      if (!outputPath.empty()) {
+        std::ofstream file(outputPath);
+        file << output.dump(2);
+        logger.info("Results written to " + outputPath);
+      }
+      return 0;
+    }
+
+    analyzer::BatchAnalysis batch(readJson(paths[0]),
+                                  std::chrono::milliseconds(framePeriod),
+                                  historySize, threadCount);
+    auto analysisStart = std::chrono::steady_clock::now();
+    auto results = batch.analyze(trials);
+    auto analysisTime = std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - analysisStart)
+                            .count();
+
+    double totalDuration = 0;
+    size_t totalSamples = 0;
+    auto output = nlohmann::json::object();
+    output["trials"] = nlohmann::json::array();
+    for (const auto &result : results) {
+      totalDuration += result.trialDuration.count();
+      totalSamples += result.sampleCount;
+      std::string message =
+          result.name + ": " + std::to_string(result.frameCount) +
+          " frames in " +
+          std::to_string(result.processingTime.count() / 1000.0) + " ms (" +
+          std::to_string(result.trialDuration.count() /
+                         std::max<double>(result.processingTime.count(), 1)) +
+          "x real time)";
+      if (result.error.empty()) {
+        logger.info(message);
+      } else {
+        logger.warning(message + ", " +
+                       std::to_string(result.failedFrameCount) +
+                       " failed frames: " + result.error);
+      }
+      output["trials"].push_back(result.serialize());
+    }
+    logger.info("Analyzed " + std::to_string(results.size()) + " trials (" +
+                std::to_string(totalSamples) + " samples) in " +
+                std::to_string(analysisTime / 1000.0) + " ms, " +
+                std::to_string(totalDuration / std::max(analysisTime, 1.0)) +
+                "x real time");
+
+    if (!outputPath.empty()) {
+      std::ofstream file(outputPath);
+      file << output.dump(2);
+      logger.info("Results written to " + outputPath);
+    }
+  } catch (const std::exception &e) {
+    logger.fatal(e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,376 @@
+#include "neurobio.h"
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#if defined(__linux__)
+#include <filesystem>
+#include <unistd.h>
+#endif
+
+using namespace NEUROBIO_NAMESPACE;
+
+// Usage:
+//   benchmark_server [--clients=4] [--rate=10] [--duration=10] [--warmup=2]
+//                    [--analyzers=analyzers.json] [--output=results.json]
+//                    [--port=6000]
+// Start a mocked server whose Delsys devices are generated [rate] times faster
+// than the actual ones, connect [clients] clients to it and measure, for
+// [duration] seconds after [warmup] seconds:
+// - the latencies of the live data: from the newest sample to the server
+//   sending it (header timestamp), from the server to the client and from the
+//   newest sample to the client;
+// - the latency of the live analyses (if [analyzers] is given, a json of an
+//   analyzer configuration, or an array of them, as for ADD_ANALYZER);
+// - the throughput of the devices and of the live data sent to the clients;
+// - the CPU used by the server, the devices, the clients and the benchmark
+//   itself (Linux only, the total CPU elsewhere).
+// The results are also written as json to [output], so they can be compared
+// between releases
+
+struct Arguments {
+  size_t clientCount = 4;
+  double rateFactor = 10.0;
+  double duration = 10.0;
+  double warmup = 2.0;
+  std::string analyzersPath;
+  std::string outputPath;
+  int port = 6000;
+};
+
+Arguments parseArgs(int argc, char *argv[]) {
+  Arguments arguments;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t pos = arg.find("=");
+    std::string key = arg.substr(0, pos);
+    std::string value = pos != std::string::npos ? arg.substr(pos + 1) : "";
+    if (key == "--clients") {
+      arguments.clientCount = std::stoul(value);
+    } else if (key == "--rate") {
+      arguments.rateFactor = std::stod(value);
+    } else if (key == "--duration") {
+      arguments.duration = std::stod(value);
+    } else if (key == "--warmup") {
+      arguments.warmup = std::stod(value);
+    } else if (key == "--analyzers") {
+      arguments.analyzersPath = value;
+    } else if (key == "--output") {
+      arguments.outputPath = value;
+    } else if (key == "--port") {
+      arguments.port = std::stoi(value);
+    } else {
+      throw std::invalid_argument("Unknown argument: " + arg);
+    }
+  }
+  return arguments;
+}
+
+double toMilliseconds(const std::chrono::system_clock::duration &duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+nlohmann::json summarize(std::vector<double> values) {
+  nlohmann::json json;
+  json["count"] = values.size();
+  if (values.empty()) {
+    return json;
+  }
+
+  std::sort(values.begin(), values.end());
+  double sum = 0;
+  for (auto value : values) {
+    sum += value;
+  }
+  auto percentile = [&values](double p) {
+    size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[std::min(index, values.size() - 1)];
+  };
+  json["mean_ms"] = sum / values.size();
+  json["p50_ms"] = percentile(0.50);
+  json["p99_ms"] = percentile(0.99);
+  json["max_ms"] = values.back();
+  return json;
+}
+
+std::string describe(const std::string &name, const nlohmann::json &summary) {
+  if (summary.at("count") == 0) {
+    return name + ": no data";
+  }
+  return name + ": p50 " + std::to_string(summary.at("p50_ms").get<double>()) +
+         " ms, p99 " + std::to_string(summary.at("p99_ms").get<double>()) +
+         " ms, max " + std::to_string(summary.at("max_ms").get<double>()) +
+         " ms";
+}
+
+// The CPU time (in seconds) of each thread of the process, by thread id. The
+// threads are attributed to a component by the step of the benchmark that
+// created them
+std::map<std::string, double> threadCpuTimes() {
+  std::map<std::string, double> times;
+#if defined(__linux__)
+  double ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator("/proc/self/task", error)) {
+    std::ifstream file(entry.path() / "stat");
+    std::string stat;
+    std::getline(file, stat);
+    size_t nameEnd = stat.rfind(')');
+    if (nameEnd == std::string::npos) {
+      continue;
+    }
+
+    // The fields after the name start with the state (3rd field), the user
+    // and system times being the 14th and 15th fields
+    std::istringstream fields(stat.substr(nameEnd + 2));
+    std::string field;
+    double userTicks = 0;
+    double systemTicks = 0;
+    for (int i = 3; i <= 15 && fields >> field; i++) {
+      if (i == 14) {
+        userTicks = std::stod(field);
+      } else if (i == 15) {
+        systemTicks = std::stod(field);
+      }
+    }
+    times[entry.path().filename().string()] =
+        (userTicks + systemTicks) / ticksPerSecond;
+  }
+#endif
+  return times;
+}
+
+void attributeNewThreads(std::map<std::string, std::string> &components,
+                         const std::string &component) {
+  for (const auto &[threadId, time] : threadCpuTimes()) {
+    if (components.find(threadId) == components.end()) {
+      components[threadId] = component;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  auto &logger = utils::Logger::getInstance();
+  logger.setLogLevel(utils::Logger::WARNING);
+
+  Arguments arguments;
+  nlohmann::json analyzers = nlohmann::json::array();
+  try {
+    arguments = parseArgs(argc, argv);
+    if (!arguments.analyzersPath.empty()) {
+      std::ifstream file(arguments.analyzersPath);
+      if (!file) {
+        throw std::runtime_error("Could not open " + arguments.analyzersPath);
+      }
+      auto json = nlohmann::json::parse(file);
+      analyzers = json.is_array() ? json : nlohmann::json::array({json});
+    }
+  } catch (const std::exception &e) {
+    logger.fatal(e.what());
+    logger.fatal("Usage: benchmark_server [--clients=4] [--rate=10] "
+                 "[--duration=10] [--warmup=2] [--analyzers=analyzers.json] "
+                 "[--output=results.json] [--port=6000]");
+    return EXIT_FAILURE;
+  }
+
+  // The threads of the benchmark itself
+  std::map<std::string, std::string> components;
+  attributeNewThreads(components, "benchmark");
+
+  server::TcpServerMock server(arguments.port, arguments.port + 1,
+                               arguments.port + 2, arguments.port + 3);
+  server.setSyntheticDevice(
+      "DelsysEmgDevice",
+      devices::SyntheticDeviceConfiguration::delsysEmg(arguments.rateFactor));
+  server.setSyntheticDevice(
+      "DelsysAnalogDevice",
+      devices::SyntheticDeviceConfiguration::delsysAnalog(
+          arguments.rateFactor));
+  server.startServer();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  attributeNewThreads(components, "server");
+
+  // The latencies are only gathered during the measurement
+  std::atomic<bool> isMeasuring(false);
+  std::mutex statisticsMutex;
+  std::vector<double> sampleToServer;
+  std::vector<double> serverToClient;
+  std::vector<double> sampleToClient;
+  std::vector<double> analysesServerToClient;
+  std::vector<size_t> liveDataPackets(arguments.clientCount, 0);
+  std::vector<size_t> liveAnalysesPackets(arguments.clientCount, 0);
+  size_t liveDataBytes = 0;
+
+  std::vector<std::unique_ptr<server::TcpClient>> clients;
+  for (size_t i = 0; i < arguments.clientCount; i++) {
+    auto client = std::make_unique<server::TcpClient>(
+        "localhost", arguments.port, arguments.port + 1, arguments.port + 2,
+        arguments.port + 3);
+    client->onNewLiveData.listen([&, i](const auto &reception) {
+      if (!isMeasuring) {
+        return;
+      }
+      std::lock_guard lock(statisticsMutex);
+      liveDataPackets[i]++;
+      liveDataBytes += reception.byteCount;
+      serverToClient.push_back(
+          toMilliseconds(reception.receivedAt - reception.sentAt));
+      for (const auto &[name, series] : reception.content) {
+        if (series.size() == 0) {
+          continue;
+        }
+        auto newestSample =
+            series.getStartingTime() + series.back().getTimeStamp();
+        sampleToServer.push_back(
+            toMilliseconds(reception.sentAt - newestSample));
+        sampleToClient.push_back(
+            toMilliseconds(reception.receivedAt - newestSample));
+      }
+    });
+    client->onNewLiveAnalyses.listen([&, i](const auto &reception) {
+      if (!isMeasuring) {
+        return;
+      }
+      std::lock_guard lock(statisticsMutex);
+      liveAnalysesPackets[i]++;
+      analysesServerToClient.push_back(
+          toMilliseconds(reception.receivedAt - reception.sentAt));
+    });
+    if (!client->connect(static_cast<uint32_t>(0x10000000 + i))) {
+      logger.fatal("The client " + std::to_string(i) + " failed to connect");
+      return EXIT_FAILURE;
+    }
+    clients.push_back(std::move(client));
+  }
+  attributeNewThreads(components, "clients");
+
+  if (clients.empty() || !clients[0]->addDelsysEmgDevice() ||
+      !clients[0]->addDelsysAnalogDevice()) {
+    logger.fatal("The devices could not be added");
+    return EXIT_FAILURE;
+  }
+  for (const auto &analyzer : analyzers) {
+    if (!clients[0]->addAnalyzer(analyzer)) {
+      logger.fatal("The analyzer " + analyzer.value("name", "") +
+                   " could not be added");
+      return EXIT_FAILURE;
+    }
+  }
+  attributeNewThreads(components, "devices");
+
+  // The frames generated by each synthetic device
+  auto countFrames = [&server]() {
+    std::map<std::string, std::pair<size_t, size_t>> frames;
+    const auto &devices = server.getDevices();
+    for (auto id : devices.getDeviceIds()) {
+      auto device =
+          dynamic_cast<const devices::SyntheticDevice *>(&devices[id]);
+      if (device) {
+        frames[device->deviceName()] = {device->getSentFrameCount(),
+                                        device->getDroppedFrameCount()};
+      }
+    }
+    return frames;
+  };
+
+  std::this_thread::sleep_for(
+      std::chrono::duration<double>(arguments.warmup));
+  auto cpuStart = threadCpuTimes();
+  auto processCpuStart = std::clock();
+  auto framesStart = countFrames();
+  auto measurementStart = std::chrono::steady_clock::now();
+  isMeasuring = true;
+
+  std::this_thread::sleep_for(
+      std::chrono::duration<double>(arguments.duration));
+
+  isMeasuring = false;
+  double elapsed = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - measurementStart)
+                       .count();
+  auto framesEnd = countFrames();
+  auto processCpuEnd = std::clock();
+  auto cpuEnd = threadCpuTimes();
+
+  for (auto &client : clients) {
+    client->disconnect();
+  }
+  server.stopServer();
+
+  // Gather the results
+  std::lock_guard lock(statisticsMutex);
+  nlohmann::json results;
+  results["configuration"] = {{"clients", arguments.clientCount},
+                              {"rate_factor", arguments.rateFactor},
+                              {"duration_s", elapsed},
+                              {"warmup_s", arguments.warmup},
+                              {"analyzers", analyzers.size()}};
+  results["latency"]["live_data"] = {
+      {"sample_to_server", summarize(sampleToServer)},
+      {"server_to_client", summarize(serverToClient)},
+      {"sample_to_client", summarize(sampleToClient)}};
+  results["latency"]["live_analyses"] = {
+      {"server_to_client", summarize(analysesServerToClient)}};
+
+  auto &throughput = results["throughput"];
+  for (const auto &[name, counts] : framesEnd) {
+    auto start = framesStart.count(name) ? framesStart.at(name)
+                                         : std::pair<size_t, size_t>(0, 0);
+    throughput["devices"][name] = {
+        {"frames_per_s", (counts.first - start.first) / elapsed},
+        {"dropped_frames_per_s", (counts.second - start.second) / elapsed}};
+  }
+  size_t totalPackets = 0;
+  size_t totalAnalysesPackets = 0;
+  for (size_t i = 0; i < arguments.clientCount; i++) {
+    totalPackets += liveDataPackets[i];
+    totalAnalysesPackets += liveAnalysesPackets[i];
+  }
+  throughput["live_data_packets_per_s"] = totalPackets / elapsed;
+  throughput["live_data_mb_per_s"] = liveDataBytes / elapsed / 1e6;
+  throughput["live_analyses_packets_per_s"] = totalAnalysesPackets / elapsed;
+  throughput["slowest_client_live_data_packets_per_s"] =
+      *std::min_element(liveDataPackets.begin(), liveDataPackets.end()) /
+      elapsed;
+
+  // The CPU of each component, in percent of one core
+  auto &cpu = results["cpu_percent"];
+  cpu["total"] = static_cast<double>(processCpuEnd - processCpuStart) /
+                 CLOCKS_PER_SEC / elapsed * 100;
+  for (const auto &[threadId, time] : cpuEnd) {
+    auto component = components.count(threadId) ? components.at(threadId)
+                                                 : std::string("other");
+    double startTime = cpuStart.count(threadId) ? cpuStart.at(threadId) : 0;
+    double usage = (time - startTime) / elapsed * 100;
+    cpu[component] = cpu.value(component, 0.0) + usage;
+  }
+
+  logger.setLogLevel(utils::Logger::INFO);
+  logger.info(std::to_string(arguments.clientCount) + " clients, devices " +
+              std::to_string(arguments.rateFactor) + "x faster, " +
+              std::to_string(elapsed) + " s");
+  const auto &liveData = results["latency"]["live_data"];
+  logger.info(describe("Sample to server", liveData["sample_to_server"]));
+  logger.info(describe("Server to client", liveData["server_to_client"]));
+  logger.info(describe("Sample to client", liveData["sample_to_client"]));
+  if (!analyzers.empty()) {
+    logger.info(describe("Analyses server to client",
+                         results["latency"]["live_analyses"]
+                                ["server_to_client"]));
+  }
+  logger.info("Throughput: " + throughput.dump());
+  logger.info("CPU (% of one core): " + cpu.dump());
+
+  if (!arguments.outputPath.empty()) {
+    std::ofstream file(arguments.outputPath);
+    file << results.dump(2);
+    logger.info("Results written to " + arguments.outputPath);
+  }
+  return EXIT_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #include "neurobio.h"
 
 #include <asio.hpp>
+#include <fstream>
 
 using namespace NEUROBIO_NAMESPACE;
 
@@ -28,7 +29,14 @@ int main(int argc, char *argv[]) {
   int messagePort = 5001;
   int liveDataPort = 5002;
   int liveAnalysesPort = 5003;
+  int multiplexedPort = 0;
   bool useMock = false;
+  std::string mockLoad;
+  std::string replayPath;
+  double replaySpeed = 1.0;
+  bool replayLoop = false;
+  bool useSharedMemory = false;
+  size_t threadCount = 0;
 
   // If argv contains the ports (--portCommand=xxxx, --portMessage=xxxxx,
   // etc.), use them
@@ -42,29 +50,91 @@ int main(int argc, char *argv[]) {
       liveDataPort = std::stoi(arg.second);
     } else if (arg.first == "portLiveAnalyses") {
       liveAnalysesPort = std::stoi(arg.second);
+    } else if (arg.first == "portMultiplexed") {
+      multiplexedPort = std::stoi(arg.second);
     } else if (arg.first == "useMock") {
       useMock = (arg.second == "true");
+    } else if (arg.first == "mockLoad") {
+      mockLoad = arg.second;
+    } else if (arg.first == "replay") {
+      replayPath = arg.second;
+    } else if (arg.first == "replaySpeed") {
+      replaySpeed = std::stod(arg.second);
+    } else if (arg.first == "replayLoop") {
+      replayLoop = (arg.second == "true");
+    } else if (arg.first == "sharedMemory") {
+      useSharedMemory = (arg.second == "true");
+    } else if (arg.first == "threads") {
+      threadCount = std::stoul(arg.second);
     } else if (arg.first == "help") {
       logger.info("Usage: neurobio [--portCommand=xxxx] [--portMessage=xxxxx] "
                   "[--portLiveData=xxxxx] [--portLiveAnalyses=xxxxx] "
-                  "[--useMock=<true|false>]");
+                  "[--portMultiplexed=xxxxx] "
+                  "[--useMock=<true|false>] "
+                  "[--mockLoad=<rate factor|configuration.json>] "
+                  "[--replay=<trial file>] "
+                  "[--replaySpeed=<speed, 0 for unthrottled>] "
+                  "[--replayLoop=<true|false>] "
+                  "[--sharedMemory=<true|false>] "
+                  "[--threads=<number of threads>]");
       return EXIT_SUCCESS;
     }
   }
 
   try {
-    if (useMock) {
+    if (!replayPath.empty()) {
+      logger.warning("Starting the neurobio server replaying " + replayPath);
+    } else if (useMock) {
       logger.warning("Starting the neurobio server using the MOCK server");
     } else {
       logger.info("Starting the neurobio server");
     }
 
     // Create a TCP server asynchroniously
-    auto mainServer =
-        useMock ? std::make_unique<server::TcpServerMock>(
-                      commandPort, messagePort, liveDataPort, liveAnalysesPort)
-                : std::make_unique<server::TcpServer>(
-                      commandPort, messagePort, liveDataPort, liveAnalysesPort);
+    std::unique_ptr<server::TcpServer> mainServer;
+    if (!replayPath.empty()) {
+      mainServer = std::make_unique<server::TcpServerReplay>(
+          data::TrialFile::load(replayPath), replaySpeed,
+          replayLoop, commandPort, messagePort, liveDataPort,
+          liveAnalysesPort);
+    } else if (useMock) {
+      auto mockServer = std::make_unique<server::TcpServerMock>(
+          commandPort, messagePort, liveDataPort, liveAnalysesPort);
+      if (mockLoad.size() >= 5 &&
+          mockLoad.substr(mockLoad.size() - 5) == ".json") {
+        // The configuration of each synthetic device, by device name
+        std::ifstream file(mockLoad);
+        if (!file) {
+          throw std::runtime_error("Could not open " + mockLoad);
+        }
+        for (const auto &[deviceName, configuration] :
+             nlohmann::json::parse(file).items()) {
+          mockServer->setSyntheticDevice(
+              deviceName, devices::SyntheticDeviceConfiguration(configuration));
+        }
+        logger.warning("The mocked devices are generated from " + mockLoad);
+      } else if (!mockLoad.empty()) {
+        // The Delsys devices generated this many times faster
+        double rateFactor = std::stod(mockLoad);
+        mockServer->setSyntheticDevice(
+            "DelsysEmgDevice",
+            devices::SyntheticDeviceConfiguration::delsysEmg(rateFactor));
+        mockServer->setSyntheticDevice(
+            "DelsysAnalogDevice",
+            devices::SyntheticDeviceConfiguration::delsysAnalog(rateFactor));
+        logger.warning("The mocked Delsys devices are generated " + mockLoad +
+                       " times faster than the actual ones");
+      }
+      mainServer = std::move(mockServer);
+    } else {
+      mainServer = std::make_unique<server::TcpServer>(
+          commandPort, messagePort, liveDataPort, liveAnalysesPort);
+    }
+    mainServer->setMultiplexedPort(multiplexedPort);
+    mainServer->setIsSharedMemoryEnabled(useSharedMemory);
+    if (threadCount > 0) {
+      mainServer->setThreadCount(threadCount);
+    }
     mainServer->startServerSync();
 
   } catch (std::exception &e) {
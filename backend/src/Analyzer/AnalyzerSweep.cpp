@@ -0,0 +1,177 @@
+#include "Analyzer/AnalyzerSweep.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "Analyzer/Analyzer.h"
+#include "Analyzer/Analyzers.h"
+
+using namespace NEUROBIO_NAMESPACE::data;
+using namespace NEUROBIO_NAMESPACE::analyzer;
+
+static bool hasChangedPhase(const DataPoint &prediction) {
+  const auto &extraInfo = prediction.getExtraInfo();
+  auto it = extraInfo.find("has_changed_phase");
+  return it != extraInfo.end() && std::holds_alternative<bool>(it->second) &&
+         std::get<bool>(it->second);
+}
+
+nlohmann::json SweepEntry::serialize() const {
+  nlohmann::json json;
+  json["name"] = name;
+  json["parameters"] = parameters;
+  json["prediction_count"] = predictionCount;
+  json["phase_change_count"] = phaseChangeCount;
+  json["failed_frame_count"] = failedFrameCount;
+  json["last_prediction_time"] = lastPredictionTime.count();
+  return json;
+}
+
+nlohmann::json SweepResult::serialize() const {
+  nlohmann::json json = analysis.serialize();
+  json["entries"] = nlohmann::json::array();
+  for (const auto &entry : entries) {
+    json["entries"].push_back(entry.serialize());
+  }
+  return json;
+}
+
+AnalyzerSweep::AnalyzerSweep(const nlohmann::json &baseConfiguration,
+                             const nlohmann::json &parameters,
+                             const std::chrono::microseconds &framePeriod,
+                             size_t historySize, size_t threadCount)
+    : BatchAnalysis(
+          makeConfigurations(baseConfiguration, combineParameters(parameters)),
+          framePeriod, historySize, threadCount),
+      m_ParameterSets(combineParameters(parameters)) {}
+
+SweepResult AnalyzerSweep::sweep(const std::string &name,
+                                 const std::map<std::string, TimeSeries> &trial,
+                                 bool keepPredictions) {
+  auto processingStart = std::chrono::steady_clock::now();
+  SweepResult result;
+  result.analysis.name = name;
+  for (size_t i = 0; i < m_AnalyzerConfigurations.size(); i++) {
+    result.entries.push_back({m_AnalyzerConfigurations[i].at("name"),
+                              m_ParameterSets[i]});
+  }
+
+  size_t configurationCount = m_AnalyzerConfigurations.size();
+  std::vector<std::string> errors(configurationCount);
+  try {
+    // Each configuration has its own analyzers, so their failures are their
+    // own. The streams are created beforehand, as the groups fill them at once
+    std::vector<std::unique_ptr<Analyzers>> analyzers;
+    std::vector<std::map<size_t, std::chrono::microseconds>> lastTimeStamps(
+        configurationCount);
+    std::vector<std::vector<DataPoint> *> streams(configurationCount, nullptr);
+    auto startingTime = getStartingTime(trial);
+    for (size_t i = 0; i < configurationCount; i++) {
+      analyzers.push_back(std::make_unique<Analyzers>(0));
+      analyzers[i]->setReferenceTime(startingTime);
+      analyzers[i]->add(m_AnalyzerConfigurations[i]);
+      if (keepPredictions) {
+        streams[i] = &result.analysis.predictions[result.entries[i].name];
+      }
+    }
+
+    // The trial is cut once and each frame is fed to one group of
+    // configurations per thread
+    size_t groupCount =
+        std::min(configurationCount, m_ThreadPool.getThreadCount() + 1);
+    replay(trial, result.analysis,
+           [&](const std::map<std::string, TimeSeries> &frame) {
+             m_ThreadPool.parallelFor(groupCount, [&](size_t group) {
+               size_t begin = group * configurationCount / groupCount;
+               size_t end = (group + 1) * configurationCount / groupCount;
+               for (size_t i = begin; i < end; i++) {
+                 auto &entry = result.entries[i];
+                 try {
+                   predict(*analyzers[i], frame, lastTimeStamps[i],
+                           [&](size_t, const DataPoint &prediction) {
+                             entry.predictionCount++;
+                             entry.lastPredictionTime =
+                                 prediction.getTimeStamp();
+                             if (hasChangedPhase(prediction)) {
+                               entry.phaseChangeCount++;
+                             }
+                             if (streams[i]) {
+                               streams[i]->push_back(prediction);
+                             }
+                           });
+                 } catch (const std::exception &e) {
+                   entry.failedFrameCount++;
+                   if (errors[i].empty()) {
+                     errors[i] = e.what();
+                   }
+                 }
+               }
+             });
+           });
+  } catch (const std::exception &e) {
+    result.analysis.error = e.what();
+  }
+
+  // The failed frames of all the configurations, and the first failure in
+  // their order
+  for (size_t i = 0; i < configurationCount; i++) {
+    result.analysis.failedFrameCount += result.entries[i].failedFrameCount;
+    if (result.analysis.error.empty()) {
+      result.analysis.error = errors[i];
+    }
+  }
+
+  result.analysis.processingTime =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - processingStart);
+  return result;
+}
+
+std::vector<nlohmann::json>
+AnalyzerSweep::combineParameters(const nlohmann::json &parameters) {
+  if (!parameters.is_object()) {
+    throw std::invalid_argument(
+        "The swept parameters must be an object of values by json pointer");
+  }
+
+  std::vector<nlohmann::json> combinations = {nlohmann::json::object()};
+  for (const auto &[pointer, values] : parameters.items()) {
+    if (!values.is_array() || values.empty()) {
+      throw std::invalid_argument("The values of the swept parameter " +
+                                  pointer + " must be a non-empty array");
+    }
+
+    std::vector<nlohmann::json> extended;
+    extended.reserve(combinations.size() * values.size());
+    for (const auto &combination : combinations) {
+      for (const auto &value : values) {
+        extended.push_back(combination);
+        extended.back()[pointer] = value;
+      }
+    }
+    combinations = std::move(extended);
+  }
+  return combinations;
+}
+
+nlohmann::json AnalyzerSweep::makeConfigurations(
+    const nlohmann::json &baseConfiguration,
+    const std::vector<nlohmann::json> &parameterSets) {
+  std::string baseName = baseConfiguration.at("name");
+
+  auto configurations = nlohmann::json::array();
+  for (size_t i = 0; i < parameterSets.size(); i++) {
+    auto configuration = baseConfiguration;
+    for (const auto &[pointer, value] : parameterSets[i].items()) {
+      auto jsonPointer = nlohmann::json::json_pointer(pointer);
+      if (!configuration.contains(jsonPointer)) {
+        throw std::invalid_argument("The swept parameter " + pointer +
+                                    " is not in the base configuration");
+      }
+      configuration[jsonPointer] = value;
+    }
+    configuration["name"] = baseName + " #" + std::to_string(i);
+    configurations.push_back(configuration);
+  }
+  return configurations;
+}
@@ -5,20 +5,87 @@
 #include "Analyzer/EventConditions.h"
 #include "Data/DataPoint.h"
 #include "Utils/Logger.h"
+#include "Utils/Tracer.h"
+#include <algorithm>
 
 using namespace NEUROBIO_NAMESPACE::data;
 using namespace NEUROBIO_NAMESPACE::analyzer;
 
+Analyzers::Analyzers(size_t threadCount)
+    : m_NextId(1), m_ThreadPool(threadCount),
+      m_PredictDurationMetric(utils::Metrics::getInstance().histogram(
+          "Analyzers.predictDuration")),
+      m_AnalyzerPredictDurationMetric(utils::Metrics::getInstance().histogram(
+          "Analyzer.predictDuration")) {}
+
 Predictions
 Analyzers::predict(const std::map<std::string, data::TimeSeries> &data) {
+  NEUROBIO_TRACE_SCOPE("Analyzers::predict");
+  utils::HistogramScope durationScope(*m_PredictDurationMetric);
+  // The predictions update the time aligners, the analyzers and the last
+  // predictions, so they are made one at a time
+  std::lock_guard predictLock(m_MutexPredict);
   std::shared_lock lock(m_MutexAnalyzers);
+  {
+    NEUROBIO_TRACE_SCOPE("Analyzers::predict (align)");
+    for (auto &[key, aligner] : m_TimeAligners) {
+      aligner->update(data);
+    }
+  }
+
+  // Collect the analyzers that have something to predict on, in id order
+  std::vector<std::pair<Analyzer *, const std::map<std::string, TimeSeries> *>>
+      jobs;
+  jobs.reserve(m_Analyzers.size());
   for (const auto &analyzer : m_Analyzers) {
-    m_LastPredictions[analyzer.second->getName()] =
-        analyzer.second->predict(data);
+    const auto &alignment = analyzer.second->getAlignmentConfiguration();
+    if (alignment.is_null()) {
+      jobs.push_back({analyzer.second.get(), &data});
+      continue;
+    }
+
+    // Until all the devices have data, there is nothing aligned to predict on
+    const auto &aligner = *m_TimeAligners.at(alignment.dump());
+    if (aligner.getAlignedCount() == 0) {
+      continue;
+    }
+    jobs.push_back({analyzer.second.get(), &aligner.getAlignedData()});
+  }
+
+  // Each analyzer only touches its own state and its own slot
+  std::vector<DataPoint> results(jobs.size());
+  std::vector<std::exception_ptr> errors(jobs.size());
+  auto &analyzerDuration = *m_AnalyzerPredictDurationMetric;
+  m_ThreadPool.parallelFor(jobs.size(), [&jobs, &results, &errors,
+                                         &analyzerDuration](size_t i) {
+    NEUROBIO_TRACE_SCOPE("Analyzer::predict");
+    utils::HistogramScope durationScope(analyzerDuration);
+    try {
+      results[i] = jobs[i].first->predict(*jobs[i].second);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  });
+
+  // Merge as the serial loop would have, stopping at the first failure
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (errors[i]) {
+      std::rethrow_exception(errors[i]);
+    }
+    m_LastPredictions[jobs[i].first->getName()] = results[i];
   }
   return m_LastPredictions;
 }
 
+void Analyzers::setReferenceTime(
+    const std::chrono::system_clock::time_point &time) {
+  std::unique_lock lock(m_MutexAnalyzers);
+  m_LastPredictions.setStartingTime(time);
+  for (auto &analyzer : m_Analyzers) {
+    analyzer.second->setReferenceTime(time);
+  }
+}
+
 size_t Analyzers::getAnalyzerId(const std::string &analyzerName) const {
   std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexAnalyzers));
   for (const auto &analyzer : m_Analyzers) {
@@ -33,11 +100,19 @@ size_t Analyzers::getAnalyzerId(const std::string &analyzerName) const {
 size_t Analyzers::add(std::unique_ptr<Analyzer> analyzer) {
   std::unique_lock lock(m_MutexAnalyzers);
 
-  static size_t uniqueId = 1;
-  m_Analyzers[uniqueId] = std::move(analyzer);
-  m_Analyzers[uniqueId]->setReferenceTime(m_LastPredictions.getStartingTime());
-  m_LastPredictions.add(m_Analyzers[uniqueId]->getName());
-  return uniqueId++;
+  const auto &alignment = analyzer->getAlignmentConfiguration();
+  if (!alignment.is_null()) {
+    auto &aligner = m_TimeAligners[alignment.dump()];
+    if (!aligner) {
+      aligner = std::make_unique<TimeAligner>(alignment);
+    }
+  }
+
+  size_t id = m_NextId++;
+  analyzer->setReferenceTime(m_LastPredictions.getStartingTime());
+  m_LastPredictions.add(analyzer->getName());
+  m_Analyzers[id] = std::move(analyzer);
+  return id;
 }
 
 size_t Analyzers::add(const nlohmann::json &json) {
@@ -63,16 +138,40 @@ size_t Analyzers::add(const nlohmann::json &json) {
 }
 
 void Analyzers::remove(const std::string &analyzerName) {
-  remove(getAnalyzerId(analyzerName));
+  // The analyzer is found and removed under the same lock, so it cannot be
+  // removed by someone else in between
+  std::unique_lock lock(m_MutexAnalyzers);
+  auto it = std::find_if(
+      m_Analyzers.begin(), m_Analyzers.end(), [&](const auto &analyzer) {
+        return analyzer.second->getName() == analyzerName;
+      });
+  if (it == m_Analyzers.end()) {
+    throw std::invalid_argument("Analyzer with name " + analyzerName +
+                                " does not exist");
+  }
+  remove(it);
 }
 
 void Analyzers::remove(size_t analyzerId) {
   std::unique_lock lock(m_MutexAnalyzers);
-  utils::Logger::getInstance().info("Removing analyzer with id " +
-                                    std::to_string(analyzerId) + " (" +
-                                    m_Analyzers[analyzerId]->getName() + ")");
-  m_LastPredictions.remove(m_Analyzers[analyzerId]->getName());
-  m_Analyzers.erase(analyzerId);
+  auto it = m_Analyzers.find(analyzerId);
+  if (it == m_Analyzers.end()) {
+    std::string message =
+        "Analyzer with id " + std::to_string(analyzerId) + " does not exist";
+    utils::Logger::getInstance().fatal(message);
+    throw std::out_of_range(message);
+  }
+  remove(it);
+}
+
+void Analyzers::remove(
+    std::map<size_t, std::shared_ptr<Analyzer>>::iterator analyzer) {
+  utils::Logger::getInstance().info(
+      "Removing analyzer with id " + std::to_string(analyzer->first) + " (" +
+      analyzer->second->getName() + ")");
+  m_LastPredictions.remove(analyzer->second->getName());
+  m_Analyzers.erase(analyzer);
+  removeUnusedTimeAligners();
 }
 
 std::vector<size_t> Analyzers::getAnalyzerIds() const {
@@ -84,11 +183,15 @@ std::vector<size_t> Analyzers::getAnalyzerIds() const {
   return analyzerIds;
 }
 
-size_t Analyzers::size() const { return m_Analyzers.size(); }
+size_t Analyzers::size() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexAnalyzers));
+  return m_Analyzers.size();
+}
 
 void Analyzers::clear() {
   std::unique_lock lock(m_MutexAnalyzers);
   m_Analyzers.clear();
+  m_TimeAligners.clear();
   m_LastPredictions.reset();
 }
 
@@ -123,4 +226,28 @@ nlohmann::json Analyzers::getSerializedConfigurations() const {
     config.push_back(analyzer.second->getSerializedConfiguration());
   }
   return config;
-}
\ No newline at end of file
+}
+
+nlohmann::json Analyzers::getSerializedConfigurationsByName() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexAnalyzers));
+  nlohmann::json configs = nlohmann::json::object();
+  for (const auto &analyzer : m_Analyzers) {
+    configs[analyzer.second->getName()] =
+        analyzer.second->getSerializedConfiguration();
+  }
+  return configs;
+}
+
+void Analyzers::removeUnusedTimeAligners() {
+  for (auto it = m_TimeAligners.begin(); it != m_TimeAligners.end();) {
+    bool isUsed = false;
+    for (const auto &analyzer : m_Analyzers) {
+      const auto &alignment = analyzer.second->getAlignmentConfiguration();
+      if (!alignment.is_null() && alignment.dump() == it->first) {
+        isUsed = true;
+        break;
+      }
+    }
+    it = isUsed ? std::next(it) : m_TimeAligners.erase(it);
+  }
+}
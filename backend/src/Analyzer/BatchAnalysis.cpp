@@ -0,0 +1,215 @@
+#include "Analyzer/BatchAnalysis.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Analyzer/Analyzer.h"
+#include "Analyzer/Analyzers.h"
+
+using namespace NEUROBIO_NAMESPACE::data;
+using namespace NEUROBIO_NAMESPACE::analyzer;
+
+static nlohmann::json toConfigurationArray(const nlohmann::json &configurations) {
+  if (configurations.is_array()) {
+    return configurations;
+  }
+  return nlohmann::json::array({configurations});
+}
+
+nlohmann::json TrialAnalysis::serialize() const {
+  nlohmann::json json;
+  json["name"] = name;
+  json["starting_time"] = std::chrono::duration_cast<std::chrono::microseconds>(
+                              startingTime.time_since_epoch())
+                              .count();
+  json["frame_count"] = frameCount;
+  json["failed_frame_count"] = failedFrameCount;
+  json["sample_count"] = sampleCount;
+  json["trial_duration"] = trialDuration.count();
+  json["processing_time"] = processingTime.count();
+  if (!error.empty()) {
+    json["error"] = error;
+  }
+  json["predictions"] = nlohmann::json::object();
+  for (const auto &[analyzerName, stream] : predictions) {
+    auto &serialized = json["predictions"][analyzerName];
+    serialized = nlohmann::json::array();
+    for (const auto &prediction : stream) {
+      serialized.push_back(prediction.serialize());
+    }
+  }
+  return json;
+}
+
+BatchAnalysis::BatchAnalysis(const nlohmann::json &analyzerConfigurations,
+                             const std::chrono::microseconds &framePeriod,
+                             size_t historySize, size_t threadCount)
+    : m_AnalyzerConfigurations(toConfigurationArray(analyzerConfigurations)),
+      m_FramePeriod(framePeriod), m_HistorySize(historySize),
+      m_ThreadPool(threadCount) {
+  if (m_FramePeriod.count() <= 0) {
+    throw std::invalid_argument("The frame period must be positive");
+  }
+
+  // Fail early if the configurations are invalid
+  Analyzers analyzers(0);
+  for (const auto &configuration : m_AnalyzerConfigurations) {
+    analyzers.add(configuration);
+  }
+}
+
+TrialAnalysis
+BatchAnalysis::analyze(const std::string &name,
+                       const std::map<std::string, TimeSeries> &trial) const {
+  auto processingStart = std::chrono::steady_clock::now();
+  TrialAnalysis result;
+  result.name = name;
+
+  try {
+    // A fresh set of analyzers, so the trials do not influence each other
+    Analyzers analyzers(0);
+    analyzers.setReferenceTime(getStartingTime(trial));
+    std::map<size_t, std::vector<DataPoint> *> streams;
+    for (const auto &configuration : m_AnalyzerConfigurations) {
+      auto id = analyzers.add(configuration);
+      streams[id] = &result.predictions[analyzers[id].getName()];
+    }
+
+    std::map<size_t, std::chrono::microseconds> lastTimeStamps;
+    replay(trial, result, [&](const std::map<std::string, TimeSeries> &frame) {
+      try {
+        predict(analyzers, frame, lastTimeStamps,
+                [&streams](size_t id, const DataPoint &prediction) {
+                  streams.at(id)->push_back(prediction);
+                });
+      } catch (const std::exception &e) {
+        result.failedFrameCount++;
+        if (result.error.empty()) {
+          result.error = e.what();
+        }
+      }
+    });
+  } catch (const std::exception &e) {
+    result.error = e.what();
+  }
+
+  result.processingTime =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - processingStart);
+  return result;
+}
+
+std::vector<TrialAnalysis> BatchAnalysis::analyze(
+    const std::map<std::string, std::map<std::string, TimeSeries>> &trials) {
+  std::vector<const std::pair<const std::string,
+                              std::map<std::string, TimeSeries>> *>
+      jobs;
+  for (const auto &trial : trials) {
+    jobs.push_back(&trial);
+  }
+
+  std::vector<TrialAnalysis> results(jobs.size());
+  m_ThreadPool.parallelFor(jobs.size(), [this, &jobs, &results](size_t i) {
+    results[i] = analyze(jobs[i]->first, jobs[i]->second);
+  });
+  return results;
+}
+
+void BatchAnalysis::replay(
+    const std::map<std::string, TimeSeries> &trial, TrialAnalysis &result,
+    const std::function<void(const std::map<std::string, TimeSeries> &)>
+        &onFrame) const {
+  // The absolute time of each sample, so the frames can be cut by time
+  struct DeviceCursor {
+    const TimeSeries *data;
+    std::vector<int64_t> times;
+    size_t next = 0;
+  };
+  std::map<std::string, DeviceCursor> cursors;
+  int64_t firstCommonTime = std::numeric_limits<int64_t>::min();
+  int64_t lastTime = std::numeric_limits<int64_t>::min();
+  for (const auto &[deviceName, data] : trial) {
+    if (data.size() == 0) {
+      throw std::invalid_argument("The device " + deviceName + " has no data");
+    }
+    auto &cursor = cursors[deviceName];
+    cursor.data = &data;
+    int64_t startingTime =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            data.getStartingTime().time_since_epoch())
+            .count();
+    cursor.times.reserve(data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+      cursor.times.push_back(startingTime + data[i].getTimeStamp().count());
+    }
+    firstCommonTime = std::max(firstCommonTime, cursor.times.front());
+    lastTime = std::max(lastTime, cursor.times.back());
+  }
+  if (cursors.empty()) {
+    throw std::invalid_argument("The trial has no device");
+  }
+  result.startingTime = getStartingTime(trial);
+  int64_t trialStart = std::chrono::duration_cast<std::chrono::microseconds>(
+                           result.startingTime.time_since_epoch())
+                           .count();
+  result.trialDuration = std::chrono::microseconds(lastTime - trialStart);
+
+  // The first frame is a full period after all the devices have data, as
+  // the live server would do
+  int64_t framePeriod = m_FramePeriod.count();
+  for (int64_t frameTime = firstCommonTime + framePeriod;;
+       frameTime += framePeriod) {
+    bool isLastFrame = frameTime >= lastTime;
+    if (isLastFrame) {
+      frameTime = lastTime;
+    }
+
+    std::map<std::string, TimeSeries> frame;
+    for (auto &[deviceName, cursor] : cursors) {
+      size_t end = std::upper_bound(cursor.times.begin() + cursor.next,
+                                    cursor.times.end(), frameTime) -
+                   cursor.times.begin();
+      size_t begin =
+          cursor.next > m_HistorySize ? cursor.next - m_HistorySize : 0;
+      frame[deviceName] = cursor.data->slice(begin, end);
+      result.sampleCount += end - cursor.next;
+      cursor.next = end;
+    }
+    result.frameCount++;
+    onFrame(frame);
+
+    if (isLastFrame) {
+      break;
+    }
+  }
+}
+
+void BatchAnalysis::predict(
+    Analyzers &analyzers, const std::map<std::string, TimeSeries> &frame,
+    std::map<size_t, std::chrono::microseconds> &lastTimeStamps,
+    const std::function<void(size_t, const DataPoint &)> &onPrediction) {
+  auto predictions = analyzers.predict(frame);
+  for (auto id : analyzers.getAnalyzerIds()) {
+    const auto &prediction = predictions[analyzers[id].getName()];
+    auto lastTimeStamp =
+        lastTimeStamps.try_emplace(id, std::chrono::microseconds::min()).first;
+    if (prediction.getData().empty() ||
+        prediction.getTimeStamp() == lastTimeStamp->second) {
+      continue;
+    }
+    lastTimeStamp->second = prediction.getTimeStamp();
+    onPrediction(id, prediction);
+  }
+}
+
+std::chrono::system_clock::time_point
+BatchAnalysis::getStartingTime(const std::map<std::string, TimeSeries> &trial) {
+  // The times of the replay are in microseconds
+  auto startingTime = std::chrono::system_clock::time_point::max();
+  for (const auto &[deviceName, data] : trial) {
+    startingTime = std::min(startingTime, data.getStartingTime());
+  }
+  return std::chrono::system_clock::time_point(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          startingTime.time_since_epoch()));
+}
@@ -1,6 +1,7 @@
 #include "Analyzer/CyclicTimedEventsAnalyzer.h"
 
 #include "Analyzer/EventConditions.h"
+#include "Data/TimeAligner.h"
 #include "Data/TimeSeries.h"
 
 using namespace NEUROBIO_NAMESPACE::analyzer;
@@ -37,6 +38,11 @@ CyclicTimedEventsAnalyzer::CyclicTimedEventsAnalyzer(const nlohmann::json &json)
           },
           json.at("learning_rate")) {
   EventConditions::collapseNameToIndices(m_EventConditions);
+  if (json.contains("alignment")) {
+    // Normalize the configuration so equivalent alignments can be shared
+    m_AlignmentConfiguration =
+        data::TimeAligner(json.at("alignment")).getSerializedConfiguration();
+  }
 }
 
 nlohmann::json CyclicTimedEventsAnalyzer::getSerializedConfiguration() const {
@@ -54,6 +60,9 @@ nlohmann::json CyclicTimedEventsAnalyzer::getSerializedConfiguration() const {
   for (const auto &event : m_EventConditions) {
     config["events"].push_back(event->getSerializedConfiguration());
   }
+  if (!m_AlignmentConfiguration.is_null()) {
+    config["alignment"] = m_AlignmentConfiguration;
+  }
   return config;
 }
 
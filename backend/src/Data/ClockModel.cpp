@@ -0,0 +1,141 @@
+#include "Data/ClockModel.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NEUROBIO_NAMESPACE::data;
+
+// Real oscillators drift by a few tens of ppm, anything further than that is
+// the jitter of the arrival times leaking into the estimation
+double CLOCK_MODEL_MAX_SKEW_PPM(500.0);
+
+// If an arrival time is that far from the model, samples were lost or the
+// device restarted its clock, so the model is restarted from scratch
+std::chrono::microseconds CLOCK_MODEL_RESYNC_THRESHOLD(1000000);
+
+// The maximum correction applied to the period between two stamped samples
+double CLOCK_MODEL_MAX_SLEW(0.05);
+
+ClockModel::ClockModel() : ClockModel(std::chrono::microseconds(0)) {}
+
+ClockModel::ClockModel(const std::chrono::microseconds &nominalPeriod,
+                       double forgettingFactor)
+    : m_NominalPeriod(nominalPeriod), m_ForgettingFactor(forgettingFactor) {
+  reset();
+}
+
+bool ClockModel::isEnabled() const {
+  return m_NominalPeriod > std::chrono::microseconds(0);
+}
+
+void ClockModel::reset() {
+  m_ObservationCount = 0;
+  m_EstimatedPeriod = static_cast<double>(m_NominalPeriod.count());
+  m_FirstIndex = 0;
+  m_FirstArrivalTime = std::chrono::high_resolution_clock::time_point();
+  m_WeightSum = 0.0;
+  m_MeanIndex = 0.0;
+  m_MeanTime = 0.0;
+  m_IndexVariance = 0.0;
+  m_Covariance = 0.0;
+  m_LastStampedIndex = 0;
+  m_LastStamp.reset();
+}
+
+void ClockModel::observe(
+    size_t sampleIndex,
+    const std::chrono::high_resolution_clock::time_point &arrivalTime) {
+  if (!isEnabled()) {
+    return;
+  }
+
+  if (m_ObservationCount > 0) {
+    double elapsed = std::chrono::duration<double, std::micro>(
+                         arrivalTime - m_FirstArrivalTime)
+                         .count();
+    if (sampleIndex < m_FirstIndex ||
+        std::abs(elapsed - predict(sampleIndex)) >
+            static_cast<double>(CLOCK_MODEL_RESYNC_THRESHOLD.count())) {
+      reset();
+    }
+  }
+  if (m_ObservationCount == 0) {
+    m_FirstIndex = sampleIndex;
+    m_FirstArrivalTime = arrivalTime;
+  }
+
+  double index = static_cast<double>(sampleIndex - m_FirstIndex);
+  double time = std::chrono::duration<double, std::micro>(arrivalTime -
+                                                          m_FirstArrivalTime)
+                    .count();
+
+  // Exponentially weighted update of the means and of the sums of deviations
+  m_WeightSum = m_ForgettingFactor * m_WeightSum + 1.0;
+  double indexDeviation = index - m_MeanIndex;
+  m_MeanIndex += indexDeviation / m_WeightSum;
+  m_MeanTime += (time - m_MeanTime) / m_WeightSum;
+  m_IndexVariance = m_ForgettingFactor * m_IndexVariance +
+                    indexDeviation * (index - m_MeanIndex);
+  m_Covariance = m_ForgettingFactor * m_Covariance +
+                 indexDeviation * (time - m_MeanTime);
+  m_ObservationCount++;
+
+  // Until the observations span more than one sample, the nominal period is
+  // the best guess we have
+  double nominal = static_cast<double>(m_NominalPeriod.count());
+  double period = nominal;
+  if (m_IndexVariance > 0.0) {
+    period = m_Covariance / m_IndexVariance;
+  }
+  double maxDeviation = nominal * CLOCK_MODEL_MAX_SKEW_PPM * 1e-6;
+  m_EstimatedPeriod =
+      std::clamp(period, nominal - maxDeviation, nominal + maxDeviation);
+}
+
+std::chrono::high_resolution_clock::time_point
+ClockModel::timeOf(size_t sampleIndex) const {
+  return m_FirstArrivalTime +
+         std::chrono::duration_cast<
+             std::chrono::high_resolution_clock::duration>(
+             std::chrono::duration<double, std::micro>(predict(sampleIndex)));
+}
+
+std::chrono::high_resolution_clock::time_point
+ClockModel::stamp(size_t sampleIndex) {
+  auto time = timeOf(sampleIndex);
+  if (m_LastStamp.has_value() && sampleIndex > m_LastStampedIndex) {
+    double steps = static_cast<double>(sampleIndex - m_LastStampedIndex);
+    double expected = m_EstimatedPeriod * steps;
+    double elapsed =
+        std::chrono::duration<double, std::micro>(time - *m_LastStamp).count();
+    if (std::abs(elapsed - expected) <
+        static_cast<double>(CLOCK_MODEL_RESYNC_THRESHOLD.count())) {
+      double maxCorrection = expected * CLOCK_MODEL_MAX_SLEW;
+      elapsed = std::clamp(elapsed, expected - maxCorrection,
+                           expected + maxCorrection);
+      time = *m_LastStamp +
+             std::chrono::duration_cast<
+                 std::chrono::high_resolution_clock::duration>(
+                 std::chrono::duration<double, std::micro>(elapsed));
+    }
+  }
+
+  m_LastStampedIndex = sampleIndex;
+  m_LastStamp = time;
+  return time;
+}
+
+double ClockModel::getSkew() const {
+  if (!isEnabled()) {
+    return 0.0;
+  }
+  return (m_EstimatedPeriod / static_cast<double>(m_NominalPeriod.count()) -
+          1.0) *
+         1e6;
+}
+
+double ClockModel::predict(size_t sampleIndex) const {
+  double index = static_cast<double>(sampleIndex) -
+                 static_cast<double>(m_FirstIndex) - m_MeanIndex;
+  return m_MeanTime + m_EstimatedPeriod * index;
+}
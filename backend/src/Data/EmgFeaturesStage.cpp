@@ -0,0 +1,118 @@
+#include "Data/EmgFeaturesStage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace NEUROBIO_NAMESPACE::data;
+
+size_t EMG_FEATURE_COUNT(static_cast<size_t>(EmgFeature::COUNT));
+
+EmgFeaturesStage::EmgFeaturesStage(size_t channelCount, size_t windowSize,
+                                   size_t decimation, double threshold)
+    : ProcessingStage("EmgFeatures", channelCount),
+      m_WindowSize(std::max(windowSize, size_t(1))),
+      m_Decimation(std::max(decimation, size_t(1))), m_Threshold(threshold) {
+  reset();
+}
+
+void EmgFeaturesStage::reset() {
+  size_t slotSize = EMG_FEATURE_COUNT * m_ChannelCount;
+  m_SampleCount = 0;
+  m_Contributions.assign(m_WindowSize * slotSize, 0.0);
+  m_CurrentContribution.assign(slotSize, 0.0);
+  m_Sums.assign(slotSize, 0.0);
+  m_Previous.assign(m_ChannelCount, 0.0);
+  m_BeforePrevious.assign(m_ChannelCount, 0.0);
+  m_Output.assign(slotSize, 0.0);
+}
+
+size_t EmgFeaturesStage::outputIndex(EmgFeature feature,
+                                     size_t channel) const {
+  return static_cast<size_t>(feature) * m_ChannelCount + channel;
+}
+
+bool EmgFeaturesStage::process(std::vector<double> &sample) {
+  if (sample.size() != m_ChannelCount) {
+    throw std::invalid_argument("The sample has " +
+                                std::to_string(sample.size()) +
+                                " channels, but " +
+                                std::to_string(m_ChannelCount) +
+                                " were expected");
+  }
+
+  // The loops below run over the channels on contiguous arrays and without
+  // branches so the compiler can vectorize them
+  size_t channelCount = m_ChannelCount;
+  const double *x = sample.data();
+  const double *previous = m_Previous.data();
+  const double *beforePrevious = m_BeforePrevious.data();
+  double *squares = &m_CurrentContribution[0];
+  double *absolutes = &m_CurrentContribution[channelCount];
+  double *lengths = &m_CurrentContribution[2 * channelCount];
+  double *zeroCrossings = &m_CurrentContribution[3 * channelCount];
+  double *slopeSignChanges = &m_CurrentContribution[4 * channelCount];
+
+  // The differences need one (or two) previous samples to be defined
+  double hasPrevious = m_SampleCount >= 1 ? 1.0 : 0.0;
+  double hasBeforePrevious = m_SampleCount >= 2 ? 1.0 : 0.0;
+  double threshold = m_Threshold;
+  for (size_t i = 0; i < channelCount; i++) {
+    double difference = x[i] - previous[i];
+    double slopeProduct =
+        (previous[i] - beforePrevious[i]) * (previous[i] - x[i]);
+    squares[i] = x[i] * x[i];
+    absolutes[i] = std::abs(x[i]);
+    lengths[i] = hasPrevious * std::abs(difference);
+    zeroCrossings[i] =
+        (x[i] * previous[i] < 0.0 && std::abs(difference) >= threshold)
+            ? hasPrevious
+            : 0.0;
+    slopeSignChanges[i] = slopeProduct > threshold ? hasBeforePrevious : 0.0;
+  }
+
+  // Replace the contribution of the sample leaving the window
+  size_t slotSize = EMG_FEATURE_COUNT * channelCount;
+  size_t slot = m_SampleCount % m_WindowSize;
+  double *oldest = &m_Contributions[slot * slotSize];
+  const double *current = m_CurrentContribution.data();
+  double *sums = m_Sums.data();
+  for (size_t i = 0; i < slotSize; i++) {
+    sums[i] += current[i] - oldest[i];
+    oldest[i] = current[i];
+  }
+
+  m_BeforePrevious.swap(m_Previous);
+  std::copy(sample.begin(), sample.end(), m_Previous.begin());
+  m_SampleCount++;
+
+  if (slot == m_WindowSize - 1) {
+    recomputeSums();
+  }
+
+  if (m_SampleCount % m_Decimation != 0) {
+    return false;
+  }
+
+  double count = static_cast<double>(std::min(m_SampleCount, m_WindowSize));
+  double *output = m_Output.data();
+  for (size_t i = 0; i < channelCount; i++) {
+    output[i] = std::sqrt(std::max(sums[i], 0.0) / count);
+    output[channelCount + i] = sums[channelCount + i] / count;
+  }
+  std::copy(m_Sums.begin() + 2 * channelCount, m_Sums.end(),
+            m_Output.begin() + 2 * channelCount);
+  return true;
+}
+
+void EmgFeaturesStage::recomputeSums() {
+  size_t slotSize = EMG_FEATURE_COUNT * m_ChannelCount;
+  std::fill(m_Sums.begin(), m_Sums.end(), 0.0);
+  double *sums = m_Sums.data();
+  for (size_t slot = 0; slot < m_WindowSize; slot++) {
+    const double *contribution = &m_Contributions[slot * slotSize];
+    for (size_t i = 0; i < slotSize; i++) {
+      sums[i] += contribution[i];
+    }
+  }
+}
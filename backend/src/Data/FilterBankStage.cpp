@@ -0,0 +1,157 @@
+#include "Data/FilterBankStage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace NEUROBIO_NAMESPACE::data;
+
+// The frequency of a design must be representable at the sampling frequency
+static double normalizedAngularFrequency(double frequency,
+                                         double samplingFrequency) {
+  if (samplingFrequency <= 0.0) {
+    throw std::invalid_argument("The sampling frequency must be positive");
+  }
+  if (frequency <= 0.0 || frequency >= samplingFrequency / 2.0) {
+    throw std::invalid_argument(
+        "The frequency of a filter must be between 0 and the Nyquist "
+        "frequency");
+  }
+  return 2.0 * M_PI * frequency / samplingFrequency;
+}
+
+static Biquad normalizedBiquad(double b0, double b1, double b2, double a0,
+                               double a1, double a2) {
+  return Biquad{b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+}
+
+Biquad Biquad::lowPass(double cutoff, double samplingFrequency, double q) {
+  double w0 = normalizedAngularFrequency(cutoff, samplingFrequency);
+  double alpha = std::sin(w0) / (2.0 * q);
+  double cosw0 = std::cos(w0);
+  return normalizedBiquad((1.0 - cosw0) / 2.0, 1.0 - cosw0,
+                          (1.0 - cosw0) / 2.0, 1.0 + alpha, -2.0 * cosw0,
+                          1.0 - alpha);
+}
+
+Biquad Biquad::highPass(double cutoff, double samplingFrequency, double q) {
+  double w0 = normalizedAngularFrequency(cutoff, samplingFrequency);
+  double alpha = std::sin(w0) / (2.0 * q);
+  double cosw0 = std::cos(w0);
+  return normalizedBiquad((1.0 + cosw0) / 2.0, -(1.0 + cosw0),
+                          (1.0 + cosw0) / 2.0, 1.0 + alpha, -2.0 * cosw0,
+                          1.0 - alpha);
+}
+
+Biquad Biquad::notch(double frequency, double samplingFrequency, double q) {
+  double w0 = normalizedAngularFrequency(frequency, samplingFrequency);
+  double alpha = std::sin(w0) / (2.0 * q);
+  double cosw0 = std::cos(w0);
+  return normalizedBiquad(1.0, -2.0 * cosw0, 1.0, 1.0 + alpha, -2.0 * cosw0,
+                          1.0 - alpha);
+}
+
+FilterBankStage::FilterBankStage(const std::string &name, size_t channelCount,
+                                 bool isInPlace, size_t decimation)
+    : ProcessingStage(name, channelCount), m_IsInPlace(isInPlace),
+      m_Decimation(std::max(decimation, size_t(1))), m_SampleCount(0) {
+  m_Buffer.assign(m_ChannelCount, 0.0);
+  if (!m_IsInPlace) {
+    m_Output.assign(m_ChannelCount, 0.0);
+  }
+}
+
+FilterBankStage::FilterBankStage(size_t channelCount,
+                                 const nlohmann::json &json)
+    : FilterBankStage(json.at("name").get<std::string>(), channelCount,
+                      json.value("in_place", true),
+                      json.value("decimation", size_t(1))) {
+  double samplingFrequency = json.at("sampling_frequency").get<double>();
+  for (const auto &step : json.at("steps")) {
+    std::string type = step.at("type");
+    if (type == "low_pass") {
+      addFilter(Biquad::lowPass(step.at("frequency").get<double>(),
+                                samplingFrequency,
+                                step.value("q", 0.7071067811865476)));
+    } else if (type == "high_pass") {
+      addFilter(Biquad::highPass(step.at("frequency").get<double>(),
+                                 samplingFrequency,
+                                 step.value("q", 0.7071067811865476)));
+    } else if (type == "band_pass") {
+      addFilter(Biquad::highPass(step.at("low").get<double>(),
+                                 samplingFrequency));
+      addFilter(Biquad::lowPass(step.at("high").get<double>(),
+                                samplingFrequency));
+    } else if (type == "notch") {
+      addFilter(Biquad::notch(step.at("frequency").get<double>(),
+                              samplingFrequency, step.value("q", 30.0)));
+    } else if (type == "rectify") {
+      addRectification();
+    } else {
+      throw std::invalid_argument("Invalid filter type: " + type);
+    }
+  }
+}
+
+void FilterBankStage::addFilter(const Biquad &filter) {
+  m_Steps.push_back(Step{false, filter});
+  m_FirstStates.resize(m_Steps.size() * m_ChannelCount, 0.0);
+  m_SecondStates.resize(m_Steps.size() * m_ChannelCount, 0.0);
+}
+
+void FilterBankStage::addRectification() {
+  m_Steps.push_back(Step{true, Biquad{0.0, 0.0, 0.0, 0.0, 0.0}});
+  m_FirstStates.resize(m_Steps.size() * m_ChannelCount, 0.0);
+  m_SecondStates.resize(m_Steps.size() * m_ChannelCount, 0.0);
+}
+
+void FilterBankStage::reset() {
+  m_SampleCount = 0;
+  std::fill(m_FirstStates.begin(), m_FirstStates.end(), 0.0);
+  std::fill(m_SecondStates.begin(), m_SecondStates.end(), 0.0);
+}
+
+bool FilterBankStage::process(std::vector<double> &sample) {
+  if (sample.size() != m_ChannelCount) {
+    throw std::invalid_argument("The sample has " +
+                                std::to_string(sample.size()) +
+                                " channels, but " +
+                                std::to_string(m_ChannelCount) +
+                                " were expected");
+  }
+
+  double *x = sample.data();
+  if (!m_IsInPlace) {
+    std::copy(sample.begin(), sample.end(), m_Buffer.begin());
+    x = m_Buffer.data();
+  }
+
+  // Each step runs over all the channels before the next one, so the inner
+  // loops are independent across channels and the compiler vectorizes them
+  size_t channelCount = m_ChannelCount;
+  for (size_t step = 0; step < m_Steps.size(); step++) {
+    if (m_Steps[step].isRectification) {
+      for (size_t i = 0; i < channelCount; i++) {
+        x[i] = std::abs(x[i]);
+      }
+      continue;
+    }
+
+    const auto filter = m_Steps[step].filter;
+    double *z1 = &m_FirstStates[step * channelCount];
+    double *z2 = &m_SecondStates[step * channelCount];
+    for (size_t i = 0; i < channelCount; i++) {
+      double y = filter.b0 * x[i] + z1[i];
+      z1[i] = filter.b1 * x[i] - filter.a1 * y + z2[i];
+      z2[i] = filter.b2 * x[i] - filter.a2 * y;
+      x[i] = y;
+    }
+  }
+  m_SampleCount++;
+
+  if (m_IsInPlace || m_SampleCount % m_Decimation != 0) {
+    return false;
+  }
+  m_Output = m_Buffer;
+  return true;
+}
@@ -0,0 +1,203 @@
+#include "Data/TimeAligner.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NEUROBIO_NAMESPACE::data;
+
+static TimeAligner::Interpolation
+interpolationFromString(const std::string &interpolation) {
+  if (interpolation == "linear")
+    return TimeAligner::Interpolation::LINEAR;
+  else if (interpolation == "zero_order_hold")
+    return TimeAligner::Interpolation::ZERO_ORDER_HOLD;
+  else
+    throw std::invalid_argument("Invalid interpolation: " + interpolation);
+}
+
+static std::string
+interpolationToString(TimeAligner::Interpolation interpolation) {
+  switch (interpolation) {
+  case TimeAligner::Interpolation::LINEAR:
+    return "linear";
+  case TimeAligner::Interpolation::ZERO_ORDER_HOLD:
+    return "zero_order_hold";
+  default:
+    throw std::invalid_argument("Invalid interpolation");
+  }
+}
+
+static int64_t absoluteTime(const TimeSeries &data, const DataPoint &point) {
+  // The starting times are finer than a microsecond, so the ticks of the
+  // system clock are kept not to round the aligned instants
+  return (data.getStartingTime().time_since_epoch() +
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              point.getTimeStamp()))
+      .count();
+}
+
+static int64_t ticks(const std::chrono::microseconds &duration) {
+  return std::chrono::duration_cast<std::chrono::system_clock::duration>(
+             duration)
+      .count();
+}
+
+TimeAligner::TimeAligner(const std::chrono::microseconds &period,
+                         Interpolation interpolation, size_t maxSize)
+    : m_Period(period), m_Interpolation(interpolation), m_MaxSize(maxSize),
+      m_AlignedCount(0), m_StartingTime(0) {
+  if (m_Period.count() <= 0) {
+    throw std::invalid_argument("The period of the aligner must be positive");
+  }
+}
+
+TimeAligner::TimeAligner(const nlohmann::json &json)
+    : TimeAligner(
+          std::chrono::microseconds(static_cast<int64_t>(
+              std::round(1e6 / json.at("frequency").get<double>()))),
+          interpolationFromString(json.value("interpolation", "linear"))) {}
+
+nlohmann::json TimeAligner::getSerializedConfiguration() const {
+  nlohmann::json config;
+  config["frequency"] = 1e6 / static_cast<double>(m_Period.count());
+  config["interpolation"] = interpolationToString(m_Interpolation);
+  return config;
+}
+
+size_t TimeAligner::update(const std::map<std::string, TimeSeries> &data) {
+  // Forget the devices that are gone and register the new ones
+  for (auto it = m_PendingSamples.begin(); it != m_PendingSamples.end();) {
+    if (data.find(it->first) == data.end()) {
+      m_AlignedData.erase(it->first);
+      it = m_PendingSamples.erase(it);
+    } else {
+      it++;
+    }
+  }
+  for (const auto &[name, timeSeries] : data) {
+    appendNewSamples(timeSeries, m_PendingSamples[name]);
+  }
+
+  // The aligned frames can only go as far as the slowest device
+  if (m_PendingSamples.empty()) {
+    return 0;
+  }
+  int64_t horizon = std::numeric_limits<int64_t>::max();
+  int64_t firstCommonTime = std::numeric_limits<int64_t>::min();
+  for (const auto &[name, pending] : m_PendingSamples) {
+    if (pending.samples.empty()) {
+      return 0;
+    }
+    horizon = std::min(horizon, pending.lastTime);
+    firstCommonTime = std::max(firstCommonTime, pending.samples.front().first);
+  }
+
+  int64_t period = ticks(m_Period);
+  if (m_AlignedCount == 0) {
+    m_StartingTime = firstCommonTime;
+    m_AlignedData.clear();
+  }
+  if (horizon <
+      m_StartingTime + static_cast<int64_t>(m_AlignedCount) * period) {
+    return 0;
+  }
+
+  // The frames that would be dropped by the rolling vectors right away are not
+  // computed at all
+  size_t lastIndex = static_cast<size_t>((horizon - m_StartingTime) / period);
+  size_t firstIndex = m_AlignedCount;
+  if (lastIndex - firstIndex + 1 > m_MaxSize) {
+    firstIndex = lastIndex + 1 - m_MaxSize;
+  }
+
+  for (const auto &[name, pending] : m_PendingSamples) {
+    if (m_AlignedData.find(name) == m_AlignedData.end()) {
+      auto &timeSeries = m_AlignedData[name];
+      timeSeries = TimeSeries(std::chrono::system_clock::time_point(
+          std::chrono::system_clock::duration(m_StartingTime)));
+      timeSeries.setRollingVectorMaxSize(m_MaxSize);
+    }
+  }
+
+  for (size_t index = firstIndex; index <= lastIndex; index++) {
+    auto timeStamp = static_cast<int64_t>(index) * m_Period;
+    for (auto &[name, pending] : m_PendingSamples) {
+      m_AlignedData[name].add(
+          timeStamp, valueAt(m_StartingTime + ticks(timeStamp), pending));
+    }
+  }
+
+  size_t newCount = lastIndex + 1 - m_AlignedCount;
+  m_AlignedCount = lastIndex + 1;
+  return newCount;
+}
+
+void TimeAligner::reset() {
+  m_AlignedCount = 0;
+  m_StartingTime = 0;
+  m_AlignedData.clear();
+  m_PendingSamples.clear();
+}
+
+void TimeAligner::appendNewSamples(const TimeSeries &data,
+                                   PendingSamples &pending) const {
+  // The time series may be a rolling window, so only the samples it still
+  // holds can be accessed
+  const auto &rollingData = data.getData();
+  size_t count =
+      rollingData.getIsFull() ? rollingData.getMaxSize() : rollingData.size();
+  if (count == 0 ||
+      absoluteTime(data, rollingData[count - 1]) <= pending.lastTime) {
+    return;
+  }
+
+  // Find the first sample that was not processed yet
+  size_t first = 0;
+  size_t last = count;
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    if (absoluteTime(data, rollingData[middle]) <= pending.lastTime) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+
+  for (size_t i = first; i < count; i++) {
+    pending.samples.emplace_back(absoluteTime(data, rollingData[i]),
+                                 rollingData[i].getData());
+  }
+  pending.lastTime = pending.samples.back().first;
+
+  // If another device is late, the samples older than what can be kept in
+  // the aligned data will never be used
+  auto oldestUsefulTime =
+      pending.lastTime - static_cast<int64_t>(m_MaxSize) * ticks(m_Period);
+  while (pending.samples.size() > 1 &&
+         pending.samples[1].first <= oldestUsefulTime) {
+    pending.samples.pop_front();
+  }
+}
+
+std::vector<double> TimeAligner::valueAt(int64_t time,
+                                         PendingSamples &pending) const {
+  auto &samples = pending.samples;
+  while (samples.size() > 1 && samples[1].first <= time) {
+    samples.pop_front();
+  }
+
+  const auto &[previousTime, previous] = samples.front();
+  if (m_Interpolation == Interpolation::ZERO_ORDER_HOLD ||
+      samples.size() == 1 || previousTime >= time) {
+    return previous;
+  }
+
+  const auto &[nextTime, next] = samples[1];
+  double ratio = static_cast<double>(time - previousTime) /
+                 static_cast<double>(nextTime - previousTime);
+  std::vector<double> value(previous.size());
+  for (size_t i = 0; i < value.size() && i < next.size(); i++) {
+    value[i] = previous[i] + ratio * (next[i] - previous[i]);
+  }
+  return value;
+}
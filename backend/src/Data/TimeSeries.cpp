@@ -11,7 +11,7 @@ TimeSeries::TimeSeries(const nlohmann::json &json)
           static_cast<size_t>(json.at("data").size()))) {
   for (const auto &point : json.at("data")) {
     m_Data.push_back(std::move(
-        DataPoint(std::chrono::microseconds(point[0].get<int>()), point[1])));
+        DataPoint(std::chrono::microseconds(point[0].get<int64_t>()), point[1])));
   }
 }
 
@@ -35,6 +35,11 @@ void TimeSeries::add(const std::vector<double> &data) {
                 zeroLevelData(data))));
 }
 
+void TimeSeries::addZeroLevelled(const std::chrono::microseconds &timeStamp,
+                                 const std::vector<double> &data) {
+  m_Data.push_back(std::move(DataPoint(timeStamp, data)));
+}
+
 const DataPoint &TimeSeries::operator[](size_t index) const {
   return m_Data.at(index);
 }
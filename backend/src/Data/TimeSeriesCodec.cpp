@@ -0,0 +1,309 @@
+#include "Data/TimeSeriesCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace NEUROBIO_NAMESPACE::data;
+
+static int countLeadingZeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+  return value == 0 ? 64 : __builtin_clzll(value);
+#else
+  int count = 0;
+  for (uint64_t bit = uint64_t(1) << 63; bit && !(value & bit); bit >>= 1) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+static int countTrailingZeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+  return value == 0 ? 64 : __builtin_ctzll(value);
+#else
+  int count = 0;
+  for (uint64_t bit = 1; bit && !(value & bit); bit <<= 1) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+static uint64_t toBits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double fromBits(uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static void appendVarint(std::vector<char> &buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<char>(value));
+}
+
+static uint64_t readVarint(const std::vector<char> &buffer, size_t &position) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (position >= buffer.size()) {
+      throw std::runtime_error("The compressed time series is truncated");
+    }
+    auto byte = static_cast<unsigned char>(buffer[position++]);
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw std::runtime_error("The compressed time series is invalid");
+}
+
+/// @brief Append bits to a buffer, most significant first
+class BitWriter {
+public:
+  BitWriter(std::vector<char> &buffer)
+      : m_Buffer(buffer), m_Bits(0), m_BitCount(0) {}
+
+  /// @brief Write the [bitCount] lowest bits of [value]
+  void write(uint64_t value, int bitCount) {
+    if (bitCount > 56) {
+      // The pending bits and the new ones must fit in the accumulator
+      write(value >> 32, bitCount - 32);
+      write(value & 0xFFFFFFFF, 32);
+      return;
+    }
+    uint64_t mask = (uint64_t(1) << bitCount) - 1;
+    m_Bits = (m_Bits << bitCount) | (value & mask);
+    m_BitCount += bitCount;
+    while (m_BitCount >= 8) {
+      m_BitCount -= 8;
+      m_Buffer.push_back(static_cast<char>((m_Bits >> m_BitCount) & 0xFF));
+    }
+  }
+
+  /// @brief Write the pending bits, padded with zeros up to a byte
+  void flush() {
+    if (m_BitCount > 0) {
+      m_Buffer.push_back(
+          static_cast<char>((m_Bits << (8 - m_BitCount)) & 0xFF));
+      m_BitCount = 0;
+    }
+  }
+
+protected:
+  std::vector<char> &m_Buffer;
+  uint64_t m_Bits;
+  int m_BitCount;
+};
+
+/// @brief Read the bits written by a [BitWriter]
+class BitReader {
+public:
+  BitReader(const std::vector<char> &buffer, size_t &position)
+      : m_Buffer(buffer), m_Position(position), m_Bits(0), m_BitCount(0) {}
+
+  /// @brief Read [bitCount] bits
+  uint64_t read(int bitCount) {
+    if (bitCount > 56) {
+      uint64_t high = read(bitCount - 32);
+      return (high << 32) | read(32);
+    }
+    while (m_BitCount < bitCount) {
+      if (m_Position >= m_Buffer.size()) {
+        throw std::runtime_error("The compressed time series is truncated");
+      }
+      auto byte = static_cast<unsigned char>(m_Buffer[m_Position++]);
+      m_Bits = (m_Bits << 8) | byte;
+      m_BitCount += 8;
+    }
+    m_BitCount -= bitCount;
+    return (m_Bits >> m_BitCount) & ((uint64_t(1) << bitCount) - 1);
+  }
+
+  /// @brief Read one bit
+  bool readBit() { return read(1) != 0; }
+
+protected:
+  const std::vector<char> &m_Buffer;
+  size_t &m_Position;
+  uint64_t m_Bits;
+  int m_BitCount;
+};
+
+/// @brief The meaningful bits of the last value of a channel that did change
+struct ChannelState {
+  uint64_t bits = 0;
+  int leadingZeros = -1;
+  int trailingZeros = 0;
+};
+
+void TimeSeriesCodec::encode(const TimeSeries &data,
+                             std::vector<char> &buffer,
+                             const TimeSeriesSelection &selection) {
+  if (selection.decimation == 0) {
+    throw std::invalid_argument("The decimation must be at least 1");
+  }
+  size_t dataCount = data.size();
+  size_t dataChannelCount = dataCount > 0 ? data[0].size() : 0;
+  std::vector<size_t> kept;
+  if (selection.channels.empty()) {
+    for (size_t j = 0; j < dataChannelCount; j++) {
+      kept.push_back(j);
+    }
+  } else {
+    for (auto channel : selection.channels) {
+      if (channel < dataChannelCount) {
+        kept.push_back(channel);
+      }
+    }
+  }
+
+  size_t sampleCount =
+      (dataCount + selection.decimation - 1) / selection.decimation;
+  size_t channelCount = kept.size();
+  appendVarint(buffer, sampleCount);
+  appendVarint(buffer, channelCount);
+
+  BitWriter writer(buffer);
+  std::vector<ChannelState> channels(channelCount);
+  int64_t previousTimeStamp = 0;
+  int64_t previousInterval = 0;
+  for (size_t i = 0; i < dataCount; i += selection.decimation) {
+    const auto &point = data[i];
+    if (point.size() != dataChannelCount) {
+      throw std::invalid_argument(
+          "All the samples must have the same number of channels");
+    }
+
+    // The change of the interval, zigzag encoded so the small negative
+    // changes are small too
+    int64_t timeStamp = point.getTimeStamp().count();
+    int64_t interval = timeStamp - previousTimeStamp;
+    int64_t change = interval - previousInterval;
+    uint64_t zigzag = (static_cast<uint64_t>(change) << 1) ^
+                      static_cast<uint64_t>(change >> 63);
+    if (zigzag == 0) {
+      writer.write(0b0, 1);
+    } else if (zigzag < (uint64_t(1) << 7)) {
+      writer.write(0b10, 2);
+      writer.write(zigzag, 7);
+    } else if (zigzag < (uint64_t(1) << 9)) {
+      writer.write(0b110, 3);
+      writer.write(zigzag, 9);
+    } else if (zigzag < (uint64_t(1) << 12)) {
+      writer.write(0b1110, 4);
+      writer.write(zigzag, 12);
+    } else {
+      writer.write(0b1111, 4);
+      writer.write(zigzag, 64);
+    }
+    previousTimeStamp = timeStamp;
+    previousInterval = interval;
+
+    const auto &values = point.getData();
+    for (size_t j = 0; j < channelCount; j++) {
+      auto &channel = channels[j];
+      uint64_t bits = toBits(values[kept[j]]);
+      uint64_t xored = bits ^ channel.bits;
+      channel.bits = bits;
+      if (xored == 0) {
+        writer.write(0b0, 1);
+        continue;
+      }
+
+      // The leading zeros are stored on 5 bits
+      int leadingZeros = std::min(countLeadingZeros(xored), 31);
+      int trailingZeros = countTrailingZeros(xored);
+      if (channel.leadingZeros >= 0 && leadingZeros >= channel.leadingZeros &&
+          trailingZeros >= channel.trailingZeros) {
+        // The meaningful bits fit in those of the previous value
+        writer.write(0b10, 2);
+        writer.write(xored >> channel.trailingZeros,
+                     64 - channel.leadingZeros - channel.trailingZeros);
+        continue;
+      }
+
+      int meaningfulBits = 64 - leadingZeros - trailingZeros;
+      writer.write(0b11, 2);
+      writer.write(leadingZeros, 5);
+      writer.write(meaningfulBits - 1, 6);
+      writer.write(xored >> trailingZeros, meaningfulBits);
+      channel.leadingZeros = leadingZeros;
+      channel.trailingZeros = trailingZeros;
+    }
+  }
+  writer.flush();
+}
+
+TimeSeries TimeSeriesCodec::decode(
+    const std::vector<char> &buffer, size_t &position,
+    const std::chrono::system_clock::time_point &startingTime) {
+  size_t sampleCount = readVarint(buffer, position);
+  size_t channelCount = readVarint(buffer, position);
+
+  TimeSeries data(startingTime);
+  if (sampleCount == 0) {
+    return data;
+  }
+
+  // Each sample takes at least one bit per channel and one for its timestamp,
+  // which bounds the counts before anything is allocated
+  size_t bitCount = (buffer.size() - position) * 8;
+  if (channelCount >= bitCount || sampleCount > bitCount / (channelCount + 1)) {
+    throw std::runtime_error("The compressed time series is truncated");
+  }
+
+  BitReader reader(buffer, position);
+  std::vector<ChannelState> channels(channelCount);
+  std::vector<double> values(channelCount);
+  int64_t previousTimeStamp = 0;
+  int64_t previousInterval = 0;
+  for (size_t i = 0; i < sampleCount; i++) {
+    uint64_t zigzag = 0;
+    if (reader.readBit()) {
+      if (!reader.readBit()) {
+        zigzag = reader.read(7);
+      } else if (!reader.readBit()) {
+        zigzag = reader.read(9);
+      } else if (!reader.readBit()) {
+        zigzag = reader.read(12);
+      } else {
+        zigzag = reader.read(64);
+      }
+    }
+    int64_t change = static_cast<int64_t>(zigzag >> 1) ^
+                     -static_cast<int64_t>(zigzag & 1);
+    int64_t interval = previousInterval + change;
+    int64_t timeStamp = previousTimeStamp + interval;
+    previousTimeStamp = timeStamp;
+    previousInterval = interval;
+
+    for (size_t j = 0; j < channelCount; j++) {
+      auto &channel = channels[j];
+      if (reader.readBit()) {
+        if (reader.readBit()) {
+          channel.leadingZeros = static_cast<int>(reader.read(5));
+          int meaningfulBits = static_cast<int>(reader.read(6)) + 1;
+          channel.trailingZeros = 64 - channel.leadingZeros - meaningfulBits;
+          if (channel.trailingZeros < 0) {
+            throw std::runtime_error("The compressed time series is invalid");
+          }
+        } else if (channel.leadingZeros < 0) {
+          throw std::runtime_error("The compressed time series is invalid");
+        }
+        int meaningfulBits = 64 - channel.leadingZeros - channel.trailingZeros;
+        channel.bits ^= reader.read(meaningfulBits) << channel.trailingZeros;
+      }
+      values[j] = fromBits(channel.bits);
+    }
+    data.add(std::chrono::microseconds(timeStamp), values);
+  }
+  return data;
+}
@@ -0,0 +1,147 @@
+#include "Data/TrialFile.h"
+
+#include "Data/TimeSeriesCodec.h"
+#include "Utils/LittleEndian.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace NEUROBIO_NAMESPACE::data;
+
+static const char TRIAL_FILE_MAGIC[4] = {'N', 'B', 'T', 'R'};
+static const uint32_t TRIAL_FILE_VERSION(1);
+static const uint32_t COMPRESSED_TRIAL_FILE_VERSION(2);
+static const char TRUNCATED[] = "The trial file is truncated";
+
+void TrialFile::save(const std::string &path,
+                     const std::map<std::string, TimeSeries> &trial,
+                     bool isCompressed) {
+  std::vector<char> buffer(TRIAL_FILE_MAGIC, TRIAL_FILE_MAGIC + 4);
+  utils::appendLittleEndian(buffer,
+                            isCompressed ? COMPRESSED_TRIAL_FILE_VERSION
+                                         : TRIAL_FILE_VERSION,
+                            4);
+  utils::appendLittleEndian(buffer, trial.size(), 4);
+  for (const auto &[name, data] : trial) {
+    utils::appendLittleEndian(buffer, name.size(), 4);
+    buffer.insert(buffer.end(), name.begin(), name.end());
+    utils::appendLittleEndian(
+        buffer,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            data.getStartingTime().time_since_epoch())
+            .count(),
+        8);
+
+    if (isCompressed) {
+      try {
+        TimeSeriesCodec::encode(data, buffer);
+      } catch (const std::invalid_argument &) {
+        throw std::invalid_argument("All the samples of the device " + name +
+                                    " must have the same number of channels");
+      }
+      continue;
+    }
+
+    size_t sampleCount = data.size();
+    size_t channelCount = sampleCount > 0 ? data[0].size() : 0;
+    utils::appendLittleEndian(buffer, sampleCount, 8);
+    utils::appendLittleEndian(buffer, channelCount, 4);
+    for (size_t i = 0; i < sampleCount; i++) {
+      const auto &point = data[i];
+      if (point.size() != channelCount) {
+        throw std::invalid_argument("All the samples of the device " + name +
+                                    " must have the same number of channels");
+      }
+      utils::appendLittleEndian(buffer, point.getTimeStamp().count(), 8);
+      for (size_t j = 0; j < channelCount; j++) {
+        utils::appendDouble(buffer, point[j]);
+      }
+    }
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Could not open the trial file " + path);
+  }
+  file.write(buffer.data(), buffer.size());
+  if (!file) {
+    throw std::runtime_error("Could not write the trial file " + path);
+  }
+}
+
+std::map<std::string, TimeSeries> TrialFile::load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Could not open the trial file " + path);
+  }
+  if (path.size() >= 5 && path.substr(path.size() - 5) == ".json") {
+    return deserialize(nlohmann::json::parse(file));
+  }
+
+  std::vector<char> buffer((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+
+  if (buffer.size() < 4 || std::memcmp(buffer.data(), TRIAL_FILE_MAGIC, 4)) {
+    throw std::runtime_error(path + " is not a trial file");
+  }
+  size_t position = 4;
+  auto version = utils::readLittleEndian(buffer, position, 4, TRUNCATED);
+  if (version != TRIAL_FILE_VERSION &&
+      version != COMPRESSED_TRIAL_FILE_VERSION) {
+    throw std::runtime_error("Unsupported trial file version: " +
+                             std::to_string(version));
+  }
+
+  std::map<std::string, TimeSeries> trial;
+  auto deviceCount = utils::readLittleEndian(buffer, position, 4, TRUNCATED);
+  for (size_t device = 0; device < deviceCount; device++) {
+    auto nameLength = utils::readLittleEndian(buffer, position, 4, TRUNCATED);
+    if (position + nameLength > buffer.size()) {
+      throw std::runtime_error(TRUNCATED);
+    }
+    std::string name(buffer.data() + position, nameLength);
+    position += nameLength;
+
+    auto startingTime = std::chrono::system_clock::time_point(
+        std::chrono::microseconds(static_cast<int64_t>(
+            utils::readLittleEndian(buffer, position, 8, TRUNCATED))));
+    if (version == COMPRESSED_TRIAL_FILE_VERSION) {
+      trial[name] = TimeSeriesCodec::decode(buffer, position, startingTime);
+      continue;
+    }
+
+    TimeSeries data(startingTime);
+    auto sampleCount = utils::readLittleEndian(buffer, position, 8, TRUNCATED);
+    auto channelCount = utils::readLittleEndian(buffer, position, 4, TRUNCATED);
+    // The counts are checked against what is left of the file before
+    // anything is allocated, as those of a corrupted file can be anything
+    size_t valueCount = (buffer.size() - position) / 8;
+    if (sampleCount > 0 && (channelCount >= valueCount ||
+                            sampleCount > valueCount / (channelCount + 1))) {
+      throw std::runtime_error(TRUNCATED);
+    }
+    std::vector<double> values(sampleCount > 0 ? channelCount : 0);
+    for (size_t i = 0; i < sampleCount; i++) {
+      auto timeStamp = static_cast<int64_t>(
+          utils::readLittleEndian(buffer, position, 8, TRUNCATED));
+      for (size_t j = 0; j < channelCount; j++) {
+        values[j] = utils::readDouble(buffer, position, TRUNCATED);
+      }
+      data.add(std::chrono::microseconds(timeStamp), values);
+    }
+    trial[name] = std::move(data);
+  }
+  return trial;
+}
+
+std::map<std::string, TimeSeries>
+TrialFile::deserialize(const nlohmann::json &json) {
+  std::map<std::string, TimeSeries> trial;
+  for (const auto &[deviceIndex, deviceData] : json.items()) {
+    std::string name = deviceData.at("name");
+    trial[name] = TimeSeries(deviceData.at("data"));
+  }
+  return trial;
+}
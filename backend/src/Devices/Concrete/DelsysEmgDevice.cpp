@@ -2,6 +2,9 @@
 
 #include <thread>
 
+#include "Data/EmgFeaturesStage.h"
+#include "Data/FilterBankStage.h"
+
 using namespace NEUROBIO_NAMESPACE::devices;
 
 size_t DELSYS_EMG_CHANNEL_COUNT(16);
@@ -10,21 +13,46 @@ std::chrono::microseconds
     DELSYS_EMG_FRAME_RATE(1000 * 1000 * 1 / DELSYS_EMG_ACQUISITION_FREQUENCY);
 size_t DELSYS_EMG_SAMPLE_COUNT(27);
 
+void DelsysEmgDevice::addProcessingStages(DataCollector &collector,
+                                          size_t channelCount) {
+  using namespace NEUROBIO_NAMESPACE::data;
+  collector.addProcessingStage(
+      std::make_unique<EmgFeaturesStage>(channelCount));
+
+  // Linear envelope: 20-450Hz band-pass, 60Hz notch, rectification and 6Hz
+  // low-pass, published at 100Hz
+  double frequency = static_cast<double>(DELSYS_EMG_ACQUISITION_FREQUENCY);
+  auto envelope =
+      std::make_unique<FilterBankStage>("EmgEnvelope", channelCount, false, 20);
+  envelope->addFilter(Biquad::highPass(20.0, frequency));
+  envelope->addFilter(Biquad::lowPass(450.0, frequency));
+  envelope->addFilter(Biquad::notch(60.0, frequency));
+  envelope->addRectification();
+  envelope->addFilter(Biquad::lowPass(6.0, frequency));
+  collector.addProcessingStage(std::move(envelope));
+}
+
 DelsysEmgDevice::DelsysEmgDevice(const std::string &host, size_t dataPort,
                                  size_t commandPort)
     : DelsysBaseDevice(DELSYS_EMG_CHANNEL_COUNT, DELSYS_EMG_FRAME_RATE,
-                       DELSYS_EMG_SAMPLE_COUNT, host, dataPort, commandPort) {}
+                       DELSYS_EMG_SAMPLE_COUNT, host, dataPort, commandPort) {
+  addProcessingStages(*this, DELSYS_EMG_CHANNEL_COUNT);
+}
 
 DelsysEmgDevice::DelsysEmgDevice(const DelsysBaseDevice &other, size_t dataPort)
     : DelsysBaseDevice(DELSYS_EMG_CHANNEL_COUNT, DELSYS_EMG_FRAME_RATE,
-                       DELSYS_EMG_SAMPLE_COUNT, dataPort, other) {}
+                       DELSYS_EMG_SAMPLE_COUNT, dataPort, other) {
+  addProcessingStages(*this, DELSYS_EMG_CHANNEL_COUNT);
+}
 
 DelsysEmgDevice::DelsysEmgDevice(
     std::unique_ptr<DataTcpDevice> dataDevice,
     std::shared_ptr<CommandTcpDevice> commandDevice)
     : DelsysBaseDevice(std::move(dataDevice), commandDevice,
                        DELSYS_EMG_CHANNEL_COUNT, DELSYS_EMG_FRAME_RATE,
-                       DELSYS_EMG_SAMPLE_COUNT) {}
+                       DELSYS_EMG_SAMPLE_COUNT) {
+  addProcessingStages(*this, DELSYS_EMG_CHANNEL_COUNT);
+}
 
 DelsysEmgDevice::~DelsysEmgDevice() {
   if (m_IsConnected) {
@@ -0,0 +1,223 @@
+#include "Devices/Concrete/ReplayDataCollector.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Devices/Concrete/DelsysEmgDevice.h"
+#include "Utils/Logger.h"
+
+using namespace NEUROBIO_NAMESPACE;
+using namespace NEUROBIO_NAMESPACE::devices;
+
+// How often the samples whose time has come are sent. When replaying as fast
+// as possible, the samples are sent REPLAY_UNTHROTTLED_CHUNK at a time so the
+// streaming can still be stopped in between
+static const std::chrono::microseconds REPLAY_DATA_CHECK_INTERVAL(1000);
+static const size_t REPLAY_UNTHROTTLED_CHUNK(1000);
+
+ReplayDataCollector::ReplayDataCollector(
+    const std::string &dataCollectorName, data::TimeSeries data, double speed,
+    bool isLooping, const std::chrono::microseconds &startingOffset)
+    : Device(),
+      AsyncDataCollector(
+          data.size() > 0 ? data[0].size() : 0, REPLAY_DATA_CHECK_INTERVAL,
+          []() {
+            return std::make_unique<NEUROBIO_NAMESPACE::data::TimeSeries>();
+          }),
+      m_DataCollectorName(dataCollectorName), m_Data(std::move(data)),
+      m_Speed(speed), m_IsLooping(isLooping), m_HasFinished(false),
+      m_NextIndex(0), m_LoopOffset(0), m_HasReplayStarted(false),
+      m_HasLiveDataBeenReset(false) {
+  auto &logger = utils::Logger::getInstance();
+  if (m_Data.size() == 0) {
+    std::string message =
+        "There are no recorded data to replay for " + dataCollectorName;
+    logger.fatal(message);
+    throw std::invalid_argument(message);
+  }
+  if (speed < 0) {
+    std::string message = "The replay speed cannot be negative";
+    logger.fatal(message);
+    throw std::invalid_argument(message);
+  }
+  m_IgnoreTooSlowWarning = true;
+  if (speed == 0) {
+    // A data check sends everything, so it has no deadline to hold
+    auto budget = getDeadlineBudget();
+    budget.maxExecutionTime = std::chrono::microseconds::max();
+    setDeadlineBudget(budget);
+  }
+
+  // The derived data are computed as by the actual device
+  if (deviceNameFromDataCollectorName(dataCollectorName) == "DelsysEmgDevice") {
+    DelsysEmgDevice::addProcessingStages(*this, m_Data[0].size());
+  }
+
+  m_ReplayTimes.reserve(m_Data.size());
+  for (size_t i = 0; i < m_Data.size(); i++) {
+    m_ReplayTimes.push_back(startingOffset + m_Data[i].getTimeStamp());
+  }
+}
+
+ReplayDataCollector::~ReplayDataCollector() {
+  stopDataCollectorWorkers();
+  if (m_IsConnected) {
+    disconnect();
+  }
+}
+
+std::unique_ptr<ReplayDataCollector> ReplayDataCollector::fromTrial(
+    const std::map<std::string, data::TimeSeries> &trial,
+    const std::string &dataCollectorName, double speed, bool isLooping) {
+  auto it = trial.find(dataCollectorName);
+  if (it == trial.end()) {
+    std::string message =
+        "The trial has no data for the data collector " + dataCollectorName;
+    utils::Logger::getInstance().fatal(message);
+    throw std::invalid_argument(message);
+  }
+
+  // The devices of the trial stay synchronized with the earliest one
+  auto trialStartingTime = std::chrono::system_clock::time_point::max();
+  for (const auto &[name, data] : trial) {
+    trialStartingTime = std::min(trialStartingTime, data.getStartingTime());
+  }
+  return std::make_unique<ReplayDataCollector>(
+      dataCollectorName, it->second, speed, isLooping,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          it->second.getStartingTime() - trialStartingTime));
+}
+
+std::string ReplayDataCollector::deviceNameFromDataCollectorName(
+    const std::string &dataCollectorName) {
+  std::string suffix("DataCollector");
+  if (dataCollectorName.size() > suffix.size() &&
+      dataCollectorName.compare(dataCollectorName.size() - suffix.size(),
+                                suffix.size(), suffix) == 0) {
+    return dataCollectorName.substr(0,
+                                    dataCollectorName.size() - suffix.size()) +
+           "Device";
+  }
+  return dataCollectorName + "Device";
+}
+
+std::string ReplayDataCollector::deviceName() const {
+  return deviceNameFromDataCollectorName(m_DataCollectorName);
+}
+
+std::string ReplayDataCollector::dataCollectorName() const {
+  return m_DataCollectorName;
+}
+
+void ReplayDataCollector::resetLiveData() {
+  DataCollector::resetLiveData();
+  // The data check thread restarts the replay, [HasFinished] is reset right
+  // away so nobody waits on the previous replay
+  m_HasFinished = false;
+  m_HasLiveDataBeenReset = true;
+}
+
+bool ReplayDataCollector::handleConnect() { return true; }
+
+bool ReplayDataCollector::handleDisconnect() {
+  if (m_IsStreamingData) {
+    stopDataStreaming();
+  }
+  return true;
+}
+
+bool ReplayDataCollector::handleStartDataStreaming() {
+  // The replay restarts from the beginning when the live data are reset, which
+  // is the last step of starting the data streaming
+  return true;
+}
+
+bool ReplayDataCollector::handleStopDataStreaming() { return true; }
+
+void ReplayDataCollector::handleNewData(const data::DataPoint &data) {
+  // Do nothing
+}
+
+DeviceResponses
+ReplayDataCollector::parseSendCommand(const DeviceCommands &command,
+                                      const std::any &data) {
+  return DeviceResponses::COMMAND_NOT_FOUND;
+}
+
+void ReplayDataCollector::dataCheck() {
+  // The clock of the replay starts with the first data check after the reset.
+  // The processing stages start over as well, as the samples do
+  if (m_HasLiveDataBeenReset.exchange(false)) {
+    resetStreamingState();
+    m_NextIndex = 0;
+    m_LoopOffset = std::chrono::microseconds(0);
+    m_HasFinished = false;
+    m_HasReplayStarted = false;
+  }
+  if (m_HasFinished) {
+    return;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (!m_HasReplayStarted) {
+    m_ReplayStart = now;
+    m_HasReplayStarted = true;
+  }
+
+  if (m_Speed > 0) {
+    sendSamples(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::duration<double, std::micro>(
+                        now - m_ReplayStart) *
+                    m_Speed),
+                std::numeric_limits<size_t>::max());
+    return;
+  }
+
+  // As fast as possible, the chunks follow each other until the end of the
+  // replay, unless the streaming stops or restarts meanwhile
+  while (m_IsStreamingData && !m_HasFinished && !m_HasLiveDataBeenReset) {
+    sendSamples(std::chrono::microseconds::max(), REPLAY_UNTHROTTLED_CHUNK);
+  }
+}
+
+void ReplayDataCollector::sendSamples(const std::chrono::microseconds &dueTime,
+                                      size_t maxSampleCount) {
+  std::vector<std::vector<double>> samples;
+  std::vector<std::chrono::microseconds> timeStamps;
+  bool hasFinished = false;
+  while (samples.size() < maxSampleCount) {
+    if (m_NextIndex == m_Data.size()) {
+      if (!m_IsLooping) {
+        hasFinished = true;
+        break;
+      }
+
+      // Loop one sampling period after the last sample
+      auto duration = m_ReplayTimes.back() - m_ReplayTimes.front();
+      auto period = m_Data.size() > 1
+                        ? duration / static_cast<int64_t>(m_Data.size() - 1)
+                        : std::chrono::microseconds(1);
+      m_LoopOffset += duration + period;
+      m_NextIndex = 0;
+    }
+
+    auto time = m_ReplayTimes[m_NextIndex] + m_LoopOffset;
+    if (time > dueTime) {
+      break;
+    }
+    samples.push_back(m_Data[m_NextIndex].getData());
+    timeStamps.push_back(time);
+    m_NextIndex++;
+  }
+
+  addDataPoints(samples, timeStamps);
+
+  // Only finish once the last samples are in the live data, so whoever waits
+  // on [HasFinished] sees them all
+  if (hasFinished) {
+    m_HasFinished = true;
+    utils::Logger::getInstance().info("The data collector " +
+                                      m_DataCollectorName +
+                                      " has replayed all its data");
+  }
+}
@@ -0,0 +1,317 @@
+#include "Devices/Concrete/SyntheticDevice.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Utils/Logger.h"
+
+using namespace NEUROBIO_NAMESPACE;
+using namespace NEUROBIO_NAMESPACE::devices;
+
+// The noise table is read at a different offset by each channel (and by the
+// bursts), so the channels are not correlated
+size_t SYNTHETIC_NOISE_TABLE_SIZE(1 << 16);
+size_t SYNTHETIC_NOISE_CHANNEL_STRIDE(4099);
+std::chrono::microseconds SYNTHETIC_MAX_DATA_CHECK_INTERVAL(1000);
+
+// The Delsys geometry the load is usually generated with
+size_t SYNTHETIC_DELSYS_EMG_CHANNEL_COUNT(16);
+double SYNTHETIC_DELSYS_EMG_SAMPLE_RATE(2000.0);
+size_t SYNTHETIC_DELSYS_EMG_FRAME_SIZE(27);
+size_t SYNTHETIC_DELSYS_ANALOG_CHANNEL_COUNT(9 * 16);
+double SYNTHETIC_DELSYS_ANALOG_SAMPLE_RATE(1000.0 * 1000.0 / 6750.0);
+size_t SYNTHETIC_DELSYS_ANALOG_FRAME_SIZE(2);
+
+static std::chrono::microseconds
+dataCheckInterval(const SyntheticDeviceConfiguration &configuration) {
+  // The configuration is validated here as the interval is needed to construct
+  // the data collector
+  configuration.validate();
+  return std::clamp(configuration.framePeriod(), std::chrono::microseconds(1),
+                    SYNTHETIC_MAX_DATA_CHECK_INTERVAL);
+}
+
+static size_t tableSize(double sampleRate,
+                        const std::chrono::microseconds &period) {
+  return std::max<size_t>(
+      static_cast<size_t>(std::round(sampleRate * period.count() / 1e6)), 1);
+}
+
+SyntheticDeviceConfiguration::SyntheticDeviceConfiguration(
+    const nlohmann::json &json) {
+  channelCount = json.value("channel_count", channelCount);
+  sampleRate = json.value("sample_rate", sampleRate);
+  frameSize = json.value("frame_size", frameSize);
+  sineAmplitude = json.value("sine_amplitude", sineAmplitude);
+  sineFrequency = json.value("sine_frequency", sineFrequency);
+  noiseAmplitude = json.value("noise_amplitude", noiseAmplitude);
+  burstAmplitude = json.value("burst_amplitude", burstAmplitude);
+  burstPeriod = std::chrono::microseconds(
+      json.value("burst_period", static_cast<int64_t>(burstPeriod.count())));
+  burstDutyCycle = json.value("burst_duty_cycle", burstDutyCycle);
+  stepAmplitude = json.value("step_amplitude", stepAmplitude);
+  stepPeriod = std::chrono::microseconds(
+      json.value("step_period", static_cast<int64_t>(stepPeriod.count())));
+  jitter = std::chrono::microseconds(
+      json.value("jitter", static_cast<int64_t>(jitter.count())));
+  dropRate = json.value("drop_rate", dropRate);
+  seed = json.value("seed", seed);
+}
+
+std::chrono::microseconds SyntheticDeviceConfiguration::framePeriod() const {
+  return std::chrono::microseconds(
+      static_cast<int64_t>(std::round(frameSize * 1e6 / sampleRate)));
+}
+
+void SyntheticDeviceConfiguration::validate() const {
+  std::string message;
+  if (channelCount == 0) {
+    message = "The synthetic data must have at least one channel";
+  } else if (!(sampleRate > 0)) {
+    message = "The sample rate of the synthetic data must be positive";
+  } else if (frameSize == 0) {
+    message = "The frames of the synthetic data must have at least one sample";
+  } else if (sineAmplitude != 0 && !(sineFrequency > 0)) {
+    message = "The frequency of the synthetic sine must be positive";
+  } else if (burstAmplitude != 0 &&
+             (burstPeriod.count() <= 0 || !(burstDutyCycle > 0) ||
+              burstDutyCycle > 1)) {
+    message = "The synthetic bursts must have a positive period and a duty "
+              "cycle in ]0, 1]";
+  } else if (stepAmplitude != 0 && stepPeriod.count() <= 0) {
+    message = "The period of the synthetic steps must be positive";
+  } else if (jitter.count() < 0) {
+    message = "The jitter of the synthetic data cannot be negative";
+  } else if (!(dropRate >= 0) || dropRate >= 1) {
+    message = "The drop rate of the synthetic data must be in [0, 1[";
+  }
+
+  if (!message.empty()) {
+    utils::Logger::getInstance().fatal(message);
+    throw std::invalid_argument(message);
+  }
+}
+
+nlohmann::json SyntheticDeviceConfiguration::serialize() const {
+  nlohmann::json json;
+  json["channel_count"] = channelCount;
+  json["sample_rate"] = sampleRate;
+  json["frame_size"] = frameSize;
+  json["sine_amplitude"] = sineAmplitude;
+  json["sine_frequency"] = sineFrequency;
+  json["noise_amplitude"] = noiseAmplitude;
+  json["burst_amplitude"] = burstAmplitude;
+  json["burst_period"] = burstPeriod.count();
+  json["burst_duty_cycle"] = burstDutyCycle;
+  json["step_amplitude"] = stepAmplitude;
+  json["step_period"] = stepPeriod.count();
+  json["jitter"] = jitter.count();
+  json["drop_rate"] = dropRate;
+  json["seed"] = seed;
+  return json;
+}
+
+SyntheticDeviceConfiguration
+SyntheticDeviceConfiguration::delsysEmg(double rateFactor) {
+  SyntheticDeviceConfiguration configuration;
+  configuration.channelCount = SYNTHETIC_DELSYS_EMG_CHANNEL_COUNT;
+  configuration.sampleRate = SYNTHETIC_DELSYS_EMG_SAMPLE_RATE * rateFactor;
+  configuration.frameSize = SYNTHETIC_DELSYS_EMG_FRAME_SIZE;
+  configuration.sineAmplitude = 0.0;
+  configuration.noiseAmplitude = 0.05;
+  configuration.burstAmplitude = 1.0;
+  configuration.burstDutyCycle = 0.4;
+  return configuration;
+}
+
+SyntheticDeviceConfiguration
+SyntheticDeviceConfiguration::delsysAnalog(double rateFactor) {
+  SyntheticDeviceConfiguration configuration;
+  configuration.channelCount = SYNTHETIC_DELSYS_ANALOG_CHANNEL_COUNT;
+  configuration.sampleRate = SYNTHETIC_DELSYS_ANALOG_SAMPLE_RATE * rateFactor;
+  configuration.frameSize = SYNTHETIC_DELSYS_ANALOG_FRAME_SIZE;
+  configuration.stepAmplitude = 0.5;
+  return configuration;
+}
+
+SyntheticDevice::SyntheticDevice(
+    const std::string &deviceName, const std::string &dataCollectorName,
+    const SyntheticDeviceConfiguration &configuration)
+    : Device(),
+      AsyncDataCollector(
+          configuration.channelCount, dataCheckInterval(configuration),
+          []() {
+            return std::make_unique<NEUROBIO_NAMESPACE::data::TimeSeries>();
+          }),
+      m_Configuration(configuration), m_SentFrameCount(0),
+      m_DroppedFrameCount(0), m_DeviceName(deviceName),
+      m_DataCollectorName(dataCollectorName), m_NextFrameIndex(0),
+      m_NextFrameDelivery(0) {
+  m_IgnoreTooSlowWarning = true;
+
+  const auto &config = m_Configuration;
+  std::mt19937 generator(config.seed);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  m_NoiseTable.resize(SYNTHETIC_NOISE_TABLE_SIZE);
+  for (auto &value : m_NoiseTable) {
+    value = normal(generator);
+  }
+
+  if (config.sineAmplitude != 0) {
+    m_SineTable.resize(tableSize(
+        config.sampleRate, std::chrono::microseconds(static_cast<int64_t>(
+                               std::round(1e6 / config.sineFrequency)))));
+    for (size_t i = 0; i < m_SineTable.size(); i++) {
+      m_SineTable[i] = config.sineAmplitude *
+                       std::sin(2 * M_PI * i / m_SineTable.size());
+    }
+  }
+
+  // A burst is a raised cosine over the active part of the period
+  if (config.burstAmplitude != 0) {
+    m_BurstTable.resize(tableSize(config.sampleRate, config.burstPeriod));
+    double activeSize = config.burstDutyCycle * m_BurstTable.size();
+    for (size_t i = 0; i < m_BurstTable.size() && i < activeSize; i++) {
+      double envelope = std::sin(M_PI * i / activeSize);
+      m_BurstTable[i] = config.burstAmplitude * envelope * envelope;
+    }
+  }
+
+  if (config.stepAmplitude != 0) {
+    m_StepTable.resize(tableSize(config.sampleRate, config.stepPeriod));
+    for (size_t i = m_StepTable.size() / 2; i < m_StepTable.size(); i++) {
+      m_StepTable[i] = config.stepAmplitude;
+    }
+  }
+
+  m_Frame.assign(config.frameSize, std::vector<double>(config.channelCount));
+}
+
+SyntheticDevice::~SyntheticDevice() {
+  stopDataCollectorWorkers();
+  if (m_IsConnected) {
+    disconnect();
+  }
+}
+
+std::string SyntheticDevice::dataCollectorNameFromDeviceName(
+    const std::string &deviceName) {
+  std::string suffix("Device");
+  if (deviceName.size() > suffix.size() &&
+      deviceName.compare(deviceName.size() - suffix.size(), suffix.size(),
+                         suffix) == 0) {
+    return deviceName.substr(0, deviceName.size() - suffix.size()) +
+           "DataCollector";
+  }
+  return deviceName + "DataCollector";
+}
+
+std::string SyntheticDevice::deviceName() const { return m_DeviceName; }
+
+std::string SyntheticDevice::dataCollectorName() const {
+  return m_DataCollectorName;
+}
+
+bool SyntheticDevice::handleConnect() { return true; }
+
+bool SyntheticDevice::handleDisconnect() {
+  if (m_IsStreamingData) {
+    stopDataStreaming();
+  }
+  return true;
+}
+
+bool SyntheticDevice::handleStartDataStreaming() {
+  // Each streaming generates the same data
+  m_RandomGenerator.seed(m_Configuration.seed);
+  m_SentFrameCount = 0;
+  m_DroppedFrameCount = 0;
+  m_NextFrameIndex = 0;
+  m_StreamingStart = std::chrono::steady_clock::now();
+  m_NextFrameDelivery = drawDelivery(0);
+  return true;
+}
+
+bool SyntheticDevice::handleStopDataStreaming() { return true; }
+
+void SyntheticDevice::handleNewData(const data::DataPoint &data) {
+  // Do nothing
+}
+
+DeviceResponses SyntheticDevice::parseSendCommand(const DeviceCommands &command,
+                                                  const std::any &data) {
+  return DeviceResponses::COMMAND_NOT_FOUND;
+}
+
+void SyntheticDevice::dataCheck() {
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - m_StreamingStart);
+
+  // The frames are delivered in order, so a late frame also delays the next
+  // ones (as with a TCP stream)
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  while (m_NextFrameDelivery <= elapsed) {
+    if (m_Configuration.dropRate > 0 &&
+        uniform(m_RandomGenerator) < m_Configuration.dropRate) {
+      m_DroppedFrameCount++;
+    } else {
+      generateFrame(m_NextFrameIndex);
+      addDataPoints(m_Frame);
+      m_SentFrameCount++;
+    }
+    m_NextFrameIndex++;
+    m_NextFrameDelivery = drawDelivery(m_NextFrameIndex);
+  }
+}
+
+void SyntheticDevice::generateFrame(size_t frameIndex) {
+  const auto &config = m_Configuration;
+  size_t noiseMask = m_NoiseTable.size() - 1;
+  size_t firstSample = frameIndex * config.frameSize;
+  bool hasSine = !m_SineTable.empty();
+  bool hasNoise = config.noiseAmplitude != 0;
+  bool hasBursts = !m_BurstTable.empty();
+  bool hasSteps = !m_StepTable.empty();
+
+  for (size_t channel = 0; channel < config.channelCount; channel++) {
+    // Each channel is phase shifted by 0.1 rad and reads its own noise
+    size_t phase =
+        hasSine ? static_cast<size_t>(channel * 0.1 / (2 * M_PI) *
+                                      m_SineTable.size())
+                : 0;
+    size_t noiseOffset = channel * SYNTHETIC_NOISE_CHANNEL_STRIDE;
+    size_t burstNoiseOffset = noiseOffset + m_NoiseTable.size() / 2;
+
+    for (size_t i = 0; i < config.frameSize; i++) {
+      size_t sample = firstSample + i;
+      double value = 0;
+      if (hasSine) {
+        value += m_SineTable[(sample + phase) % m_SineTable.size()];
+      }
+      if (hasNoise) {
+        value += config.noiseAmplitude *
+                 m_NoiseTable[(sample + noiseOffset) & noiseMask];
+      }
+      if (hasBursts) {
+        value += m_BurstTable[sample % m_BurstTable.size()] *
+                 m_NoiseTable[(sample + burstNoiseOffset) & noiseMask];
+      }
+      if (hasSteps) {
+        value += m_StepTable[sample % m_StepTable.size()];
+      }
+      m_Frame[i][channel] = value;
+    }
+  }
+}
+
+std::chrono::microseconds SyntheticDevice::drawDelivery(size_t frameIndex) {
+  const auto &config = m_Configuration;
+  double sampleCount = static_cast<double>((frameIndex + 1) * config.frameSize);
+  auto delivery = std::chrono::microseconds(
+      static_cast<int64_t>(std::round(sampleCount * 1e6 / config.sampleRate)));
+  if (config.jitter.count() > 0) {
+    std::uniform_int_distribution<int64_t> jitter(0, config.jitter.count());
+    delivery += std::chrono::microseconds(jitter(m_RandomGenerator));
+  }
+  return delivery;
+}
@@ -1,20 +1,36 @@
 #include "Devices/Devices.h"
 
 #include "Data/TimeSeries.h"
+#include "Data/TimeSeriesCodec.h"
+#include "Data/TrialFile.h"
 #include "Devices/Exceptions.h"
 #include "Devices/Generic/AsyncDataCollector.h"
 #include "Devices/Generic/AsyncDevice.h"
 #include "Devices/Generic/DataCollector.h"
+#include "Utils/LittleEndian.h"
 #include "Utils/Logger.h"
+#include "Utils/Tracer.h"
+#include <algorithm>
 #include <thread>
 
 using namespace NEUROBIO_NAMESPACE;
 using namespace NEUROBIO_NAMESPACE::devices;
 
+static const uint64_t UNNUMBERED_SEQUENCE(0xFFFFFFFFFFFFFFFF);
+static const char TRUNCATED[] = "The compressed live data are truncated";
+
+
+
 Devices::~Devices() {
   if (m_IsConnected) {
     disconnect();
   }
+
+  // The devices may be kept alive by others, so they must not call back
+  std::unique_lock devicesLock(m_MutexDevices);
+  for (auto &[deviceId, device] : m_Devices) {
+    device->onConnectionChanged.clear(m_ConnectionListenerIds[deviceId]);
+  }
 }
 
 size_t Devices::add(std::unique_ptr<Device> device) {
@@ -22,7 +38,13 @@ size_t Devices::add(std::unique_ptr<Device> device) {
   static size_t deviceId = 0;
 
   // Add the device to the device collection if it does not exist yet
+  std::unique_lock devicesLock(m_MutexDevices);
   m_Devices[deviceId] = std::move(device);
+  m_ConnectionListenerIds[deviceId] =
+      m_Devices[deviceId]->onConnectionChanged.listen(
+          [this, id = deviceId](const bool &) {
+            onDeviceConnectionChanged.notifyListeners(id);
+          });
 
   // If we can dynamic cast the device to a data collector, add it to the data
   // collector collection
@@ -36,22 +58,37 @@ size_t Devices::add(std::unique_ptr<Device> device) {
 }
 
 bool Devices::zeroLevelDevice(const std::string &deviceName) {
+  std::shared_lock devicesLock(m_MutexDevices);
+  std::shared_lock lock(m_MutexDataCollectors);
   for (auto &[deviceId, device] : m_Devices) {
-    if (device->deviceName() == deviceName) {
-      m_DataCollectors[deviceId]->setZeroLevel(std::chrono::milliseconds(1000));
+    auto dataCollector = m_DataCollectors.find(deviceId);
+    if (device->deviceName() == deviceName &&
+        dataCollector != m_DataCollectors.end()) {
+      dataCollector->second->setZeroLevel(std::chrono::milliseconds(1000));
     }
   }
   return true;
 }
 
 void Devices::remove(size_t deviceId) {
-  m_Devices[deviceId]->disconnect();
+  std::shared_ptr<Device> device;
+  {
+    std::shared_lock lock(m_MutexDevices);
+    device = m_Devices.at(deviceId);
+  }
+  device->disconnect();
+
+  // The device is only destroyed once the threads still using it let it go
+  std::unique_lock devicesLock(m_MutexDevices);
   std::unique_lock lock(m_MutexDataCollectors);
+  device->onConnectionChanged.clear(m_ConnectionListenerIds[deviceId]);
+  m_ConnectionListenerIds.erase(deviceId);
   m_DataCollectors.erase(deviceId);
   m_Devices.erase(deviceId);
 }
 
 std::vector<size_t> Devices::getDeviceIds() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
   std::vector<size_t> deviceIds;
   for (auto &[deviceId, device] : m_Devices) {
     deviceIds.push_back(deviceId);
@@ -60,6 +97,7 @@ std::vector<size_t> Devices::getDeviceIds() const {
 }
 
 std::vector<std::string> Devices::getDeviceNames() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
   std::vector<std::string> deviceNames;
   for (auto &[deviceId, device] : m_Devices) {
     deviceNames.push_back(device->deviceName());
@@ -67,20 +105,29 @@ std::vector<std::string> Devices::getDeviceNames() const {
   return deviceNames;
 }
 
-size_t Devices::size() const { return m_Devices.size(); }
+size_t Devices::size() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
+  return m_Devices.size();
+}
 
 void Devices::clear() {
   if (m_IsConnected) {
     disconnect();
   }
 
+  std::unique_lock devicesLock(m_MutexDevices);
   std::unique_lock lock(m_MutexDataCollectors);
+  for (auto &[deviceId, device] : m_Devices) {
+    device->onConnectionChanged.clear(m_ConnectionListenerIds[deviceId]);
+  }
+  m_ConnectionListenerIds.clear();
   m_Devices.clear();
   m_DataCollectors.clear();
 }
 
 const Device &Devices::operator[](size_t deviceId) const {
   try {
+    std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
     return *m_Devices.at(deviceId);
   } catch (const std::out_of_range &) {
     std::string message =
@@ -91,11 +138,13 @@ const Device &Devices::operator[](size_t deviceId) const {
 }
 
 bool Devices::hasDevice(size_t deviceId) const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
   return m_Devices.find(deviceId) != m_Devices.end();
 }
 
 const Device &Devices::getDevice(size_t deviceId) const {
   try {
+    std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
     return *m_Devices.at(deviceId);
   } catch (const std::out_of_range &) {
     std::string message =
@@ -123,10 +172,22 @@ const DataCollector &Devices::getDataCollector(size_t deviceId) const {
   }
 }
 
+std::map<size_t, std::shared_ptr<const Device>> Devices::getDevices() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
+  return std::map<size_t, std::shared_ptr<const Device>>(m_Devices.begin(),
+                                                         m_Devices.end());
+}
+
+std::map<size_t, std::shared_ptr<Device>> Devices::copyDevices() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDevices));
+  return m_Devices;
+}
+
 bool Devices::connect() {
   m_IsConnected = false;
 
-  for (auto &[deviceId, device] : m_Devices) {
+  auto devices = copyDevices();
+  for (auto &[deviceId, device] : devices) {
     // Try to connect the device asynchronously so it takes less time
     try {
       auto &asyncDevice = dynamic_cast<AsyncDevice &>(*device);
@@ -143,7 +204,7 @@ bool Devices::connect() {
     hasConnected = 0;
     hasFailedToConnect = 0;
 
-    for (auto &[deviceId, device] : m_Devices) {
+    for (auto &[deviceId, device] : devices) {
       if (device->getIsConnected()) {
         hasConnected++;
       }
@@ -151,7 +212,7 @@ bool Devices::connect() {
         hasFailedToConnect++;
       }
     }
-    if (hasConnected + hasFailedToConnect == m_Devices.size()) {
+    if (hasConnected + hasFailedToConnect == devices.size()) {
       break;
     }
 
@@ -182,7 +243,7 @@ bool Devices::disconnect() {
   }
 
   bool allDisconnected = true;
-  for (auto &[deviceId, device] : m_Devices) {
+  for (auto &[deviceId, device] : copyDevices()) {
     allDisconnected = device->disconnect() && allDisconnected;
   }
 
@@ -291,9 +352,12 @@ bool Devices::stopDataStreaming() {
 bool Devices::startRecording() {
   bool hasStartedRecording = true;
 
-  for (auto &[deviceId, dataCollector] : m_DataCollectors) {
-    hasStartedRecording =
-        dataCollector->startRecording() && hasStartedRecording;
+  {
+    std::shared_lock lock(m_MutexDataCollectors);
+    for (auto &[deviceId, dataCollector] : m_DataCollectors) {
+      hasStartedRecording =
+          dataCollector->startRecording() && hasStartedRecording;
+    }
   }
 
   if (!hasStartedRecording) {
@@ -332,22 +396,66 @@ bool Devices::stopRecording() {
 }
 
 std::map<std::string, data::TimeSeries> Devices::getLiveData() const {
+  NEUROBIO_TRACE_SCOPE("Devices::getLiveData");
   std::map<std::string, data::TimeSeries> data;
 
   std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDataCollectors));
   for (const auto &[deviceId, dataCollector] : m_DataCollectors) {
     data[dataCollector->dataCollectorName()] = dataCollector->getLiveData();
+    data.merge(dataCollector->getDerivedLiveData());
   }
   return data;
 }
 
 nlohmann::json Devices::getLiveDataSerialized() const {
+  NEUROBIO_TRACE_SCOPE("Devices::getLiveDataSerialized");
   nlohmann::json json;
   std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDataCollectors));
   for (const auto &[deviceId, dataCollector] : m_DataCollectors) {
+    size_t sequence;
+    auto data = dataCollector->getSerializedLiveData(sequence);
+    json[std::to_string(deviceId)] = {
+        {"name", dataCollector->dataCollectorName()},
+        {"data", std::move(data)},
+        {"sequence", sequence}};
+    for (auto &[stageName, stageData] :
+         dataCollector->getSerializedDerivedLiveData()) {
+      json[std::to_string(deviceId) + "." + stageName] = {
+          {"name", dataCollector->dataCollectorName() + "." + stageName},
+          {"data", stageData}};
+    }
+  }
+  return json;
+}
+
+std::map<size_t, size_t> Devices::getLiveDataSequences() const {
+  std::map<size_t, size_t> sequences;
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDataCollectors));
+  for (const auto &[deviceId, dataCollector] : m_DataCollectors) {
+    sequences[deviceId] = dataCollector->getLiveDataSequence();
+  }
+  return sequences;
+}
+
+nlohmann::json Devices::getReplayDataSerialized(
+    const std::map<std::string, size_t> &fromSequences) const {
+  nlohmann::json json = nlohmann::json::object();
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDataCollectors));
+  for (const auto &[deviceId, dataCollector] : m_DataCollectors) {
+    auto it = fromSequences.find(dataCollector->dataCollectorName());
+    if (it == fromSequences.end()) {
+      continue;
+    }
+
+    size_t firstSequence;
+    size_t sequence;
+    auto data = dataCollector->getSerializedReplayData(it->second,
+                                                       firstSequence, sequence);
     json[std::to_string(deviceId)] = {
         {"name", dataCollector->dataCollectorName()},
-        {"data", dataCollector->getSerializedLiveData()}};
+        {"data", std::move(data)},
+        {"first_sequence", firstSequence},
+        {"sequence", sequence}};
   }
   return json;
 }
@@ -365,10 +473,92 @@ nlohmann::json Devices::getLastTrialDataSerialized() const {
 
 std::map<std::string, data::TimeSeries>
 Devices::deserializeData(const nlohmann::json &json) {
-  auto data = std::map<std::string, data::TimeSeries>();
-  for (const auto &[deviceIndex, deviceData] : json.items()) {
-    std::string name = deviceData["name"];
-    data[name] = data::TimeSeries(deviceData["data"]);
+  return data::TrialFile::deserialize(json);
+}
+
+std::vector<char> Devices::getLiveDataCompressed() const {
+  return compressLiveData(nullptr);
+}
+
+std::vector<char> Devices::getLiveDataCompressed(
+    const std::map<std::string, data::TimeSeriesSelection> &selections) const {
+  return compressLiveData(&selections);
+}
+
+std::vector<char> Devices::compressLiveData(
+    const std::map<std::string, data::TimeSeriesSelection> *selections) const {
+  NEUROBIO_TRACE_SCOPE("Devices::compressLiveData");
+  static const data::TimeSeriesSelection everything;
+
+  // The number of data collectors is only known once they are all selected
+  std::vector<char> buffer(4);
+  uint64_t count = 0;
+  auto append = [&](const std::string &name, const data::TimeSeries &data,
+                    uint64_t sequence) {
+    const data::TimeSeriesSelection *selection = &everything;
+    if (selections) {
+      auto it = selections->find(name);
+      if (it == selections->end()) {
+        return;
+      }
+      selection = &it->second;
+    }
+
+    utils::appendLittleEndian(buffer, name.size(), 4);
+    buffer.insert(buffer.end(), name.begin(), name.end());
+    utils::appendLittleEndian(buffer, sequence, 8);
+    utils::appendLittleEndian(
+        buffer,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            data.getStartingTime().time_since_epoch())
+            .count(),
+        8);
+    data::TimeSeriesCodec::encode(data, buffer, *selection);
+    count++;
+  };
+
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_MutexDataCollectors));
+  for (const auto &[deviceId, dataCollector] : m_DataCollectors) {
+    dataCollector->readLiveData(
+        [&](const data::TimeSeries &data, size_t sequence) {
+          append(dataCollector->dataCollectorName(), data, sequence);
+        });
+    dataCollector->readDerivedLiveData(
+        [&](const std::string &name, const data::TimeSeries &data) {
+          append(name, data, UNNUMBERED_SEQUENCE);
+        });
   }
-  return data;
-}
\ No newline at end of file
+  lock.unlock();
+
+  std::vector<char> header;
+  utils::appendLittleEndian(header, count, 4);
+  std::copy(header.begin(), header.end(), buffer.begin());
+  return buffer;
+}
+
+std::map<std::string, data::TimeSeries>
+Devices::decompressLiveData(const std::vector<char> &buffer,
+                            std::map<std::string, size_t> &sequences) {
+  std::map<std::string, data::TimeSeries> liveData;
+  size_t position = 0;
+  auto deviceCount = utils::readLittleEndian(buffer, position, 4, TRUNCATED);
+  for (size_t i = 0; i < deviceCount; i++) {
+    auto nameLength = utils::readLittleEndian(buffer, position, 4, TRUNCATED);
+    if (position + nameLength > buffer.size()) {
+      throw std::runtime_error(TRUNCATED);
+    }
+    std::string name(buffer.data() + position, nameLength);
+    position += nameLength;
+
+    auto sequence = utils::readLittleEndian(buffer, position, 8, TRUNCATED);
+    if (sequence != UNNUMBERED_SEQUENCE) {
+      sequences[name] = sequence;
+    }
+    auto startingTime = std::chrono::system_clock::time_point(
+        std::chrono::microseconds(static_cast<int64_t>(
+            utils::readLittleEndian(buffer, position, 8, TRUNCATED))));
+    liveData[name] =
+        data::TimeSeriesCodec::decode(buffer, position, startingTime);
+  }
+  return liveData;
+}
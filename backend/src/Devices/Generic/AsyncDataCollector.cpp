@@ -1,6 +1,7 @@
 #include "Devices/Generic/AsyncDataCollector.h"
 
 #include "Utils/Logger.h"
+#include "Utils/Metrics.h"
 #include <regex>
 #include <thread>
 
@@ -11,7 +12,12 @@ AsyncDataCollector::AsyncDataCollector(
     const std::function<std::unique_ptr<data::TimeSeries>()>
         &timeSeriesGenerator)
     : m_KeepDataWorkerAliveInterval(dataCheckIntervals),
-      DataCollector(channelCount, timeSeriesGenerator) {}
+      m_ConsecutiveDeadlineMisses(0),
+      DataCollector(channelCount, timeSeriesGenerator) {
+  auto budget = std::max<std::chrono::microseconds>(
+      dataCheckIntervals, std::chrono::milliseconds(1));
+  m_DeadlineBudget = DeadlineBudget{budget, budget, 3};
+}
 
 AsyncDataCollector::~AsyncDataCollector() { stopDataCollectorWorkers(); }
 
@@ -36,7 +42,8 @@ void AsyncDataCollector::startDataStreamingAsync() {
       return;
     }
 
-    m_LiveTimeSeries->reset();
+    resetStreamingState();
+    resetLiveData();
     startKeepDataWorkerAlive();
     m_IsStreamingData = true;
     logger.info("The data collector " + dataCollectorName() +
@@ -119,6 +126,14 @@ void AsyncDataCollector::stopDataCollectorWorkers() {
 }
 
 void AsyncDataCollector::startKeepDataWorkerAlive() {
+  auto &metrics = utils::Metrics::getInstance();
+  m_LatenessMetric = metrics.histogram(dataCollectorName() + ".lateness");
+  m_ExecutionTimeMetric =
+      metrics.histogram(dataCollectorName() + ".executionTime");
+  m_DeadlineMissesMetric =
+      metrics.counter(dataCollectorName() + ".deadlineMisses");
+  m_ConsecutiveDeadlineMisses = 0;
+
   m_KeepDataWorkerAliveTimer = std::make_unique<asio::steady_timer>(
       m_AsyncDataContext, m_KeepDataWorkerAliveInterval);
   keepDataWorkerAlive(m_KeepDataWorkerAliveInterval);
@@ -133,11 +148,13 @@ void AsyncDataCollector::keepDataWorkerAlive(
     std::chrono::microseconds timeout) {
 
   // Set a timer that will call [pingDataWorker] every [timeout] milliseconds
-  m_KeepDataWorkerAliveTimer->expires_after(timeout);
+  m_NextDataCheckTime = std::chrono::steady_clock::now() + timeout;
+  m_KeepDataWorkerAliveTimer->expires_at(m_NextDataCheckTime);
 
   m_KeepDataWorkerAliveTimer->async_wait([this](const auto &errorCode) {
     // Get the current time
-    auto now = std::chrono::high_resolution_clock::now();
+    auto now = std::chrono::steady_clock::now();
+    auto startingTime = std::chrono::system_clock::now();
 
     // If errorCode is not false, it means the timer was stopped by the user, or
     // the device was disconnected. In both cases, do nothing and return
@@ -152,7 +169,12 @@ void AsyncDataCollector::keepDataWorkerAlive(
 
     // Once it's done, repeat the process, but take into account the time it
     // took to execute the [dataCheck] method
-    auto timeToExecute = std::chrono::high_resolution_clock::now() - now;
+    auto timeToExecute = std::chrono::steady_clock::now() - now;
+    monitorDeadline(
+        startingTime,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - m_NextDataCheckTime),
+        std::chrono::duration_cast<std::chrono::microseconds>(timeToExecute));
     auto next = m_KeepDataWorkerAliveInterval - timeToExecute;
     if (next < std::chrono::microseconds(1)) {
       next = std::chrono::microseconds(1);
@@ -179,3 +201,37 @@ void AsyncDataCollector::keepDataWorkerAlive(
 }
 
 void AsyncDataCollector::dataCheck() {}
+
+DeadlineBudget AsyncDataCollector::getDeadlineBudget() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_AsyncDataMutex));
+  return m_DeadlineBudget;
+}
+
+void AsyncDataCollector::setDeadlineBudget(const DeadlineBudget &budget) {
+  std::unique_lock lock(m_AsyncDataMutex);
+  m_DeadlineBudget = budget;
+}
+
+void AsyncDataCollector::monitorDeadline(
+    const std::chrono::system_clock::time_point &startingTime,
+    const std::chrono::microseconds &lateness,
+    const std::chrono::microseconds &executionTime) {
+  m_LatenessMetric->record(lateness);
+  m_ExecutionTimeMetric->record(executionTime);
+
+  auto budget = getDeadlineBudget();
+  if (lateness <= budget.maxLateness &&
+      executionTime <= budget.maxExecutionTime) {
+    m_ConsecutiveDeadlineMisses = 0;
+    return;
+  }
+
+  m_ConsecutiveDeadlineMisses++;
+  m_DeadlineMissesMetric->add();
+  if (m_ConsecutiveDeadlineMisses < budget.maxConsecutiveMisses) {
+    return;
+  }
+  onDeadlineMiss.notifyListeners(
+      DeadlineMiss{dataCollectorName(), startingTime, m_SampleCounter, lateness,
+                   executionTime, m_ConsecutiveDeadlineMisses});
+}
@@ -36,6 +36,7 @@ void AsyncDevice::connectAsync() {
     logger.info("The device " + deviceName() + " is now connected");
     startKeepDeviceWorkerAlive();
     m_IsConnected = true;
+    onConnectionChanged.notifyListeners(true);
     m_AsyncDeviceContext.run();
   });
 }
@@ -74,6 +75,7 @@ bool AsyncDevice::disconnect() {
 
   stopDeviceWorkers();
   logger.info("The device " + deviceName() + " is now disconnected");
+  onConnectionChanged.notifyListeners(false);
   return true;
 }
 
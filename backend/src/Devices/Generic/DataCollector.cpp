@@ -1,7 +1,11 @@
 #include "Devices/Generic/DataCollector.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 #include "Devices/Exceptions.h"
 #include "Utils/Logger.h"
+#include "Utils/Tracer.h"
 
 using namespace NEUROBIO_NAMESPACE::data;
 using namespace NEUROBIO_NAMESPACE::devices;
@@ -12,8 +16,10 @@ DataCollector::DataCollector(
         &timeSeriesGenerator)
     : m_DataChannelCount(channelCount), m_IsStreamingData(false),
       m_IsRecording(false), m_LiveTimeSeries(timeSeriesGenerator()),
-      m_TrialTimeSeries(timeSeriesGenerator()) {
+      m_TrialTimeSeries(timeSeriesGenerator()), m_SampleCounter(0),
+      m_ReplayHistorySize(DEFAULT_REPLAY_HISTORY_SIZE) {
   m_LiveTimeSeries->setRollingVectorMaxSize(1000);
+  m_ReplayTimeSeries.setRollingVectorMaxSize(m_ReplayHistorySize);
 }
 
 bool DataCollector::startDataStreaming() {
@@ -27,10 +33,8 @@ bool DataCollector::startDataStreaming() {
 
   m_IsStreamingData = handleStartDataStreaming();
   m_HasFailedToStartDataStreaming = !m_IsStreamingData;
-  {
-    std::unique_lock lock(m_LiveDataMutex);
-    m_LiveTimeSeries->reset();
-  }
+  resetStreamingState();
+  resetLiveData();
 
   if (m_IsStreamingData) {
     logger.info("The data collector " + dataCollectorName() +
@@ -105,12 +109,85 @@ bool DataCollector::stopRecording() {
 }
 
 void DataCollector::setZeroLevel(const std::chrono::milliseconds &duration) {
+  std::unique_lock lock(m_LiveDataMutex);
   m_LiveTimeSeries->setZeroLevel(duration);
 }
 
 void DataCollector::resetLiveData() {
   std::unique_lock lock(m_LiveDataMutex);
   m_LiveTimeSeries->reset();
+  for (auto &derived : m_DerivedLiveTimeSeries) {
+    derived = TimeSeries(m_LiveTimeSeries->getStartingTime());
+    derived.setRollingVectorMaxSize(1000);
+  }
+  m_ReplayTimeSeries = TimeSeries(m_LiveTimeSeries->getStartingTime());
+  m_ReplayTimeSeries.setRollingVectorMaxSize(m_ReplayHistorySize);
+}
+
+void DataCollector::setReplayHistorySize(size_t size) {
+  std::unique_lock lock(m_LiveDataMutex);
+  m_ReplayHistorySize = size;
+  m_ReplayTimeSeries = TimeSeries(m_LiveTimeSeries->getStartingTime());
+  m_ReplayTimeSeries.setRollingVectorMaxSize(m_ReplayHistorySize);
+}
+
+void DataCollector::resetStreamingState() {
+  std::unique_lock lock(m_LiveDataMutex);
+  m_SampleCounter = 0;
+  m_ClockModel.reset();
+  for (auto &stage : m_ProcessingStages) {
+    stage->reset();
+  }
+}
+
+void DataCollector::addProcessingStage(std::unique_ptr<ProcessingStage> stage) {
+  if (stage->getChannelCount() != m_DataChannelCount) {
+    std::string message = "The processing stage " + stage->getName() +
+                          " expects " +
+                          std::to_string(stage->getChannelCount()) +
+                          " channels, but the data collector " +
+                          dataCollectorName() + " has " +
+                          std::to_string(m_DataChannelCount);
+    utils::Logger::getInstance().fatal(message);
+    throw std::invalid_argument(message);
+  }
+
+  std::unique_lock lock(m_LiveDataMutex);
+  TimeSeries derived(m_LiveTimeSeries->getStartingTime());
+  derived.setRollingVectorMaxSize(1000);
+  m_ProcessingStages.push_back(std::move(stage));
+  m_DerivedLiveTimeSeries.push_back(std::move(derived));
+}
+
+std::map<std::string, TimeSeries> DataCollector::getDerivedLiveData() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  std::map<std::string, TimeSeries> data;
+  for (size_t i = 0; i < m_ProcessingStages.size(); i++) {
+    data[dataCollectorName() + "." + m_ProcessingStages[i]->getName()] =
+        m_DerivedLiveTimeSeries[i];
+  }
+  return data;
+}
+
+void DataCollector::readDerivedLiveData(
+    const std::function<void(const std::string &, const TimeSeries &)> &reader)
+    const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  for (size_t i = 0; i < m_ProcessingStages.size(); i++) {
+    reader(dataCollectorName() + "." + m_ProcessingStages[i]->getName(),
+           m_DerivedLiveTimeSeries[i]);
+  }
+}
+
+std::map<std::string, nlohmann::json>
+DataCollector::getSerializedDerivedLiveData() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  std::map<std::string, nlohmann::json> data;
+  for (size_t i = 0; i < m_ProcessingStages.size(); i++) {
+    data[m_ProcessingStages[i]->getName()] =
+        m_DerivedLiveTimeSeries[i].serialize();
+  }
+  return data;
 }
 
 const TimeSeries &DataCollector::getLiveData() const {
@@ -118,10 +195,51 @@ const TimeSeries &DataCollector::getLiveData() const {
 }
 
 nlohmann::json DataCollector::getSerializedLiveData() const {
+  NEUROBIO_TRACE_SCOPE("DataCollector::getSerializedLiveData");
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  return m_LiveTimeSeries->serialize();
+}
+
+nlohmann::json DataCollector::getSerializedLiveData(size_t &sequence) const {
+  NEUROBIO_TRACE_SCOPE("DataCollector::getSerializedLiveData");
   std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  sequence = m_SampleCounter;
   return m_LiveTimeSeries->serialize();
 }
 
+void DataCollector::readLiveData(
+    const std::function<void(const TimeSeries &, size_t)> &reader) const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  reader(*m_LiveTimeSeries, m_SampleCounter);
+}
+
+size_t DataCollector::getLiveDataSequence() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  return m_SampleCounter;
+}
+
+nlohmann::json DataCollector::getSerializedReplayData(size_t fromSequence,
+                                                      size_t &firstSequence,
+                                                      size_t &sequence) const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  sequence = m_SampleCounter;
+
+  // The history holds the samples right before [SampleCounter]. It is a
+  // rolling window, so only the samples it still holds are counted
+  const auto &history = m_ReplayTimeSeries.getData();
+  size_t historySize =
+      history.getIsFull() ? history.getMaxSize() : history.size();
+  size_t oldestSequence = m_SampleCounter - historySize;
+  firstSequence = std::min(std::max(fromSequence, oldestSequence), sequence);
+  return m_ReplayTimeSeries.slice(firstSequence - oldestSequence, historySize)
+      .serialize();
+}
+
+double DataCollector::getClockSkew() const {
+  std::shared_lock lock(const_cast<std::shared_mutex &>(m_LiveDataMutex));
+  return m_ClockModel.getSkew();
+}
+
 const TimeSeries &DataCollector::getTrialData() const {
   if (m_IsRecording) {
     std::string message =
@@ -134,17 +252,102 @@ const TimeSeries &DataCollector::getTrialData() const {
 
 void DataCollector::addDataPoints(
     const std::vector<std::vector<double>> &data) {
+  addDataPoints(data, nullptr);
+}
+
+void DataCollector::addDataPoints(
+    const std::vector<std::vector<double>> &data,
+    const std::vector<std::chrono::microseconds> &timeStamps) {
+  if (timeStamps.size() != data.size()) {
+    std::string message = "The data collector " + dataCollectorName() +
+                          " received " + std::to_string(data.size()) +
+                          " samples but " + std::to_string(timeStamps.size()) +
+                          " timestamps";
+    utils::Logger::getInstance().fatal(message);
+    throw std::invalid_argument(message);
+  }
+  addDataPoints(data, &timeStamps);
+}
+
+void DataCollector::addDataPoints(
+    const std::vector<std::vector<double>> &data,
+    const std::vector<std::chrono::microseconds> *timeStamps) {
   if (!m_IsStreamingData || data.size() == 0) {
     return;
   }
+  NEUROBIO_TRACE_SCOPE("DataCollector::addDataPoints");
+  auto arrivalTime = std::chrono::high_resolution_clock::now();
   {
-    std::unique_lock lock(m_LiveDataMutex);
-    for (auto d : data) {
-      m_LiveTimeSeries->add(d);
-      if (m_IsRecording) {
-        m_TrialTimeSeries->add(d);
+    std::unique_lock lock(m_LiveDataMutex, std::defer_lock);
+    {
+      NEUROBIO_TRACE_SCOPE("DataCollector::addDataPoints (lock)");
+      lock.lock();
+    }
+    if (!m_IngestedSamplesMetric) {
+      m_IngestedSamplesMetric = utils::Metrics::getInstance().counter(
+          dataCollectorName() + ".ingestedSamples");
+    }
+
+    // Only the last sample of the block was acquired right before its arrival
+    bool hasClockModel = !timeStamps && m_ClockModel.isEnabled();
+    if (hasClockModel) {
+      m_ClockModel.observe(m_SampleCounter + data.size() - 1, arrivalTime);
+    }
+
+    std::vector<bool> hasOutput(m_ProcessingStages.size());
+    for (size_t k = 0; k < data.size(); k++) {
+      // The stages work on the zero levelled sample, so their outputs are not
+      // biased by the offset, and they may transform it before it is stored
+      // in the live data. The trials keep the raw samples
+      const auto &raw = data[k];
+      auto d = m_LiveTimeSeries->zeroLevelData(raw);
+      for (size_t i = 0; i < m_ProcessingStages.size(); i++) {
+        hasOutput[i] = m_ProcessingStages[i]->process(d);
+      }
+
+      if (timeStamps || hasClockModel) {
+        auto time = timeStamps ? m_LiveTimeSeries->getStopWatch() +
+                                     (*timeStamps)[k]
+                               : m_ClockModel.stamp(m_SampleCounter);
+        m_LiveTimeSeries->addZeroLevelled(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                time - m_LiveTimeSeries->getStopWatch()),
+            d);
+        // The samples acquired before the recording started (e.g. the
+        // beginning of the block that arrived right after) are not part of
+        // the trial, which would otherwise start with negative timestamps
+        if (m_IsRecording && time >= m_TrialTimeSeries->getStopWatch()) {
+          m_TrialTimeSeries->add(
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  time - m_TrialTimeSeries->getStopWatch()),
+              raw);
+        }
+      } else {
+        m_LiveTimeSeries->addZeroLevelled(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() -
+                m_LiveTimeSeries->getStopWatch()),
+            d);
+        if (m_IsRecording) {
+          m_TrialTimeSeries->add(raw);
+        }
       }
+
+      // The history keeps the samples as they are in the live data
+      const auto &sample = m_LiveTimeSeries->back();
+      m_ReplayTimeSeries.add(sample.getTimeStamp(), sample.getData());
+
+      // The derived data share the timestamp of the sample they end with
+      for (size_t i = 0; i < m_ProcessingStages.size(); i++) {
+        if (hasOutput[i]) {
+          m_DerivedLiveTimeSeries[i].add(
+              m_LiveTimeSeries->back().getTimeStamp(),
+              m_ProcessingStages[i]->getOutput());
+        }
+      }
+      m_SampleCounter++;
     }
+    m_IngestedSamplesMetric->add(data.size());
     onNewData.notifyListeners(m_LiveTimeSeries->back());
   }
-}
\ No newline at end of file
+}
@@ -9,6 +9,8 @@
 #include "Data/FixedTimeSeries.h"
 #include "Devices/Exceptions.h"
 #include "Utils/Logger.h"
+#include "Utils/Metrics.h"
+#include "Utils/Tracer.h"
 
 using namespace NEUROBIO_NAMESPACE::devices;
 std::chrono::microseconds DATA_COLLECTOR_TIMER(5);
@@ -71,6 +73,8 @@ DelsysBaseDevice::DelsysBaseDevice(size_t channelCount,
         return timeSeriesGenerator(deltaTime);
       }) {
   m_IgnoreTooSlowWarning = true;
+  m_ClockModel = data::ClockModel(deltaTime);
+  setFrameDeadlineBudget();
 }
 
 DelsysBaseDevice::DelsysBaseDevice(size_t channelCount,
@@ -88,6 +92,8 @@ DelsysBaseDevice::DelsysBaseDevice(size_t channelCount,
         return timeSeriesGenerator(deltaTime);
       }) {
   m_IgnoreTooSlowWarning = true;
+  m_ClockModel = data::ClockModel(deltaTime);
+  setFrameDeadlineBudget();
 }
 
 DelsysBaseDevice::DelsysBaseDevice(
@@ -105,6 +111,15 @@ DelsysBaseDevice::DelsysBaseDevice(
         return timeSeriesGenerator(deltaTime);
       }) {
   m_IgnoreTooSlowWarning = true;
+  m_ClockModel = data::ClockModel(deltaTime);
+  setFrameDeadlineBudget();
+}
+
+void DelsysBaseDevice::setFrameDeadlineBudget() {
+  // The data check waits for each frame, so it only misses its deadline when a
+  // frame arrives a full frame late
+  m_DeadlineBudget.maxExecutionTime =
+      m_DeltaTime * static_cast<int64_t>(2 * m_SampleCount);
 }
 
 DelsysBaseDevice::~DelsysBaseDevice() {
@@ -182,7 +197,25 @@ DelsysBaseDevice::parseAsyncSendCommand(const DeviceCommands &command,
 }
 
 void DelsysBaseDevice::dataCheck() {
-  m_DataDevice->read(m_DataBuffer);
+  // The data worker is the only caller, so the metrics can be fetched lazily
+  if (!m_DataCheckDurationMetric) {
+    auto &metrics = utils::Metrics::getInstance();
+    m_DataCheckDurationMetric =
+        metrics.histogram(dataCollectorName() + ".dataCheckDuration");
+    m_DroppedFramesMetric =
+        metrics.counter(dataCollectorName() + ".droppedFrames");
+    m_SkippedSamplesMetric =
+        metrics.counter(dataCollectorName() + ".skippedZeroSamples");
+  }
+
+  // The read waits for the device, only the decoding is traced
+  if (!m_DataDevice->read(m_DataBuffer)) {
+    // The buffer still holds the previous frame, do not add it twice
+    m_DroppedFramesMetric->add();
+    return;
+  }
+  NEUROBIO_TRACE_SCOPE("DelsysBaseDevice::dataCheck");
+  utils::HistogramScope durationScope(*m_DataCheckDurationMetric);
 
   // Allocate space for all data in a single vector of floats
   std::vector<float> allData(m_SampleCount * m_DataChannelCount);
@@ -207,6 +240,7 @@ void DelsysBaseDevice::dataCheck() {
     // If the first frame is all zeros, assume no data were sent at all
     if (std::all_of(frame.begin(), frame.end(),
                     [](double value) { return value == 0.0; })) {
+      m_SkippedSamplesMetric->add();
       continue;
     }
     dataPoints.push_back(std::move(frame));
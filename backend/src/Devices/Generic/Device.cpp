@@ -23,6 +23,7 @@ bool Device::connect() {
 
   if (m_IsConnected) {
     logger.info("The device " + deviceName() + " is now connected");
+    onConnectionChanged.notifyListeners(true);
     return true;
   } else {
     logger.fatal("Could not connect to the device " + deviceName());
@@ -46,6 +47,7 @@ bool Device::disconnect() {
     return false;
   } else {
     logger.info("The device " + deviceName() + " is now disconnected");
+    onConnectionChanged.notifyListeners(false);
     return true;
   }
 }
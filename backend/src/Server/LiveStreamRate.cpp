@@ -0,0 +1,25 @@
+#include "Server/LiveStreamRate.h"
+
+#include <algorithm>
+
+using namespace NEUROBIO_NAMESPACE::server;
+
+LiveStreamRate::LiveStreamRate(std::chrono::milliseconds interval,
+                               std::chrono::milliseconds maxInterval)
+    : m_Interval(interval), m_MaxInterval(std::max(interval, maxInterval)),
+      m_CurrentInterval(interval) {}
+
+void LiveStreamRate::update(std::chrono::steady_clock::duration sendDuration) {
+  std::chrono::steady_clock::duration interval = m_Interval;
+  std::chrono::steady_clock::duration maxInterval = m_MaxInterval;
+
+  if (sendDuration > m_CurrentInterval / 2) {
+    // The client does not read as fast as the packets are sent
+    m_CurrentInterval = std::min(m_CurrentInterval * 2, maxInterval);
+  } else if (sendDuration < m_CurrentInterval / 4) {
+    // The client keeps up
+    m_CurrentInterval = std::max(m_CurrentInterval * 3 / 4, interval);
+  }
+}
+
+void LiveStreamRate::reset() { m_CurrentInterval = m_Interval; }
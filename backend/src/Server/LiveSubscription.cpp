@@ -0,0 +1,113 @@
+#include "Server/LiveSubscription.h"
+
+#include "Utils/Logger.h"
+#include <stdexcept>
+
+using namespace NEUROBIO_NAMESPACE::server;
+
+LiveSubscription::LiveSubscription()
+    : m_IsEveryStream(true), m_MaxRate(0.0), m_IsCompressedData(false),
+      m_HasAnalyses(true), m_IsBinaryAnalyses(false), m_Key("") {}
+
+LiveSubscription::LiveSubscription(const nlohmann::json &json)
+    : LiveSubscription() {
+  std::string message;
+  try {
+    m_MaxRate = json.value("max_rate", m_MaxRate);
+    m_IsCompressedData = json.value("compressed_data", m_IsCompressedData);
+    m_HasAnalyses = json.value("analyses", m_HasAnalyses);
+    m_IsBinaryAnalyses = json.value("binary_analyses", m_IsBinaryAnalyses);
+    if (json.contains("streams")) {
+      m_IsEveryStream = false;
+      for (const auto &[name, value] : json.at("streams").items()) {
+        LiveSubscriptionStream stream;
+        stream.channels = value.value("channels", stream.channels);
+        stream.decimation = value.value("decimation", stream.decimation);
+        if (stream.decimation == 0) {
+          message = "The decimation of " + name + " must be at least 1";
+        }
+        m_Streams[name] = stream;
+      }
+      // The streams are sorted by name, so the same streams give the same key
+      m_Key = serialize()["streams"].dump();
+    }
+    if (m_IsCompressedData) {
+      m_Key += "compressed";
+    }
+  } catch (const nlohmann::json::exception &e) {
+    message = "The live subscription is invalid: " + std::string(e.what());
+  }
+  if (message.empty() && !(m_MaxRate >= 0)) {
+    message = "The maximum rate of the live subscription cannot be negative";
+  }
+
+  if (!message.empty()) {
+    utils::Logger::getInstance().fatal(message);
+    throw std::invalid_argument(message);
+  }
+}
+
+nlohmann::json LiveSubscription::filter(const nlohmann::json &liveData) const {
+  if (m_IsEveryStream) {
+    return liveData;
+  }
+
+  nlohmann::json filtered = nlohmann::json::object();
+  for (const auto &[key, device] : liveData.items()) {
+    auto it = m_Streams.find(device.at("name").get<std::string>());
+    if (it == m_Streams.end()) {
+      continue;
+    }
+    const auto &stream = it->second;
+    const auto &data = device.at("data");
+    const auto &points = data.at("data");
+
+    auto keptPoints = nlohmann::json::array();
+    for (size_t i = 0; i < points.size(); i += stream.decimation) {
+      const auto &point = points[i];
+      if (stream.channels.empty()) {
+        keptPoints.push_back(point);
+        continue;
+      }
+
+      // A point is [timestamp, values, extra info]
+      const auto &values = point.at(1);
+      auto keptValues = nlohmann::json::array();
+      for (auto channel : stream.channels) {
+        if (channel < values.size()) {
+          keptValues.push_back(values[channel]);
+        }
+      }
+      auto keptPoint = nlohmann::json::array({point.at(0), keptValues});
+      if (point.size() > 2) {
+        keptPoint.push_back(point[2]);
+      }
+      keptPoints.push_back(std::move(keptPoint));
+    }
+
+    filtered[key] = {{"name", device.at("name")},
+                     {"data",
+                      {{"starting_time", data.at("starting_time")},
+                       {"data", std::move(keptPoints)}}}};
+    if (device.contains("sequence")) {
+      filtered[key]["sequence"] = device.at("sequence");
+    }
+  }
+  return filtered;
+}
+
+nlohmann::json LiveSubscription::serialize() const {
+  nlohmann::json json;
+  json["max_rate"] = m_MaxRate;
+  json["compressed_data"] = m_IsCompressedData;
+  json["analyses"] = m_HasAnalyses;
+  json["binary_analyses"] = m_IsBinaryAnalyses;
+  if (!m_IsEveryStream) {
+    json["streams"] = nlohmann::json::object();
+    for (const auto &[name, stream] : m_Streams) {
+      json["streams"][name] = {{"channels", stream.channels},
+                               {"decimation", stream.decimation}};
+    }
+  }
+  return json;
+}
@@ -0,0 +1,292 @@
+#include "Server/MultiplexedSocket.h"
+
+#include "Utils/Endian.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace NEUROBIO_NAMESPACE::server;
+
+// Frames are exactly 12 bytes of header followed by the payload, little-endian
+// - First 4 bytes are the channel of the frame
+// - Next 8 bytes are the size of the payload
+// The payloads of a channel, put end to end, are the bytes that would be sent
+// on the socket of this channel if it had its own
+
+MultiplexedSocket::MultiplexedSocket(
+    std::shared_ptr<asio::ip::tcp::socket> socket,
+    const std::vector<TcpServerChannel> &readChannels, size_t maxPendingBytes)
+    : m_Socket(socket), m_IsWritingFrame(false), m_PriorityFrameCount(0),
+      m_IsReadingFrame(false), m_IsChannelRead{},
+      m_MaxPendingBytes(maxPendingBytes) {
+  for (auto channel : readChannels) {
+    m_IsChannelRead[static_cast<size_t>(channel)] = true;
+  }
+}
+
+void MultiplexedSocket::writeFrameHeader(char *header,
+                                         TcpServerChannel channel,
+                                         size_t size) {
+  uint32_t channelLittleEndian = htole32(static_cast<uint32_t>(channel));
+  std::memcpy(header, &channelLittleEndian, sizeof(channelLittleEndian));
+
+  uint64_t sizeLittleEndian = htole64(static_cast<uint64_t>(size));
+  std::memcpy(header + sizeof(channelLittleEndian), &sizeLittleEndian,
+              sizeof(sizeLittleEndian));
+}
+
+bool MultiplexedSocket::parseFrameHeader(const char *header,
+                                         TcpServerChannel &channel,
+                                         size_t &size) const {
+  uint32_t channelLittleEndian;
+  std::memcpy(&channelLittleEndian, header, sizeof(channelLittleEndian));
+  uint32_t channelValue = le32toh(channelLittleEndian);
+
+  uint64_t sizeLittleEndian;
+  std::memcpy(&sizeLittleEndian, header + sizeof(channelLittleEndian),
+              sizeof(sizeLittleEndian));
+  uint64_t sizeValue = le64toh(sizeLittleEndian);
+
+  if (channelValue >= TCP_SERVER_CHANNEL_COUNT ||
+      !m_IsChannelRead[channelValue] ||
+      sizeValue > MAX_BYTES_IN_MULTIPLEXED_FRAME) {
+    return false;
+  }
+  channel = static_cast<TcpServerChannel>(channelValue);
+  size = static_cast<size_t>(sizeValue);
+  return true;
+}
+
+size_t
+MultiplexedSocket::write(TcpServerChannel channel,
+                         const std::array<asio::const_buffer, 2> &buffers,
+                         asio::error_code &error) {
+  bool isBulk = channel == TcpServerChannel::LIVE_DATA;
+  size_t total = buffers[0].size() + buffers[1].size();
+
+  // Where the next frame starts in [buffers]
+  size_t bufferIndex = 0;
+  size_t bufferOffset = 0;
+
+  size_t written = 0;
+  while (written < total) {
+    size_t frameSize =
+        std::min(MAX_BYTES_IN_MULTIPLEXED_FRAME, total - written);
+    std::array<char, BYTES_IN_MULTIPLEXED_FRAME_HEADER> header;
+    writeFrameHeader(header.data(), channel, frameSize);
+
+    // A frame spans at most the end of the first buffer and the beginning of
+    // the second one
+    std::array<asio::const_buffer, 3> frame;
+    frame[0] = asio::buffer(header);
+    size_t pieceCount = 1;
+    size_t remaining = frameSize;
+    while (remaining > 0) {
+      const auto &buffer = buffers[bufferIndex];
+      size_t size = std::min(remaining, buffer.size() - bufferOffset);
+      frame[pieceCount++] = asio::buffer(
+          static_cast<const char *>(buffer.data()) + bufferOffset, size);
+      remaining -= size;
+      bufferOffset += size;
+      if (bufferOffset == buffer.size()) {
+        bufferIndex++;
+        bufferOffset = 0;
+      }
+    }
+
+    lockForFrame(isBulk);
+    asio::write(*m_Socket, frame, error);
+    unlockForFrame();
+    if (error) {
+      return written;
+    }
+    written += frameSize;
+  }
+  return written;
+}
+
+size_t MultiplexedSocket::write(TcpServerChannel channel,
+                                asio::const_buffer buffer,
+                                asio::error_code &error) {
+  return write(channel, {buffer, asio::const_buffer()}, error);
+}
+
+void MultiplexedSocket::lockForFrame(bool isBulk) {
+  std::unique_lock lock(m_WriteMutex);
+  if (isBulk) {
+    m_WriteCondition.wait(lock, [this]() {
+      return !m_IsWritingFrame && m_PriorityFrameCount == 0;
+    });
+  } else {
+    m_PriorityFrameCount++;
+    m_WriteCondition.wait(lock, [this]() { return !m_IsWritingFrame; });
+    m_PriorityFrameCount--;
+  }
+  m_IsWritingFrame = true;
+}
+
+void MultiplexedSocket::unlockForFrame() {
+  {
+    std::lock_guard lock(m_WriteMutex);
+    m_IsWritingFrame = false;
+  }
+  m_WriteCondition.notify_all();
+}
+
+size_t MultiplexedSocket::read(TcpServerChannel channel,
+                               asio::mutable_buffer buffer,
+                               asio::error_code &error) {
+  std::unique_lock lock(m_ReadMutex);
+  while (!consume(channel, buffer)) {
+    if (m_ReadError) {
+      error = m_ReadError;
+      return 0;
+    }
+    if (m_IsReadingFrame) {
+      // Another thread is reading, the frame may be for this channel
+      m_ReadCondition.wait(lock);
+      continue;
+    }
+
+    m_IsReadingFrame = true;
+    lock.unlock();
+    readFrame(error);
+    lock.lock();
+    if (error) {
+      m_ReadError = error;
+      m_IsReadingFrame = false;
+      m_ReadCondition.notify_all();
+    }
+  }
+  return buffer.size();
+}
+
+bool MultiplexedSocket::tryRead(TcpServerChannel channel,
+                                asio::mutable_buffer buffer) {
+  std::lock_guard lock(m_ReadMutex);
+  return consume(channel, buffer);
+}
+
+void MultiplexedSocket::readFrame(asio::error_code &error) {
+  std::array<char, BYTES_IN_MULTIPLEXED_FRAME_HEADER> header;
+  asio::read(*m_Socket, asio::buffer(header), error);
+  if (error) {
+    return;
+  }
+
+  TcpServerChannel channel;
+  size_t size;
+  if (!parseFrameHeader(header.data(), channel, size)) {
+    error = asio::error::invalid_argument;
+    return;
+  }
+  std::vector<char> payload(size);
+  asio::read(*m_Socket, asio::buffer(payload), error);
+  if (error) {
+    return;
+  }
+
+  std::lock_guard lock(m_ReadMutex);
+  if (!receiveFrame(channel, payload)) {
+    error = asio::error::no_buffer_space;
+  }
+}
+
+void MultiplexedSocket::asyncReadFrame(
+    std::function<void(const asio::error_code &)> handler) {
+  {
+    std::lock_guard lock(m_ReadMutex);
+    m_IsReadingFrame = true;
+  }
+
+  auto fail = [this, handler](const asio::error_code &error) {
+    {
+      std::lock_guard lock(m_ReadMutex);
+      m_ReadError = error;
+      m_IsReadingFrame = false;
+    }
+    m_ReadCondition.notify_all();
+    handler(error);
+  };
+
+  auto header =
+      std::make_shared<std::array<char, BYTES_IN_MULTIPLEXED_FRAME_HEADER>>();
+  asio::async_read(
+      *m_Socket, asio::buffer(*header),
+      [this, header, handler, fail](const asio::error_code &ec, size_t) {
+        if (ec) {
+          fail(ec);
+          return;
+        }
+
+        TcpServerChannel channel;
+        size_t size;
+        if (!parseFrameHeader(header->data(), channel, size)) {
+          fail(asio::error::invalid_argument);
+          return;
+        }
+        auto payload = std::make_shared<std::vector<char>>(size);
+        asio::async_read(
+            *m_Socket, asio::buffer(*payload),
+            [this, channel, payload, handler,
+             fail](const asio::error_code &ec, size_t) {
+              if (ec) {
+                fail(ec);
+                return;
+              }
+              bool isReceived;
+              {
+                std::lock_guard lock(m_ReadMutex);
+                isReceived = receiveFrame(channel, *payload);
+              }
+              if (!isReceived) {
+                fail(asio::error::no_buffer_space);
+                return;
+              }
+              handler(ec);
+            });
+      });
+}
+
+bool MultiplexedSocket::receiveFrame(TcpServerChannel channel,
+                                     const std::vector<char> &payload) {
+  auto &pendingBytes = m_PendingBytes[static_cast<size_t>(channel)];
+  if (m_MaxPendingBytes > 0 &&
+      pendingBytes.size() + payload.size() > m_MaxPendingBytes) {
+    // The reader of the channel does not keep up (or the peer floods it), the
+    // caller fails the reading
+    return false;
+  }
+  pendingBytes.insert(pendingBytes.end(), payload.begin(), payload.end());
+  m_IsReadingFrame = false;
+  m_ReadCondition.notify_all();
+  return true;
+}
+
+bool MultiplexedSocket::consume(TcpServerChannel channel,
+                                asio::mutable_buffer buffer) {
+  auto &pendingBytes = m_PendingBytes[static_cast<size_t>(channel)];
+  if (pendingBytes.size() < buffer.size()) {
+    return false;
+  }
+  std::memcpy(buffer.data(), pendingBytes.data(), buffer.size());
+  pendingBytes.erase(pendingBytes.begin(),
+                     pendingBytes.begin() + buffer.size());
+  return true;
+}
+
+bool MultiplexedSocket::isOpen() const { return m_Socket->is_open(); }
+
+void MultiplexedSocket::shutdown() {
+  if (m_Socket->is_open()) {
+    asio::error_code error;
+    m_Socket->shutdown(asio::ip::tcp::socket::shutdown_both, error);
+  }
+}
+
+void MultiplexedSocket::close() {
+  if (m_Socket->is_open()) {
+    asio::error_code error;
+    m_Socket->shutdown(asio::ip::tcp::socket::shutdown_both, error);
+    m_Socket->close(error);
+  }
+}
@@ -0,0 +1,203 @@
+#include "Server/PredictionHistory.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Utils/LittleEndian.h"
+#include "Utils/Logger.h"
+
+using namespace NEUROBIO_NAMESPACE::server;
+
+static const uint8_t HAS_PHASE_FLAG = 1;
+static const uint8_t HAS_CHANGED_PHASE_FLAG = 2;
+static const uint8_t IS_TRUNCATED_FLAG = 1;
+static const char TRUNCATED[] = "The live predictions are truncated";
+
+PredictionHistory::PredictionHistory(size_t capacity)
+    : m_Capacity(std::max(capacity, size_t(1))), m_LastSequence(0),
+      m_LastDroppedSequence(0), m_StartingTime(std::chrono::system_clock::now()) {}
+
+size_t PredictionHistory::add(const analyzer::Predictions &predictions) {
+  m_StartingTime = predictions.getStartingTime();
+
+  size_t addedCount = 0;
+  for (const auto &[name, prediction] : predictions.getPredictions()) {
+    auto it = m_AnalyzerIds.find(name);
+    if (it == m_AnalyzerIds.end()) {
+      it = m_AnalyzerIds
+               .emplace(name, static_cast<uint32_t>(m_Predictions.size()))
+               .first;
+      m_Predictions.emplace_back(m_Capacity);
+    }
+
+    auto &history = m_Predictions[it->second];
+    if (history.size() > 0 &&
+        history.back().prediction.getTimeStamp() ==
+            prediction.getTimeStamp()) {
+      // The analyzer did not predict anything new
+      continue;
+    }
+
+    if (history.getIsFull()) {
+      // The oldest prediction of the analyzer is about to be overwritten
+      m_LastDroppedSequence =
+          std::max(m_LastDroppedSequence, history[0].sequence);
+    }
+
+    LivePrediction livePrediction;
+    livePrediction.sequence = ++m_LastSequence;
+    livePrediction.analyzer = name;
+    livePrediction.prediction = prediction;
+    history.push_back(std::move(livePrediction));
+    addedCount++;
+  }
+  return addedCount;
+}
+
+std::string PredictionHistory::serialize(uint64_t afterSequence) const {
+  // Collect the predictions to send, newest first for each analyzer
+  std::vector<std::pair<const LivePrediction *, uint32_t>> toSend;
+  std::vector<uint32_t> analyzerIds;
+  for (uint32_t id = 0; id < m_Predictions.size(); id++) {
+    const auto &history = m_Predictions[id];
+    size_t count = history.getIsFull() ? history.getMaxSize() : history.size();
+    size_t sentCount = 0;
+    for (size_t i = count; i > 0; i--) {
+      const auto &prediction = history[i - 1];
+      if (prediction.sequence <= afterSequence) {
+        break;
+      }
+      toSend.push_back({&prediction, id});
+      sentCount++;
+    }
+    if (sentCount > 0) {
+      analyzerIds.push_back(id);
+    }
+  }
+  std::sort(toSend.begin(), toSend.end(), [](const auto &a, const auto &b) {
+    return a.first->sequence < b.first->sequence;
+  });
+
+  std::string buffer;
+  utils::appendLittleEndian(
+      buffer,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          m_StartingTime.time_since_epoch())
+          .count(),
+      8);
+  utils::appendLittleEndian(
+      buffer, m_LastDroppedSequence > afterSequence ? IS_TRUNCATED_FLAG : 0, 1);
+
+  utils::appendLittleEndian(buffer, analyzerIds.size(), 4);
+  for (const auto &[name, id] : m_AnalyzerIds) {
+    if (std::find(analyzerIds.begin(), analyzerIds.end(), id) ==
+        analyzerIds.end()) {
+      continue;
+    }
+    utils::appendLittleEndian(buffer, id, 4);
+    utils::appendLittleEndian(buffer, name.size(), 4);
+    buffer.append(name);
+  }
+
+  utils::appendLittleEndian(buffer, toSend.size(), 4);
+  for (const auto &[livePrediction, id] : toSend) {
+    const auto &prediction = livePrediction->prediction;
+    const auto &extraInfo = prediction.getExtraInfo();
+
+    uint64_t phase = 0;
+    uint8_t flags = 0;
+    auto phaseIt = extraInfo.find("current_phase");
+    if (phaseIt != extraInfo.end() &&
+        std::holds_alternative<size_t>(phaseIt->second)) {
+      phase = std::get<size_t>(phaseIt->second);
+      flags |= HAS_PHASE_FLAG;
+    }
+    auto changedIt = extraInfo.find("has_changed_phase");
+    if (changedIt != extraInfo.end() &&
+        std::holds_alternative<bool>(changedIt->second) &&
+        std::get<bool>(changedIt->second)) {
+      flags |= HAS_CHANGED_PHASE_FLAG;
+    }
+
+    utils::appendLittleEndian(buffer, livePrediction->sequence, 8);
+    utils::appendLittleEndian(buffer, id, 4);
+    utils::appendLittleEndian(buffer, prediction.getTimeStamp().count(), 8);
+    utils::appendLittleEndian(buffer, phase, 4);
+    utils::appendLittleEndian(buffer, flags, 1);
+
+    const auto &values = prediction.getData();
+    utils::appendLittleEndian(buffer, values.size(), 4);
+    for (auto value : values) {
+      utils::appendDouble(buffer, value);
+    }
+  }
+  return buffer;
+}
+
+LivePredictions
+PredictionHistory::deserialize(const std::vector<char> &data) {
+  LivePredictions livePredictions;
+  size_t position = 0;
+  livePredictions.startingTime =
+      std::chrono::system_clock::time_point(
+          std::chrono::microseconds(static_cast<int64_t>(
+              utils::readLittleEndian(data, position, 8, TRUNCATED))));
+  livePredictions.isTruncated =
+      utils::readLittleEndian(data, position, 1, TRUNCATED) &
+      IS_TRUNCATED_FLAG;
+
+  std::map<uint32_t, std::string> names;
+  size_t analyzerCount = utils::readLittleEndian(data, position, 4, TRUNCATED);
+  for (size_t i = 0; i < analyzerCount; i++) {
+    auto id = static_cast<uint32_t>(
+        utils::readLittleEndian(data, position, 4, TRUNCATED));
+    size_t nameSize = utils::readLittleEndian(data, position, 4, TRUNCATED);
+    if (position + nameSize > data.size()) {
+      throw std::runtime_error(TRUNCATED);
+    }
+    names[id] = std::string(data.data() + position, nameSize);
+    position += nameSize;
+  }
+
+  size_t predictionCount =
+      utils::readLittleEndian(data, position, 4, TRUNCATED);
+  for (size_t i = 0; i < predictionCount; i++) {
+    LivePrediction livePrediction;
+    livePrediction.sequence =
+        utils::readLittleEndian(data, position, 8, TRUNCATED);
+    auto id = static_cast<uint32_t>(
+        utils::readLittleEndian(data, position, 4, TRUNCATED));
+    auto nameIt = names.find(id);
+    if (nameIt == names.end()) {
+      std::string message = "The analyzer " + std::to_string(id) +
+                            " of the live predictions is unknown";
+      utils::Logger::getInstance().fatal(message);
+      throw std::runtime_error(message);
+    }
+    livePrediction.analyzer = nameIt->second;
+
+    auto timeStamp = std::chrono::microseconds(static_cast<int64_t>(
+        utils::readLittleEndian(data, position, 8, TRUNCATED)));
+    size_t phase = utils::readLittleEndian(data, position, 4, TRUNCATED);
+    auto flags = static_cast<uint8_t>(
+        utils::readLittleEndian(data, position, 1, TRUNCATED));
+
+    size_t valueCount = utils::readLittleEndian(data, position, 4, TRUNCATED);
+    if (position + valueCount * 8 > data.size()) {
+      throw std::runtime_error(TRUNCATED);
+    }
+    std::vector<double> values(valueCount);
+    for (size_t j = 0; j < valueCount; j++) {
+      values[j] = utils::readDouble(data, position, TRUNCATED);
+    }
+
+    data::ExtraInfo extraInfo;
+    if (flags & HAS_PHASE_FLAG) {
+      extraInfo["current_phase"] = phase;
+      extraInfo["has_changed_phase"] = (flags & HAS_CHANGED_PHASE_FLAG) != 0;
+    }
+    livePrediction.prediction = data::DataPoint(timeStamp, values, extraInfo);
+    livePredictions.predictions.push_back(std::move(livePrediction));
+  }
+  return livePredictions;
+}
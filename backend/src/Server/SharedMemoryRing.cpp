@@ -0,0 +1,305 @@
+#include "Server/SharedMemoryRing.h"
+
+#include "Utils/Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <random>
+#include <stdexcept>
+
+#if defined(__linux__) || defined(__APPLE__)
+#define NEUROBIO_HAS_SHARED_MEMORY
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace NEUROBIO_NAMESPACE::server;
+
+// "NBSM" in little endian, so a segment that is not ours is not read
+static const uint32_t SHARED_MEMORY_MAGIC = 0x4D53424E;
+static const uint32_t SHARED_MEMORY_VERSION = 1;
+
+// The headers and the slots are aligned on cache lines so the writer and the
+// readers do not share them for nothing
+static const size_t CACHE_LINE_SIZE = 64;
+
+static size_t alignOnCacheLine(size_t size) {
+  return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+struct SharedMemoryRing::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t slotCount;
+  uint64_t slotSize;
+  uint64_t token;
+
+  /// @brief The number of messages published, written last so a reader never
+  /// sees a message before it is complete
+  std::atomic<uint64_t> writeSequence;
+};
+
+struct SharedMemoryRing::SlotHeader {
+  /// @brief 2n + 1 while the message n is written, 2n + 2 once it is complete
+  std::atomic<uint64_t> sequence;
+  uint32_t dataType;
+  uint32_t reserved;
+
+  /// @brief When the message was published, in milliseconds since epoch
+  int64_t timestamp;
+
+  /// @brief The size of the message, which follows this header
+  uint64_t size;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The shared memory requires lock-free atomics, as they are "
+              "shared between processes");
+
+size_t SharedMemoryRing::headerSize() {
+  return alignOnCacheLine(sizeof(Header));
+}
+
+size_t SharedMemoryRing::slotStride(size_t slotSize) {
+  return alignOnCacheLine(sizeof(SlotHeader) + slotSize);
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string &name, size_t slotCount,
+                                   size_t slotSize)
+    : m_Name(name), m_SlotCount(slotCount), m_SlotSize(slotSize),
+      m_IsWriter(true),
+      m_MappedSize(headerSize() + slotCount * slotStride(slotSize)),
+      m_Memory(nullptr) {
+  auto &logger = utils::Logger::getInstance();
+  if (slotCount < 2) {
+    std::string message = "The shared memory needs at least 2 slots";
+    logger.fatal(message);
+    throw std::invalid_argument(message);
+  }
+
+#ifdef NEUROBIO_HAS_SHARED_MEMORY
+  // Replace the segment a previous server may have left behind
+  shm_unlink(m_Name.c_str());
+  int fileDescriptor =
+      shm_open(m_Name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fileDescriptor < 0) {
+    std::string message = "Could not create the shared memory " + m_Name +
+                          ": " + std::strerror(errno);
+    logger.fatal(message);
+    throw std::runtime_error(message);
+  }
+  if (ftruncate(fileDescriptor, static_cast<off_t>(m_MappedSize)) != 0) {
+    std::string message = "Could not allocate the shared memory " + m_Name +
+                          ": " + std::strerror(errno);
+    close(fileDescriptor);
+    shm_unlink(m_Name.c_str());
+    logger.fatal(message);
+    throw std::runtime_error(message);
+  }
+  try {
+    map(fileDescriptor);
+  } catch (...) {
+    shm_unlink(m_Name.c_str());
+    throw;
+  }
+
+  // The segment is zero-filled, so only the geometry is left to write
+  auto header = new (m_Memory) Header();
+  header->magic = SHARED_MEMORY_MAGIC;
+  header->version = SHARED_MEMORY_VERSION;
+  header->slotCount = m_SlotCount;
+  header->slotSize = m_SlotSize;
+  header->token = (static_cast<uint64_t>(std::random_device()()) << 32) |
+                  std::random_device()();
+  header->writeSequence.store(0, std::memory_order_release);
+  logger.info("Shared memory " + m_Name + " created (" +
+              std::to_string(m_SlotCount) + " slots of " +
+              std::to_string(m_SlotSize) + " bytes)");
+#else
+  std::string message = "The shared memory is not supported on this platform";
+  logger.fatal(message);
+  throw std::runtime_error(message);
+#endif
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string &name)
+    : m_Name(name), m_SlotCount(0), m_SlotSize(0), m_IsWriter(false),
+      m_MappedSize(0), m_Memory(nullptr) {
+  auto &logger = utils::Logger::getInstance();
+
+#ifdef NEUROBIO_HAS_SHARED_MEMORY
+  int fileDescriptor = shm_open(m_Name.c_str(), O_RDONLY, 0);
+  if (fileDescriptor < 0) {
+    std::string message = "Could not open the shared memory " + m_Name +
+                          ": " + std::strerror(errno);
+    logger.fatal(message);
+    throw std::runtime_error(message);
+  }
+  struct stat status;
+  if (fstat(fileDescriptor, &status) != 0 ||
+      static_cast<size_t>(status.st_size) < headerSize()) {
+    close(fileDescriptor);
+    std::string message = "The shared memory " + m_Name + " is invalid";
+    logger.fatal(message);
+    throw std::runtime_error(message);
+  }
+  m_MappedSize = static_cast<size_t>(status.st_size);
+  map(fileDescriptor);
+
+  const auto &header = *reinterpret_cast<const Header *>(m_Memory);
+  m_SlotCount = header.slotCount;
+  m_SlotSize = header.slotSize;
+  if (header.magic != SHARED_MEMORY_MAGIC ||
+      header.version != SHARED_MEMORY_VERSION || m_SlotCount < 2 ||
+      headerSize() + m_SlotCount * slotStride(m_SlotSize) > m_MappedSize) {
+    munmap(m_Memory, m_MappedSize);
+    m_Memory = nullptr;
+    std::string message = "The shared memory " + m_Name + " is invalid";
+    logger.fatal(message);
+    throw std::runtime_error(message);
+  }
+#else
+  std::string message = "The shared memory is not supported on this platform";
+  logger.fatal(message);
+  throw std::runtime_error(message);
+#endif
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+#ifdef NEUROBIO_HAS_SHARED_MEMORY
+  if (m_Memory) {
+    munmap(m_Memory, m_MappedSize);
+  }
+  if (m_IsWriter) {
+    shm_unlink(m_Name.c_str());
+  }
+#endif
+}
+
+bool SharedMemoryRing::isSupported() {
+#ifdef NEUROBIO_HAS_SHARED_MEMORY
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SharedMemoryRing::map(int fileDescriptor) {
+#ifdef NEUROBIO_HAS_SHARED_MEMORY
+  int protection = m_IsWriter ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *memory =
+      mmap(nullptr, m_MappedSize, protection, MAP_SHARED, fileDescriptor, 0);
+  int error = errno;
+  // The mapping keeps the segment alive, the descriptor is not needed anymore
+  close(fileDescriptor);
+  if (memory == MAP_FAILED) {
+    std::string message = "Could not map the shared memory " + m_Name + ": " +
+                          std::strerror(error);
+    utils::Logger::getInstance().fatal(message);
+    throw std::runtime_error(message);
+  }
+  m_Memory = static_cast<char *>(memory);
+#endif
+}
+
+SharedMemoryRing::SlotHeader &SharedMemoryRing::slot(uint64_t sequence) const {
+  return *reinterpret_cast<SlotHeader *>(m_Memory + headerSize() +
+                                         (sequence % m_SlotCount) *
+                                             slotStride(m_SlotSize));
+}
+
+uint64_t SharedMemoryRing::getWriteSequence() const {
+  return reinterpret_cast<const Header *>(m_Memory)->writeSequence.load(
+      std::memory_order_acquire);
+}
+
+uint64_t SharedMemoryRing::getToken() const {
+  return reinterpret_cast<const Header *>(m_Memory)->token;
+}
+
+bool SharedMemoryRing::publish(uint32_t dataType, const std::string &data) {
+  if (!m_IsWriter || data.size() > m_SlotSize) {
+    return false;
+  }
+
+  auto &header = *reinterpret_cast<Header *>(m_Memory);
+  uint64_t sequence = header.writeSequence.load(std::memory_order_relaxed);
+  auto &slotHeader = slot(sequence);
+
+  // Mark the slot as being written before touching its content
+  slotHeader.sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slotHeader.dataType = dataType;
+  slotHeader.timestamp =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  slotHeader.size = data.size();
+  std::memcpy(reinterpret_cast<char *>(&slotHeader) + sizeof(SlotHeader),
+              data.data(), data.size());
+
+  slotHeader.sequence.store(2 * sequence + 2, std::memory_order_release);
+  header.writeSequence.store(sequence + 1, std::memory_order_release);
+  return true;
+}
+
+bool SharedMemoryRing::read(uint64_t &sequence,
+                            SharedMemoryMessage &message) const {
+  SharedMemoryView view;
+  while (this->view(sequence, view)) {
+    message.dataType = view.dataType;
+    message.publishedAt = view.publishedAt;
+    message.data.assign(view.data.data(), view.data.size());
+    if (isValid(view)) {
+      return true;
+    }
+    // The message changed while being copied
+    sequence = getWriteSequence() - 1;
+  }
+  return false;
+}
+
+bool SharedMemoryRing::view(uint64_t &sequence,
+                            SharedMemoryView &message) const {
+  while (true) {
+    uint64_t writeSequence = getWriteSequence();
+    if (sequence >= writeSequence) {
+      return false;
+    }
+    if (writeSequence - sequence >= m_SlotCount) {
+      // The message is overwritten (or about to be), go to the newest one
+      sequence = writeSequence - 1;
+    }
+
+    const auto &slotHeader = slot(sequence);
+    if (slotHeader.sequence.load(std::memory_order_acquire) !=
+        2 * sequence + 2) {
+      // The writer lapped the reader since [writeSequence] was read
+      sequence = getWriteSequence() - 1;
+      continue;
+    }
+
+    message.sequence = sequence;
+    message.dataType = slotHeader.dataType;
+    message.publishedAt = std::chrono::system_clock::time_point(
+        std::chrono::milliseconds(slotHeader.timestamp));
+    // The size is bounded as it may be torn, which [isValid] detects
+    message.data = std::string_view(
+        reinterpret_cast<const char *>(&slotHeader) + sizeof(SlotHeader),
+        std::min<uint64_t>(slotHeader.size, m_SlotSize));
+
+    sequence++;
+    return true;
+  }
+}
+
+bool SharedMemoryRing::isValid(const SharedMemoryView &message) const {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot(message.sequence).sequence.load(std::memory_order_relaxed) ==
+         2 * message.sequence + 2;
+}
@@ -1,28 +1,8 @@
 #include "Server/TcpClient.h"
 
+#include "Utils/Endian.h"
 #include "Utils/Logger.h"
 
-#if defined(_WIN32) // Windows-specific handling
-// Windows is little-endian by default
-#define le32toh(x) (x)
-#define htole32(x) (x)
-#define le64toh(x) (x)
-#define htole64(x) (x)
-
-#elif defined(__APPLE__) // macOS
-#include <libkern/OSByteOrder.h>
-#define htole32(x) OSSwapHostToLittleInt32(x)
-#define le32toh(x) OSSwapLittleToHostInt32(x)
-#define htole64(x) OSSwapHostToLittleInt64(x)
-#define le64toh(x) OSSwapLittleToHostInt64(x)
-
-#elif defined(__linux__) // Linux
-#include <endian.h>      // Provides le32toh() and htole32()
-
-#else
-#error "Unsupported platform"
-#endif
-
 using asio::ip::tcp;
 using namespace NEUROBIO_NAMESPACE;
 using namespace NEUROBIO_NAMESPACE::server;
@@ -34,6 +14,8 @@ using namespace NEUROBIO_NAMESPACE::server;
 // - Next 4 bytes are the data type (if any)
 // - Remaining 8 mandatory bytes are the timestamp of the packet
 //   (milliseconds since epoch)
+// - If the version is PIPELINED_PROTOCOL_VERSION, the next 4 bytes are the id
+// of the request the server responds to
 // - If DATA_TYPE is not NONE, then the next 8 bytes are the data length to
 // follow
 //   (in bytes)
@@ -47,7 +29,8 @@ bool ServerResponse::checkVersionFromPacket(const std::vector<char> &buffer) {
   std::memcpy(&version, buffer.data(), sizeof(version));
   version = le32toh(version);
 
-  if (version != COMMUNICATION_PROTOCOL_VERSION) {
+  if (version != COMMUNICATION_PROTOCOL_VERSION &&
+      version != PIPELINED_PROTOCOL_VERSION) {
     auto &logger = utils::Logger::getInstance();
     logger.fatal("CLIENT: Invalid version: " + std::to_string(version) +
                  ". Please "
@@ -116,21 +99,30 @@ ServerResponse::ServerResponse()
     : m_HasReceivedData(false), m_Command(TcpServerCommand::NONE),
       m_Message(TcpServerMessage::NOK), m_DataType(TcpServerDataType::NONE),
       m_Timestamp(
-          std::chrono::system_clock::time_point(std::chrono::milliseconds(0))) {
-}
+          std::chrono::system_clock::time_point(std::chrono::milliseconds(0))),
+      m_HasRequestId(false), m_RequestId(0) {}
 
 ServerResponse::ServerResponse(tcp::socket &socket, std::shared_mutex &mutex)
+    : ServerResponse(
+          [&socket](asio::mutable_buffer buffer, asio::error_code &error) {
+            return asio::read(socket, buffer, error);
+          },
+          mutex) {}
+
+ServerResponse::ServerResponse(const ReadFunction &read,
+                               std::shared_mutex &mutex)
     : m_HasReceivedData(false), m_Command(TcpServerCommand::NONE),
       m_Message(TcpServerMessage::NOK), m_DataType(TcpServerDataType::NONE),
       m_Timestamp(
-          std::chrono::system_clock::time_point(std::chrono::milliseconds(0))) {
+          std::chrono::system_clock::time_point(std::chrono::milliseconds(0))),
+      m_HasRequestId(false), m_RequestId(0) {
 
-  std::vector<char> header = readHeaderFromSocket(socket);
+  std::vector<char> header = readHeaderFromSocket(read);
   if (header.empty()) {
     return;
   }
   auto dataType = parseDataTypeFromPacket(header);
-  auto data = readDataFromSocket(socket, dataType);
+  auto data = readDataFromSocket(read, dataType);
 
   std::unique_lock<std::shared_mutex> lock(mutex);
   m_HasReceivedData = true;
@@ -139,6 +131,13 @@ ServerResponse::ServerResponse(tcp::socket &socket, std::shared_mutex &mutex)
   m_DataType = dataType;
   m_Timestamp = parseTimeStampFromPacket(header);
   m_Data = std::move(data);
+  m_HasRequestId = header.size() > BYTES_IN_SERVER_PACKET_HEADER;
+  if (m_HasRequestId) {
+    uint32_t requestId;
+    std::memcpy(&requestId, header.data() + BYTES_IN_SERVER_PACKET_HEADER,
+                sizeof(requestId));
+    m_RequestId = le32toh(requestId);
+  }
 }
 
 std::chrono::system_clock::time_point
@@ -164,17 +163,31 @@ ServerResponse::parseTimeStampFromPacket(const std::vector<char> &buffer) {
       std::chrono::milliseconds(timestamp));
 }
 
-std::vector<char> ServerResponse::readHeaderFromSocket(tcp::socket &socket) {
+std::vector<char>
+ServerResponse::readHeaderFromSocket(const ReadFunction &read) {
   std::vector<char> headerBuffer(BYTES_IN_SERVER_PACKET_HEADER);
   asio::error_code error;
-  auto byteRead = asio::read(socket, asio::buffer(headerBuffer), error);
+  auto byteRead = read(asio::buffer(headerBuffer), error);
   if (byteRead != BYTES_IN_SERVER_PACKET_HEADER || error) {
     return {};
   }
+
+  uint32_t version;
+  std::memcpy(&version, headerBuffer.data(), sizeof(version));
+  if (le32toh(version) == PIPELINED_PROTOCOL_VERSION) {
+    headerBuffer.resize(BYTES_IN_SERVER_PACKET_HEADER + BYTES_IN_REQUEST_ID);
+    byteRead = read(asio::buffer(headerBuffer.data() +
+                                     BYTES_IN_SERVER_PACKET_HEADER,
+                                 BYTES_IN_REQUEST_ID),
+                    error);
+    if (byteRead != BYTES_IN_REQUEST_ID || error) {
+      return {};
+    }
+  }
   return headerBuffer;
 }
 
-std::vector<char> ServerResponse::readDataFromSocket(tcp::socket &socket,
+std::vector<char> ServerResponse::readDataFromSocket(const ReadFunction &read,
                                                      TcpServerDataType type) {
   if (type == TcpServerDataType::NONE) {
     return {}; // No data to read
@@ -182,7 +195,7 @@ std::vector<char> ServerResponse::readDataFromSocket(tcp::socket &socket,
 
   std::vector<char> dataBuffer(sizeof(uint64_t));
   asio::error_code error;
-  auto byteRead = asio::read(socket, asio::buffer(dataBuffer), error);
+  auto byteRead = read(asio::buffer(dataBuffer), error);
   if (byteRead != 8 || error) {
     return {};
   }
@@ -193,7 +206,7 @@ std::vector<char> ServerResponse::readDataFromSocket(tcp::socket &socket,
   }
 
   dataBuffer.resize(dataSize);
-  byteRead = asio::read(socket, asio::buffer(dataBuffer), error);
+  byteRead = read(asio::buffer(dataBuffer), error);
   if (byteRead != dataSize || error) {
     utils::Logger::getInstance().fatal(
         "CLIENT: Failed to read data from socket. Expected: " +
@@ -207,7 +220,9 @@ TcpClient::TcpClient(std::string host, int commandPort, int messagePort,
                      int liveDataPort, int liveAnalysesPort)
     : m_Host(host), m_CommandPort(commandPort), m_MessagePort(messagePort),
       m_LiveDataPort(liveDataPort), m_LiveAnalysesPort(liveAnalysesPort),
-      m_IsConnected(false) {};
+      m_MultiplexedPort(0), m_IsPipelined(true), m_IsConnected(false),
+      m_NextRequestId(0), m_CachedStatesVersion(0), m_LatestStatesVersion(0),
+      m_HasCachedStates(false) {};
 
 TcpClient::~TcpClient() {
   if (m_IsConnected) {
@@ -218,94 +233,155 @@ TcpClient::~TcpClient() {
 bool TcpClient::connect(uint32_t stateId) {
   auto &logger = utils::Logger::getInstance();
 
-  // Connect
+  // Connect, the context being stopped if the client was connected before
   m_IsConnected = false;
+  m_Context.restart();
   tcp::resolver resolver(m_Context);
 
-  m_CommandSocket = std::make_unique<tcp::socket>(m_Context);
-  auto commandHasReturned = std::make_shared<bool>(false);
-  asio::async_connect(
-      *m_CommandSocket, resolver.resolve(m_Host, std::to_string(m_CommandPort)),
-      [this, stateId, commandHasReturned](const asio::error_code &ec,
-                                          const tcp::endpoint &) {
-        *commandHasReturned = true;
-        if (ec) {
-          return;
-        }
-        asio::write(*m_CommandSocket,
-                    asio::buffer(constructCommandPacket(
-                        static_cast<TcpServerCommand>(stateId))));
-      });
-
-  m_MessageSocket = std::make_unique<tcp::socket>(m_Context);
-  auto messageHasReturned = std::make_shared<bool>(false);
-  asio::async_connect(
-      *m_MessageSocket, resolver.resolve(m_Host, std::to_string(m_MessagePort)),
-      [this, stateId, messageHasReturned](const asio::error_code &ec,
-                                          const tcp::endpoint &) {
-        *messageHasReturned = true;
-        if (ec) {
-          return;
-        }
-        asio::write(*m_MessageSocket,
-                    asio::buffer(constructCommandPacket(
-                        static_cast<TcpServerCommand>(stateId))));
-      });
-
-  m_LiveDataSocket = std::make_unique<tcp::socket>(m_Context);
-  auto liveDataHasReturned = std::make_shared<bool>(false);
-  asio::async_connect(
-      *m_LiveDataSocket,
-      resolver.resolve(m_Host, std::to_string(m_LiveDataPort)),
-      [this, stateId, liveDataHasReturned](const asio::error_code &ec,
-                                           const tcp::endpoint &) {
-        *liveDataHasReturned = true;
-        if (ec) {
-          return;
-        }
-        asio::write(*m_LiveDataSocket,
-                    asio::buffer(constructCommandPacket(
-                        static_cast<TcpServerCommand>(stateId))));
-        startUpdatingLiveData();
-      });
-
-  m_LiveAnalysesSocket = std::make_unique<tcp::socket>(m_Context);
-  auto liveAnalysesHasReturned = std::make_shared<bool>(false);
-  asio::async_connect(
-      *m_LiveAnalysesSocket,
-      resolver.resolve(m_Host, std::to_string(m_LiveAnalysesPort)),
-      [this, stateId, liveAnalysesHasReturned](const asio::error_code &ec,
-                                               const tcp::endpoint &) {
-        *liveAnalysesHasReturned = true;
-        if (ec) {
-          return;
-        }
-        asio::write(*m_LiveAnalysesSocket,
-                    asio::buffer(constructCommandPacket(
-                        static_cast<TcpServerCommand>(stateId))));
-        startUpdatingLiveAnalyses();
-      });
-
-  while (!*commandHasReturned || !*messageHasReturned ||
-         !*liveDataHasReturned || !*liveAnalysesHasReturned) {
-    m_Context.run_one();
+  m_MultiplexedSocket.reset();
+  if (m_MultiplexedPort > 0) {
+    // All the channels share a single connexion, identified as the others
+    auto socket = std::make_shared<tcp::socket>(m_Context);
+    auto hasReturned = std::make_shared<bool>(false);
+    asio::async_connect(
+        *socket, resolver.resolve(m_Host, std::to_string(m_MultiplexedPort)),
+        [this, socket, stateId, hasReturned](const asio::error_code &ec,
+                                             const tcp::endpoint &) {
+          *hasReturned = true;
+          if (ec) {
+            return;
+          }
+          asio::write(*socket, asio::buffer(constructCommandPacket(
+                                   static_cast<TcpServerCommand>(stateId))));
+        });
+    while (!*hasReturned) {
+      m_Context.run_one();
+    }
+    m_MultiplexedSocket = std::make_unique<MultiplexedSocket>(socket);
+  } else {
+    m_CommandSocket = std::make_unique<tcp::socket>(m_Context);
+    auto commandHasReturned = std::make_shared<bool>(false);
+    asio::async_connect(
+        *m_CommandSocket,
+        resolver.resolve(m_Host, std::to_string(m_CommandPort)),
+        [this, stateId, commandHasReturned](const asio::error_code &ec,
+                                            const tcp::endpoint &) {
+          *commandHasReturned = true;
+          if (ec) {
+            return;
+          }
+          asio::write(*m_CommandSocket,
+                      asio::buffer(constructCommandPacket(
+                          static_cast<TcpServerCommand>(stateId))));
+        });
+
+    m_MessageSocket = std::make_unique<tcp::socket>(m_Context);
+    auto messageHasReturned = std::make_shared<bool>(false);
+    asio::async_connect(
+        *m_MessageSocket,
+        resolver.resolve(m_Host, std::to_string(m_MessagePort)),
+        [this, stateId, messageHasReturned](const asio::error_code &ec,
+                                            const tcp::endpoint &) {
+          *messageHasReturned = true;
+          if (ec) {
+            return;
+          }
+          asio::write(*m_MessageSocket,
+                      asio::buffer(constructCommandPacket(
+                          static_cast<TcpServerCommand>(stateId))));
+        });
+
+    m_LiveDataSocket = std::make_unique<tcp::socket>(m_Context);
+    auto liveDataHasReturned = std::make_shared<bool>(false);
+    asio::async_connect(
+        *m_LiveDataSocket,
+        resolver.resolve(m_Host, std::to_string(m_LiveDataPort)),
+        [this, stateId, liveDataHasReturned](const asio::error_code &ec,
+                                             const tcp::endpoint &) {
+          *liveDataHasReturned = true;
+          if (ec) {
+            return;
+          }
+          asio::write(*m_LiveDataSocket,
+                      asio::buffer(constructCommandPacket(
+                          static_cast<TcpServerCommand>(stateId))));
+        });
+
+    m_LiveAnalysesSocket = std::make_unique<tcp::socket>(m_Context);
+    auto liveAnalysesHasReturned = std::make_shared<bool>(false);
+    asio::async_connect(
+        *m_LiveAnalysesSocket,
+        resolver.resolve(m_Host, std::to_string(m_LiveAnalysesPort)),
+        [this, stateId, liveAnalysesHasReturned](const asio::error_code &ec,
+                                                 const tcp::endpoint &) {
+          *liveAnalysesHasReturned = true;
+          if (ec) {
+            return;
+          }
+          asio::write(*m_LiveAnalysesSocket,
+                      asio::buffer(constructCommandPacket(
+                          static_cast<TcpServerCommand>(stateId))));
+        });
+
+    while (!*commandHasReturned || !*messageHasReturned ||
+           !*liveDataHasReturned || !*liveAnalysesHasReturned) {
+      m_Context.run_one();
+    }
   }
   m_IsConnected = true;
 
+  // The live streams are read only once the client is connected, otherwise
+  // their workers would stop right away
+  if (m_MultiplexedSocket ? m_MultiplexedSocket->isOpen()
+                          : m_LiveDataSocket->is_open()) {
+    startUpdatingLiveData();
+  }
+  if (m_MultiplexedSocket ? m_MultiplexedSocket->isOpen()
+                          : m_LiveAnalysesSocket->is_open()) {
+    startUpdatingLiveAnalyses();
+  }
+
   // Wait for the sockets to be connected
   m_ContextWorker = std::thread([this]() { m_Context.run(); });
 
   // Message socket should always listen to the server
   m_MessageWorker = std::thread([this]() {
     while (m_IsConnected) {
+      auto mutex = std::shared_mutex();
+      auto response = readResponse(TcpServerChannel::MESSAGE, mutex);
+
+      // The states and their changes are applied in the order they come
+      if (response.getDataType() == TcpServerDataType::STATES ||
+          response.getMessage() == TcpServerMessage::STATES_CHANGED) {
+        updateCachedStates(response);
+      }
+      if (response.getHasRequestId()) {
+        dispatchResponse(TcpServerChannel::MESSAGE, response);
+        continue;
+      }
+
       // For now, we do nothing with this, but it can be used to react from a
       // change in states of the server
-      m_PreviousMessage =
-          ServerResponse(*m_MessageSocket, m_PreviousMessageMutex);
+      std::unique_lock lock(m_PreviousMessageMutex);
+      m_PreviousMessage = response;
       m_HasPreviousMessage = m_PreviousMessage.getHasReceivedData();
     }
   });
 
+  // The responses to the pipelined requests may come in any order, so they
+  // are read as they come and given to the thread waiting for each of them
+  if (m_IsPipelined) {
+    m_CommandWorker = std::thread([this]() {
+      while (m_IsConnected) {
+        auto mutex = std::shared_mutex();
+        auto response = readResponse(TcpServerChannel::COMMAND, mutex);
+        if (response.getHasRequestId()) {
+          dispatchResponse(TcpServerChannel::COMMAND, response);
+        }
+      }
+    });
+  }
+
   // Send the handshake
   auto response = sendCommand(TcpServerCommand::HANDSHAKE);
   if (response.getMessage() == TcpServerMessage::NOK) {
@@ -319,19 +395,41 @@ bool TcpClient::connect(uint32_t stateId) {
 }
 
 bool TcpClient::disconnect() {
-  m_IsConnected = false;
+  {
+    std::lock_guard lock(m_PipelinedResponsesMutex);
+    m_IsConnected = false;
+  }
+  m_PipelinedResponsesCondition.notify_all();
 
-  closeSockets();
+  // The sockets are only closed once the workers are done with them, as a
+  // descriptor closed under a worker about to read it could already be
+  // reused by another socket (of another client) and be read instead
+  shutdownSockets();
   if (m_LiveDataWorker.joinable()) {
     m_LiveDataWorker.join();
   }
   if (m_LiveAnalysesWorker.joinable()) {
     m_LiveAnalysesWorker.join();
   }
+  if (m_SharedMemoryWorker.joinable()) {
+    m_SharedMemoryWorker.join();
+  }
+  m_SharedMemory.reset();
   m_MessageWorker.join();
+  if (m_CommandWorker.joinable()) {
+    m_CommandWorker.join();
+  }
+  closeSockets();
 
   m_Context.stop();
   m_ContextWorker.join();
+
+  // The server may be a new one next time, with its own versions of states
+  {
+    std::lock_guard lock(m_CachedStatesMutex);
+    m_HasCachedStates = false;
+    m_LatestStatesVersion = 0;
+  }
   return true;
 }
 
@@ -460,6 +558,173 @@ std::map<std::string, data::TimeSeries> TcpClient::getLastTrialData() {
   return data;
 }
 
+nlohmann::json TcpClient::getStates() {
+  auto &logger = utils::Logger::getInstance();
+  logger.info("CLIENT: Fetching the states of the server");
+
+  std::vector<char> dataBuffer =
+      sendCommandWithResponse(TcpServerCommand::GET_STATES);
+
+  nlohmann::json states;
+  try {
+    states = nlohmann::json::parse(dataBuffer);
+  } catch (...) {
+    logger.fatal("CLIENT: Failed to parse the states");
+    return nlohmann::json();
+  }
+
+  logger.info("CLIENT: States acquired");
+  return states;
+}
+
+nlohmann::json TcpClient::getCachedStates() {
+  std::lock_guard lock(m_CachedStatesMutex);
+  if (!m_HasCachedStates) {
+    return nlohmann::json();
+  }
+  auto states = m_CachedStates;
+  states["version"] = m_CachedStatesVersion;
+  return states;
+}
+
+void TcpClient::updateCachedStates(const ServerResponse &response) {
+  auto &logger = utils::Logger::getInstance();
+
+  if (response.getDataType() != TcpServerDataType::STATES) {
+    // The states changed, but the server did not tell how
+    std::lock_guard lock(m_CachedStatesMutex);
+    m_HasCachedStates = false;
+    return;
+  }
+
+  nlohmann::json json;
+  uint64_t version;
+  try {
+    json = nlohmann::json::parse(response.getData());
+    version = json.at("version").get<uint64_t>();
+  } catch (...) {
+    logger.fatal("CLIENT: Failed to parse the states");
+    return;
+  }
+
+  std::lock_guard lock(m_CachedStatesMutex);
+  if (version < m_LatestStatesVersion) {
+    // These states were already changed, and the changes are missing from
+    // them
+    return;
+  }
+  m_LatestStatesVersion = version;
+  if (response.getMessage() == TcpServerMessage::STATES_CHANGED) {
+    if (!m_HasCachedStates || version <= m_CachedStatesVersion) {
+      // Nothing to change, or already changed
+      return;
+    }
+    if (version != m_CachedStatesVersion + 1) {
+      logger.warning("CLIENT: Some changes of the states were missed");
+      m_HasCachedStates = false;
+      return;
+    }
+    try {
+      m_CachedStates = m_CachedStates.patch(json.at("changes"));
+    } catch (...) {
+      logger.fatal("CLIENT: Failed to apply the changes of the states");
+      m_HasCachedStates = false;
+      return;
+    }
+  } else {
+    json.erase("version");
+    m_CachedStates = std::move(json);
+    m_HasCachedStates = true;
+  }
+  m_CachedStatesVersion = version;
+}
+
+nlohmann::json TcpClient::getTrace() {
+  auto &logger = utils::Logger::getInstance();
+  logger.info("CLIENT: Fetching the trace of the server");
+
+  std::vector<char> dataBuffer =
+      sendCommandWithResponse(TcpServerCommand::GET_TRACE);
+
+  nlohmann::json trace;
+  try {
+    trace = nlohmann::json::parse(dataBuffer);
+  } catch (...) {
+    logger.fatal("CLIENT: Failed to parse the trace");
+    return nlohmann::json();
+  }
+
+  logger.info("CLIENT: Trace acquired");
+  return trace;
+}
+
+nlohmann::json TcpClient::getMetrics() {
+  auto &logger = utils::Logger::getInstance();
+  logger.info("CLIENT: Fetching the metrics of the server");
+
+  std::vector<char> dataBuffer =
+      sendCommandWithResponse(TcpServerCommand::GET_METRICS);
+
+  nlohmann::json metrics;
+  try {
+    metrics = nlohmann::json::parse(dataBuffer);
+  } catch (...) {
+    logger.fatal("CLIENT: Failed to parse the metrics");
+    return nlohmann::json();
+  }
+
+  logger.info("CLIENT: Metrics acquired");
+  return metrics;
+}
+
+bool TcpClient::useSharedMemory() {
+  auto &logger = utils::Logger::getInstance();
+  if (m_SharedMemory) {
+    return true;
+  }
+  if (!m_IsConnected || !SharedMemoryRing::isSupported()) {
+    return false;
+  }
+
+  // Open the shared memory before asking for it, so the server only stops
+  // sending the live data through the sockets once they can be read
+  std::unique_ptr<SharedMemoryRing> sharedMemory;
+  try {
+    sharedMemory =
+        std::make_unique<SharedMemoryRing>(sharedMemoryName(m_CommandPort));
+  } catch (...) {
+    logger.warning("CLIENT: The shared memory of the server is not available");
+    return false;
+  }
+  uint64_t sequence = sharedMemory->getWriteSequence();
+
+  std::vector<char> dataBuffer =
+      sendCommandWithResponse(TcpServerCommand::USE_SHARED_MEMORY);
+  nlohmann::json response;
+  try {
+    response = nlohmann::json::parse(dataBuffer);
+  } catch (...) {
+    logger.fatal("CLIENT: Failed to parse the shared memory description");
+    return false;
+  }
+  if (!response.contains("token")) {
+    logger.warning("CLIENT: The server does not share its memory with this "
+                   "client");
+    return false;
+  }
+  if (response["token"].get<uint64_t>() != sharedMemory->getToken()) {
+    // The shared memory opened is not the one of the server
+    logger.fatal("CLIENT: The shared memory " + sharedMemory->getName() +
+                 " does not belong to the server");
+    return false;
+  }
+
+  m_SharedMemory = std::move(sharedMemory);
+  startUpdatingFromSharedMemory(sequence);
+  logger.info("CLIENT: Reading the live data from the shared memory");
+  return true;
+}
+
 bool TcpClient::addAnalyzer(const nlohmann::json &analyzer) {
   auto &logger = utils::Logger::getInstance();
 
@@ -487,6 +752,65 @@ bool TcpClient::removeAnalyzer(const std::string &analyzerName) {
   return true;
 }
 
+bool TcpClient::subscribe(const nlohmann::json &subscription) {
+  auto &logger = utils::Logger::getInstance();
+
+  auto response = sendCommandWithData(
+      TcpServerCommand::SUBSCRIBE,
+      subscription.is_null() ? nlohmann::json::object() : subscription);
+  if (response.getMessage() != TcpServerMessage::OK) {
+    logger.fatal("CLIENT: Failed to subscribe to the live data");
+    return false;
+  }
+
+  logger.info("CLIENT: Subscribed to the live data");
+  return true;
+}
+
+bool TcpClient::resumeLiveData() {
+  auto &logger = utils::Logger::getInstance();
+
+  nlohmann::json fromSequences = nlohmann::json::object();
+  {
+    std::lock_guard lock(m_LiveSequencesMutex);
+    for (const auto &[name, sequence] : m_LiveSequences) {
+      fromSequences[name] = sequence;
+    }
+  }
+
+  std::vector<char> dataBuffer;
+  auto response = sendCommandWithData(TcpServerCommand::RESUME_LIVE_DATA,
+                                      fromSequences, &dataBuffer);
+  if (response.getMessage() != TcpServerMessage::OK) {
+    logger.fatal("CLIENT: Failed to resume the live data");
+    return false;
+  }
+
+  LiveReception<std::map<std::string, data::TimeSeries>> reception;
+  reception.sentAt = response.getTimestamp();
+  reception.receivedAt = std::chrono::system_clock::now();
+  reception.byteCount = dataBuffer.size();
+  try {
+    auto json = nlohmann::json::parse(dataBuffer);
+    for (const auto &[key, device] : json.items()) {
+      std::string name = device.at("name");
+      if (device.at("first_sequence") > fromSequences.at(name)) {
+        logger.warning("CLIENT: Some live data of " + name +
+                       " are no longer available");
+      }
+    }
+    updateLiveSequences(json);
+    reception.content = devices::Devices::deserializeData(json);
+  } catch (...) {
+    logger.fatal("CLIENT: Failed to parse the missed live data");
+    return false;
+  }
+
+  logger.info("CLIENT: Live data resumed");
+  onNewLiveData.notifyListeners(reception);
+  return true;
+}
+
 void TcpClient::startUpdatingLiveData() {
   m_LiveDataWorker = std::thread([this]() {
     while (m_IsConnected) {
@@ -499,22 +823,54 @@ void TcpClient::updateLiveData() {
   auto &logger = utils::Logger::getInstance();
 
   auto mutex = std::shared_mutex();
-  auto response = ServerResponse(*m_LiveDataSocket, mutex);
+  auto response = readResponse(TcpServerChannel::LIVE_DATA, mutex);
   if (!response.getHasReceivedData()) {
     // If no data received, just return
     return;
   }
 
-  std::map<std::string, data::TimeSeries> data;
+  LiveReception<std::map<std::string, data::TimeSeries>> reception;
+  reception.sentAt = response.getTimestamp();
+  reception.receivedAt = std::chrono::system_clock::now();
+  reception.byteCount = response.getData().size();
   try {
-    data = devices::Devices::deserializeData(
-        nlohmann::json::parse(response.getData()));
+    if (response.getDataType() == TcpServerDataType::LIVE_DATA_COMPRESSED) {
+      std::map<std::string, size_t> sequences;
+      reception.content =
+          devices::Devices::decompressLiveData(response.getData(), sequences);
+      updateLiveSequences(sequences);
+    } else {
+      auto json = nlohmann::json::parse(response.getData());
+      updateLiveSequences(json);
+      reception.content = devices::Devices::deserializeData(json);
+    }
   } catch (...) {
     logger.fatal("CLIENT: Failed to parse the live trial data");
     return;
   }
 
   logger.debug("CLIENT: Live data received");
+  onNewLiveData.notifyListeners(reception);
+}
+
+void TcpClient::updateLiveSequences(const nlohmann::json &liveData) {
+  std::lock_guard lock(m_LiveSequencesMutex);
+  for (const auto &[key, device] : liveData.items()) {
+    if (!device.contains("sequence")) {
+      // The derived data are not numbered
+      continue;
+    }
+    m_LiveSequences[device.at("name").get<std::string>()] =
+        device.at("sequence").get<size_t>();
+  }
+}
+
+void TcpClient::updateLiveSequences(
+    const std::map<std::string, size_t> &sequences) {
+  std::lock_guard lock(m_LiveSequencesMutex);
+  for (const auto &[name, sequence] : sequences) {
+    m_LiveSequences[name] = sequence;
+  }
 }
 
 void TcpClient::startUpdatingLiveAnalyses() {
@@ -528,48 +884,199 @@ void TcpClient::startUpdatingLiveAnalyses() {
 void TcpClient::updateLiveAnalyses() {
   auto &logger = utils::Logger::getInstance();
 
+  LiveReception<analyzer::Predictions> reception;
+  LiveReception<LivePredictions> predictionsReception;
+  bool isBinary = false;
   try {
     auto mutex = std::shared_mutex();
-    auto response = ServerResponse(*m_LiveAnalysesSocket, mutex);
+    auto response = readResponse(TcpServerChannel::LIVE_ANALYSES, mutex);
     if (!response.getHasReceivedData()) {
       // If no data received, just return
       return;
     }
-    auto serialized = nlohmann::json::parse(response.getData());
+    reception.sentAt = response.getTimestamp();
+    reception.receivedAt = std::chrono::system_clock::now();
+    reception.byteCount = response.getData().size();
+    isBinary = response.getDataType() == TcpServerDataType::LIVE_PREDICTIONS;
+    if (isBinary) {
+      predictionsReception.sentAt = reception.sentAt;
+      predictionsReception.receivedAt = reception.receivedAt;
+      predictionsReception.byteCount = reception.byteCount;
+      predictionsReception.content =
+          PredictionHistory::deserialize(response.getData());
+      if (predictionsReception.content.isTruncated) {
+        logger.warning("CLIENT: Some live predictions were dropped by the "
+                       "server before being sent");
+      }
 
-    auto data = analyzer::Predictions(serialized);
+      // The predictions are in the order they were made, so the last one of
+      // each analyzer is kept
+      reception.content.setStartingTime(
+          predictionsReception.content.startingTime);
+      for (const auto &prediction : predictionsReception.content.predictions) {
+        reception.content.set(prediction.analyzer, prediction.prediction);
+      }
+    } else {
+      reception.content =
+          analyzer::Predictions(nlohmann::json::parse(response.getData()));
+    }
   } catch (...) {
     logger.fatal("CLIENT: Failed to parse the last analyses");
     return;
   }
 
   logger.debug("CLIENT: Live analyze received");
+  if (isBinary) {
+    onNewLivePredictions.notifyListeners(predictionsReception);
+  }
+  onNewLiveAnalyses.notifyListeners(reception);
 }
 
-ServerResponse TcpClient::sendCommand(TcpServerCommand command) {
+void TcpClient::startUpdatingFromSharedMemory(uint64_t sequence) {
+  m_SharedMemoryWorker = std::thread([this, sequence]() mutable {
+    while (m_IsConnected) {
+      if (!updateFromSharedMemory(sequence)) {
+        // Nothing new was published, the server publishes at most every few
+        // milliseconds
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  });
+}
+
+bool TcpClient::updateFromSharedMemory(uint64_t &sequence) {
+  auto &logger = utils::Logger::getInstance();
+  SharedMemoryView message;
+  if (!m_SharedMemory->view(sequence, message)) {
+    return false;
+  }
+
+  // The message is parsed in place, and only used if the server did not
+  // overwrite it while it was parsed
+  auto receivedAt = std::chrono::system_clock::now();
+  nlohmann::json json;
+  try {
+    json = nlohmann::json::parse(message.data.begin(), message.data.end());
+  } catch (...) {
+    if (m_SharedMemory->isValid(message)) {
+      logger.fatal("CLIENT: Failed to parse the shared memory message");
+    }
+    return true;
+  }
+  if (!m_SharedMemory->isValid(message)) {
+    logger.debug("CLIENT: Shared memory message overwritten while parsed");
+    return true;
+  }
+
+  try {
+    switch (static_cast<TcpServerDataType>(message.dataType)) {
+    case TcpServerDataType::LIVE_DATA: {
+      LiveReception<std::map<std::string, data::TimeSeries>> reception;
+      reception.sentAt = message.publishedAt;
+      reception.receivedAt = receivedAt;
+      reception.byteCount = message.data.size();
+      updateLiveSequences(json);
+      reception.content = devices::Devices::deserializeData(json);
+      onNewLiveData.notifyListeners(reception);
+    } break;
+
+    case TcpServerDataType::LIVE_ANALYSES: {
+      LiveReception<analyzer::Predictions> reception;
+      reception.sentAt = message.publishedAt;
+      reception.receivedAt = receivedAt;
+      reception.byteCount = message.data.size();
+      reception.content = analyzer::Predictions(json);
+      onNewLiveAnalyses.notifyListeners(reception);
+    } break;
+
+    default:
+      break;
+    }
+  } catch (...) {
+    logger.fatal("CLIENT: Failed to parse the shared memory message");
+  }
+  return true;
+}
+
+bool TcpClient::writeCommand(TcpServerCommand command, uint32_t &requestId) {
   auto &logger = utils::Logger::getInstance();
 
   if (!m_IsConnected) {
     logger.fatal("CLIENT: Client is not connected");
-    return ServerResponse();
+    return false;
   }
 
   asio::error_code error;
-  size_t byteWritten = asio::write(
-      *m_CommandSocket, asio::buffer(constructCommandPacket(command)), error);
+  size_t byteWritten;
+  size_t packetSize;
+  if (m_IsPipelined) {
+    requestId = m_NextRequestId++;
+    auto packet = constructCommandPacket(command, requestId);
+    packetSize = packet.size();
+    byteWritten = write(TcpServerChannel::COMMAND, asio::buffer(packet), error);
+  } else {
+    auto packet = constructCommandPacket(command);
+    packetSize = packet.size();
+    byteWritten = write(TcpServerChannel::COMMAND, asio::buffer(packet), error);
+  }
 
-  if (byteWritten != BYTES_IN_CLIENT_PACKET_HEADER || error) {
+  if (byteWritten != packetSize || error) {
     logger.fatal("CLIENT: TCP write error: " + error.message());
     disconnect();
-    return ServerResponse();
+    return false;
+  }
+  return true;
+}
+
+ServerResponse TcpClient::readCommandResponse(uint32_t requestId) {
+  if (m_IsPipelined) {
+    return waitForResponse(TcpServerChannel::COMMAND, requestId);
   }
 
   ServerResponse response;
   do {
     auto mutex = std::shared_mutex();
-    response = ServerResponse(*m_CommandSocket, mutex);
+    response = readResponse(TcpServerChannel::COMMAND, mutex);
   } while (m_IsConnected && !response.getHasReceivedData());
+  return response;
+}
+
+ServerResponse TcpClient::waitForResponse(TcpServerChannel channel,
+                                          uint32_t requestId) {
+  auto key = std::make_pair(channel, requestId);
+  std::unique_lock lock(m_PipelinedResponsesMutex);
+  m_PipelinedResponsesCondition.wait(lock, [this, &key]() {
+    return !m_IsConnected || m_PipelinedResponses.count(key) > 0;
+  });
+
+  auto it = m_PipelinedResponses.find(key);
+  if (it == m_PipelinedResponses.end()) {
+    return ServerResponse();
+  }
+  auto response = std::move(it->second);
+  m_PipelinedResponses.erase(it);
+  return response;
+}
 
+void TcpClient::dispatchResponse(TcpServerChannel channel,
+                                 const ServerResponse &response) {
+  {
+    std::lock_guard lock(m_PipelinedResponsesMutex);
+    m_PipelinedResponses[std::make_pair(channel, response.getRequestId())] =
+        response;
+  }
+  m_PipelinedResponsesCondition.notify_all();
+}
+
+ServerResponse TcpClient::sendCommand(TcpServerCommand command) {
+  auto &logger = utils::Logger::getInstance();
+
+  uint32_t requestId = 0;
+  if (!writeCommand(command, requestId)) {
+    return ServerResponse();
+  }
+
+  auto response = readCommandResponse(requestId);
   if (response.getMessage() == TcpServerMessage::NOK) {
     logger.warning("CLIENT: Failed to get confirmation for command: " +
                    std::to_string(static_cast<uint32_t>(command)));
@@ -578,22 +1085,29 @@ ServerResponse TcpClient::sendCommand(TcpServerCommand command) {
 }
 
 ServerResponse TcpClient::sendCommandWithData(TcpServerCommand command,
-                                              const nlohmann::json &data) {
+                                              const nlohmann::json &data,
+                                              std::vector<char> *responseData) {
   auto &logger = utils::Logger::getInstance();
 
   // First send the command as usual
-  auto response = sendCommand(command);
+  uint32_t requestId = 0;
+  if (!writeCommand(command, requestId)) {
+    return ServerResponse();
+  }
+  auto response = readCommandResponse(requestId);
   if (response.getMessage() == TcpServerMessage::NOK) {
+    logger.warning("CLIENT: Failed to get confirmation for command: " +
+                   std::to_string(static_cast<uint32_t>(command)));
     return response;
   }
 
   // If the command was successful, send the length of the data
   asio::error_code error;
   size_t byteWritten =
-      asio::write(*m_MessageSocket,
-                  asio::buffer(constructCommandPacket(
-                      static_cast<TcpServerCommand>(data.dump().size()))),
-                  error);
+      write(TcpServerChannel::MESSAGE,
+            asio::buffer(constructCommandPacket(
+                static_cast<TcpServerCommand>(data.dump().size()))),
+            error);
 
   if (byteWritten != BYTES_IN_CLIENT_PACKET_HEADER || error) {
     logger.fatal("CLIENT: TCP write error: " + error.message());
@@ -603,70 +1117,137 @@ ServerResponse TcpClient::sendCommandWithData(TcpServerCommand command,
 
   // Send the data
   m_HasPreviousMessage = false;
-  byteWritten = asio::write(*m_MessageSocket, asio::buffer(data.dump()), error);
+  byteWritten =
+      write(TcpServerChannel::MESSAGE, asio::buffer(data.dump()), error);
   if (byteWritten != data.dump().size() || error) {
     logger.fatal("CLIENT: TCP write error: " + error.message());
     disconnect();
     return ServerResponse();
   }
 
-  // Wait for the acknowledgment from the server
-  while (true) {
+  // Wait for the acknowledgment from the server, which holds its response if
+  // any (the other pipelined requests are only answered on the command socket)
+  if (m_IsPipelined && responseData) {
+    *responseData =
+        waitForResponse(TcpServerChannel::MESSAGE, requestId).getData();
+  }
+  bool hasAcknowledgment = m_IsPipelined;
+  while (!hasAcknowledgment) {
     m_Context.run_one();
     std::shared_lock lock(m_PreviousMessageMutex);
     if (m_HasPreviousMessage) {
       m_HasPreviousMessage = false;
-      if (m_PreviousMessage.getCommand() == command) {
-        return m_PreviousMessage;
+      hasAcknowledgment = m_PreviousMessage.getCommand() == command;
+      if (hasAcknowledgment && responseData) {
+        *responseData = m_PreviousMessage.getData();
       }
     }
   }
+
+  // The server then tells on the command socket if it could handle the data.
+  // It must be read, otherwise the next command would take it as its response
+  return readCommandResponse(requestId);
 }
 
 std::vector<char> TcpClient::sendCommandWithResponse(TcpServerCommand command) {
-  auto &logger = utils::Logger::getInstance();
-
-  if (!m_IsConnected) {
-    logger.fatal("CLIENT: Client is not connected");
-    return std::vector<char>();
-  }
-
   m_HasPreviousMessage = false;
-  asio::error_code error;
-  size_t byteWritten = asio::write(
-      *m_CommandSocket, asio::buffer(constructCommandPacket(command)), error);
-
-  if (byteWritten != BYTES_IN_CLIENT_PACKET_HEADER || error) {
-    logger.fatal("CLIENT: TCP write error: " + error.message());
-    disconnect();
+  uint32_t requestId = 0;
+  if (!writeCommand(command, requestId)) {
     return std::vector<char>();
   }
 
   // Wait for the response from the server
-  while (true) {
-    m_Context.run_one();
-    std::shared_lock lock(m_PreviousMessageMutex);
-    if (m_HasPreviousMessage) {
-      m_HasPreviousMessage = false;
-      if (m_PreviousMessage.getCommand() == command) {
-        return m_PreviousMessage.getData();
+  std::vector<char> data;
+  if (m_IsPipelined) {
+    data = waitForResponse(TcpServerChannel::MESSAGE, requestId).getData();
+  } else {
+    bool hasResponse = false;
+    while (!hasResponse) {
+      m_Context.run_one();
+      std::shared_lock lock(m_PreviousMessageMutex);
+      if (m_HasPreviousMessage) {
+        m_HasPreviousMessage = false;
+        hasResponse = m_PreviousMessage.getCommand() == command;
+        if (hasResponse) {
+          data = m_PreviousMessage.getData();
+        }
       }
     }
   }
+
+  // The command is then confirmed on the command socket, which must be read
+  // so the next command does not take it as its response
+  readCommandResponse(requestId);
+  return data;
+}
+
+void TcpClient::shutdownSockets() {
+  // A mere close does not interrupt a read of another thread
+  for (auto *socket : {m_CommandSocket.get(), m_MessageSocket.get(),
+                       m_LiveDataSocket.get(), m_LiveAnalysesSocket.get()}) {
+    if (socket && socket->is_open()) {
+      asio::error_code error;
+      socket->shutdown(tcp::socket::shutdown_both, error);
+    }
+  }
+  if (m_MultiplexedSocket) {
+    m_MultiplexedSocket->shutdown();
+  }
 }
 
 void TcpClient::closeSockets() {
-  if (m_CommandSocket && m_CommandSocket->is_open()) {
-    m_CommandSocket->close();
+  for (auto *socket : {m_CommandSocket.get(), m_MessageSocket.get(),
+                       m_LiveDataSocket.get(), m_LiveAnalysesSocket.get()}) {
+    if (socket && socket->is_open()) {
+      asio::error_code error;
+      socket->shutdown(tcp::socket::shutdown_both, error);
+      socket->close(error);
+    }
+  }
+  if (m_MultiplexedSocket) {
+    m_MultiplexedSocket->close();
   }
-  if (m_MessageSocket && m_MessageSocket->is_open()) {
-    m_MessageSocket->close();
+}
+
+size_t TcpClient::write(TcpServerChannel channel, asio::const_buffer buffer,
+                        asio::error_code &error) {
+  std::lock_guard lock(m_WriteMutex);
+  if (m_MultiplexedSocket) {
+    return m_MultiplexedSocket->write(channel, buffer, error);
+  }
+
+  switch (channel) {
+  case TcpServerChannel::COMMAND:
+    return asio::write(*m_CommandSocket, buffer, error);
+  case TcpServerChannel::MESSAGE:
+    return asio::write(*m_MessageSocket, buffer, error);
+  default:
+    // The client never writes to the live channels
+    error = asio::error::operation_not_supported;
+    return 0;
   }
-  if (m_LiveDataSocket && m_LiveDataSocket->is_open()) {
-    m_LiveDataSocket->close();
+}
+
+ServerResponse TcpClient::readResponse(TcpServerChannel channel,
+                                       std::shared_mutex &mutex) {
+  if (m_MultiplexedSocket) {
+    return ServerResponse(
+        [this, channel](asio::mutable_buffer buffer, asio::error_code &error) {
+          return m_MultiplexedSocket->read(channel, buffer, error);
+        },
+        mutex);
   }
-  if (m_LiveAnalysesSocket && m_LiveAnalysesSocket->is_open()) {
-    m_LiveAnalysesSocket->close();
+
+  switch (channel) {
+  case TcpServerChannel::COMMAND:
+    return ServerResponse(*m_CommandSocket, mutex);
+  case TcpServerChannel::MESSAGE:
+    return ServerResponse(*m_MessageSocket, mutex);
+  case TcpServerChannel::LIVE_DATA:
+    return ServerResponse(*m_LiveDataSocket, mutex);
+  case TcpServerChannel::LIVE_ANALYSES:
+  default:
+    return ServerResponse(*m_LiveAnalysesSocket, mutex);
   }
 }
 
@@ -690,3 +1271,32 @@ TcpClient::constructCommandPacket(TcpServerCommand command) {
 
   return packet;
 }
+
+std::array<char, BYTES_IN_CLIENT_PACKET_HEADER + BYTES_IN_REQUEST_ID>
+TcpClient::constructCommandPacket(TcpServerCommand command,
+                                  uint32_t requestId) {
+  // Packets are exactly 12 bytes long, little-endian
+  // - First 4 bytes are the version number
+  // - Next 4 bytes are the command
+  // - Next 4 bytes are the id of the request
+
+  auto packet =
+      std::array<char, BYTES_IN_CLIENT_PACKET_HEADER + BYTES_IN_REQUEST_ID>();
+  packet.fill('\0');
+
+  // Add the version number
+  uint32_t versionLittleEndian = htole32(PIPELINED_PROTOCOL_VERSION);
+  std::memcpy(packet.data(), &versionLittleEndian, sizeof(versionLittleEndian));
+
+  // Add the command
+  uint32_t commandLittleEndian = htole32(static_cast<uint32_t>(command));
+  std::memcpy(packet.data() + sizeof(versionLittleEndian), &commandLittleEndian,
+              sizeof(commandLittleEndian));
+
+  // Add the id of the request
+  uint32_t requestIdLittleEndian = htole32(requestId);
+  std::memcpy(packet.data() + BYTES_IN_CLIENT_PACKET_HEADER,
+              &requestIdLittleEndian, sizeof(requestIdLittleEndian));
+
+  return packet;
+}
@@ -1,7 +1,10 @@
 #include "Server/TcpServer.h"
 
+#include "Utils/Endian.h"
 #include "Utils/Logger.h"
+#include "Utils/Tracer.h"
 #include <asio/steady_timer.hpp>
+#include <optional>
 #include <thread>
 
 #include "Analyzer/Analyzer.h"
@@ -10,43 +13,32 @@
 #include "Devices/Concrete/DelsysAnalogDevice.h"
 #include "Devices/Concrete/DelsysEmgDevice.h"
 #include "Devices/Concrete/MagstimRapidDevice.h"
+#include "Devices/Concrete/ReplayDataCollector.h"
 #include "Devices/Generic/DelsysBaseDevice.h"
 #include "Devices/Generic/Device.h"
 
-#if defined(_WIN32) // Windows-specific byte swap functions
-// Windows is little-endian by default
-#define htole32(x) (x)
-#define htole64(x) (x)
-#define le32toh(x) (x)
-
-#elif defined(__APPLE__) // macOS
-#include <libkern/OSByteOrder.h>
-#define htole32(x) OSSwapHostToLittleInt32(x)
-#define le32toh(x) OSSwapLittleToHostInt32(x)
-#define htole64(x) OSSwapHostToLittleInt64(x)
-
-#elif defined(__linux__) // Linux
-#include <endian.h>      // Provides htole32(), htole64() and le32toh()
-
-#else
-#error "Unsupported platform"
-#endif
-
 using namespace NEUROBIO_NAMESPACE::server;
 
+uint32_t parseVersionFromCommandPacket(
+    const std::array<char, BYTES_IN_CLIENT_PACKET_HEADER> &buffer) {
+  uint32_t version;
+  // Safely copy memory and convert from little-endian
+  std::memcpy(&version, buffer.data(), sizeof(version));
+  return le32toh(version); // Convert to native endianness
+}
+
 TcpServerCommand parseCommandPacket(
     const std::array<char, BYTES_IN_CLIENT_PACKET_HEADER> &buffer) {
   // Packets are exactly 8 bytes long, litte endian
   // - First 4 bytes are the version number
   // - Next 4 bytes are the command
+  // If the version is PIPELINED_PROTOCOL_VERSION, the packet is followed by 4
+  // bytes of the id of the request
 
   // Check the version
-  uint32_t version;
-  // Safely copy memory and convert from little-endian
-  std::memcpy(&version, buffer.data(), sizeof(version));
-  version = le32toh(version); // Convert to native endianness
-
-  if (version != COMMUNICATION_PROTOCOL_VERSION) {
+  uint32_t version = parseVersionFromCommandPacket(buffer);
+  if (version != COMMUNICATION_PROTOCOL_VERSION &&
+      version != PIPELINED_PROTOCOL_VERSION) {
     auto &logger = NEUROBIO_NAMESPACE::utils::Logger::getInstance();
     logger.fatal("Invalid version: " + std::to_string(version) +
                  ". Please "
@@ -63,10 +55,9 @@ TcpServerCommand parseCommandPacket(
   return static_cast<TcpServerCommand>(command);
 }
 
-template <typename T>
-std::vector<char>
-constructMessagePacket(TcpServerCommand command, TcpServerMessage message,
-                       TcpServerDataType dataType, uint64_t dataSize, T data) {
+size_t writeMessageHeader(char *header, const TcpServerRequest &request,
+                          TcpServerMessage message, TcpServerDataType dataType,
+                          uint64_t dataSize) {
   // Packets are exactly 24 bytes long, litte endian if dataType is NONE,
   // otherwise a mandatory 8 bytes is added alongside the actual data
   // - First 4 bytes are the version number
@@ -76,6 +67,8 @@ constructMessagePacket(TcpServerCommand command, TcpServerMessage message,
   // - Next 4 bytes are the data type (if any, otherwise 0xFFFFFFFF) that is
   // being sent to the client
   // - The Next 8 bytes are the timestamp of the message
+  // - Next 4 bytes are the id of the request it is responding to, only if the
+  // version is PIPELINED_PROTOCOL_VERSION (the request was pipelined)
   // - Next 8 bytes are skiped if dataType is NONE, otherwise they are the size
   // of the extra data that will be sent to the client. bytes of extra data that
   // will be sent to the client.
@@ -88,70 +81,100 @@ constructMessagePacket(TcpServerCommand command, TcpServerMessage message,
         "0");
   }
 
-  auto packet = dataType == TcpServerDataType::NONE
-                    ? std::vector<char>(BYTES_IN_SERVER_PACKET_HEADER, '\0')
-                    : std::vector<char>(
-                          BYTES_IN_SERVER_PACKET_HEADER + 8 + dataSize, '\0');
-
   // Add the version number in uint32_t format (litte endian)
-  uint32_t versionLittleEndian = htole32(COMMUNICATION_PROTOCOL_VERSION);
-  std::memcpy(packet.data(), &versionLittleEndian, sizeof(versionLittleEndian));
+  uint32_t versionLittleEndian =
+      htole32(request.isPipelined ? PIPELINED_PROTOCOL_VERSION
+                                  : COMMUNICATION_PROTOCOL_VERSION);
+  std::memcpy(header, &versionLittleEndian, sizeof(versionLittleEndian));
 
   // Add the command in uint32_t format (litte endian)
-  uint32_t commandLittleEndian = htole32(static_cast<uint32_t>(command));
-  std::memcpy(packet.data() + sizeof(versionLittleEndian), &commandLittleEndian,
-              sizeof(commandLittleEndian));
+  uint32_t commandLittleEndian =
+      htole32(static_cast<uint32_t>(request.command));
+  std::memcpy(header + 4, &commandLittleEndian, sizeof(commandLittleEndian));
 
   // Add the message in uint32_t format (litte endian)
   uint32_t messageLittleEndian = htole32(static_cast<uint32_t>(message));
-  std::memcpy(packet.data() + sizeof(versionLittleEndian) +
-                  sizeof(commandLittleEndian),
-              &messageLittleEndian, sizeof(messageLittleEndian));
+  std::memcpy(header + 8, &messageLittleEndian, sizeof(messageLittleEndian));
 
   // Add the data type in uint32_t format (litte endian)
   uint32_t dataTypeLittleEndian = htole32(static_cast<uint32_t>(dataType));
-  std::memcpy(packet.data() + sizeof(versionLittleEndian) +
-                  sizeof(commandLittleEndian) + sizeof(messageLittleEndian),
-              &dataTypeLittleEndian, sizeof(dataTypeLittleEndian));
+  std::memcpy(header + 12, &dataTypeLittleEndian,
+              sizeof(dataTypeLittleEndian));
 
   // Add the timestamps in uint64_t format (litte endian)
   uint64_t timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
                            std::chrono::system_clock::now().time_since_epoch())
                            .count();
   uint64_t timestampLittleEndian = htole64(timestamp);
-  std::memcpy(packet.data() + sizeof(versionLittleEndian) +
-                  sizeof(commandLittleEndian) + sizeof(messageLittleEndian) +
-                  sizeof(dataTypeLittleEndian),
-              &timestampLittleEndian, sizeof(timestampLittleEndian));
+  std::memcpy(header + 16, &timestampLittleEndian,
+              sizeof(timestampLittleEndian));
+
+  size_t headerSize = BYTES_IN_SERVER_PACKET_HEADER;
+  if (request.isPipelined) {
+    // Add the id of the request in uint32_t format (litte endian)
+    uint32_t idLittleEndian = htole32(request.id);
+    std::memcpy(header + headerSize, &idLittleEndian, sizeof(idLittleEndian));
+    headerSize += sizeof(idLittleEndian);
+  }
 
-  // Add the size of the extra data in uint64_t format (litte endian)
-  if (dataType != TcpServerDataType::NONE) {
-
-    uint64_t dataSizeLittleEndian = htole64(dataSize);
-    std::memcpy(packet.data() + sizeof(versionLittleEndian) +
-                    sizeof(commandLittleEndian) + sizeof(messageLittleEndian) +
-                    sizeof(dataTypeLittleEndian) +
-                    sizeof(timestampLittleEndian),
-                &dataSizeLittleEndian, sizeof(dataSizeLittleEndian));
-
-    // If there is extra data, add it to the packet
-    if (dataSize > 0) {
-      std::memcpy(
-          packet.data() + sizeof(versionLittleEndian) +
-              sizeof(commandLittleEndian) + sizeof(messageLittleEndian) +
-              sizeof(dataTypeLittleEndian) + sizeof(timestampLittleEndian) +
-              sizeof(dataSizeLittleEndian),
-          data.data(), dataSize);
-    }
+  if (dataType == TcpServerDataType::NONE) {
+    return headerSize;
   }
 
+  // Add the size of the extra data in uint64_t format (litte endian)
+  uint64_t dataSizeLittleEndian = htole64(dataSize);
+  std::memcpy(header + headerSize, &dataSizeLittleEndian,
+              sizeof(dataSizeLittleEndian));
+  return headerSize + sizeof(dataSizeLittleEndian);
+}
+
+std::vector<char> NEUROBIO_NAMESPACE::server::constructMessagePacket(
+    const TcpServerRequest &request, TcpServerMessage message) {
+  auto packet = std::vector<char>(
+      BYTES_IN_SERVER_PACKET_HEADER + BYTES_IN_REQUEST_ID, '\0');
+  packet.resize(writeMessageHeader(packet.data(), request, message,
+                                   TcpServerDataType::NONE, 0));
+  return packet;
+}
+
+std::vector<char> NEUROBIO_NAMESPACE::server::constructMessagePacket(
+    const TcpServerRequest &request, TcpServerMessage message,
+    TcpServerDataType dataType, const std::string &data) {
+  NEUROBIO_TRACE_SCOPE("constructMessagePacket");
+  auto packet = std::vector<char>(
+      BYTES_IN_SERVER_PACKET_HEADER + BYTES_IN_REQUEST_ID + 8 + data.size(),
+      '\0');
+  size_t headerSize = writeMessageHeader(packet.data(), request, message,
+                                         dataType, data.size());
+  packet.resize(headerSize + data.size());
+  std::memcpy(packet.data() + headerSize, data.data(), data.size());
   return packet;
 }
 
-std::vector<char> constructMessagePacket(TcpServerCommand command,
-                                         TcpServerMessage message) {
-  return constructMessagePacket(command, message, TcpServerDataType::NONE, 0,
-                                std::vector<char>());
+MessagePacket::MessagePacket(const TcpServerRequest &request,
+                             TcpServerMessage message)
+    : m_HeaderSize(writeMessageHeader(m_Header.data(), request, message,
+                                      TcpServerDataType::NONE, 0)) {}
+
+MessagePacket::MessagePacket(const TcpServerRequest &request,
+                             TcpServerMessage message,
+                             TcpServerDataType dataType,
+                             std::shared_ptr<const std::string> data)
+    : m_HeaderSize(writeMessageHeader(m_Header.data(), request, message,
+                                      dataType, data ? data->size() : 0)),
+      m_Data(std::move(data)) {}
+
+std::array<asio::const_buffer, 2> MessagePacket::buffers() const {
+  return {asio::buffer(m_Header.data(), m_HeaderSize),
+          m_Data ? asio::buffer(*m_Data) : asio::const_buffer()};
+}
+
+size_t MessagePacket::size() const {
+  return m_HeaderSize + (m_Data ? m_Data->size() : 0);
+}
+
+std::string NEUROBIO_NAMESPACE::server::sharedMemoryName(int commandPort) {
+  return "/neurobio_" + std::to_string(commandPort);
 }
 
 // Here are the names of the devices that can be connected (for internal use)
@@ -159,20 +182,42 @@ const std::string DEVICE_NAME_DELSYS_EMG = "DelsysEmgDevice";
 const std::string DEVICE_NAME_DELSYS_ANALOG = "DelsysAnalogDevice";
 const std::string DEVICE_NAME_MAGSTIM = "MagstimRapidDevice";
 
+// The most bytes of a channel kept for the server to read, on a multiplexed
+// connexion
+static const size_t MAX_PENDING_BYTES_FROM_CLIENT = 1024 * 1024;
+
 ClientSession::ClientSession(
     std::shared_ptr<asio::io_context> context, uint32_t id,
-    std::function<bool(TcpServerCommand command, const ClientSession &client)>
+    std::function<bool(const TcpServerRequest &request,
+                       const ClientSession &client)>
         handleHandshake,
-    std::function<bool(TcpServerCommand command, const ClientSession &client)>
+    std::function<bool(const TcpServerRequest &request,
+                       const ClientSession &client)>
         handleCommand,
     std::function<void(const ClientSession &client)> onDisconnect,
-    std::chrono::milliseconds timeoutPeriod)
-    : m_TimeoutPeriod(timeoutPeriod), m_Context(context), m_Id(id),
-      m_IsHandshakeDone(false), m_HasDisconnected(false),
-      m_HandleHandshake(handleHandshake), m_HandleCommand(handleCommand),
-      m_OnDisconnect(onDisconnect) {}
+    std::chrono::milliseconds timeoutPeriod,
+    const LiveStreamRate &liveDataRate, const LiveStreamRate &liveAnalysesRate)
+    : m_TimeoutPeriod(timeoutPeriod), m_Context(context),
+      m_Strand(asio::make_strand(*context)), m_Id(id),
+      m_IsHandshakeDone(false), m_IsPipelined(false), m_HasDisconnected(false),
+      m_IsUsingSharedMemory(false),
+      m_LiveSubscription(std::make_shared<const LiveSubscription>()),
+      m_LiveRates({{TcpServerChannel::LIVE_DATA, liveDataRate},
+                   {TcpServerChannel::LIVE_ANALYSES, liveAnalysesRate}}),
+      m_LastPredictionSequence(0), m_HandleHandshake(handleHandshake),
+      m_HandleCommand(handleCommand), m_OnDisconnect(onDisconnect) {
+  auto &metrics = utils::Metrics::getInstance();
+  std::string prefix = "TcpServer.sessions." + std::to_string(m_Id) + ".";
+  m_SendDurationMetric = metrics.histogram(prefix + "sendDuration");
+  m_SentBytesMetric = metrics.counter(prefix + "sentBytes");
+  m_QueuedBytesMetric = metrics.gauge(prefix + "queuedBytes");
+}
 
-ClientSession::~ClientSession() { disconnect(); }
+ClientSession::~ClientSession() {
+  disconnect();
+  utils::Metrics::getInstance().remove("TcpServer.sessions." +
+                                       std::to_string(m_Id) + ".");
+}
 
 void ClientSession::connectCommandSocket(
     std::shared_ptr<asio::ip::tcp::socket> socket) {
@@ -206,54 +251,235 @@ void ClientSession::connectLiveAnalysesSocket(
   tryStartSessionLoop();
 }
 
+void ClientSession::connectMultiplexedSocket(
+    std::shared_ptr<asio::ip::tcp::socket> socket) {
+  if (m_HasDisconnected)
+    return;
+  // The server only reads the commands and their extra data, which are small.
+  // A client sending anything else (or flooding them) is disconnected
+  m_MultiplexedSocket = std::make_shared<MultiplexedSocket>(
+      socket,
+      std::vector<TcpServerChannel>{TcpServerChannel::COMMAND,
+                                    TcpServerChannel::MESSAGE},
+      MAX_PENDING_BYTES_FROM_CLIENT);
+  tryStartSessionLoop();
+}
+
 bool ClientSession::isConnected() const {
-  return !m_HasDisconnected && m_CommandSocket && m_CommandSocket->is_open() &&
-         m_MessageSocket && m_MessageSocket->is_open() && m_LiveDataSocket &&
+  if (m_HasDisconnected) {
+    return false;
+  }
+  if (m_MultiplexedSocket) {
+    return m_MultiplexedSocket->isOpen();
+  }
+  return m_CommandSocket && m_CommandSocket->is_open() && m_MessageSocket &&
+         m_MessageSocket->is_open() && m_LiveDataSocket &&
          m_LiveDataSocket->is_open() && m_LiveAnalysesSocket &&
          m_LiveAnalysesSocket->is_open();
 }
 
 void ClientSession::disconnect() {
-  if (m_HasDisconnected) {
+  if (m_HasDisconnected.exchange(true)) {
     return; // Already disconnected
   }
-  m_HasDisconnected = true;
 
-  auto closeSocket = [](std::shared_ptr<asio::ip::tcp::socket> &s) {
-    if (s && s->is_open()) {
-      asio::error_code ec;
-      s->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
-      s->close(ec);
+  m_IsHandshakeDone = false;
+  m_IsPipelined = false;
+
+  // The live loops may be writing to the sockets from other threads. The
+  // sockets are shut down first, so these writes fail, and only closed once
+  // nothing is written to them anymore, as a descriptor closed under a
+  // writer could already be reused by another socket
+  shutdown();
+  {
+    std::array<std::unique_lock<std::mutex>, TCP_SERVER_CHANNEL_COUNT> locks;
+    for (size_t i = 0; i < TCP_SERVER_CHANNEL_COUNT; i++) {
+      locks[i] = std::unique_lock(m_WriteMutexes[i]);
     }
-  };
 
-  m_IsHandshakeDone = false;
-  closeSocket(m_CommandSocket);
-  closeSocket(m_MessageSocket);
-  closeSocket(m_LiveDataSocket);
-  closeSocket(m_LiveAnalysesSocket);
+    asio::error_code error;
+    for (auto *socket : {m_CommandSocket.get(), m_MessageSocket.get(),
+                         m_LiveDataSocket.get(), m_LiveAnalysesSocket.get()}) {
+      if (socket && socket->is_open()) {
+        socket->close(error);
+      }
+    }
+    if (m_MultiplexedSocket) {
+      m_MultiplexedSocket->close();
+    }
+  }
 
   utils::Logger::getInstance().info("Session " + std::to_string(m_Id) +
                                     " disconnected and cleaned up.");
   m_OnDisconnect(*this);
 }
 
+void ClientSession::shutdown() const {
+  asio::error_code error;
+  for (auto *socket : {m_CommandSocket.get(), m_MessageSocket.get(),
+                       m_LiveDataSocket.get(), m_LiveAnalysesSocket.get()}) {
+    if (socket && socket->is_open()) {
+      socket->shutdown(asio::ip::tcp::socket::shutdown_both, error);
+    }
+  }
+  if (m_MultiplexedSocket) {
+    m_MultiplexedSocket->shutdown();
+  }
+}
+
+const std::shared_ptr<asio::ip::tcp::socket> &
+ClientSession::socket(TcpServerChannel channel) const {
+  switch (channel) {
+  case TcpServerChannel::COMMAND:
+    return m_CommandSocket;
+  case TcpServerChannel::MESSAGE:
+    return m_MessageSocket;
+  case TcpServerChannel::LIVE_DATA:
+    return m_LiveDataSocket;
+  case TcpServerChannel::LIVE_ANALYSES:
+  default:
+    return m_LiveAnalysesSocket;
+  }
+}
+
+size_t ClientSession::write(TcpServerChannel channel,
+                            const MessagePacket &packet,
+                            asio::error_code &error) const {
+  auto writePacket = [this, channel, &packet, &error]() -> size_t {
+    std::lock_guard lock(m_WriteMutexes[static_cast<size_t>(channel)]);
+    if (m_MultiplexedSocket) {
+      return m_MultiplexedSocket->write(channel, packet.buffers(), error);
+    }
+    const auto &channelSocket = socket(channel);
+    if (!channelSocket) {
+      // The socket may not be connected yet (or anymore)
+      error = asio::error::not_connected;
+      return 0;
+    }
+    return asio::write(*channelSocket, packet.buffers(), error);
+  };
+
+  // Only the live data and analyses are monitored, as they are the bulk of
+  // what is sent
+  if (channel != TcpServerChannel::LIVE_DATA &&
+      channel != TcpServerChannel::LIVE_ANALYSES) {
+    return writePacket();
+  }
+
+  auto size = static_cast<int64_t>(packet.size());
+  size_t byteWritten;
+  m_QueuedBytesMetric->add(size);
+  {
+    utils::HistogramScope durationScope(*m_SendDurationMetric);
+    byteWritten = writePacket();
+  }
+  m_QueuedBytesMetric->add(-size);
+  if (!error) {
+    m_SentBytesMetric->add(packet.size());
+  }
+  return byteWritten;
+}
+
+size_t ClientSession::read(TcpServerChannel channel,
+                           asio::mutable_buffer buffer,
+                           asio::error_code &error) const {
+  if (m_MultiplexedSocket) {
+    return m_MultiplexedSocket->read(channel, buffer, error);
+  }
+  const auto &channelSocket = socket(channel);
+  if (!channelSocket) {
+    error = asio::error::not_connected;
+    return 0;
+  }
+  return asio::read(*channelSocket, buffer, error);
+}
+
+bool ClientSession::isLocal() const {
+  auto *commandSocket = m_MultiplexedSocket ? &m_MultiplexedSocket->getSocket()
+                                            : m_CommandSocket.get();
+  if (!commandSocket || !commandSocket->is_open()) {
+    return false;
+  }
+
+  asio::error_code error;
+  auto remoteAddress = commandSocket->remote_endpoint(error).address();
+  if (error) {
+    return false;
+  }
+  auto localAddress = commandSocket->local_endpoint(error).address();
+  return !error &&
+         (remoteAddress.is_loopback() || remoteAddress == localAddress);
+}
+
+std::shared_ptr<const LiveSubscription>
+ClientSession::getLiveSubscription() const {
+  std::lock_guard lock(m_LiveSubscriptionMutex);
+  return m_LiveSubscription;
+}
+
+void ClientSession::setLiveSubscription(
+    std::shared_ptr<const LiveSubscription> subscription) {
+  std::lock_guard lock(m_LiveSubscriptionMutex);
+  m_LiveSubscription = subscription;
+}
+
+bool ClientSession::isLiveDue(TcpServerChannel channel) {
+  // A client that does not keep up is sent fewer packets than the others,
+  // whatever the rate it subscribed to
+  auto &rate = m_LiveRates.at(channel);
+  std::chrono::steady_clock::duration interval =
+      std::chrono::steady_clock::duration::zero();
+  if (rate.getCurrentInterval() > rate.getInterval()) {
+    interval = rate.getCurrentInterval();
+  }
+  double maxRate = getLiveSubscription()->getMaxRate();
+  if (maxRate > 0) {
+    interval = std::max(
+        interval,
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / maxRate)));
+  }
+  if (interval == std::chrono::steady_clock::duration::zero()) {
+    return true;
+  }
+
+  // The live loops only run on their own thread, so the next times need no
+  // lock. A tenth of the interval of slack absorbs the jitter of the loops
+  auto now = std::chrono::steady_clock::now();
+  auto &next = m_NextLiveTimes[static_cast<size_t>(channel)];
+  if (now + interval / 10 < next) {
+    return false;
+  }
+  // The schedule starts over from now if the client was not sent anything for
+  // more than an interval (e.g. the first packet)
+  next = (now - next > interval ? now : next) + interval;
+  return true;
+}
+
+void ClientSession::updateLiveRate(
+    TcpServerChannel channel,
+    std::chrono::steady_clock::duration writeDuration) {
+  m_LiveRates.at(channel).update(writeDuration);
+}
+
 void ClientSession::startTimerForTimeout() {
-  m_ConnexionTimer = std::make_shared<asio::steady_timer>(*m_Context);
+  m_ConnexionTimer = std::make_shared<asio::steady_timer>(m_Strand);
   m_ConnexionTimer->expires_after(m_TimeoutPeriod);
-  m_ConnexionTimer->async_wait([this](const asio::error_code &ec) {
-    if (ec) {
-      // Timer was cancelled or failed (meaning the connexion was
-      // successful)
-      return;
-    }
-    // If we reach here, the timer expired, meaning the client did not
-    // connect all sockets in time, so we disconnect them
-    auto &logger = utils::Logger::getInstance();
-    logger.warning("Client session " + std::to_string(m_Id) +
-                   " did not connect all sockets in time, disconnecting.");
-    disconnect();
-  });
+  m_ConnexionTimer->async_wait(
+      [weakSelf = weak_from_this()](const asio::error_code &ec) {
+        auto self = weakSelf.lock();
+        if (ec || !self) {
+          // Timer was cancelled or failed (meaning the connexion was
+          // successful)
+          return;
+        }
+        // If we reach here, the timer expired, meaning the client did not
+        // connect all sockets in time, so we disconnect them
+        auto &logger = utils::Logger::getInstance();
+        logger.warning("Client session " + std::to_string(self->m_Id) +
+                       " did not connect all sockets in time, disconnecting.");
+        self->disconnect();
+      });
 }
 
 void ClientSession::tryStartSessionLoop() {
@@ -272,7 +498,11 @@ void ClientSession::tryStartSessionLoop() {
   logger.info("Starting client session with ID: " + std::to_string(m_Id));
 
   // Start reading from the sockets
-  commandSocketLoop();
+  if (m_MultiplexedSocket) {
+    multiplexedSocketLoop();
+  } else {
+    commandSocketLoop();
+  }
 }
 
 void ClientSession::commandSocketLoop() {
@@ -281,51 +511,144 @@ void ClientSession::commandSocketLoop() {
     return;
   }
 
+  // The session is kept alive while its command is handled, even if the
+  // client disconnects meanwhile
   auto buffer =
       std::make_shared<std::array<char, BYTES_IN_CLIENT_PACKET_HEADER>>();
-  m_CommandSocket->async_read_some(
-      asio::buffer(*buffer),
-      [this, buffer](const asio::error_code &ec, size_t byteRead) {
-        auto &logger = utils::Logger::getInstance();
+  asio::async_read(
+      *m_CommandSocket, asio::buffer(*buffer),
+      asio::bind_executor(m_Strand, [self = shared_from_this(), buffer](
+                                        const asio::error_code &ec, size_t) {
         if (ec) {
           // If anything went wrong, disconnect the client
-          disconnect();
+          self->disconnect();
           return;
         }
 
-        // Parse the packet
-        TcpServerCommand command = parseCommandPacket(*buffer);
-
-        // Handle the command based on the current status
-        if (!(m_IsHandshakeDone ? m_HandleCommand(command, *this)
-                                : m_HandleHandshake(command, *this))) {
+        if (!self->handleCommandPacket(*buffer)) {
           // If anything went wrong, disconnect the client
-          disconnect();
+          self->disconnect();
         }
-        m_IsHandshakeDone = true;
 
         // If we get here, the command was successful and we can continue
         // listening for the next command
-        commandSocketLoop();
+        self->commandSocketLoop();
+      }));
+}
+
+void ClientSession::multiplexedSocketLoop() {
+  if (m_HasDisconnected || !m_MultiplexedSocket ||
+      !m_MultiplexedSocket->isOpen()) {
+    // Terminate the loop if disconnected or socket is not open
+    return;
+  }
+
+  // The frames are read by the multiplexed socket, so the commands they hold
+  // are handed back to the strand of the session
+  m_MultiplexedSocket->asyncReadFrame(
+      [self = shared_from_this()](const asio::error_code &ec) {
+        asio::post(self->m_Strand, [self, ec]() {
+          if (ec) {
+            // If anything went wrong, disconnect the client
+            self->disconnect();
+            return;
+          }
+
+          // The frame may hold any number of commands (or only part of one),
+          // or bytes of another channel
+          auto buffer = std::array<char, BYTES_IN_CLIENT_PACKET_HEADER>();
+          while (self->m_MultiplexedSocket->tryRead(TcpServerChannel::COMMAND,
+                                                    asio::buffer(buffer))) {
+            if (!self->handleCommandPacket(buffer)) {
+              // If anything went wrong, disconnect the client
+              self->disconnect();
+              return;
+            }
+          }
+
+          self->multiplexedSocketLoop();
+        });
       });
 }
 
+bool ClientSession::handleCommandPacket(
+    const std::array<char, BYTES_IN_CLIENT_PACKET_HEADER> &buffer) {
+  TcpServerRequest request(parseCommandPacket(buffer));
+  if (parseVersionFromCommandPacket(buffer) == PIPELINED_PROTOCOL_VERSION) {
+    // The id is sent along the command, so it is already there
+    auto idBuffer = std::array<char, BYTES_IN_REQUEST_ID>();
+    asio::error_code error;
+    read(TcpServerChannel::COMMAND, asio::buffer(idBuffer), error);
+    if (error) {
+      return false;
+    }
+    uint32_t id;
+    std::memcpy(&id, idBuffer.data(), sizeof(id));
+    request = TcpServerRequest(request.command, le32toh(id));
+  }
+
+  // Handle the command based on the current status
+  if (!m_IsHandshakeDone) {
+    m_IsPipelined = request.isPipelined;
+  }
+  bool isHandled = m_IsHandshakeDone ? m_HandleCommand(request, *this)
+                                     : m_HandleHandshake(request, *this);
+  m_IsHandshakeDone = true;
+  return isHandled;
+}
+
 TcpServer::TcpServer(int commandPort, int messagePort, int liveDataPort,
                      int liveAnalysesPort)
     : m_CommandPort(commandPort), m_MessagePort(messagePort),
       m_LiveDataPort(liveDataPort), m_LiveAnalysesPort(liveAnalysesPort),
       m_TimeoutPeriod(std::chrono::milliseconds(5000)),
+      m_ThreadCount(std::max(std::thread::hardware_concurrency(), 2u)),
+      m_MultiplexedPort(0), m_IsSharedMemoryEnabled(false),
+      m_SharedMemorySlotCount(SharedMemoryRing::DefaultSlotCount),
+      m_SharedMemorySlotSize(SharedMemoryRing::DefaultSlotSize),
       m_Status(TcpServerStatus::OFF),
+      m_LiveDataRate(std::chrono::milliseconds(100),
+                     std::chrono::milliseconds(1000)),
+      m_LiveAnalysesRate(std::chrono::milliseconds(25),
+                         std::chrono::milliseconds(250)),
+      m_IsLiveDataLoopPaused(false), m_IsLiveAnalysesLoopPaused(false),
       m_Context(std::make_shared<asio::io_context>()),
-      m_LiveDataContext(std::make_shared<asio::io_context>()),
-      m_LiveAnalysesContext(std::make_shared<asio::io_context>()) {
-  m_LiveDataTimer = std::make_shared<asio::steady_timer>(
-      *m_LiveDataContext, std::chrono::milliseconds(100));
-  m_LiveAnalysesTimer = std::make_shared<asio::steady_timer>(
-      *m_LiveAnalysesContext, std::chrono::milliseconds(25));
+      m_LiveDataStrand(asio::make_strand(*m_Context)),
+      m_LiveAnalysesStrand(asio::make_strand(*m_Context)),
+      m_DevicesContext(std::make_shared<asio::io_context>()) {
+  auto &metrics = utils::Metrics::getInstance();
+  m_LiveDataSerializeDurationMetric =
+      metrics.histogram("TcpServer.liveData.serializeDuration");
+  m_LiveAnalysesSerializeDurationMetric =
+      metrics.histogram("TcpServer.liveAnalyses.serializeDuration");
+
+  m_States = serializeStates();
+  m_StatesVersion = 0;
+  m_AreStatesDirty = false;
+  m_DevicesConnectionListenerId = m_Devices.onDeviceConnectionChanged.listen(
+      [this](const size_t &) { m_AreStatesDirty = true; });
+
+  m_LiveDataTimer = std::make_shared<asio::steady_timer>(m_LiveDataStrand);
+  m_LiveAnalysesTimer =
+      std::make_shared<asio::steady_timer>(m_LiveAnalysesStrand);
 }
 
-TcpServer::~TcpServer() { stopServer(); }
+TcpServer::~TcpServer() {
+  stopServer();
+
+  // The acceptors and timers must be destroyed before the contexts they are
+  // bound to, which are declared after them
+  m_CommandAcceptor.reset();
+  m_MessageAcceptor.reset();
+  m_LiveDataAcceptor.reset();
+  m_LiveAnalysesAcceptor.reset();
+  m_MultiplexedAcceptor.reset();
+  m_LiveDataTimer.reset();
+  m_LiveAnalysesTimer.reset();
+
+  // The devices are disconnected after the server is gone
+  m_Devices.onDeviceConnectionChanged.clear(m_DevicesConnectionListenerId);
+}
 
 void TcpServer::startServer() {
   m_ServerWorker = std::thread([this]() { startServerSync(); });
@@ -340,26 +663,43 @@ void TcpServer::startServerSync() {
   auto &logger = utils::Logger::getInstance();
 
   m_Status = TcpServerStatus::PREPARING;
+  if (m_IsSharedMemoryEnabled) {
+    try {
+      m_SharedMemory = std::make_unique<SharedMemoryRing>(
+          sharedMemoryName(m_CommandPort), m_SharedMemorySlotCount,
+          m_SharedMemorySlotSize);
+    } catch (const std::exception &) {
+      // The clients will keep receiving the live data through the sockets
+      logger.warning("The shared memory is disabled");
+    }
+  }
   startAcceptors();
   startAcceptingSocketConnexions();
   m_Status = TcpServerStatus::READY;
 
-  liveDataLoop();
-  // Start the loop timers
-  std::thread liveDataWorkerThread([this]() {
-    m_LiveDataContext->run();
-    utils::Logger::getInstance().info("Live data has terminated");
-  });
-
-  liveAnalysesLoop();
-  std::thread liveAnalysesWorkerThread([this]() {
-    m_LiveAnalysesContext->run();
-    utils::Logger::getInstance().info("Live analyses has terminated");
-  });
-
+  // Start the loop timers, on their strands. The live loops pause while no
+  // client is connected, so the pool must run even when they are
+  auto workGuard = asio::make_work_guard(*m_Context);
+  asio::post(m_LiveDataStrand, [this]() { liveDataLoop(); });
+  asio::post(m_LiveAnalysesStrand, [this]() { liveAnalysesLoop(); });
+
+  // The commands on the devices wait their turn there, so it must run even
+  // when there are none
+  auto devicesWorkGuard = asio::make_work_guard(*m_DevicesContext);
+  std::thread devicesWorkerThread([this]() { m_DevicesContext->run(); });
+
+  // The acceptors, the sessions and the live loops share the pool, this
+  // thread being one of them
+  std::vector<std::thread> workerThreads;
+  for (size_t i = 1; i < m_ThreadCount; i++) {
+    workerThreads.emplace_back([this]() { m_Context->run(); });
+  }
   m_Context->run();
-  liveAnalysesWorkerThread.join();
-  liveDataWorkerThread.join();
+  for (auto &workerThread : workerThreads) {
+    workerThread.join();
+  }
+  devicesWorkerThread.join();
+  m_SharedMemory.reset();
   logger.info("TCP Server is terminating");
 }
 
@@ -371,6 +711,10 @@ void TcpServer::startAcceptingSocketConnexions() {
   acceptSocketConnexion(m_LiveDataAcceptor, &TcpServer::handleLiveDataSocket);
   acceptSocketConnexion(m_LiveAnalysesAcceptor,
                         &TcpServer::handleLiveAnalysesSocket);
+  if (m_MultiplexedAcceptor) {
+    acceptSocketConnexion(m_MultiplexedAcceptor,
+                          &TcpServer::handleMultiplexedSocket);
+  }
 }
 
 void TcpServer::acceptSocketConnexion(
@@ -391,123 +735,116 @@ void TcpServer::acceptSocketConnexion(
 
 void TcpServer::handleCommandSocketConnexion(
     std::shared_ptr<asio::ip::tcp::socket> socket) {
-  auto sessionId = readSessionIdFromSocket(socket);
-  if (sessionId == 0xFFFFFFFF) {
-    return;
-  }
-
-  auto session = getOrCreateSession(sessionId);
-  session->connectCommandSocket(socket);
+  readSessionIdFromSocket(socket, [socket](ClientSession &session) {
+    session.connectCommandSocket(socket);
+  });
 }
 
 void TcpServer::handleMessageSocketConnexion(
     std::shared_ptr<asio::ip::tcp::socket> socket) {
-  auto sessionId = readSessionIdFromSocket(socket);
-  if (sessionId == 0xFFFFFFFF) {
-    return;
-  }
-
-  auto session = getOrCreateSession(sessionId);
-  session->connectMessageSocket(socket);
+  readSessionIdFromSocket(socket, [socket](ClientSession &session) {
+    session.connectMessageSocket(socket);
+  });
 }
 
 void TcpServer::handleLiveDataSocket(
     std::shared_ptr<asio::ip::tcp::socket> socket) {
-  auto sessionId = readSessionIdFromSocket(socket);
-  if (sessionId == 0xFFFFFFFF) {
-    return;
-  }
-
-  auto session = getOrCreateSession(sessionId);
-  session->connectLiveDataSocket(socket);
+  readSessionIdFromSocket(socket, [socket](ClientSession &session) {
+    session.connectLiveDataSocket(socket);
+  });
 }
 
 void TcpServer::handleLiveAnalysesSocket(
     std::shared_ptr<asio::ip::tcp::socket> socket) {
-  auto sessionId = readSessionIdFromSocket(socket);
-  if (sessionId == 0xFFFFFFFF) {
-    return;
-  }
+  readSessionIdFromSocket(socket, [socket](ClientSession &session) {
+    session.connectLiveAnalysesSocket(socket);
+  });
+}
 
-  auto session = getOrCreateSession(sessionId);
-  session->connectLiveAnalysesSocket(socket);
+void TcpServer::handleMultiplexedSocket(
+    std::shared_ptr<asio::ip::tcp::socket> socket) {
+  readSessionIdFromSocket(socket, [socket](ClientSession &session) {
+    session.connectMultiplexedSocket(socket);
+  });
 }
 
 std::shared_ptr<ClientSession> TcpServer::getOrCreateSession(uint32_t id) {
   std::unique_lock lock(m_SessionMutex); // Exclusive lock
   auto &session = m_Sessions[id];
   if (!session) {
+    // The live loops only check for the sessions under the lock, so they see
+    // this one once they are woken up
+    wakeUpLiveLoops();
     session = std::make_shared<ClientSession>(
         m_Context, id,
-        [this](TcpServerCommand command, const ClientSession &client) {
-          return handleHandshake(command, client);
+        [this](const TcpServerRequest &request, const ClientSession &client) {
+          return handleHandshake(request, client);
         },
-        [this](TcpServerCommand command, const ClientSession &client) {
-          return handleCommand(command, client);
+        [this](const TcpServerRequest &request, const ClientSession &client) {
+          return handleCommand(request, client);
         },
         [this](const ClientSession &client) {
           return handleClientHasDisconnected(client);
         },
-        m_TimeoutPeriod);
+        m_TimeoutPeriod, m_LiveDataRate, m_LiveAnalysesRate);
   }
   return session;
 }
 
-uint32_t TcpServer::readSessionIdFromSocket(
-    std::shared_ptr<asio::ip::tcp::socket> socket) {
-  uint32_t id(0xFFFFFFFF); // Default invalid ID
-  bool hasValue(false);
-
+void TcpServer::readSessionIdFromSocket(
+    std::shared_ptr<asio::ip::tcp::socket> socket,
+    std::function<void(ClientSession &session)> connect) {
   // Start a timer so a user that would not send the session ID
   // will be disconnected after a while
-  asio::steady_timer timer(*m_Context, m_TimeoutPeriod);
-  timer.async_wait([&hasValue](const asio::error_code &ec) {
-    if (ec)
-      return;        // Timer was canceled
-    hasValue = true; // Timeout occurred
+  auto timer =
+      std::make_shared<asio::steady_timer>(*m_Context, m_TimeoutPeriod);
+  timer->async_wait([socket](const asio::error_code &ec) {
+    if (ec) {
+      return; // Timer was canceled
+    }
+    asio::error_code error;
+    socket->close(error);
   });
 
-  auto buffer = std::array<char, BYTES_IN_CLIENT_PACKET_HEADER>();
+  auto buffer =
+      std::make_shared<std::array<char, BYTES_IN_CLIENT_PACKET_HEADER>>();
   asio::async_read(
-      *socket, asio::buffer(buffer),
-      [this, &hasValue, &id, &timer, &buffer](const asio::error_code &ec,
-                                              std::size_t byteRead) {
-        if (ec || byteRead != BYTES_IN_CLIENT_PACKET_HEADER || hasValue) {
-          // If anything went wrong, we will return an error value
-          hasValue = true;
+      *socket, asio::buffer(*buffer),
+      [this, socket, timer, buffer, connect](const asio::error_code &ec,
+                                             std::size_t byteRead) {
+        timer->cancel();
+        if (ec || byteRead != BYTES_IN_CLIENT_PACKET_HEADER) {
+          // If anything went wrong (or the client took too long), the socket
+          // is dropped
           return;
         }
-        timer.cancel(); // Cancel the timer since we successfully read the ID
-
-        id = static_cast<uint32_t>(parseCommandPacket(buffer));
-        hasValue = true;
-      });
-
-  // Wait for the timer or the async read to finish
-  while (!hasValue) {
-    m_Context->run_one();
-  }
-
-  if (id < 0x10000000) {
-    id = 0xFFFFFFFF; // Invalid ID, return error value
-  }
 
-  std::unique_lock lock(m_SessionMutex);
-  auto &session = m_Sessions[id];
-  if (session && session->isConnected()) {
-    // If the session is already connected so the state is invalid
-    auto &logger = utils::Logger::getInstance();
-    logger.warning("Client with ID " + std::to_string(id) +
-                   " is already connected, please choose a different ID.");
-    id = 0xFFFFFFFF; // Return error value
-  }
+        asio::error_code error;
+        auto id = static_cast<uint32_t>(parseCommandPacket(*buffer));
+        if (id < 0x10000000) {
+          socket->close(error);
+          return;
+        }
 
-  if (id == 0xFFFFFFFF) {
-    auto &logger = utils::Logger::getInstance();
-    socket->close();
-  }
+        {
+          std::shared_lock lock(m_SessionMutex);
+          auto it = m_Sessions.find(id);
+          if (it != m_Sessions.end() && it->second &&
+              it->second->isConnected()) {
+            // If the session is already connected so the state is invalid
+            auto &logger = utils::Logger::getInstance();
+            logger.warning(
+                "Client with ID " + std::to_string(id) +
+                " is already connected, please choose a different ID.");
+            socket->close(error);
+            return;
+          }
+        }
 
-  return id;
+        auto session = getOrCreateSession(id);
+        asio::post(session->getStrand(),
+                   [session, connect]() { connect(*session); });
+      });
 }
 
 void TcpServer::handleClientHasDisconnected(const ClientSession &session) {
@@ -532,8 +869,7 @@ void TcpServer::stopServer() {
 
   // Stop any running contexts
   m_Context->stop();
-  m_LiveDataContext->stop();
-  m_LiveAnalysesContext->stop();
+  m_DevicesContext->stop();
 
   // Shutdown the server down
   auto &logger = utils::Logger::getInstance();
@@ -545,8 +881,12 @@ void TcpServer::stopServer() {
 
   // Make sure all the devices are properly disconnected
   logger.info("Disconnecting all devices");
-  for (auto &name : m_Devices.getDeviceNames()) {
-    removeDevice(name, false);
+  {
+    // Wait for the command on the devices being handled, if any
+    std::lock_guard lock(m_DevicesMutex);
+    for (auto &name : m_Devices.getDeviceNames()) {
+      removeDevice(name, false);
+    }
   }
 
   // Clear the analyzers
@@ -606,6 +946,14 @@ void TcpServer::startAcceptors() {
       asio::ip::tcp::endpoint(asio::ip::tcp::v4(), m_LiveAnalysesPort));
   logger.info("TCP Live Analyses server started on port " +
               std::to_string(m_LiveAnalysesPort));
+
+  if (m_MultiplexedPort > 0) {
+    m_MultiplexedAcceptor = std::make_unique<asio::ip::tcp::acceptor>(
+        *m_Context,
+        asio::ip::tcp::endpoint(asio::ip::tcp::v4(), m_MultiplexedPort));
+    logger.info("TCP Multiplexed server started on port " +
+                std::to_string(m_MultiplexedPort));
+  }
 }
 
 void TcpServer::cancelAcceptors() {
@@ -624,9 +972,13 @@ void TcpServer::cancelAcceptors() {
   if (m_LiveAnalysesAcceptor && m_LiveAnalysesAcceptor->is_open()) {
     m_LiveAnalysesAcceptor->cancel();
   }
+
+  if (m_MultiplexedAcceptor && m_MultiplexedAcceptor->is_open()) {
+    m_MultiplexedAcceptor->cancel();
+  }
 }
 
-bool TcpServer::handleHandshake(TcpServerCommand command,
+bool TcpServer::handleHandshake(const TcpServerRequest &request,
                                 const ClientSession &session) {
   if (m_Status == TcpServerStatus::OFF) {
     // If the server is off, we cannot handle any commands
@@ -637,16 +989,14 @@ bool TcpServer::handleHandshake(TcpServerCommand command,
   asio::error_code error;
 
   // The only valid command during initialization is the handshake
-  auto isAccepted = command == TcpServerCommand::HANDSHAKE;
-  size_t byteWritten = asio::write(
-      *session.getCommandSocket(),
-      asio::buffer(constructMessagePacket(
-          command, isAccepted ? TcpServerMessage::OK : TcpServerMessage::NOK)),
-      error);
-  if (!isAccepted || byteWritten != BYTES_IN_SERVER_PACKET_HEADER || error) {
+  auto isAccepted = request.command == TcpServerCommand::HANDSHAKE;
+  auto packet = MessagePacket(
+      request, isAccepted ? TcpServerMessage::OK : TcpServerMessage::NOK);
+  size_t byteWritten = session.write(TcpServerChannel::COMMAND, packet, error);
+  if (!isAccepted || byteWritten != packet.size() || error) {
     if (!isAccepted) {
       logger.fatal("Invalid command during initialization: " +
-                   std::to_string(static_cast<uint32_t>(command)));
+                   std::to_string(static_cast<uint32_t>(request.command)));
     } else {
       logger.fatal("TCP write error: " + error.message());
     }
@@ -660,7 +1010,23 @@ bool TcpServer::handleHandshake(TcpServerCommand command,
   return true;
 }
 
-bool TcpServer::handleCommand(TcpServerCommand command,
+bool isDeviceCommand(TcpServerCommand command) {
+  switch (command) {
+  case TcpServerCommand::CONNECT_DELSYS_ANALOG:
+  case TcpServerCommand::CONNECT_DELSYS_EMG:
+  case TcpServerCommand::CONNECT_MAGSTIM:
+  case TcpServerCommand::ZERO_DELSYS_ANALOG:
+  case TcpServerCommand::ZERO_DELSYS_EMG:
+  case TcpServerCommand::DISCONNECT_DELSYS_ANALOG:
+  case TcpServerCommand::DISCONNECT_DELSYS_EMG:
+  case TcpServerCommand::DISCONNECT_MAGSTIM:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool TcpServer::handleCommand(const TcpServerRequest &request,
                               const ClientSession &session) {
   if (m_Status == TcpServerStatus::OFF) {
     // If the server is off, we cannot handle any commands
@@ -669,101 +1035,67 @@ bool TcpServer::handleCommand(TcpServerCommand command,
 
   auto &logger = utils::Logger::getInstance();
   asio::error_code error;
+  auto command = request.command;
+
+  if (isDeviceCommand(command)) {
+    // The devices can take long to answer, so the strand of the session is
+    // not held meanwhile. A pipelined client sends its next commands, which
+    // are handled in the meantime, while the others wait for the response.
+    // It is sent to the session once the device answered, if the client is
+    // still there
+    asio::post(*m_DevicesContext, [this, request, id = session.getId()]() {
+      auto message = handleDeviceCommand(request.command);
+
+      std::shared_ptr<ClientSession> session;
+      {
+        std::shared_lock lock(m_SessionMutex);
+        auto it = m_Sessions.find(id);
+        if (it != m_Sessions.end()) {
+          session = it->second;
+        }
+      }
+      bool isResponded = session && session->isConnected() &&
+                         respondToCommand(request, message, true, *session);
+      if (!isResponded) {
+        // The other clients must still know that the devices changed
+        notifyClientsOfStateChange(request.command);
+      }
+    });
+    return true;
+  }
 
   // Handle the command
   TcpServerMessage message = TcpServerMessage::OK;
   bool shouldNotifyClients = false;
   switch (command) {
   case TcpServerCommand::GET_STATES: {
-    auto states = nlohmann::json();
-
-    // Connected devices status
-    auto connectedDevices = nlohmann::json();
-    for (auto &id : m_Devices.getDeviceIds()) {
-      const auto &device = m_Devices[id];
-      auto value = nlohmann::json();
-      value["is_connected"] = device.getIsConnected();
-      value["is_collecting"] = m_Devices.hasDataCollector(id);
-      value["is_recording"] = false;
-      if (value["is_collecting"]) {
-        value["is_recording"] = m_Devices.getDataCollector(id).getIsRecording();
-      }
-      connectedDevices[device.deviceName()] = value;
+    // The states are refreshed first if a device got connected or
+    // disconnected on its own. They are written once [StatesMutex] is
+    // released, so a slow client does not hold the others
+    nlohmann::json changes;
+    uint64_t version;
+    std::string dump;
+    {
+      std::lock_guard lock(m_StatesMutex);
+      changes = refreshStates();
+      version = m_StatesVersion;
+      dump = getStatesWithVersion().dump();
     }
-    states["connected_devices"] = connectedDevices;
-
-    // Connected analyzers status
-    auto connectedAnalyzers = nlohmann::json();
-    for (const auto &id : m_Analyzers.getAnalyzerIds()) {
-      const auto &analyzer = m_Analyzers[id];
-      auto value = nlohmann::json();
-      value["configuration"] = analyzer.getSerializedConfiguration();
-      connectedAnalyzers[analyzer.getName()] = value;
+    if (!changes.empty()) {
+      sendStateChange(command, version, changes);
     }
-    states["connected_analyzers"] = connectedAnalyzers;
-
-    auto dump = states.dump();
-    asio::write(*session.getMessageSocket(),
-                asio::buffer(constructMessagePacket(
-                    command, TcpServerMessage::SENDING_DATA,
-                    TcpServerDataType::STATES, dump.size(), dump)),
-                error);
+    session.write(
+        TcpServerChannel::MESSAGE,
+        MessagePacket(request, TcpServerMessage::SENDING_DATA,
+                      TcpServerDataType::STATES,
+                      std::make_shared<std::string>(std::move(dump))),
+        error);
     if (error) {
       logger.fatal("TCP write error: " + error.message());
       message = TcpServerMessage::NOK;
     }
     break;
   }
-  case TcpServerCommand::CONNECT_DELSYS_ANALOG:
-    message = addDevice(DEVICE_NAME_DELSYS_ANALOG) ? TcpServerMessage::OK
-                                                   : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
-  case TcpServerCommand::CONNECT_DELSYS_EMG:
-    message = addDevice(DEVICE_NAME_DELSYS_EMG) ? TcpServerMessage::OK
-                                                : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
-  case TcpServerCommand::CONNECT_MAGSTIM:
-    message = addDevice(DEVICE_NAME_MAGSTIM) ? TcpServerMessage::OK
-                                             : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
-  case TcpServerCommand::ZERO_DELSYS_ANALOG:
-    message = m_Devices.zeroLevelDevice(DEVICE_NAME_DELSYS_ANALOG)
-                  ? TcpServerMessage::OK
-                  : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
-  case TcpServerCommand::ZERO_DELSYS_EMG:
-    message = m_Devices.zeroLevelDevice(DEVICE_NAME_DELSYS_EMG)
-                  ? TcpServerMessage::OK
-                  : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
-  case TcpServerCommand::DISCONNECT_DELSYS_ANALOG:
-    message = removeDevice(DEVICE_NAME_DELSYS_ANALOG) ? TcpServerMessage::OK
-                                                      : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
-  case TcpServerCommand::DISCONNECT_DELSYS_EMG:
-    message = removeDevice(DEVICE_NAME_DELSYS_EMG) ? TcpServerMessage::OK
-                                                   : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
-  case TcpServerCommand::DISCONNECT_MAGSTIM:
-    message = removeDevice(DEVICE_NAME_MAGSTIM) ? TcpServerMessage::OK
-                                                : TcpServerMessage::NOK;
-    shouldNotifyClients = true;
-    break;
-
   case TcpServerCommand::START_RECORDING:
     message = m_Devices.startRecording() ? TcpServerMessage::OK
                                          : TcpServerMessage::NOK;
@@ -780,16 +1112,107 @@ bool TcpServer::handleCommand(TcpServerCommand command,
     auto data = m_Devices.getLastTrialDataSerialized();
 
     auto dump = data.dump();
-    asio::write(*session.getMessageSocket(),
-                asio::buffer(constructMessagePacket(
-                    command, TcpServerMessage::SENDING_DATA,
-                    TcpServerDataType::FULL_TRIAL, dump.size(), dump)),
-                error);
+    session.write(
+        TcpServerChannel::MESSAGE,
+        MessagePacket(request, TcpServerMessage::SENDING_DATA,
+                      TcpServerDataType::FULL_TRIAL,
+                      std::make_shared<std::string>(std::move(dump))),
+        error);
+  } break;
+
+  case TcpServerCommand::GET_TRACE: {
+    auto dump = utils::Tracer::getInstance().serialize().dump();
+    session.write(
+        TcpServerChannel::MESSAGE,
+        MessagePacket(request, TcpServerMessage::SENDING_DATA,
+                      TcpServerDataType::TRACE,
+                      std::make_shared<std::string>(std::move(dump))),
+        error);
+  } break;
+
+  case TcpServerCommand::GET_METRICS: {
+    auto dump = utils::Metrics::getInstance().serialize().dump();
+    session.write(
+        TcpServerChannel::MESSAGE,
+        MessagePacket(request, TcpServerMessage::SENDING_DATA,
+                      TcpServerDataType::METRICS,
+                      std::make_shared<std::string>(std::move(dump))),
+        error);
+  } break;
+
+  case TcpServerCommand::USE_SHARED_MEMORY: {
+    // Only a client on the same host can read the shared memory, the others
+    // keep receiving the live data through the sockets
+    auto response = nlohmann::json::object();
+    if (m_SharedMemory && session.isLocal()) {
+      std::shared_lock lock(m_SessionMutex);
+      auto it = m_Sessions.find(session.getId());
+      if (it != m_Sessions.end() && it->second) {
+        it->second->setIsUsingSharedMemory(true);
+        response["name"] = m_SharedMemory->getName();
+        response["token"] = m_SharedMemory->getToken();
+      }
+    }
+    if (response.empty()) {
+      message = TcpServerMessage::NOK;
+    }
+    session.write(
+        TcpServerChannel::MESSAGE,
+        MessagePacket(request, TcpServerMessage::SENDING_DATA,
+                      TcpServerDataType::SHARED_MEMORY,
+                      std::make_shared<std::string>(response.dump())),
+        error);
+  } break;
+
+  case TcpServerCommand::SUBSCRIBE: {
+    try {
+      auto subscription = std::make_shared<const LiveSubscription>(
+          handleExtraData(request, error, session));
+      std::shared_lock lock(m_SessionMutex);
+      auto it = m_Sessions.find(session.getId());
+      if (it != m_Sessions.end() && it->second) {
+        it->second->setLiveSubscription(subscription);
+      }
+    } catch (const std::exception &e) {
+      logger.fatal("Failed to get extra info: " + std::string(e.what()));
+      message = TcpServerMessage::NOK;
+    }
+    // The other clients are not concerned, so only the subscriber is told
+    // (on its message channel) that its subscription changed. A pipelined
+    // client gets the response to its request instead
+    if (!request.isPipelined) {
+      session.write(TcpServerChannel::MESSAGE, MessagePacket(request, message),
+                    error);
+    }
+  } break;
+
+  case TcpServerCommand::RESUME_LIVE_DATA: {
+    std::shared_ptr<const std::string> replay;
+    try {
+      auto fromSequences = handleExtraData(request, error, session)
+                               .get<std::map<std::string, size_t>>();
+      replay = std::make_shared<const std::string>(
+          m_Devices.getReplayDataSerialized(fromSequences).dump());
+    } catch (const std::exception &e) {
+      logger.fatal("Failed to get extra info: " + std::string(e.what()));
+      message = TcpServerMessage::NOK;
+    }
+    // The client waits for the samples it missed on its message channel, so
+    // it is told there if they cannot be sent
+    if (replay) {
+      session.write(TcpServerChannel::MESSAGE,
+                    MessagePacket(request, TcpServerMessage::SENDING_DATA,
+                                  TcpServerDataType::LIVE_DATA, replay),
+                    error);
+    } else {
+      session.write(TcpServerChannel::MESSAGE, MessagePacket(request, message),
+                    error);
+    }
   } break;
 
   case TcpServerCommand::ADD_ANALYZER: {
     try {
-      auto data = handleExtraData(command, error, session);
+      auto data = handleExtraData(request, error, session);
       m_Analyzers.add(data);
     } catch (const std::exception &e) {
       logger.fatal("Failed to get extra info: " + std::string(e.what()));
@@ -804,7 +1227,7 @@ bool TcpServer::handleCommand(TcpServerCommand command,
   case TcpServerCommand::REMOVE_ANALYZER: {
     try {
       std::string analyzerName =
-          handleExtraData(command, error, session)["analyzer"];
+          handleExtraData(request, error, session)["analyzer"];
       m_Analyzers.remove(analyzerName);
     } catch (const std::exception &e) {
       logger.fatal("Failed to get extra info: " + std::string(e.what()));
@@ -820,25 +1243,169 @@ bool TcpServer::handleCommand(TcpServerCommand command,
     break;
   }
 
-  // Respond to the command
-  size_t byteWritten = asio::write(
-      *session.getCommandSocket(),
-      asio::buffer(constructMessagePacket(command, message)), error);
-  if (byteWritten != BYTES_IN_SERVER_PACKET_HEADER || error) {
-    logger.fatal("TCP write error: " + error.message());
-    return false;
+  return respondToCommand(request, message, shouldNotifyClients, session);
+}
+
+TcpServerMessage TcpServer::handleDeviceCommand(TcpServerCommand command) {
+  std::lock_guard lock(m_DevicesMutex);
+
+  bool isSuccessful = false;
+  switch (command) {
+  case TcpServerCommand::CONNECT_DELSYS_ANALOG:
+    isSuccessful = addDevice(DEVICE_NAME_DELSYS_ANALOG);
+    break;
+  case TcpServerCommand::CONNECT_DELSYS_EMG:
+    isSuccessful = addDevice(DEVICE_NAME_DELSYS_EMG);
+    break;
+  case TcpServerCommand::CONNECT_MAGSTIM:
+    isSuccessful = addDevice(DEVICE_NAME_MAGSTIM);
+    break;
+  case TcpServerCommand::ZERO_DELSYS_ANALOG:
+    isSuccessful = m_Devices.zeroLevelDevice(DEVICE_NAME_DELSYS_ANALOG);
+    break;
+  case TcpServerCommand::ZERO_DELSYS_EMG:
+    isSuccessful = m_Devices.zeroLevelDevice(DEVICE_NAME_DELSYS_EMG);
+    break;
+  case TcpServerCommand::DISCONNECT_DELSYS_ANALOG:
+    isSuccessful = removeDevice(DEVICE_NAME_DELSYS_ANALOG);
+    break;
+  case TcpServerCommand::DISCONNECT_DELSYS_EMG:
+    isSuccessful = removeDevice(DEVICE_NAME_DELSYS_EMG);
+    break;
+  case TcpServerCommand::DISCONNECT_MAGSTIM:
+    isSuccessful = removeDevice(DEVICE_NAME_MAGSTIM);
+    break;
+  default:
+    break;
   }
+  return isSuccessful ? TcpServerMessage::OK : TcpServerMessage::NOK;
+}
+
+bool TcpServer::respondToCommand(const TcpServerRequest &request,
+                                 TcpServerMessage message,
+                                 bool shouldNotifyClients,
+                                 const ClientSession &session) {
+  // The clients are sent the change before the response, so a client that
+  // gets the states as soon as it got the response does get the new ones, and
+  // the change of its next command reaches everyone after this one
   if (shouldNotifyClients) {
-    notifyClientsOfStateChange(command);
+    nlohmann::json changes;
+    uint64_t version;
+    {
+      std::lock_guard lock(m_StatesMutex);
+      m_AreStatesDirty = true;
+      changes = refreshStates();
+      version = m_StatesVersion;
+    }
+    sendStateChange(request.command, version, changes);
+  }
+
+  asio::error_code error;
+  auto packet = MessagePacket(request, message);
+  size_t byteWritten = session.write(TcpServerChannel::COMMAND, packet, error);
+  if (byteWritten != packet.size() || error) {
+    utils::Logger::getInstance().fatal("TCP write error: " + error.message());
+    return false;
   }
 
   return true;
 }
 
+nlohmann::json TcpServer::serializeStates() const {
+  auto states = nlohmann::json();
+
+  // Connected devices status. The commands on the devices may add or remove
+  // some meanwhile, so the ones serialized are kept alive until then
+  auto connectedDevices = nlohmann::json();
+  for (auto &[id, device] : m_Devices.getDevices()) {
+    auto dataCollector =
+        dynamic_cast<const devices::DataCollector *>(device.get());
+    auto value = nlohmann::json();
+    value["is_connected"] = device->getIsConnected();
+    value["is_collecting"] = dataCollector != nullptr;
+    value["is_recording"] = false;
+    if (dataCollector) {
+      value["is_recording"] = dataCollector->getIsRecording();
+    }
+    connectedDevices[device->deviceName()] = value;
+  }
+  states["connected_devices"] = connectedDevices;
+
+  // Connected analyzers status
+  auto connectedAnalyzers = nlohmann::json();
+  for (auto &[name, configuration] :
+       m_Analyzers.getSerializedConfigurationsByName().items()) {
+    auto value = nlohmann::json();
+    value["configuration"] = std::move(configuration);
+    connectedAnalyzers[name] = value;
+  }
+  states["connected_analyzers"] = connectedAnalyzers;
+
+  return states;
+}
+
+nlohmann::json TcpServer::getStatesWithVersion() {
+  auto states = m_States;
+  states["version"] = m_StatesVersion;
+
+  // The clock skews are estimated continuously, so they are always current
+  for (auto &[id, device] : m_Devices.getDevices()) {
+    auto dataCollector =
+        dynamic_cast<const devices::DataCollector *>(device.get());
+    if (!dataCollector) {
+      continue;
+    }
+    const auto &name = device->deviceName();
+    auto &connectedDevices = states["connected_devices"];
+    if (connectedDevices.is_object() && connectedDevices.contains(name)) {
+      connectedDevices[name]["clock_skew"] = dataCollector->getClockSkew();
+    }
+  }
+  return states;
+}
+
 void TcpServer::notifyClientsOfStateChange(TcpServerCommand command) {
-  auto packet =
-      constructMessagePacket(command, TcpServerMessage::STATES_CHANGED);
+  nlohmann::json changes;
+  uint64_t version;
+  {
+    std::lock_guard statesLock(m_StatesMutex);
+    m_AreStatesDirty = true;
+    changes = refreshStates();
+    version = m_StatesVersion;
+  }
+  sendStateChange(command, version, changes);
+}
 
+nlohmann::json TcpServer::refreshStates() {
+  // A change made while they are serialized marks them dirty again
+  if (!m_AreStatesDirty.exchange(false)) {
+    return nlohmann::json::array();
+  }
+
+  auto states = serializeStates();
+  auto changes = nlohmann::json::diff(m_States, states);
+  if (!changes.empty()) {
+    m_States = std::move(states);
+    m_StatesVersion++;
+  }
+  return changes;
+}
+
+void TcpServer::sendStateChange(TcpServerCommand command, uint64_t version,
+                                const nlohmann::json &changes) {
+  // The clients of the previous version get the STATES_CHANGED event alone
+  // and must get the states again. The pipelined ones are sent what changed
+  // (as a JSON patch), from the previous version. The changes of concurrent
+  // commands may reach them out of order, in which case they get the states
+  // again as well
+  auto packet = MessagePacket(command, TcpServerMessage::STATES_CHANGED);
+  auto packetWithChanges = MessagePacket(
+      command, TcpServerMessage::STATES_CHANGED, TcpServerDataType::STATES,
+      std::make_shared<const std::string>(
+          nlohmann::json({{"version", version}, {"changes", changes}})
+              .dump()));
+
+  asio::error_code error;
   std::shared_lock lock(m_SessionMutex);
   for (const auto &sessionPair : m_Sessions) {
     const auto &session = sessionPair.second;
@@ -846,27 +1413,52 @@ void TcpServer::notifyClientsOfStateChange(TcpServerCommand command) {
       continue;
     }
 
-    asio::write(*session->getMessageSocket(), asio::buffer(packet));
+    if (!session->getIsPipelined()) {
+      session->write(TcpServerChannel::MESSAGE, packet, error);
+    } else if (!changes.empty()) {
+      session->write(TcpServerChannel::MESSAGE, packetWithChanges, error);
+    }
   }
 }
 
-nlohmann::json TcpServer::handleExtraData(TcpServerCommand command,
+nlohmann::json TcpServer::handleExtraData(const TcpServerRequest &request,
                                           asio::error_code &error,
                                           const ClientSession &session) {
   auto &logger = utils::Logger::getInstance();
 
   // Send an acknowledgment to the client we are ready to receive the data
-  size_t byteWritten =
-      asio::write(*session.getCommandSocket(),
-                  asio::buffer(constructMessagePacket(
-                      command, TcpServerMessage::LISTENING_EXTRA_DATA)),
-                  error);
+  size_t byteWritten = session.write(
+      TcpServerChannel::COMMAND,
+      MessagePacket(request, TcpServerMessage::LISTENING_EXTRA_DATA), error);
+
+  // The reads below block the strand of the session, so a client that does
+  // not send the data in time has its sockets shut down, which fails them.
+  // Whoever of the reads and the timer finishes first sets [isDone]
+  auto isDone = std::make_shared<std::atomic<bool>>(false);
+  auto timer =
+      std::make_shared<asio::steady_timer>(*m_Context, m_TimeoutPeriod);
+  timer->async_wait([weakSession = session.weak_from_this(),
+                     isDone](const asio::error_code &ec) {
+    auto session = weakSession.lock();
+    if (ec || !session || isDone->exchange(true)) {
+      return; // Timer was canceled or the data were received
+    }
+    utils::Logger::getInstance().warning(
+        "Client session " + std::to_string(session->getId()) +
+        " did not send the extra data in time, disconnecting.");
+    session->shutdown();
+  });
+  auto stopTimer = [&isDone, &timer]() {
+    *isDone = true;
+    timer->cancel();
+  };
 
   // Receive the size of the data
   auto buffer = std::array<char, BYTES_IN_CLIENT_PACKET_HEADER>();
   size_t byteRead =
-      asio::read(*session.getMessageSocket(), asio::buffer(buffer), error);
+      session.read(TcpServerChannel::MESSAGE, asio::buffer(buffer), error);
   if (byteRead != BYTES_IN_CLIENT_PACKET_HEADER || error) {
+    stopTimer();
     logger.fatal("TCP read error: " + error.message());
     throw std::runtime_error("Failed to read the size of the data");
   }
@@ -874,8 +1466,9 @@ nlohmann::json TcpServer::handleExtraData(TcpServerCommand command,
   // Parse the size of the data
   uint32_t dataSize = static_cast<uint32_t>(parseCommandPacket(buffer));
   auto dataBuffer = std::vector<char>(dataSize);
-  byteRead =
-      asio::read(*session.getMessageSocket(), asio::buffer(dataBuffer), error);
+  byteRead = session.read(TcpServerChannel::MESSAGE, asio::buffer(dataBuffer),
+                          error);
+  stopTimer();
   if (byteRead != dataSize || error) {
     logger.fatal("TCP read error: " + error.message());
     throw std::runtime_error("Failed to read the data");
@@ -991,7 +1584,7 @@ void TcpServer::liveDataLoop() {
   }
 
   m_LiveDataTimer->expires_at(std::chrono::steady_clock::now() +
-                              std::chrono::milliseconds(100));
+                              m_LiveDataRate.getInterval());
 
   m_LiveDataTimer->async_wait([this](const asio::error_code &ec) {
     auto &logger = utils::Logger::getInstance();
@@ -999,38 +1592,106 @@ void TcpServer::liveDataLoop() {
       logger.info("Live data loop stopped");
       return;
     }
+    if (pauseLiveLoopIfIdle(m_IsLiveDataLoopPaused)) {
+      logger.debug("Live data loop paused, no client is connected");
+      return;
+    }
+
+    auto sequences = m_Devices.getLiveDataSequences();
+    if (sequences == m_LiveDataSequences) {
+      // No new sample since the last packet, skip this tick
+      liveDataLoop();
+      return;
+    }
+    m_LiveDataSequences = std::move(sequences);
     logger.debug("Sending live data to client");
+    NEUROBIO_TRACE_SCOPE("TcpServer::liveDataLoop");
 
-    auto data = m_Devices.getLiveDataSerialized();
-    if (data.size() == 0) {
-      // Reschedule the next execution
+    if (m_LiveDataSequences.empty()) {
+      // No data collector, reschedule the next execution
       liveDataLoop();
       return;
     }
-    auto dataDump = data.dump();
 
-    auto packet = constructMessagePacket(
-        TcpServerCommand::NONE, TcpServerMessage::SENDING_DATA,
-        TcpServerDataType::LIVE_DATA, dataDump.size(), dataDump);
+    // The data are dumped once for each distinct subscription, when a client
+    // first needs them. The packet shares the dump, so nothing is copied for
+    // each client. The json is only serialized if a client needs it, the
+    // compressed data are encoded straight from the live data
+    std::optional<nlohmann::json> data;
+    std::map<std::string, MessagePacket> packets;
+    size_t sentBytes = 0;
+    auto packetFor =
+        [&](const LiveSubscription &subscription) -> const MessagePacket & {
+      auto it = packets.find(subscription.getKey());
+      if (it != packets.end()) {
+        return it->second;
+      }
+
+      std::string dataDump;
+      {
+        NEUROBIO_TRACE_SCOPE("TcpServer::liveDataLoop (dump)");
+        utils::HistogramScope durationScope(*m_LiveDataSerializeDurationMetric);
+        if (subscription.getIsCompressedData()) {
+          auto compressed =
+              subscription.getIsEveryStream()
+                  ? m_Devices.getLiveDataCompressed()
+                  : m_Devices.getLiveDataCompressed(subscription.getStreams());
+          dataDump.assign(compressed.begin(), compressed.end());
+        } else {
+          if (!data) {
+            data = m_Devices.getLiveDataSerialized();
+          }
+          dataDump = subscription.filter(*data).dump();
+        }
+      }
+      sentBytes += dataDump.size();
+      auto payload = std::make_shared<const std::string>(std::move(dataDump));
+      auto dataType = subscription.getIsCompressedData()
+                          ? TcpServerDataType::LIVE_DATA_COMPRESSED
+                          : TcpServerDataType::LIVE_DATA;
+      return packets
+          .emplace(subscription.getKey(),
+                   MessagePacket(TcpServerCommand::NONE,
+                                 TcpServerMessage::SENDING_DATA, dataType,
+                                 payload))
+          .first->second;
+    };
+
+    // Publish all the data once for all the clients reading the shared memory
+    bool isPublished = false;
+    if (m_SharedMemory) {
+      const auto &packet = packetFor(LiveSubscription());
+      isPublished = m_SharedMemory->publish(
+          static_cast<uint32_t>(TcpServerDataType::LIVE_DATA), *packet.data());
+    }
 
-    // Send the data to all the clients
+    // Send the data to all the other clients, as they subscribed to them. Each
+    // client that does not keep up is sent them less often
     asio::error_code error;
     std::shared_lock lock(m_SessionMutex);
     for (auto &sessionPair : m_Sessions) {
       try {
         const auto &session = sessionPair.second;
-        if (!session || !session->isConnected()) {
+        if (!session || !session->isConnected() ||
+            (isPublished && session->getIsUsingSharedMemory()) ||
+            !session->isLiveDue(TcpServerChannel::LIVE_DATA)) {
           continue;
         }
 
-        auto &socket = session->getLiveDataSocket();
-        asio::write(*socket, asio::buffer(packet), error);
+        const auto &packet = packetFor(*session->getLiveSubscription());
+        NEUROBIO_TRACE_SCOPE("TcpServer::liveDataLoop (write)");
+        auto writeStartTime = std::chrono::steady_clock::now();
+        session->write(TcpServerChannel::LIVE_DATA, packet, error);
+        session->updateLiveRate(TcpServerChannel::LIVE_DATA,
+                                std::chrono::steady_clock::now() -
+                                    writeStartTime);
       } catch (const std::exception &) {
         // Do nothing and hope for the best
       }
     }
-    logger.debug("Sent live data of size: " + std::to_string(dataDump.size()) +
+    logger.debug("Sent live data of size: " + std::to_string(sentBytes) +
                  " to " + std::to_string(m_Sessions.size()) + " clients");
+    lock.unlock();
 
     // Reschedule the next execution
     liveDataLoop();
@@ -1043,19 +1704,31 @@ void TcpServer::liveAnalysesLoop() {
   }
 
   m_LiveAnalysesTimer->expires_at(std::chrono::steady_clock::now() +
-                                  std::chrono::milliseconds(25));
+                                  m_LiveAnalysesRate.getInterval());
   m_LiveAnalysesTimer->async_wait([this](const asio::error_code &ec) {
     auto &logger = utils::Logger::getInstance();
     if (ec) {
       logger.info("Live analyses loop stopped");
       return;
     }
+    if (pauseLiveLoopIfIdle(m_IsLiveAnalysesLoopPaused)) {
+      logger.debug("Live analyses loop paused, no client is connected");
+      return;
+    }
 
     if (m_Analyzers.size() == 0) {
       // No analyzers to run, reschedule the next execution
       liveAnalysesLoop();
       return;
     }
+    auto sequences = m_Devices.getLiveDataSequences();
+    if (sequences == m_LiveAnalysesSequences) {
+      // No new sample to analyze since the last predictions, skip this tick
+      liveAnalysesLoop();
+      return;
+    }
+    m_LiveAnalysesSequences = std::move(sequences);
+    NEUROBIO_TRACE_SCOPE("TcpServer::liveAnalysesLoop");
 
     std::map<std::string, data::TimeSeries> data = m_Devices.getLiveData();
     if (data.size() == 0) {
@@ -1083,12 +1756,68 @@ void TcpServer::liveAnalysesLoop() {
       return;
     }
 
-    // Serialize the predictions
-    auto dataDump = predictions.serialize().dump();
-    auto packet = constructMessagePacket(
-        TcpServerCommand::NONE, TcpServerMessage::SENDING_DATA,
-        TcpServerDataType::LIVE_ANALYSES, dataDump.size(), dataDump);
+    // Keep the new predictions for the clients of the binary analyses. The
+    // ones that never received any start with the predictions of this tick
+    uint64_t previousSequence = m_PredictionHistory.getLastSequence();
+    m_PredictionHistory.add(predictions);
+    uint64_t lastSequence = m_PredictionHistory.getLastSequence();
+
+    // The json of the last predictions and the binary packets are serialized
+    // when a client first needs them. The binary packets are shared by the
+    // clients that were sent the same last prediction
+    std::unique_ptr<MessagePacket> jsonPacket;
+    std::map<uint64_t, MessagePacket> binaryPackets;
+    size_t sentBytes = 0;
+    auto jsonPacketFor = [&]() -> const MessagePacket & {
+      if (jsonPacket) {
+        return *jsonPacket;
+      }
+
+      std::string dataDump;
+      {
+        NEUROBIO_TRACE_SCOPE("TcpServer::liveAnalysesLoop (dump)");
+        utils::HistogramScope durationScope(
+            *m_LiveAnalysesSerializeDurationMetric);
+        dataDump = predictions.serialize().dump();
+      }
+      sentBytes += dataDump.size();
+      jsonPacket = std::make_unique<MessagePacket>(
+          TcpServerCommand::NONE, TcpServerMessage::SENDING_DATA,
+          TcpServerDataType::LIVE_ANALYSES,
+          std::make_shared<const std::string>(std::move(dataDump)));
+      return *jsonPacket;
+    };
+    auto binaryPacketFor =
+        [&](uint64_t afterSequence) -> const MessagePacket & {
+      auto it = binaryPackets.find(afterSequence);
+      if (it != binaryPackets.end()) {
+        return it->second;
+      }
 
+      std::string dataDump;
+      {
+        NEUROBIO_TRACE_SCOPE("TcpServer::liveAnalysesLoop (dump)");
+        utils::HistogramScope durationScope(
+            *m_LiveAnalysesSerializeDurationMetric);
+        dataDump = m_PredictionHistory.serialize(afterSequence);
+      }
+      sentBytes += dataDump.size();
+      auto payload = std::make_shared<const std::string>(std::move(dataDump));
+      return binaryPackets
+          .emplace(afterSequence,
+                   MessagePacket(TcpServerCommand::NONE,
+                                 TcpServerMessage::SENDING_DATA,
+                                 TcpServerDataType::LIVE_PREDICTIONS, payload))
+          .first->second;
+    };
+
+    bool isPublished =
+        m_SharedMemory &&
+        m_SharedMemory->publish(
+            static_cast<uint32_t>(TcpServerDataType::LIVE_ANALYSES),
+            *jsonPacketFor().data());
+
+    // Each client that does not keep up is sent the analyses less often
     asio::error_code error;
     std::shared_lock lock(m_SessionMutex);
     for (auto &sessionPair : m_Sessions) {
@@ -1097,27 +1826,94 @@ void TcpServer::liveAnalysesLoop() {
         if (!session || !session->isConnected()) {
           continue; // Skip disconnected sessions
         }
+        if (isPublished && session->getIsUsingSharedMemory()) {
+          continue; // The client reads the shared memory
+        }
+        if (!session->getLiveSubscription()->getHasAnalyses() ||
+            !session->isLiveDue(TcpServerChannel::LIVE_ANALYSES)) {
+          continue; // The client did not subscribe to the analyses (now)
+        }
 
-        auto &socket = session->getLiveAnalysesSocket();
-        if (!socket || !socket->is_open()) {
-          // Skip if the socket is not connected. This should not happen, but
-          // because of a race condition, it did happen once, so we
-          // handle it anyway
+        // The socket may not be connected because of a race condition (it
+        // did happen once), in which case the write fails and is skipped
+        NEUROBIO_TRACE_SCOPE("TcpServer::liveAnalysesLoop (write)");
+        if (!session->getLiveSubscription()->getIsBinaryAnalyses()) {
+          const auto &packet = jsonPacketFor();
+          auto writeStartTime = std::chrono::steady_clock::now();
+          session->write(TcpServerChannel::LIVE_ANALYSES, packet, error);
+          session->updateLiveRate(TcpServerChannel::LIVE_ANALYSES,
+                                  std::chrono::steady_clock::now() -
+                                      writeStartTime);
           continue;
         }
-        asio::write(*socket, asio::buffer(packet), error);
+
+        uint64_t afterSequence = session->getLastPredictionSequence();
+        if (afterSequence == 0) {
+          afterSequence = previousSequence;
+        }
+        if (afterSequence >= lastSequence) {
+          continue; // No prediction was made since the last packet
+        }
+        const auto &packet = binaryPacketFor(afterSequence);
+        asio::error_code writeError;
+        auto writeStartTime = std::chrono::steady_clock::now();
+        session->write(TcpServerChannel::LIVE_ANALYSES, packet, writeError);
+        session->updateLiveRate(TcpServerChannel::LIVE_ANALYSES,
+                                std::chrono::steady_clock::now() -
+                                    writeStartTime);
+        if (!writeError) {
+          // The predictions that could not be written are sent again with
+          // the next packet
+          session->setLastPredictionSequence(lastSequence);
+        }
       } catch (const std::exception &) {
         // Do nothing and hope for the best
       }
     }
-    logger.debug("Live analyses data size: " + std::to_string(dataDump.size()) +
+    logger.debug("Live analyses data size: " + std::to_string(sentBytes) +
                  " sent to " + std::to_string(m_Sessions.size()) + " clients");
+    lock.unlock();
+
     liveAnalysesLoop();
   });
 }
 
+bool TcpServer::pauseLiveLoopIfIdle(std::atomic<bool> &isPaused) {
+  // The sessions are created under the exclusive lock, which then wakes the
+  // loops up, so no session can be missed between the check and the pause
+  std::shared_lock lock(m_SessionMutex);
+  for (const auto &sessionPair : m_Sessions) {
+    if (sessionPair.second) {
+      return false;
+    }
+  }
+  isPaused = true;
+  return true;
+}
+
+void TcpServer::wakeUpLiveLoops() {
+  if (m_IsLiveDataLoopPaused.exchange(false)) {
+    asio::post(m_LiveDataStrand, [this]() { liveDataLoop(); });
+  }
+  if (m_IsLiveAnalysesLoopPaused.exchange(false)) {
+    asio::post(m_LiveAnalysesStrand, [this]() { liveAnalysesLoop(); });
+  }
+}
+
 void TcpServerMock::makeAndAddDevice(const std::string &deviceName) {
   auto &logger = utils::Logger::getInstance();
+  std::this_thread::sleep_for(m_DeviceConnexionDelay);
+
+  auto synthetic = m_SyntheticDevices.find(deviceName);
+  if (synthetic != m_SyntheticDevices.end()) {
+    m_ConnectedDeviceIds[deviceName] =
+        m_Devices.add(std::make_unique<devices::SyntheticDevice>(
+            deviceName,
+            devices::SyntheticDevice::dataCollectorNameFromDeviceName(
+                deviceName),
+            synthetic->second));
+    return;
+  }
 
   if (deviceName == DEVICE_NAME_DELSYS_ANALOG) {
     bool isInitialized = false;
@@ -1159,4 +1955,21 @@ void TcpServerMock::makeAndAddDevice(const std::string &deviceName) {
     logger.fatal("Invalid device name: " + deviceName);
     throw std::runtime_error("Invalid device name: " + deviceName);
   }
-}
\ No newline at end of file
+}
+
+void TcpServerReplay::makeAndAddDevice(const std::string &deviceName) {
+  for (const auto &[dataCollectorName, data] : m_ReplayTrial) {
+    if (devices::ReplayDataCollector::deviceNameFromDataCollectorName(
+            dataCollectorName) == deviceName) {
+      m_ConnectedDeviceIds[deviceName] =
+          m_Devices.add(devices::ReplayDataCollector::fromTrial(
+              m_ReplayTrial, dataCollectorName, m_ReplaySpeed,
+              m_IsReplayLooping));
+      return;
+    }
+  }
+
+  utils::Logger::getInstance().warning("The replayed trial has no data for " +
+                                       deviceName + ", it is mocked instead");
+  TcpServerMock::makeAndAddDevice(deviceName);
+}
@@ -0,0 +1,194 @@
+#include "Utils/Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace NEUROBIO_NAMESPACE::utils;
+
+Counter::Counter() : m_Value(0) {}
+
+Gauge::Gauge() : m_Value(0) {}
+
+Histogram::Histogram(const std::string &unit)
+    : m_Unit(unit), m_Sum(0), m_Min(std::numeric_limits<uint64_t>::max()),
+      m_Max(0) {
+  for (auto &bucket : m_Buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t Histogram::bucketIndex(uint64_t value) {
+  if (value < 2 * SubBucketCount) {
+    return static_cast<size_t>(value);
+  }
+
+  // Find the power of two of the value, then keep its 4 next bits (which of
+  // the SubBucketCount buckets of this power the value falls in)
+  size_t magnitude = 63;
+  while (!(value >> magnitude)) {
+    magnitude--;
+  }
+  size_t shift = magnitude - 4;
+  size_t subBucket = static_cast<size_t>(value >> shift) - SubBucketCount;
+  return 2 * SubBucketCount + (magnitude - 5) * SubBucketCount + subBucket;
+}
+
+uint64_t Histogram::bucketUpperBound(size_t index) {
+  if (index < 2 * SubBucketCount) {
+    return static_cast<uint64_t>(index);
+  }
+
+  size_t magnitude = (index - 2 * SubBucketCount) / SubBucketCount + 5;
+  uint64_t subBucket = (index - 2 * SubBucketCount) % SubBucketCount;
+  size_t shift = magnitude - 4;
+  // Computed as lower bound + width - 1 so the last bucket does not overflow
+  return ((SubBucketCount + subBucket) << shift) + ((uint64_t(1) << shift) - 1);
+}
+
+void Histogram::record(uint64_t value) {
+  m_Buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  m_Sum.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t current = m_Min.load(std::memory_order_relaxed);
+  while (value < current &&
+         !m_Min.compare_exchange_weak(current, value,
+                                      std::memory_order_relaxed)) {
+  }
+  current = m_Max.load(std::memory_order_relaxed);
+  while (value > current &&
+         !m_Max.compare_exchange_weak(current, value,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+void Histogram::record(const std::chrono::nanoseconds &duration) {
+  record(static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0)));
+}
+
+uint64_t Histogram::count() const {
+  uint64_t count = 0;
+  for (const auto &bucket : m_Buckets) {
+    count += bucket.load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+uint64_t Histogram::valueAtQuantile(double quantile) const {
+  uint64_t total = count();
+  if (total == 0) {
+    return 0;
+  }
+
+  auto rank = static_cast<uint64_t>(
+      std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(total)));
+  rank = std::max<uint64_t>(rank, 1);
+
+  uint64_t cumulated = 0;
+  uint64_t min = m_Min.load(std::memory_order_relaxed);
+  uint64_t max = m_Max.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < BucketCount; i++) {
+    cumulated += m_Buckets[i].load(std::memory_order_relaxed);
+    if (cumulated >= rank) {
+      // The largest value of the bucket, but never outside what was recorded
+      return std::clamp(bucketUpperBound(i), min, std::max(min, max));
+    }
+  }
+  return max;
+}
+
+nlohmann::json Histogram::serialize() const {
+  uint64_t total = count();
+  if (total == 0) {
+    return {{"unit", m_Unit}, {"count", 0}};
+  }
+
+  return {{"unit", m_Unit},
+          {"count", total},
+          {"min", m_Min.load(std::memory_order_relaxed)},
+          {"max", m_Max.load(std::memory_order_relaxed)},
+          {"mean", static_cast<double>(m_Sum.load(std::memory_order_relaxed)) /
+                       static_cast<double>(total)},
+          {"p50", valueAtQuantile(0.5)},
+          {"p90", valueAtQuantile(0.9)},
+          {"p99", valueAtQuantile(0.99)},
+          {"p999", valueAtQuantile(0.999)}};
+}
+
+Metrics &Metrics::getInstance() {
+  static Metrics instance;
+  return instance;
+}
+
+Metrics::Metrics() : m_StartingTime(std::chrono::steady_clock::now()) {}
+
+std::shared_ptr<Counter> Metrics::counter(const std::string &name) {
+  std::lock_guard lock(m_MetricsMutex);
+  auto &counter = m_Counters[name];
+  if (!counter) {
+    counter = std::make_shared<Counter>();
+  }
+  return counter;
+}
+
+std::shared_ptr<Gauge> Metrics::gauge(const std::string &name) {
+  std::lock_guard lock(m_MetricsMutex);
+  auto &gauge = m_Gauges[name];
+  if (!gauge) {
+    gauge = std::make_shared<Gauge>();
+  }
+  return gauge;
+}
+
+std::shared_ptr<Histogram> Metrics::histogram(const std::string &name,
+                                              const std::string &unit) {
+  std::lock_guard lock(m_MetricsMutex);
+  auto &histogram = m_Histograms[name];
+  if (!histogram) {
+    histogram = std::make_shared<Histogram>(unit);
+  }
+  return histogram;
+}
+
+template <typename T>
+static void removeWithPrefix(std::map<std::string, T> &metrics,
+                             const std::string &prefix) {
+  auto it = metrics.lower_bound(prefix);
+  while (it != metrics.end() &&
+         it->first.compare(0, prefix.size(), prefix) == 0) {
+    it = metrics.erase(it);
+  }
+}
+
+void Metrics::remove(const std::string &prefix) {
+  std::lock_guard lock(m_MetricsMutex);
+  removeWithPrefix(m_Counters, prefix);
+  removeWithPrefix(m_Gauges, prefix);
+  removeWithPrefix(m_Histograms, prefix);
+}
+
+nlohmann::json Metrics::serialize() {
+  std::lock_guard lock(m_MetricsMutex);
+
+  nlohmann::json json;
+  json["uptime"] = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - m_StartingTime)
+                       .count();
+  json["timestamp"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+
+  json["counters"] = nlohmann::json::object();
+  for (const auto &[name, counter] : m_Counters) {
+    json["counters"][name] = counter->value();
+  }
+  json["gauges"] = nlohmann::json::object();
+  for (const auto &[name, gauge] : m_Gauges) {
+    json["gauges"][name] = gauge->value();
+  }
+  json["histograms"] = nlohmann::json::object();
+  for (const auto &[name, histogram] : m_Histograms) {
+    json["histograms"][name] = histogram->serialize();
+  }
+  return json;
+}
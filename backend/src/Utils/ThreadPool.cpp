@@ -0,0 +1,99 @@
+#include "Utils/ThreadPool.h"
+
+using namespace NEUROBIO_NAMESPACE::utils;
+
+ThreadPool::ThreadPool(size_t threadCount) : m_ThreadCount(threadCount) {
+  for (size_t i = 0; i < m_ThreadCount; i++) {
+    m_Workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock lock(m_Mutex);
+    m_IsStopping = true;
+  }
+  m_WorkAvailable.notify_all();
+  for (auto &worker : m_Workers) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::defaultThreadCount() {
+  size_t hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void ThreadPool::parallelFor(size_t count,
+                             const std::function<void(size_t)> &task) {
+  if (count == 0) {
+    return;
+  }
+  std::unique_lock parallelForLock(m_ParallelForMutex);
+
+  // Waking the workers is not worth it for a single task
+  bool hasWorkers = count > 1 && !m_Workers.empty();
+  {
+    std::unique_lock lock(m_Mutex);
+    m_Task = &task;
+    m_TaskCount = count;
+    m_NextIndex = 0;
+    m_Exceptions.assign(count, nullptr);
+    if (hasWorkers) {
+      m_BusyWorkers = m_Workers.size();
+      m_Generation++;
+    }
+  }
+  if (hasWorkers) {
+    m_WorkAvailable.notify_all();
+  }
+
+  runTasks();
+
+  {
+    std::unique_lock lock(m_Mutex);
+    m_WorkDone.wait(lock, [this]() { return m_BusyWorkers == 0; });
+    m_Task = nullptr;
+  }
+
+  for (const auto &exception : m_Exceptions) {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+}
+
+void ThreadPool::runTasks() {
+  for (size_t index = m_NextIndex++; index < m_TaskCount;
+       index = m_NextIndex++) {
+    try {
+      (*m_Task)(index);
+    } catch (...) {
+      m_Exceptions[index] = std::current_exception();
+    }
+  }
+}
+
+void ThreadPool::workerLoop() {
+  size_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock lock(m_Mutex);
+      m_WorkAvailable.wait(lock, [this, generation]() {
+        return m_IsStopping || m_Generation != generation;
+      });
+      if (m_IsStopping) {
+        return;
+      }
+      generation = m_Generation;
+    }
+
+    runTasks();
+
+    {
+      std::unique_lock lock(m_Mutex);
+      m_BusyWorkers--;
+    }
+    m_WorkDone.notify_all();
+  }
+}
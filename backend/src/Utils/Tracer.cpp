@@ -0,0 +1,96 @@
+#include "Utils/Tracer.h"
+
+#include <algorithm>
+
+using namespace NEUROBIO_NAMESPACE::utils;
+
+Tracer &Tracer::getInstance() {
+  static Tracer instance;
+  return instance;
+}
+
+Tracer::Tracer()
+    : m_IsEnabled(true), m_Epoch(std::chrono::steady_clock::now()),
+      m_SystemEpoch(std::chrono::system_clock::now()), m_NextThreadId(1) {}
+
+Tracer::ThreadBuffer::ThreadBuffer(uint32_t threadId)
+    : events(BufferSize), threadId(threadId), hasExited(false) {}
+
+Tracer::ThreadBufferHandle::~ThreadBufferHandle() {
+  if (buffer) {
+    buffer->hasExited = true;
+  }
+}
+
+void Tracer::setIsEnabled(bool isEnabled) { m_IsEnabled = isEnabled; }
+
+bool Tracer::isEnabled() const {
+  return m_IsEnabled.load(std::memory_order_relaxed);
+}
+
+Tracer::ThreadBuffer &Tracer::threadBuffer() {
+  thread_local ThreadBufferHandle handle;
+  if (!handle.buffer) {
+    std::lock_guard lock(m_BuffersMutex);
+    handle.buffer = std::make_shared<ThreadBuffer>(m_NextThreadId++);
+    m_Buffers.push_back(handle.buffer);
+  }
+  return *handle.buffer;
+}
+
+void Tracer::record(const char *name,
+                    const std::chrono::steady_clock::time_point &start,
+                    const std::chrono::steady_clock::time_point &end) {
+  auto &buffer = threadBuffer();
+  std::lock_guard lock(buffer.mutex);
+  buffer.events.push_back({name, start - m_Epoch, end - start});
+}
+
+void Tracer::clear() {
+  std::lock_guard lock(m_BuffersMutex);
+  for (auto &buffer : m_Buffers) {
+    std::lock_guard bufferLock(buffer->mutex);
+    buffer->events.clear();
+  }
+  m_Buffers.erase(std::remove_if(m_Buffers.begin(), m_Buffers.end(),
+                                 [](const auto &buffer) {
+                                   return buffer->hasExited.load();
+                                 }),
+                  m_Buffers.end());
+}
+
+nlohmann::json Tracer::serialize() {
+  auto toMicroseconds = [](const std::chrono::nanoseconds &duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  };
+
+  nlohmann::json events = nlohmann::json::array();
+  std::lock_guard lock(m_BuffersMutex);
+  for (auto &buffer : m_Buffers) {
+    std::lock_guard bufferLock(buffer->mutex);
+    for (const auto &event : buffer->events) {
+      events.push_back({{"name", event.name},
+                        {"ph", "X"},
+                        {"ts", toMicroseconds(event.start)},
+                        {"dur", toMicroseconds(event.duration)},
+                        {"pid", 1},
+                        {"tid", buffer->threadId}});
+    }
+  }
+
+  // The threads that exited will not record anything anymore
+  m_Buffers.erase(std::remove_if(m_Buffers.begin(), m_Buffers.end(),
+                                 [](const auto &buffer) {
+                                   return buffer->hasExited.load();
+                                 }),
+                  m_Buffers.end());
+
+  nlohmann::json json;
+  json["traceEvents"] = std::move(events);
+  json["displayTimeUnit"] = "ms";
+  json["otherData"] = {
+      {"starting_time", std::chrono::duration_cast<std::chrono::microseconds>(
+                            m_SystemEpoch.time_since_epoch())
+                            .count()}};
+  return json;
+}
@@ -1,6 +1,10 @@
+#include <atomic>
 #include <gtest/gtest.h>
+#include <thread>
 
+#include "Analyzer/AnalyzerSweep.h"
 #include "Analyzer/Analyzers.h"
+#include "Analyzer/BatchAnalysis.h"
 #include "Analyzer/CyclicTimedEventsAnalyzer.h"
 #include "Analyzer/EventConditions.h"
 #include "Data/FixedTimeSeries.h"
@@ -299,6 +303,34 @@ TEST(Analyzers, Prediction) {
   ASSERT_EQ(modelSecond.getTimeEventModel()[1], std::chrono::milliseconds(69));
 }
 
+TEST(Analyzers, ParallelPrediction) {
+  // Running the analyzers on worker threads gives exactly the same results as
+  // running them serially
+  analyzer::Analyzers serial(0);
+  analyzer::Analyzers parallel(4);
+  generateAnalyzers(serial);
+  generateAnalyzers(parallel);
+
+  auto data = generateData();
+  for (size_t i = 0; i < data.size(); i += 2) {
+    std::map<std::string, data::TimeSeries> frame = {
+        {"DelsysAnalogDataCollector", data.slice(i, i + 2)}};
+    auto expected = serial.predict(frame);
+    auto prediction = parallel.predict(frame);
+    ASSERT_EQ(prediction.size(), expected.size());
+    // The timestamps are relative to when each collection was created (and
+    // truncated to the microsecond)
+    auto offset = std::chrono::duration_cast<std::chrono::microseconds>(
+        prediction.getStartingTime() - expected.getStartingTime());
+    for (const auto &name : {"Left Foot", "Right Foot"}) {
+      auto difference = prediction[name].getTimeStamp() + offset -
+                        expected[name].getTimeStamp();
+      ASSERT_LE(std::abs(difference.count()), 1);
+      ASSERT_EQ(prediction[name].getData(), expected[name].getData());
+    }
+  }
+}
+
 TEST(Analyzers, serializeConfigurations) {
   analyzer::Analyzers analyzers;
   generateAnalyzers(analyzers);
@@ -328,4 +360,400 @@ TEST(Analyzers, serializeConfigurations) {
   ASSERT_EQ(serialized[0].at("events")[1].at("name"), "toe_off");
 
   ASSERT_EQ(serialized[1].at("name"), "Right Foot");
-}
\ No newline at end of file
+}
+
+TEST(Analyzers, serializeConfigurationsByName) {
+  analyzer::Analyzers analyzers;
+  generateAnalyzers(analyzers);
+  auto serialized = analyzers.getSerializedConfigurationsByName();
+
+  ASSERT_EQ(serialized.size(), 2);
+  ASSERT_EQ(serialized.at("Left Foot"),
+            analyzers.getSerializedConfigurations()[0]);
+  ASSERT_EQ(serialized.at("Right Foot").at("name"), "Right Foot");
+}
+
+TEST(Analyzers, ConcurrentRemove) {
+  // Only one of the clients removing the same analyzer at once succeeds, the
+  // others are told it does not exist
+  for (int repeat = 0; repeat < 50; repeat++) {
+    analyzer::Analyzers analyzers(0);
+    generateAnalyzers(analyzers);
+
+    std::atomic<int> removedCount(0);
+    std::atomic<int> missingCount(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+      threads.emplace_back([&]() {
+        try {
+          analyzers.remove("Left Foot");
+          removedCount++;
+        } catch (const std::invalid_argument &) {
+          missingCount++;
+        }
+        analyzers.getSerializedConfigurationsByName();
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    ASSERT_EQ(removedCount, 1);
+    ASSERT_EQ(missingCount, 3);
+    ASSERT_EQ(analyzers.size(), 1);
+  }
+
+  analyzer::Analyzers analyzers(0);
+  EXPECT_THROW(analyzers.remove(42), std::out_of_range);
+  ASSERT_EQ(analyzers.size(), 0);
+}
+
+TEST(Analyzers, AlignedPrediction) {
+  analyzer::Analyzers analyzers;
+  auto json = nlohmann::json::parse(R"({
+        "name" : "Aligned",
+        "analyzer_type" : "cyclic_timed_events",
+        "time_reference_device" : "DelsysAnalogDataCollector",
+        "learning_rate" : 0.5,
+        "initial_phase_durations" : [400, 600],
+        "alignment" : {"frequency" : 50},
+        "events" : [
+          {
+            "name" : "heel_strike",
+            "previous" : "toe_off",
+            "start_when" : [
+              {
+                "type": "threshold",
+                "device" : "DelsysAnalogDataCollector",
+                "channel" : 0,
+                "comparator" : ">=",
+                "value" : 0.2
+              }
+            ]
+          },
+          {
+            "name" : "toe_off",
+            "previous" : "heel_strike",
+            "start_when" : [
+              {
+                "type": "threshold",
+                "device" : "DelsysEmgDataCollector",
+                "channel" : 0,
+                "comparator" : ">=",
+                "value" : 0.2
+              }
+            ]
+          }
+        ]
+      })");
+  auto id = analyzers.add(json);
+  json["name"] = "Aligned Twin";
+  analyzers.add(json);
+
+  // The configuration is completed with the default interpolation
+  auto serialized = analyzers[id].getSerializedConfiguration();
+  ASSERT_EQ(serialized.at("alignment").at("frequency"), 50.0);
+  ASSERT_EQ(serialized.at("alignment").at("interpolation"), "linear");
+
+  // Predict from two devices at different rates. The time reference is now the
+  // aligned time base (20ms), whatever the rate of the reference device
+  auto analogs = generateData();
+  auto startingTime = analogs.getStartingTime();
+  auto emg = data::TimeSeries(startingTime);
+  for (size_t i = 0; i < analogs.size() * 5; i++) {
+    emg.add(std::chrono::microseconds(i * 2000), {std::cos(i / 50.0)});
+  }
+
+  auto prediction =
+      analyzers.predict({{"DelsysAnalogDataCollector", analogs.slice(0, 2)},
+                         {"DelsysEmgDataCollector", emg.slice(0, 10)}});
+  ASSERT_EQ(prediction["Aligned"].getTimeStamp(),
+            prediction["Aligned Twin"].getTimeStamp());
+  for (size_t i = 2; i < 200; i += 2) {
+    prediction = analyzers.predict(
+        {{"DelsysAnalogDataCollector", analogs.slice(i, i + 2)},
+         {"DelsysEmgDataCollector", emg.slice(i * 5, (i + 2) * 5)}});
+    auto timeStamp = prediction["Aligned"].getTimeStamp() -
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         startingTime - analyzers[id].getReferenceTime());
+    ASSERT_EQ(timeStamp.count() % 20000, 0);
+    ASSERT_EQ(prediction["Aligned"].getData()[0],
+              prediction["Aligned Twin"].getData()[0]);
+  }
+
+  // Removing the analyzers does not break the others
+  analyzers.remove("Aligned");
+  prediction = analyzers.predict(
+      {{"DelsysAnalogDataCollector", analogs.slice(200, 202)},
+       {"DelsysEmgDataCollector", emg.slice(1000, 1010)}});
+  ASSERT_EQ(analyzers.size(), 1);
+}
+
+TEST(BatchAnalysis, Analyze) {
+  analyzer::Analyzers analyzers(0);
+  generateAnalyzers(analyzers);
+  auto batch = analyzer::BatchAnalysis(analyzers.getSerializedConfigurations(),
+                                       std::chrono::milliseconds(20), 1, 4);
+
+  // The same trial analyzed alone or in parallel with others gives the same
+  // predictions
+  std::map<std::string, data::TimeSeries> trial = {
+      {"DelsysAnalogDataCollector", generateData()}};
+  auto expected = batch.analyze("Trial", trial);
+  ASSERT_EQ(expected.name, "Trial");
+  ASSERT_TRUE(expected.error.empty());
+  ASSERT_EQ(expected.sampleCount, 5000);
+  ASSERT_EQ(expected.trialDuration, std::chrono::milliseconds(49990));
+  ASSERT_EQ(expected.frameCount, 2500);
+  ASSERT_EQ(expected.failedFrameCount, 0);
+  ASSERT_GT(expected.processingTime.count(), 0);
+
+  for (const auto &name : {"Left Foot", "Right Foot"}) {
+    const auto &stream = expected.predictions.at(name);
+    ASSERT_GT(stream.size(), 100);
+    for (size_t i = 0; i < stream.size(); i++) {
+      ASSERT_GE(stream[i].getData()[0], 0.0);
+      ASSERT_LE(stream[i].getData()[0], 1.0);
+      if (i > 0) {
+        ASSERT_GT(stream[i].getTimeStamp(), stream[i - 1].getTimeStamp());
+      }
+    }
+  }
+
+  std::map<std::string, std::map<std::string, data::TimeSeries>> trials;
+  for (const auto &name : {"Trial 1", "Trial 2", "Trial 3", "Trial 4"}) {
+    trials[name] = trial;
+  }
+  auto results = batch.analyze(trials);
+  ASSERT_EQ(results.size(), 4);
+  for (const auto &result : results) {
+    ASSERT_TRUE(result.error.empty());
+    ASSERT_EQ(result.frameCount, expected.frameCount);
+    for (const auto &[name, stream] : expected.predictions) {
+      const auto &resultStream = result.predictions.at(name);
+      ASSERT_EQ(resultStream.size(), stream.size());
+      for (size_t i = 0; i < stream.size(); i++) {
+        ASSERT_EQ(resultStream[i].getTimeStamp(), stream[i].getTimeStamp());
+        ASSERT_EQ(resultStream[i].getData(), stream[i].getData());
+      }
+    }
+  }
+  ASSERT_EQ(results[0].name, "Trial 1");
+  ASSERT_EQ(results[3].name, "Trial 4");
+
+  auto serialized = expected.serialize();
+  ASSERT_EQ(serialized.at("frame_count"), 2500);
+  ASSERT_EQ(serialized.at("predictions").at("Left Foot").size(),
+            expected.predictions.at("Left Foot").size());
+}
+
+TEST(BatchAnalysis, ParallelTrials) {
+  analyzer::Analyzers analyzers(0);
+  generateAnalyzers(analyzers);
+  auto configurations = nlohmann::json::array();
+  for (const auto &configuration : analyzers.getSerializedConfigurations()) {
+    for (size_t i = 0; i < 4; i++) {
+      configurations.push_back(configuration);
+      configurations.back()["name"] =
+          configuration.at("name").get<std::string>() + " #" +
+          std::to_string(i);
+    }
+  }
+
+  // Each collection of analyzers numbers its own, whatever the others
+  analyzer::Analyzers other(0);
+  ASSERT_EQ(other.add(configurations[0]), 1);
+  ASSERT_EQ(other.add(configurations[1]), 2);
+
+  // Many trials with many analyzers each, analyzed on many threads at once,
+  // give the same predictions as each trial analyzed alone
+  auto batch = analyzer::BatchAnalysis(configurations,
+                                       std::chrono::milliseconds(20), 1, 8);
+  std::map<std::string, data::TimeSeries> trial = {
+      {"DelsysAnalogDataCollector", generateData()}};
+  auto expected = batch.analyze("Trial", trial);
+  ASSERT_EQ(expected.predictions.size(), 8);
+
+  std::map<std::string, std::map<std::string, data::TimeSeries>> trials;
+  for (size_t i = 0; i < 16; i++) {
+    trials["Trial " + std::to_string(i)] = trial;
+  }
+  auto results = batch.analyze(trials);
+  ASSERT_EQ(results.size(), 16);
+  for (const auto &result : results) {
+    ASSERT_TRUE(result.error.empty());
+    ASSERT_EQ(result.predictions.size(), 8);
+    for (const auto &[name, stream] : expected.predictions) {
+      const auto &resultStream = result.predictions.at(name);
+      ASSERT_EQ(resultStream.size(), stream.size());
+      for (size_t i = 0; i < stream.size(); i++) {
+        ASSERT_EQ(resultStream[i].getTimeStamp(), stream[i].getTimeStamp());
+        ASSERT_EQ(resultStream[i].getData(), stream[i].getData());
+      }
+    }
+  }
+}
+
+TEST(BatchAnalysis, Errors) {
+  analyzer::Analyzers analyzers(0);
+  generateAnalyzers(analyzers);
+  auto batch = analyzer::BatchAnalysis(analyzers.getSerializedConfigurations());
+
+  // A device without data cannot be analyzed
+  auto result = batch.analyze(
+      "Trial", {{"DelsysAnalogDataCollector", data::TimeSeries()}});
+  ASSERT_FALSE(result.error.empty());
+  ASSERT_EQ(result.frameCount, 0);
+
+  // Neither can a trial missing the device of the analyzers, which fails
+  // every frame
+  result = batch.analyze("Trial", {{"OtherDevice", generateData()}});
+  ASSERT_FALSE(result.error.empty());
+  ASSERT_EQ(result.failedFrameCount, result.frameCount);
+
+  EXPECT_THROW(analyzer::BatchAnalysis(nlohmann::json::object()),
+               std::exception);
+  EXPECT_THROW(analyzer::BatchAnalysis(analyzers.getSerializedConfigurations(),
+                                       std::chrono::microseconds(0)),
+               std::invalid_argument);
+}
+
+TEST(AnalyzerSweep, Parameters) {
+  auto combinations = analyzer::AnalyzerSweep::combineParameters(
+      nlohmann::json::parse(R"({"/b": [1, 2, 3], "/a": [true, false]})"));
+  ASSERT_EQ(combinations.size(), 6);
+  ASSERT_EQ(combinations[0], nlohmann::json::parse(R"({"/a":true,"/b":1})"));
+  ASSERT_EQ(combinations[1], nlohmann::json::parse(R"({"/a":true,"/b":2})"));
+  ASSERT_EQ(combinations[5], nlohmann::json::parse(R"({"/a":false,"/b":3})"));
+
+  auto base = nlohmann::json::parse(R"({"name": "Base", "a": 0, "b": [0]})");
+  auto configurations = analyzer::AnalyzerSweep::makeConfigurations(
+      base, analyzer::AnalyzerSweep::combineParameters(
+                nlohmann::json::parse(R"({"/a": [1, 2], "/b/0": [3]})")));
+  ASSERT_EQ(configurations.size(), 2);
+  ASSERT_EQ(configurations[1],
+            nlohmann::json::parse(R"({"name": "Base #1", "a": 2, "b": [3]})"));
+
+  EXPECT_THROW(analyzer::AnalyzerSweep::combineParameters(
+                   nlohmann::json::parse(R"({"/a": []})")),
+               std::invalid_argument);
+  EXPECT_THROW(analyzer::AnalyzerSweep::makeConfigurations(
+                   base, {nlohmann::json::parse(R"({"/c": 1})")}),
+               std::invalid_argument);
+}
+
+TEST(AnalyzerSweep, Sweep) {
+  analyzer::Analyzers analyzers(0);
+  generateAnalyzers(analyzers);
+  auto base = analyzers.getSerializedConfigurations()[0];
+  auto parameters = nlohmann::json::parse(R"({
+    "/learning_rate": [0.1, 0.5],
+    "/events/0/start_when/0/value": [0.1, 0.2, 0.3]
+  })");
+  auto sweep = analyzer::AnalyzerSweep(
+      base, parameters, std::chrono::milliseconds(20), 1, 2);
+  ASSERT_EQ(sweep.getAnalyzerConfigurations().size(), 6);
+
+  std::map<std::string, data::TimeSeries> trial = {
+      {"DelsysAnalogDataCollector", generateData()}};
+  auto result = sweep.sweep("Trial", trial, true);
+  ASSERT_TRUE(result.analysis.error.empty());
+  ASSERT_EQ(result.analysis.frameCount, 2500);
+  ASSERT_EQ(result.analysis.sampleCount, 5000);
+  ASSERT_EQ(result.entries.size(), 6);
+  ASSERT_EQ(result.analysis.predictions.size(), 6);
+
+  // Each configuration gives the same results as if it was analyzed alone
+  for (size_t i = 0; i < result.entries.size(); i++) {
+    const auto &entry = result.entries[i];
+    const auto &configuration = sweep.getAnalyzerConfigurations()[i];
+    ASSERT_EQ(entry.name, "Left Foot #" + std::to_string(i));
+    ASSERT_EQ(entry.parameters, sweep.getParameterSets()[i]);
+
+    auto alone = analyzer::BatchAnalysis(configuration,
+                                         std::chrono::milliseconds(20), 1, 0)
+                     .analyze("Trial", trial);
+    const auto &expected = alone.predictions.at(entry.name);
+    const auto &stream = result.analysis.predictions.at(entry.name);
+    ASSERT_EQ(entry.predictionCount, expected.size());
+    ASSERT_EQ(stream.size(), expected.size());
+    for (size_t j = 0; j < expected.size(); j++) {
+      ASSERT_EQ(stream[j].getTimeStamp(), expected[j].getTimeStamp());
+      ASSERT_EQ(stream[j].getData(), expected[j].getData());
+    }
+    ASSERT_EQ(entry.lastPredictionTime, expected.back().getTimeStamp());
+    ASSERT_GT(entry.phaseChangeCount, 0);
+  }
+
+  // Without keeping the predictions, only the table is filled
+  auto summary = sweep.sweep("Trial", trial);
+  ASSERT_TRUE(summary.analysis.predictions.empty());
+  for (size_t i = 0; i < summary.entries.size(); i++) {
+    ASSERT_EQ(summary.entries[i].predictionCount,
+              result.entries[i].predictionCount);
+    ASSERT_EQ(summary.entries[i].phaseChangeCount,
+              result.entries[i].phaseChangeCount);
+  }
+  ASSERT_EQ(summary.serialize().at("entries").size(), 6);
+}
+
+TEST(AnalyzerSweep, ParallelGroups) {
+  analyzer::Analyzers analyzers(0);
+  generateAnalyzers(analyzers);
+  auto base = analyzers.getSerializedConfigurations()[0];
+  auto parameters = nlohmann::json::parse(R"({
+    "/learning_rate": [0.1, 0.3, 0.5],
+    "/events/0/start_when/0/value": [0.05, 0.1, 0.2, 0.3]
+  })");
+  std::map<std::string, data::TimeSeries> trial = {
+      {"DelsysAnalogDataCollector", generateData()}};
+
+  // Each entry gets the predictions of its own configuration, whatever the
+  // number of groups replaying the trial at once
+  auto expected = analyzer::AnalyzerSweep(base, parameters,
+                                          std::chrono::milliseconds(20), 1, 0)
+                      .sweep("Trial", trial);
+  auto sweep = analyzer::AnalyzerSweep(base, parameters,
+                                       std::chrono::milliseconds(20), 1, 8);
+  for (size_t repeat = 0; repeat < 4; repeat++) {
+    auto result = sweep.sweep("Trial", trial);
+    ASSERT_TRUE(result.analysis.error.empty());
+    ASSERT_EQ(result.entries.size(), 12);
+    for (size_t i = 0; i < result.entries.size(); i++) {
+      const auto &entry = result.entries[i];
+      ASSERT_EQ(entry.name, expected.entries[i].name);
+      ASSERT_EQ(entry.predictionCount, expected.entries[i].predictionCount);
+      ASSERT_EQ(entry.phaseChangeCount, expected.entries[i].phaseChangeCount);
+      ASSERT_EQ(entry.lastPredictionTime,
+                expected.entries[i].lastPredictionTime);
+    }
+  }
+}
+
+TEST(AnalyzerSweep, FailingConfiguration) {
+  analyzer::Analyzers analyzers(0);
+  generateAnalyzers(analyzers);
+  auto base = analyzers.getSerializedConfigurations()[0];
+  auto parameters = nlohmann::json::parse(R"({
+    "/events/0/start_when/0/channel": [0, 5, 0]
+  })");
+  std::map<std::string, data::TimeSeries> trial = {
+      {"DelsysAnalogDataCollector", generateData()}};
+
+  // The configuration reading a missing channel fails on its own, even when
+  // it shares its group with the others
+  auto result = analyzer::AnalyzerSweep(base, parameters,
+                                        std::chrono::milliseconds(20), 1, 0)
+                    .sweep("Trial", trial);
+  ASSERT_FALSE(result.analysis.error.empty());
+  ASSERT_EQ(result.analysis.frameCount, 2500);
+  ASSERT_EQ(result.entries[0].failedFrameCount, 0);
+  ASSERT_GT(result.entries[1].failedFrameCount, 0);
+  ASSERT_EQ(result.entries[2].failedFrameCount, 0);
+  ASSERT_EQ(result.analysis.failedFrameCount,
+            result.entries[1].failedFrameCount);
+  ASSERT_GT(result.entries[0].predictionCount, 0);
+  ASSERT_EQ(result.entries[2].predictionCount,
+            result.entries[0].predictionCount);
+  ASSERT_EQ(result.serialize().at("entries")[1].at("failed_frame_count"),
+            result.entries[1].failedFrameCount);
+}
@@ -1,9 +1,22 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <limits>
+#include <random>
 #include <thread>
 
+#include "Data/ClockModel.h"
+#include "Data/EmgFeaturesStage.h"
+#include "Data/FilterBankStage.h"
 #include "Data/FixedTimeSeries.h"
+#include "Data/TimeAligner.h"
 #include "Data/TimeSeries.h"
+#include "Data/TimeSeriesCodec.h"
+#include "Data/TrialFile.h"
 
 #include "utils.h"
 
@@ -303,3 +316,606 @@ TEST(FixedTimeSeries, Constructors) {
     ASSERT_EQ(data[1].getTimeStamp(), std::chrono::microseconds(0 + 100));
   }
 }
+
+TEST(ClockModel, Disabled) {
+  auto clock = data::ClockModel();
+  ASSERT_FALSE(clock.isEnabled());
+
+  clock.observe(10, std::chrono::high_resolution_clock::now());
+  ASSERT_EQ(clock.getObservationCount(), 0);
+  ASSERT_EQ(clock.getSkew(), 0.0);
+}
+
+TEST(ClockModel, NominalPeriodAsPrior) {
+  auto clock = data::ClockModel(std::chrono::microseconds(500));
+  ASSERT_TRUE(clock.isEnabled());
+
+  auto start = std::chrono::high_resolution_clock::time_point(
+      std::chrono::seconds(1000));
+  clock.observe(26, start);
+  ASSERT_EQ(clock.getObservationCount(), 1);
+  ASSERT_NEAR(clock.getSkew(), 0.0, requiredPrecision);
+  ASSERT_EQ(std::chrono::duration_cast<std::chrono::microseconds>(
+                clock.timeOf(0) - start),
+            std::chrono::microseconds(-26 * 500));
+  ASSERT_EQ(std::chrono::duration_cast<std::chrono::microseconds>(
+                clock.timeOf(27) - start),
+            std::chrono::microseconds(500));
+}
+
+TEST(ClockModel, DriftEstimation) {
+  // The device announces 2000Hz, but its clock runs 100 ppm slow. The frames
+  // of 27 samples arrive with up to 2 ms of jitter
+  auto clock = data::ClockModel(std::chrono::microseconds(500));
+  double truePeriod = 500.0 * (1.0 + 100e-6);
+  auto start = std::chrono::high_resolution_clock::time_point(
+      std::chrono::seconds(1000));
+  auto trueTimeOf = [&](size_t index) {
+    return start + std::chrono::duration_cast<
+                       std::chrono::high_resolution_clock::duration>(
+                       std::chrono::duration<double, std::micro>(
+                           truePeriod * static_cast<double>(index)));
+  };
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> jitter(0.0, 2000.0);
+  size_t frameCount = 3000;
+  for (size_t i = 0; i < frameCount; i++) {
+    size_t lastIndex = (i + 1) * 27 - 1;
+    clock.observe(lastIndex,
+                  trueTimeOf(lastIndex) +
+                      std::chrono::duration_cast<
+                          std::chrono::high_resolution_clock::duration>(
+                          std::chrono::duration<double, std::micro>(
+                              jitter(generator))));
+  }
+  ASSERT_EQ(clock.getObservationCount(), frameCount);
+  ASSERT_NEAR(clock.getSkew(), 100.0, 10.0);
+  ASSERT_NEAR(clock.getEstimatedPeriod(), truePeriod, 0.005);
+
+  // The reconstructed timestamps are on a regular grid, only offset by the
+  // mean latency of the arrivals
+  size_t lastIndex = frameCount * 27 - 1;
+  for (size_t index = lastIndex - 1000; index < lastIndex; index++) {
+    auto error = std::chrono::duration<double, std::micro>(clock.timeOf(index) -
+                                                           trueTimeOf(index))
+                     .count();
+    ASSERT_NEAR(error, 1000.0, 150.0);
+  }
+}
+
+TEST(ClockModel, Stamp) {
+  auto clock = data::ClockModel(std::chrono::microseconds(500));
+  auto start = std::chrono::high_resolution_clock::time_point(
+      std::chrono::seconds(1000));
+
+  // The first frame arrives late, so the model is corrected by the second
+  clock.observe(9, start + std::chrono::microseconds(9 * 500 + 2000));
+  std::vector<std::chrono::high_resolution_clock::time_point> stamps;
+  for (size_t i = 0; i < 10; i++) {
+    stamps.push_back(clock.stamp(i));
+  }
+  clock.observe(19, start + std::chrono::microseconds(19 * 500));
+  ASSERT_LT(clock.timeOf(10), stamps.back());
+  for (size_t i = 10; i < 20; i++) {
+    stamps.push_back(clock.stamp(i));
+  }
+
+  // The correction is spread over the samples instead of going backward
+  for (size_t i = 1; i < stamps.size(); i++) {
+    auto deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(
+        stamps[i] - stamps[i - 1]);
+    ASSERT_GE(deltaTime, std::chrono::microseconds(474));
+    ASSERT_LE(deltaTime, std::chrono::microseconds(526));
+  }
+  ASSERT_LT(stamps.back(), stamps[9] + std::chrono::microseconds(10 * 500));
+}
+
+TEST(ClockModel, Resynchronize) {
+  auto clock = data::ClockModel(std::chrono::microseconds(500));
+  auto start = std::chrono::high_resolution_clock::time_point(
+      std::chrono::seconds(1000));
+  for (size_t i = 1; i <= 10; i++) {
+    clock.observe(i * 10, start + std::chrono::microseconds(i * 10 * 500));
+  }
+  ASSERT_EQ(clock.getObservationCount(), 10);
+
+  // The samples stopped for 5 seconds without the counter knowing it
+  auto restart = start + std::chrono::seconds(5);
+  clock.observe(110, restart);
+  ASSERT_EQ(clock.getObservationCount(), 1);
+  ASSERT_EQ(clock.timeOf(110), restart);
+  ASSERT_NEAR(clock.getSkew(), 0.0, requiredPrecision);
+}
+
+std::map<std::string, data::TimeSeries> generateUnalignedData() {
+  // The first device is at 1000Hz and its value is the time in ms, the second
+  // is at 333Hz, starts 300us later and its value is twice the time in ms
+  auto startingTime =
+      std::chrono::system_clock::time_point(std::chrono::seconds(1000));
+  auto fast = data::TimeSeries(startingTime);
+  for (int i = 0; i < 100; i++) {
+    fast.add(std::chrono::microseconds(i * 1000), {static_cast<double>(i)});
+  }
+  auto slow = data::TimeSeries(startingTime + std::chrono::microseconds(300));
+  for (int i = 0; i < 33; i++) {
+    slow.add(std::chrono::microseconds(i * 3000), {2.0 * (i * 3.0 + 0.3)});
+  }
+  return {{"Fast", fast}, {"Slow", slow}};
+}
+
+TEST(TimeAligner, Linear) {
+  auto data = generateUnalignedData();
+  auto aligner = data::TimeAligner(std::chrono::microseconds(1000));
+  ASSERT_EQ(aligner.update(data), 97);
+  ASSERT_EQ(aligner.getAlignedCount(), 97);
+
+  // Both devices are on the same time base, starting when the slowest started
+  const auto &fast = aligner.getAlignedData().at("Fast");
+  const auto &slow = aligner.getAlignedData().at("Slow");
+  ASSERT_EQ(fast.size(), 97);
+  ASSERT_EQ(slow.size(), 97);
+  ASSERT_EQ(fast.getStartingTime(), data.at("Slow").getStartingTime());
+  ASSERT_EQ(slow.getStartingTime(), data.at("Slow").getStartingTime());
+  for (size_t i = 0; i < fast.size(); i++) {
+    ASSERT_EQ(fast[i].getTimeStamp(), std::chrono::microseconds(i * 1000));
+    ASSERT_EQ(slow[i].getTimeStamp(), std::chrono::microseconds(i * 1000));
+    ASSERT_NEAR(fast[i].getData()[0], i + 0.3, requiredPrecision);
+    ASSERT_NEAR(slow[i].getData()[0], 2.0 * (i + 0.3), requiredPrecision);
+  }
+
+  // Nothing new was added, so nothing new is aligned
+  ASSERT_EQ(aligner.update(data), 0);
+  ASSERT_EQ(aligner.getAlignedCount(), 97);
+}
+
+TEST(TimeAligner, ZeroOrderHold) {
+  auto data = generateUnalignedData();
+  auto aligner = data::TimeAligner(nlohmann::json::parse(
+      R"({"frequency": 1000, "interpolation": "zero_order_hold"})"));
+  ASSERT_EQ(aligner.getPeriod(), std::chrono::microseconds(1000));
+  ASSERT_EQ(aligner.getSerializedConfiguration().at("interpolation"),
+            "zero_order_hold");
+  ASSERT_EQ(aligner.update(data), 97);
+
+  const auto &fast = aligner.getAlignedData().at("Fast");
+  const auto &slow = aligner.getAlignedData().at("Slow");
+  for (size_t i = 0; i < fast.size(); i++) {
+    ASSERT_NEAR(fast[i].getData()[0], static_cast<double>(i),
+                requiredPrecision);
+    ASSERT_NEAR(slow[i].getData()[0], 2.0 * ((i / 3) * 3.0 + 0.3),
+                requiredPrecision);
+  }
+}
+
+TEST(TimeAligner, Incremental) {
+  auto data = generateUnalignedData();
+  auto expected = data::TimeAligner(std::chrono::microseconds(1000));
+  expected.update(data);
+
+  // Send the data as small rolling windows, as the live data would be
+  auto aligner = data::TimeAligner(std::chrono::microseconds(1000));
+  auto fast = data::TimeSeries(data.at("Fast").getStartingTime());
+  fast.setRollingVectorMaxSize(10);
+  auto slow = data::TimeSeries(data.at("Slow").getStartingTime());
+  slow.setRollingVectorMaxSize(10);
+  size_t alignedCount = 0;
+  for (size_t i = 0; i < data.at("Fast").size(); i++) {
+    const auto &point = data.at("Fast")[i];
+    fast.add(point.getTimeStamp(), point.getData());
+    if (i % 3 == 0 && i / 3 < data.at("Slow").size()) {
+      const auto &slowPoint = data.at("Slow")[i / 3];
+      slow.add(slowPoint.getTimeStamp(), slowPoint.getData());
+    }
+    alignedCount += aligner.update({{"Fast", fast}, {"Slow", slow}});
+  }
+  ASSERT_EQ(alignedCount, 97);
+
+  for (const auto &name : {"Fast", "Slow"}) {
+    const auto &alignedData = aligner.getAlignedData().at(name);
+    const auto &expectedData = expected.getAlignedData().at(name);
+    ASSERT_EQ(alignedData.size(), expectedData.size());
+    for (size_t i = 0; i < alignedData.size(); i++) {
+      ASSERT_EQ(alignedData[i].getTimeStamp(), expectedData[i].getTimeStamp());
+      ASSERT_NEAR(alignedData[i].getData()[0], expectedData[i].getData()[0],
+                  requiredPrecision);
+    }
+  }
+}
+
+TEST(TimeAligner, WaitForAllDevices) {
+  auto data = generateUnalignedData();
+  auto aligner = data::TimeAligner(std::chrono::microseconds(1000));
+  data["Empty"] = data::TimeSeries();
+  ASSERT_EQ(aligner.update(data), 0);
+  ASSERT_EQ(aligner.getAlignedCount(), 0);
+
+  // Once the device is gone, the others can be aligned
+  data.erase("Empty");
+  ASSERT_EQ(aligner.update(data), 97);
+  ASSERT_EQ(aligner.getAlignedData().size(), 2);
+
+  aligner.reset();
+  ASSERT_EQ(aligner.getAlignedCount(), 0);
+  ASSERT_EQ(aligner.getAlignedData().size(), 0);
+}
+
+TEST(EmgFeaturesStage, Features) {
+  size_t channelCount(3);
+  size_t windowSize(20);
+  size_t decimation(7);
+  double threshold(0.1);
+  auto stage =
+      data::EmgFeaturesStage(channelCount, windowSize, decimation, threshold);
+  ASSERT_EQ(stage.getName(), "EmgFeatures");
+  ASSERT_EQ(stage.getOutput().size(), 5 * channelCount);
+
+  std::mt19937 generator(42);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::vector<std::vector<double>> samples;
+  for (size_t i = 0; i < 500; i++) {
+    std::vector<double> sample(channelCount);
+    for (size_t j = 0; j < channelCount; j++) {
+      sample[j] = std::sin(0.1 * (j + 1) * i) + 0.3 * noise(generator);
+    }
+    auto processed = sample;
+    bool hasOutput = stage.process(processed);
+    ASSERT_EQ(processed, sample);
+    samples.push_back(sample);
+    ASSERT_EQ(hasOutput, samples.size() % decimation == 0);
+    if (!hasOutput) {
+      continue;
+    }
+
+    // Compare with the features computed from scratch on the window
+    size_t first =
+        samples.size() > windowSize ? samples.size() - windowSize : 0;
+    double count = static_cast<double>(samples.size() - first);
+    for (size_t j = 0; j < channelCount; j++) {
+      double sumSquares = 0.0;
+      double sumAbsolutes = 0.0;
+      double length = 0.0;
+      double zeroCrossings = 0.0;
+      double slopeSignChanges = 0.0;
+      for (size_t k = first; k < samples.size(); k++) {
+        double x = samples[k][j];
+        sumSquares += x * x;
+        sumAbsolutes += std::abs(x);
+        if (k < 1) {
+          continue;
+        }
+        double previous = samples[k - 1][j];
+        length += std::abs(x - previous);
+        if (x * previous < 0.0 && std::abs(x - previous) >= threshold) {
+          zeroCrossings++;
+        }
+        if (k < 2) {
+          continue;
+        }
+        double beforePrevious = samples[k - 2][j];
+        if ((previous - beforePrevious) * (previous - x) > threshold) {
+          slopeSignChanges++;
+        }
+      }
+
+      const auto &output = stage.getOutput();
+      ASSERT_NEAR(output[stage.outputIndex(data::EmgFeature::RMS, j)],
+                  std::sqrt(sumSquares / count), requiredPrecision);
+      ASSERT_NEAR(output[stage.outputIndex(data::EmgFeature::MAV, j)],
+                  sumAbsolutes / count, requiredPrecision);
+      ASSERT_NEAR(output[stage.outputIndex(data::EmgFeature::WL, j)], length,
+                  requiredPrecision);
+      ASSERT_DOUBLE_EQ(output[stage.outputIndex(data::EmgFeature::ZC, j)],
+                       zeroCrossings);
+      ASSERT_DOUBLE_EQ(output[stage.outputIndex(data::EmgFeature::SSC, j)],
+                       slopeSignChanges);
+    }
+  }
+
+  // After a reset, the previous samples are forgotten
+  stage.reset();
+  ASSERT_EQ(stage.getSampleCount(), 0);
+  for (size_t i = 0; i < decimation; i++) {
+    std::vector<double> sample(channelCount, 2.0);
+    stage.process(sample);
+  }
+  for (size_t j = 0; j < channelCount; j++) {
+    const auto &output = stage.getOutput();
+    ASSERT_NEAR(output[stage.outputIndex(data::EmgFeature::RMS, j)], 2.0,
+                requiredPrecision);
+    ASSERT_NEAR(output[stage.outputIndex(data::EmgFeature::WL, j)], 0.0,
+                requiredPrecision);
+  }
+}
+
+TEST(EmgFeaturesStage, WrongChannelCount) {
+  auto stage = data::EmgFeaturesStage(3);
+  std::vector<double> sample(2, 0.0);
+  EXPECT_THROW(stage.process(sample), std::invalid_argument);
+}
+
+std::vector<double> filterSine(data::FilterBankStage &stage, double frequency,
+                               double samplingFrequency, size_t count) {
+  // Returns the amplitude of the output once the transient is gone, computed
+  // from its root mean square (the second half must hold whole periods)
+  std::vector<double> sumSquares(stage.getChannelCount(), 0.0);
+  for (size_t i = 0; i < count; i++) {
+    double value = std::sin(2.0 * M_PI * frequency * i / samplingFrequency);
+    std::vector<double> sample(stage.getChannelCount(), value);
+    stage.process(sample);
+    if (i < count / 2) {
+      continue;
+    }
+    for (size_t j = 0; j < sample.size(); j++) {
+      sumSquares[j] += sample[j] * sample[j];
+    }
+  }
+
+  std::vector<double> amplitudes;
+  for (auto sumSquare : sumSquares) {
+    amplitudes.push_back(std::sqrt(2.0 * sumSquare / (count - count / 2)));
+  }
+  return amplitudes;
+}
+
+TEST(FilterBankStage, Filters) {
+  double samplingFrequency(2000.0);
+
+  {
+    auto stage = data::FilterBankStage("Filters", 4);
+    stage.addFilter(data::Biquad::lowPass(100.0, samplingFrequency));
+    ASSERT_NEAR(filterSine(stage, 10.0, samplingFrequency, 4000)[0], 1.0,
+                1e-2);
+    stage.reset();
+    ASSERT_LT(filterSine(stage, 800.0, samplingFrequency, 4000)[0], 0.05);
+  }
+
+  {
+    auto stage = data::FilterBankStage("Filters", 4);
+    stage.addFilter(data::Biquad::highPass(100.0, samplingFrequency));
+    ASSERT_LT(filterSine(stage, 5.0, samplingFrequency, 4000)[0], 0.01);
+    stage.reset();
+    ASSERT_NEAR(filterSine(stage, 800.0, samplingFrequency, 4000)[0], 1.0,
+                1e-2);
+  }
+
+  {
+    auto stage = data::FilterBankStage("Filters", 4);
+    stage.addFilter(data::Biquad::notch(60.0, samplingFrequency));
+    ASSERT_LT(filterSine(stage, 60.0, samplingFrequency, 20000)[0], 0.01);
+    stage.reset();
+    ASSERT_GT(filterSine(stage, 200.0, samplingFrequency, 20000)[0], 0.99);
+  }
+
+  EXPECT_THROW(data::Biquad::lowPass(1000.0, samplingFrequency),
+               std::invalid_argument);
+  EXPECT_THROW(data::Biquad::lowPass(0.0, samplingFrequency),
+               std::invalid_argument);
+}
+
+TEST(FilterBankStage, IndependentChannels) {
+  // Filtering several channels at once gives the same result as filtering
+  // each of them alone
+  auto config = nlohmann::json::parse(R"({
+    "name": "Filters",
+    "sampling_frequency": 2000,
+    "steps": [
+      {"type": "band_pass", "low": 20, "high": 450},
+      {"type": "notch", "frequency": 60},
+      {"type": "rectify"},
+      {"type": "low_pass", "frequency": 6}
+    ]
+  })");
+  size_t channelCount(5);
+  auto stage = data::FilterBankStage(channelCount, config);
+  std::vector<data::FilterBankStage> singleStages;
+  for (size_t j = 0; j < channelCount; j++) {
+    singleStages.push_back(data::FilterBankStage(1, config));
+  }
+
+  std::mt19937 generator(42);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  for (size_t i = 0; i < 1000; i++) {
+    std::vector<double> sample(channelCount);
+    for (size_t j = 0; j < channelCount; j++) {
+      sample[j] = noise(generator);
+    }
+    auto filtered = sample;
+    ASSERT_FALSE(stage.process(filtered));
+    for (size_t j = 0; j < channelCount; j++) {
+      std::vector<double> single = {sample[j]};
+      singleStages[j].process(single);
+      ASSERT_DOUBLE_EQ(filtered[j], single[0]);
+    }
+  }
+}
+
+TEST(FilterBankStage, Envelope) {
+  auto config = nlohmann::json::parse(R"({
+    "name": "Envelope",
+    "sampling_frequency": 2000,
+    "in_place": false,
+    "decimation": 20,
+    "steps": [{"type": "rectify"}, {"type": "low_pass", "frequency": 6}]
+  })");
+  auto stage = data::FilterBankStage(2, config);
+  ASSERT_EQ(stage.getName(), "Envelope");
+  ASSERT_FALSE(stage.getIsInPlace());
+  ASSERT_EQ(stage.getDecimation(), 20);
+
+  // The envelope of a sine is its mean absolute value (2 / pi * amplitude),
+  // while the samples themselves are left untouched
+  for (size_t i = 0; i < 4000; i++) {
+    double value = std::sin(2.0 * M_PI * 100.0 * i / 2000.0);
+    std::vector<double> sample = {value, 2.0 * value};
+    bool hasOutput = stage.process(sample);
+    ASSERT_EQ(hasOutput, (i + 1) % 20 == 0);
+    ASSERT_DOUBLE_EQ(sample[0], value);
+    ASSERT_DOUBLE_EQ(sample[1], 2.0 * value);
+  }
+  ASSERT_NEAR(stage.getOutput()[0], 2.0 / M_PI, 1e-2);
+  ASSERT_NEAR(stage.getOutput()[1], 4.0 / M_PI, 2e-2);
+
+  config["steps"] = {{{"type", "unknown"}}};
+  EXPECT_THROW(data::FilterBankStage(2, config), std::invalid_argument);
+}
+
+TEST(TrialFile, SaveAndLoad) {
+  auto startingTime = std::chrono::system_clock::time_point(
+      std::chrono::microseconds(1700000000123456));
+  auto analogs = data::TimeSeries(startingTime);
+  auto emg = data::TimeSeries(startingTime + std::chrono::milliseconds(3));
+  for (size_t i = 0; i < 100; i++) {
+    analogs.add(std::chrono::microseconds(i * 10000),
+                {std::sin(i / 10.0), -1.0 / (i + 1)});
+    emg.add(std::chrono::microseconds(i * 500), {std::cos(i / 3.0)});
+  }
+  std::map<std::string, data::TimeSeries> trial = {
+      {"DelsysAnalogDataCollector", analogs},
+      {"DelsysEmgDataCollector", emg},
+      {"Empty", data::TimeSeries(startingTime)}};
+
+  // The compressed files hold exactly the same data
+  std::string path("trial_file_test.bin");
+  for (bool isCompressed : {false, true}) {
+    data::TrialFile::save(path, trial, isCompressed);
+    auto loaded = data::TrialFile::load(path);
+    std::remove(path.c_str());
+
+    ASSERT_EQ(loaded.size(), 3);
+    for (const auto &[name, data] : trial) {
+      const auto &loadedData = loaded.at(name);
+      ASSERT_EQ(loadedData.getStartingTime(), data.getStartingTime());
+      ASSERT_EQ(loadedData.size(), data.size());
+      for (size_t i = 0; i < data.size(); i++) {
+        ASSERT_EQ(loadedData[i].getTimeStamp(), data[i].getTimeStamp());
+        ASSERT_EQ(loadedData[i].getData(), data[i].getData());
+      }
+    }
+  }
+}
+
+TEST(TrialFile, InvalidFile) {
+  EXPECT_THROW(data::TrialFile::load("trial_file_which_does_not_exist.bin"),
+               std::runtime_error);
+
+  std::string path("trial_file_test_invalid.bin");
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "This is not a trial file";
+  }
+  EXPECT_THROW(data::TrialFile::load(path), std::runtime_error);
+
+  // A truncated file is detected
+  auto data = data::TimeSeries();
+  data.add(std::chrono::microseconds(0), {1.0, 2.0});
+  data::TrialFile::save(path, {{"Device", data}});
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+  EXPECT_THROW(data::TrialFile::load(path), std::runtime_error);
+
+  // So are corrupted counts, before the samples are allocated
+  for (auto [offset, size] :
+       std::vector<std::pair<std::streamoff, size_t>>{{30, 8}, {38, 4}}) {
+    data::TrialFile::save(path, {{"Device", data}}, false);
+    {
+      std::fstream file(path,
+                        std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(offset);
+      file.write(std::string(size, '\xFF').data(), size);
+    }
+    EXPECT_THROW(data::TrialFile::load(path), std::runtime_error);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(TimeSeriesCodec, EncodeAndDecode) {
+  auto startingTime = std::chrono::system_clock::time_point(
+      std::chrono::microseconds(1700000000123456));
+
+  // The Delsys devices send float32 values at a constant rate, with some
+  // jitter, gaps and special values thrown in
+  std::mt19937 generator(42);
+  std::normal_distribution<float> noise(0.0f, 0.01f);
+  auto data = data::TimeSeries(startingTime);
+  int64_t timeStamp = -1000;
+  for (size_t i = 0; i < 2000; i++) {
+    timeStamp += i % 100 == 0 ? 500 + i : (i % 7 == 0 ? 499 : 500);
+    if (i == 1000) {
+      timeStamp += 10000000000;
+    }
+    double special = i % 50 == 0   ? std::nan("")
+                     : i % 51 == 0 ? -std::numeric_limits<double>::infinity()
+                                   : std::sin(i / 10.0);
+    data.add(std::chrono::microseconds(timeStamp),
+             {static_cast<double>(noise(generator)), 0.0, 1.0 / 3, special});
+  }
+
+  std::vector<char> buffer = {'x'};
+  data::TimeSeriesCodec::encode(data, buffer);
+  size_t position = 1;
+  auto decoded = data::TimeSeriesCodec::decode(buffer, position, startingTime);
+  ASSERT_EQ(position, buffer.size());
+  ASSERT_EQ(decoded.getStartingTime(), startingTime);
+  ASSERT_EQ(decoded.size(), data.size());
+  for (size_t i = 0; i < data.size(); i++) {
+    ASSERT_EQ(decoded[i].getTimeStamp(), data[i].getTimeStamp());
+    // The values are compared bit for bit, so the NaNs are too
+    ASSERT_EQ(std::memcmp(decoded[i].getData().data(),
+                          data[i].getData().data(), 4 * sizeof(double)),
+              0);
+  }
+
+  // The samples take much less than their 8 bytes per value and timestamp
+  ASSERT_LT(buffer.size(), data.size() * 5 * 8 / 2);
+
+  // A constant signal at a constant rate takes about a bit per value
+  auto constant = data::TimeSeries(startingTime);
+  for (size_t i = 0; i < 1000; i++) {
+    constant.add(std::chrono::microseconds(i * 500),
+                 std::vector<double>(16, 0.25));
+  }
+  buffer.clear();
+  data::TimeSeriesCodec::encode(constant, buffer);
+  ASSERT_LT(buffer.size(), 1000 * 17 / 8 + 100);
+
+  // Only the selected channels of one sample out of a few are compressed, in
+  // the order of the selection, and the channels the samples lack are left out
+  buffer.clear();
+  data::TimeSeriesCodec::encode(data, buffer, {{3, 0, 7}, 3});
+  position = 0;
+  decoded = data::TimeSeriesCodec::decode(buffer, position, startingTime);
+  ASSERT_EQ(decoded.size(), (data.size() + 2) / 3);
+  for (size_t i = 0; i < decoded.size(); i++) {
+    ASSERT_EQ(decoded[i].getTimeStamp(), data[i * 3].getTimeStamp());
+    ASSERT_EQ(decoded[i].size(), 2);
+    ASSERT_EQ(std::memcmp(&decoded[i].getData()[0], &data[i * 3].getData()[3],
+                          sizeof(double)),
+              0);
+    ASSERT_EQ(decoded[i].getData()[1], data[i * 3].getData()[0]);
+  }
+  ASSERT_THROW(data::TimeSeriesCodec::encode(data, buffer, {{}, 0}),
+               std::invalid_argument);
+
+  // An empty time series is a block too
+  buffer.clear();
+  data::TimeSeriesCodec::encode(data::TimeSeries(startingTime), buffer);
+  ASSERT_EQ(buffer.size(), 2);
+  position = 0;
+  ASSERT_EQ(
+      data::TimeSeriesCodec::decode(buffer, position, startingTime).size(), 0);
+
+  // The samples must have the same number of channels
+  auto mismatched = data::TimeSeries(startingTime);
+  mismatched.add(std::chrono::microseconds(0), {1.0, 2.0});
+  mismatched.add(std::chrono::microseconds(1), {1.0});
+  ASSERT_THROW(data::TimeSeriesCodec::encode(mismatched, buffer),
+               std::invalid_argument);
+
+  // A truncated block is detected
+  buffer.clear();
+  data::TimeSeriesCodec::encode(constant, buffer);
+  buffer.resize(buffer.size() - 1);
+  position = 0;
+  ASSERT_THROW(data::TimeSeriesCodec::decode(buffer, position, startingTime),
+               std::runtime_error);
+}
@@ -389,6 +389,105 @@ TEST(Delsys, LiveData) {
   }
 }
 
+TEST(Delsys, ReconstructedTimeStamps) {
+  auto delsys = devices::DelsysEmgDeviceMock();
+  delsys.connect();
+
+  delsys.startDataStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  delsys.stopDataStreaming();
+
+  // The samples of a frame arrive at the same time, but their timestamps are
+  // reconstructed from the sample counter (2000Hz). The corrections of the
+  // clock model are at most 5% of the period
+  const auto &data = delsys.getLiveData();
+  ASSERT_GE(data.size(), 300);
+  ASSERT_EQ(delsys.getSampleCounter(), data.size());
+  for (size_t i = 1; i < data.size(); i++) {
+    auto deltaTime = data[i].getTimeStamp() - data[i - 1].getTimeStamp();
+    ASSERT_GE(deltaTime, std::chrono::microseconds(474));
+    ASSERT_LE(deltaTime, std::chrono::microseconds(526));
+  }
+
+  // The mock is driven by the host clock, so there is virtually no skew
+  ASSERT_NEAR(delsys.getClockSkew(), 0.0, 500.0);
+}
+
+TEST(Delsys, DerivedLiveData) {
+  auto delsys = devices::DelsysEmgDeviceMock();
+  delsys.connect();
+
+  delsys.startDataStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  delsys.stopDataStreaming();
+
+  // The EMG features are published every 50 samples (25 ms at 2000Hz), with
+  // the timestamp of the last sample of their window
+  auto derived = delsys.getDerivedLiveData();
+  ASSERT_EQ(derived.size(), 2);
+  const auto &features = derived.at("DelsysEmgDataCollector.EmgFeatures");
+  const auto &data = delsys.getLiveData();
+  ASSERT_EQ(features.size(), data.size() / 50);
+  for (size_t i = 0; i < features.size(); i++) {
+    ASSERT_EQ(features[i].size(), 5 * 16);
+    ASSERT_EQ(features[i].getTimeStamp(), data[50 * i + 49].getTimeStamp());
+    for (size_t j = 0; j < 16; j++) {
+      ASSERT_GE(features[i][j], 0.0);
+    }
+  }
+
+  // The envelope is published every 20 samples (100Hz) and is rectified
+  const auto &envelope = derived.at("DelsysEmgDataCollector.EmgEnvelope");
+  ASSERT_EQ(envelope.size(), data.size() / 20);
+  for (size_t i = 0; i < envelope.size(); i++) {
+    ASSERT_EQ(envelope[i].size(), 16);
+    ASSERT_EQ(envelope[i].getTimeStamp(), data[20 * i + 19].getTimeStamp());
+  }
+}
+
+TEST(Delsys, ZeroLevelledDerivedLiveData) {
+  auto delsys = devices::DelsysEmgDeviceMock();
+  delsys.connect();
+
+  delsys.startDataStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  delsys.stopDataStreaming();
+  delsys.setZeroLevel(std::chrono::milliseconds(1000));
+  auto zeroLevel = delsys.getLiveData().getZeroLevel();
+  ASSERT_EQ(zeroLevel.size(), 16);
+
+  // The zero level is kept when streaming again, and the features are
+  // computed on the zero levelled samples, as stored in the live data
+  delsys.startDataStreaming();
+  delsys.startRecording();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  delsys.stopDataStreaming();
+
+  // The trial keeps the raw samples
+  const auto &trial = delsys.getTrialData();
+  ASSERT_GT(trial.size(), 0);
+  for (size_t j = 0; j < 16; j++) {
+    ASSERT_NEAR(trial.back()[j] - zeroLevel[j],
+                delsys.getLiveData().back()[j], requiredPrecision);
+  }
+
+  auto derived = delsys.getDerivedLiveData();
+  const auto &features = derived.at("DelsysEmgDataCollector.EmgFeatures");
+  const auto &data = delsys.getLiveData();
+  ASSERT_GT(features.size(), 4);
+  for (size_t i = 3; i < features.size(); i++) {
+    size_t last = 50 * i + 49;
+    ASSERT_EQ(features[i].getTimeStamp(), data[last].getTimeStamp());
+    for (size_t j = 0; j < 16; j++) {
+      double mav = 0.0;
+      for (size_t k = last - 199; k <= last; k++) {
+        mav += std::abs(data[k][j]);
+      }
+      ASSERT_NEAR(features[i][16 + j], mav / 200.0, requiredPrecision);
+    }
+  }
+}
+
 TEST(Delsys, TrialData) {
   auto logger = TestLogger();
   auto delsys = devices::DelsysEmgDeviceMock();
@@ -1,7 +1,12 @@
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <iostream>
 #include <thread>
 
+#include "Data/TrialFile.h"
 #include "Devices/all.h"
 #include "utils.h"
 
@@ -102,6 +107,9 @@ TEST(Devices, Connect) {
   devices.add(devices::MagstimRapidDeviceMock::findMagstimDevice());
   devices.add(std::make_unique<devices::DelsysEmgDeviceMock>());
   devices.add(devices::MagstimRapidDeviceMock::findMagstimDevice());
+  std::atomic<size_t> connectionChangeCount = 0;
+  devices.onDeviceConnectionChanged.listen(
+      [&](const size_t &) { connectionChangeCount++; });
 
   // Connect the devices
   bool areConnected = devices.connect();
@@ -109,6 +117,7 @@ TEST(Devices, Connect) {
   ASSERT_TRUE(devices.getIsConnected());
   // Even though it is sync, the messages to the logger are sometimes late
   logger.giveTimeToUpdate();
+  ASSERT_EQ(connectionChangeCount, 4);
   ASSERT_EQ(logger.count("The device DelsysEmgDevice is now connected"), 2);
   ASSERT_EQ(logger.count("The device MagstimRapidDevice is now connected"), 2);
   ASSERT_TRUE(logger.contains("All devices are now connected"));
@@ -120,6 +129,7 @@ TEST(Devices, Connect) {
   ASSERT_TRUE(devices.getIsConnected());
   // Even though it is sync, the messages to the logger are sometimes late
   logger.giveTimeToUpdate();
+  ASSERT_EQ(connectionChangeCount, 4);
   ASSERT_EQ(logger.count("Cannot connect to the device DelsysEmgDevice because "
                          "it is already connected"),
             2);
@@ -135,6 +145,7 @@ TEST(Devices, Connect) {
   ASSERT_FALSE(devices.getIsConnected());
   // Even though it is sync, the messages to the logger are sometimes late
   logger.giveTimeToUpdate();
+  ASSERT_EQ(connectionChangeCount, 8);
   ASSERT_EQ(logger.count("The device DelsysEmgDevice is now disconnected"), 2);
   ASSERT_EQ(logger.count("The device MagstimRapidDevice is now disconnected"),
             2);
@@ -147,6 +158,7 @@ TEST(Devices, Connect) {
   ASSERT_FALSE(devices.getIsConnected());
   // Even though it is sync, the messages to the logger are sometimes late
   logger.giveTimeToUpdate();
+  ASSERT_EQ(connectionChangeCount, 8);
   ASSERT_EQ(logger.count("Cannot disconnect from the device DelsysEmgDevice "
                          "because it is not connected"),
             2);
@@ -578,6 +590,11 @@ TEST(Devices, LiveData) {
     auto data = data::TimeSeries(dataCollector->getSerializedLiveData());
     ASSERT_LE(data.getStartingTime().time_since_epoch(),
               now.time_since_epoch());
+
+    // The samples acquired before the recording started are not kept
+    if (data.size() > 0) {
+      ASSERT_GE(data.front().getTimeStamp().count(), 0);
+    }
   }
 
   // Data are supposed to be collected in the live data
@@ -706,3 +723,349 @@ TEST(Devices, SerializeTrialData) {
   ASSERT_EQ(data[thirdDevice]["data"]["data"].size(),
             devices.getDataCollector(deviceIds[2]).getTrialData().size());
 }
+
+data::TimeSeries
+generateRecordedData(const std::chrono::system_clock::time_point &startingTime,
+                     size_t count) {
+  auto data = data::TimeSeries(startingTime);
+  for (size_t i = 0; i < count; i++) {
+    data.add(std::chrono::milliseconds(i * 10),
+             {static_cast<double>(i), -static_cast<double>(i)});
+  }
+  return data;
+}
+
+bool waitForReplayToFinish(const devices::ReplayDataCollector &replay) {
+  auto start = std::chrono::steady_clock::now();
+  while (!replay.getHasFinished()) {
+    if (std::chrono::steady_clock::now() - start > std::chrono::seconds(5)) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+TEST(ReplayDataCollector, Names) {
+  ASSERT_EQ(devices::ReplayDataCollector::deviceNameFromDataCollectorName(
+                "DelsysEmgDataCollector"),
+            "DelsysEmgDevice");
+  ASSERT_EQ(devices::ReplayDataCollector::deviceNameFromDataCollectorName(
+                "Custom"),
+            "CustomDevice");
+
+  auto replay = devices::ReplayDataCollector(
+      "DelsysAnalogDataCollector",
+      generateRecordedData(std::chrono::system_clock::now(), 10));
+  ASSERT_EQ(replay.deviceName(), "DelsysAnalogDevice");
+  ASSERT_EQ(replay.dataCollectorName(), "DelsysAnalogDataCollector");
+  ASSERT_EQ(replay.getDataChannelCount(), 2);
+
+  EXPECT_THROW(devices::ReplayDataCollector("Empty", data::TimeSeries()),
+               std::invalid_argument);
+  EXPECT_THROW(devices::ReplayDataCollector::fromTrial({}, "Missing"),
+               std::invalid_argument);
+}
+
+TEST(ReplayDataCollector, Speed) {
+  auto logger = TestLogger();
+  auto recorded = generateRecordedData(std::chrono::system_clock::now(), 100);
+  auto replay = devices::ReplayDataCollector("DelsysAnalogDataCollector",
+                                             recorded, 10.0);
+
+  // One second of data replayed ten times faster
+  replay.connect();
+  auto start = std::chrono::steady_clock::now();
+  replay.startDataStreaming();
+  ASSERT_TRUE(waitForReplayToFinish(replay));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  ASSERT_GE(elapsed, std::chrono::milliseconds(95));
+  ASSERT_LT(elapsed, std::chrono::milliseconds(900));
+
+  // The samples keep their recorded timestamps
+  auto live = data::TimeSeries(replay.getSerializedLiveData());
+  ASSERT_EQ(live.size(), recorded.size());
+  for (size_t i = 0; i < recorded.size(); i++) {
+    ASSERT_EQ(live[i].getTimeStamp(), recorded[i].getTimeStamp());
+    ASSERT_EQ(live[i].getData(), recorded[i].getData());
+  }
+  replay.disconnect();
+}
+
+TEST(ReplayDataCollector, UnthrottledLoop) {
+  auto logger = TestLogger();
+  auto recorded = generateRecordedData(std::chrono::system_clock::now(), 100);
+  auto replay =
+      devices::ReplayDataCollector("Custom", recorded, 0.0, /*isLooping=*/true);
+
+  replay.connect();
+  replay.startDataStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  replay.stopDataStreaming();
+  ASSERT_FALSE(replay.getHasFinished());
+
+  // Much more than the trial was sent, and the loops follow each other
+  auto live = data::TimeSeries(replay.getSerializedLiveData());
+  ASSERT_EQ(live.size(), 1000);
+  ASSERT_GT(live.back().getTimeStamp(), std::chrono::seconds(10));
+  for (size_t i = 0; i < live.size(); i++) {
+    auto sampleIndex = live[i].getTimeStamp() / std::chrono::milliseconds(10);
+    ASSERT_EQ(live[i].getTimeStamp(),
+              std::chrono::milliseconds(10) * sampleIndex);
+    ASSERT_EQ(live[i].getData()[0], sampleIndex % 100);
+  }
+  replay.disconnect();
+}
+
+TEST(ReplayDataCollector, ReplayHistory) {
+  auto logger = TestLogger();
+  auto recorded = generateRecordedData(std::chrono::system_clock::now(), 100);
+  auto replay = devices::ReplayDataCollector("Custom", recorded, 0.0);
+  replay.setReplayHistorySize(30);
+
+  // Stream more samples than the history can hold
+  replay.connect();
+  replay.startDataStreaming();
+  ASSERT_TRUE(waitForReplayToFinish(replay));
+
+  // Only the samples still held are sent back, with their own sequences
+  size_t firstSequence;
+  size_t sequence;
+  auto history = data::TimeSeries(
+      replay.getSerializedReplayData(0, firstSequence, sequence));
+  ASSERT_EQ(sequence, 100);
+  ASSERT_EQ(firstSequence, 70);
+  ASSERT_EQ(history.size(), 30);
+  for (size_t i = 0; i < history.size(); i++) {
+    ASSERT_EQ(history[i].getData()[0], firstSequence + i);
+  }
+
+  history = data::TimeSeries(
+      replay.getSerializedReplayData(90, firstSequence, sequence));
+  ASSERT_EQ(firstSequence, 90);
+  ASSERT_EQ(history.size(), 10);
+  ASSERT_EQ(history[0].getData()[0], 90);
+  replay.disconnect();
+}
+
+TEST(ReplayDataCollector, Trial) {
+  auto logger = TestLogger();
+  auto startingTime = std::chrono::system_clock::time_point(
+      std::chrono::microseconds(1700000000000000));
+  std::map<std::string, data::TimeSeries> trial = {
+      {"DelsysAnalogDataCollector", generateRecordedData(startingTime, 50)},
+      {"DelsysEmgDataCollector",
+       generateRecordedData(startingTime + std::chrono::milliseconds(3), 50)}};
+
+  // A trial saved as json by the server can be loaded back
+  std::string path("replay_trial_test.json");
+  {
+    nlohmann::json json;
+    size_t index = 0;
+    for (const auto &[name, data] : trial) {
+      json[std::to_string(index++)] = {{"name", name},
+                                       {"data", data.serialize()}};
+    }
+    std::ofstream file(path);
+    file << json.dump();
+  }
+  auto loaded = data::TrialFile::load(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(loaded.size(), 2);
+
+  // The replayed devices keep their names and their synchronization
+  auto devices = devices::Devices();
+  std::vector<const devices::ReplayDataCollector *> replays;
+  for (const auto &[name, data] : loaded) {
+    auto replay =
+        devices::ReplayDataCollector::fromTrial(loaded, name, /*speed=*/0.0);
+    replays.push_back(replay.get());
+    devices.add(std::move(replay));
+  }
+  devices.connect();
+  devices.startDataStreaming();
+  for (auto replay : replays) {
+    ASSERT_TRUE(waitForReplayToFinish(*replay));
+  }
+
+  // The EMG is processed as by the actual device
+  auto live = devices.getLiveData();
+  ASSERT_EQ(live.size(), 4);
+  const auto &analogs = live.at("DelsysAnalogDataCollector");
+  const auto &emg = live.at("DelsysEmgDataCollector");
+  ASSERT_EQ(analogs.size(), 50);
+  ASSERT_EQ(emg.size(), 50);
+  ASSERT_EQ(analogs[10].getTimeStamp(), std::chrono::milliseconds(100));
+  ASSERT_EQ(emg[10].getTimeStamp(), std::chrono::milliseconds(103));
+  const auto &envelope = live.at("DelsysEmgDataCollector.EmgEnvelope");
+  ASSERT_EQ(envelope.size(), 2);
+  ASSERT_EQ(envelope[0].getTimeStamp(), emg[19].getTimeStamp());
+  ASSERT_TRUE(live.count("DelsysEmgDataCollector.EmgFeatures"));
+  devices.disconnect();
+}
+
+TEST(SyntheticDevice, Configuration) {
+  auto logger = TestLogger();
+  auto emg = devices::SyntheticDeviceConfiguration::delsysEmg(10.0);
+  ASSERT_EQ(emg.channelCount, 16);
+  ASSERT_EQ(emg.sampleRate, 20000.0);
+  ASSERT_EQ(emg.frameSize, 27);
+  ASSERT_EQ(emg.framePeriod(), std::chrono::microseconds(1350));
+
+  // The missing fields keep their default value
+  auto configuration = devices::SyntheticDeviceConfiguration(
+      {{"channel_count", 4}, {"jitter", 500}, {"drop_rate", 0.1}});
+  ASSERT_EQ(configuration.channelCount, 4);
+  ASSERT_EQ(configuration.jitter, std::chrono::microseconds(500));
+  ASSERT_EQ(configuration.dropRate, 0.1);
+  ASSERT_EQ(configuration.sampleRate, 2000.0);
+  ASSERT_EQ(devices::SyntheticDeviceConfiguration(configuration.serialize())
+                .serialize(),
+            configuration.serialize());
+
+  ASSERT_EQ(
+      devices::SyntheticDevice::dataCollectorNameFromDeviceName(
+          "DelsysEmgDevice"),
+      "DelsysEmgDataCollector");
+  ASSERT_EQ(devices::SyntheticDevice::dataCollectorNameFromDeviceName("Load"),
+            "LoadDataCollector");
+
+  configuration.dropRate = 1.0;
+  EXPECT_THROW(devices::SyntheticDevice("Load", "LoadCollector", configuration),
+               std::invalid_argument);
+  configuration.dropRate = 0.0;
+  configuration.sampleRate = 0.0;
+  EXPECT_THROW(devices::SyntheticDevice("Load", "LoadCollector", configuration),
+               std::invalid_argument);
+}
+
+TEST(SyntheticDevice, Waveforms) {
+  auto logger = TestLogger();
+  devices::SyntheticDeviceConfiguration configuration;
+  configuration.channelCount = 3;
+  configuration.sampleRate = 1000.0;
+  configuration.frameSize = 10;
+  configuration.sineAmplitude = 2.0;
+  configuration.stepAmplitude = 10.0;
+  configuration.stepPeriod = std::chrono::milliseconds(200);
+  auto device = devices::SyntheticDevice("Load", "LoadCollector", configuration);
+  ASSERT_EQ(device.getDataChannelCount(), 3);
+
+  device.connect();
+  device.startDataStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  device.stopDataStreaming();
+
+  // A frame every 10 ms, without drop
+  ASSERT_GE(device.getSentFrameCount(), 25);
+  ASSERT_LE(device.getSentFrameCount(), 35);
+  ASSERT_EQ(device.getDroppedFrameCount(), 0);
+
+  // A 1Hz sine starting at 0 on the first channel, the steps rising after
+  // half of their period
+  auto live = data::TimeSeries(device.getSerializedLiveData());
+  ASSERT_EQ(live.size(), device.getSentFrameCount() * 10);
+  for (size_t i = 0; i < 100; i++) {
+    ASSERT_NEAR(live[i].getData()[0], 2.0 * std::sin(2 * M_PI * i / 1000.0),
+                1e-9);
+    ASSERT_NE(live[i].getData()[1], live[i].getData()[0]);
+  }
+  for (size_t i = 100; i < std::min<size_t>(live.size(), 200); i++) {
+    ASSERT_NEAR(live[i].getData()[0],
+                10.0 + 2.0 * std::sin(2 * M_PI * i / 1000.0), 1e-9);
+  }
+  device.disconnect();
+}
+
+TEST(SyntheticDevice, JitterAndDrops) {
+  auto logger = TestLogger();
+  devices::SyntheticDeviceConfiguration configuration;
+  configuration.channelCount = 8;
+  configuration.sampleRate = 20000.0;
+  configuration.frameSize = 20;
+  configuration.noiseAmplitude = 1.0;
+  configuration.burstAmplitude = 1.0;
+  configuration.jitter = std::chrono::microseconds(2000);
+  configuration.dropRate = 0.25;
+  auto device = devices::SyntheticDevice("Load", "LoadCollector", configuration);
+
+  device.connect();
+  device.startDataStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  device.stopDataStreaming();
+
+  // A frame is due every millisecond, a quarter of them are dropped
+  auto frameCount =
+      device.getSentFrameCount() + device.getDroppedFrameCount();
+  ASSERT_GE(frameCount, 450);
+  ASSERT_LE(frameCount, 510);
+  ASSERT_GT(device.getDroppedFrameCount(), frameCount / 10);
+  ASSERT_LT(device.getDroppedFrameCount(), frameCount / 2);
+
+  auto live = data::TimeSeries(device.getSerializedLiveData());
+  ASSERT_GT(live.size(), 0);
+  for (size_t i = 0; i < live.size(); i++) {
+    for (auto value : live[i].getData()) {
+      ASSERT_TRUE(std::isfinite(value));
+    }
+  }
+  device.disconnect();
+}
+
+TEST(AsyncDataCollector, DeadlineMisses) {
+  auto logger = TestLogger();
+  devices::SyntheticDeviceConfiguration configuration;
+  configuration.channelCount = 2;
+  configuration.sampleRate = 1000.0;
+  configuration.frameSize = 10;
+  auto device =
+      devices::SyntheticDevice("Deadline", "DeadlineCollector", configuration);
+
+  // By default, the budget is the data check interval, but at least 1 ms
+  ASSERT_LE(device.getKeepDataWorkerAliveInterval(),
+            std::chrono::milliseconds(1));
+  auto budget = device.getDeadlineBudget();
+  ASSERT_EQ(budget.maxLateness, std::chrono::milliseconds(1));
+  ASSERT_EQ(budget.maxExecutionTime, std::chrono::milliseconds(1));
+  ASSERT_EQ(budget.maxConsecutiveMisses, 3);
+
+  // A budget no data check can hold, reported from the third miss in a row
+  device.setDeadlineBudget({std::chrono::microseconds(-1),
+                            std::chrono::microseconds(-1), 3});
+  std::mutex missesMutex;
+  std::vector<devices::DeadlineMiss> misses;
+  device.onDeadlineMiss.listen(
+      [&missesMutex, &misses](const devices::DeadlineMiss &miss) {
+        std::lock_guard lock(missesMutex);
+        misses.push_back(miss);
+      });
+
+  // The metrics outlive the device, only count this run
+  auto &metrics = utils::Metrics::getInstance();
+  auto executionTime = metrics.histogram("DeadlineCollector.executionTime");
+  auto lateness = metrics.histogram("DeadlineCollector.lateness");
+  auto deadlineMisses = metrics.counter("DeadlineCollector.deadlineMisses");
+  auto previousCheckCount = executionTime->count();
+  auto previousLatenessCount = lateness->count();
+  auto previousMissCount = deadlineMisses->value();
+
+  device.connect();
+  device.startDataStreaming();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  device.stopDataStreaming();
+  device.disconnect();
+
+  std::lock_guard lock(missesMutex);
+  ASSERT_GE(misses.size(), 3);
+  ASSERT_EQ(misses[0].dataCollectorName, "DeadlineCollector");
+  ASSERT_EQ(misses[0].consecutiveMisses, 3);
+  ASSERT_EQ(misses[1].consecutiveMisses, 4);
+  ASSERT_GE(misses[1].time, misses[0].time);
+  ASSERT_GE(misses[1].sampleCounter, misses[0].sampleCounter);
+
+  // Every data check was measured and missed its deadline
+  auto checkCount = executionTime->count() - previousCheckCount;
+  ASSERT_EQ(lateness->count() - previousLatenessCount, checkCount);
+  ASSERT_EQ(deadlineMisses->value() - previousMissCount, checkCount);
+  ASSERT_EQ(checkCount, misses.size() + 2);
+}
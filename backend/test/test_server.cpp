@@ -1,5 +1,9 @@
+#include <atomic>
+#include <cstring>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include <thread>
 
 #include "Server/TcpClient.h"
@@ -63,6 +67,59 @@ TEST(Server, Ports) {
   }
 }
 
+TEST(Server, MessagePacket) {
+  auto toBytes = [](const server::MessagePacket &packet) {
+    std::vector<char> bytes;
+    for (const auto &buffer : packet.buffers()) {
+      auto data = static_cast<const char *>(buffer.data());
+      bytes.insert(bytes.end(), data, data + buffer.size());
+    }
+    return bytes;
+  };
+  // The timestamps (bytes 16 to 24) may differ by a millisecond
+  auto withoutTimestamp = [](std::vector<char> bytes) {
+    std::fill(bytes.begin() + 16, bytes.begin() + 24, '\0');
+    return bytes;
+  };
+
+  // Without extra data, the packet is only the header
+  auto packet = server::MessagePacket(server::TcpServerCommand::GET_STATES,
+                                      server::TcpServerMessage::OK);
+  ASSERT_EQ(packet.size(), server::BYTES_IN_SERVER_PACKET_HEADER);
+  ASSERT_EQ(withoutTimestamp(toBytes(packet)),
+            withoutTimestamp(server::constructMessagePacket(
+                server::TcpServerCommand::GET_STATES,
+                server::TcpServerMessage::OK)));
+
+  // With extra data, the data are shared, not copied
+  auto data = std::make_shared<const std::string>("{\"key\":42}");
+  packet = server::MessagePacket(server::TcpServerCommand::NONE,
+                                 server::TcpServerMessage::SENDING_DATA,
+                                 server::TcpServerDataType::LIVE_DATA, data);
+  ASSERT_EQ(packet.size(),
+            server::BYTES_IN_SERVER_PACKET_HEADER + 8 + data->size());
+  ASSERT_EQ(packet.buffers()[1].data(), data->data());
+  ASSERT_EQ(withoutTimestamp(toBytes(packet)),
+            withoutTimestamp(server::constructMessagePacket(
+                server::TcpServerCommand::NONE,
+                server::TcpServerMessage::SENDING_DATA,
+                server::TcpServerDataType::LIVE_DATA, *data)));
+
+  // The responses to the pipelined requests carry their id after the header
+  packet = server::MessagePacket(
+      server::TcpServerRequest(server::TcpServerCommand::GET_STATES, 42),
+      server::TcpServerMessage::OK);
+  auto bytes = toBytes(packet);
+  ASSERT_EQ(bytes.size(), server::BYTES_IN_SERVER_PACKET_HEADER +
+                              server::BYTES_IN_REQUEST_ID);
+  uint32_t value;
+  std::memcpy(&value, bytes.data(), sizeof(value));
+  ASSERT_EQ(value, server::PIPELINED_PROTOCOL_VERSION);
+  std::memcpy(&value, bytes.data() + server::BYTES_IN_SERVER_PACKET_HEADER,
+              sizeof(value));
+  ASSERT_EQ(value, 42);
+}
+
 TEST(Server, StartServer) {
   auto logger = TestLogger();
 
@@ -876,6 +933,1166 @@ TEST(Server, LastTrialData) {
   ASSERT_GE(data["DelsysEmgDataCollector"].size(), 900); // Should be ~1000
 }
 
+TEST(Server, LiveData) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  std::mutex mutex;
+  std::vector<server::LiveReception<std::map<std::string, data::TimeSeries>>>
+      receptions;
+  client.onNewLiveData.listen([&](const auto &reception) {
+    std::lock_guard lock(mutex);
+    receptions.push_back(reception);
+  });
+  client.connect(0x10000001);
+  client.addDelsysEmgDevice();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  client.disconnect();
+
+  // The live data are streamed every 100ms from the synthetic device
+  std::lock_guard lock(mutex);
+  ASSERT_GE(receptions.size(), 2);
+  const auto &reception = receptions.back();
+  ASSERT_GT(reception.byteCount, 0);
+  ASSERT_LE(reception.sentAt,
+            reception.receivedAt + std::chrono::milliseconds(1));
+  const auto &emg = reception.content.at("DelsysEmgDataCollector");
+  ASSERT_GT(emg.size(), 0);
+  ASSERT_EQ(emg[0].getData().size(), 16);
+}
+
+#ifdef ENABLE_TRACING
+TEST(Server, Trace) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  client.connect(0x10000001);
+  client.addDelsysEmgDevice();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  // The hot paths of the live data were traced
+  auto trace = client.getTrace();
+  client.disconnect();
+  ASSERT_TRUE(trace.contains("traceEvents"));
+  std::set<std::string> names;
+  for (const auto &event : trace["traceEvents"]) {
+    names.insert(event["name"].get<std::string>());
+  }
+  ASSERT_TRUE(names.count("DataCollector::addDataPoints"));
+  ASSERT_TRUE(names.count("TcpServer::liveDataLoop"));
+  ASSERT_TRUE(names.count("Devices::getLiveDataSerialized"));
+}
+#endif // ENABLE_TRACING
+
+TEST(Server, Metrics) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  client.connect(0x10000001);
+  client.addDelsysEmgDevice();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  auto metrics = client.getMetrics();
+  ASSERT_TRUE(metrics.contains("uptime"));
+  ASSERT_GT(metrics["counters"]["DelsysEmgDataCollector.ingestedSamples"]
+                .get<uint64_t>(),
+            0);
+  ASSERT_GT(metrics["histograms"]["TcpServer.liveData.serializeDuration"]
+                   ["count"]
+                       .get<uint64_t>(),
+            0);
+
+  // The live data were sent to the client
+  std::string session = "TcpServer.sessions." + std::to_string(0x10000001);
+  ASSERT_GT(metrics["counters"][session + ".sentBytes"].get<uint64_t>(), 0);
+  ASSERT_GT(metrics["histograms"][session + ".sendDuration"]["count"]
+                .get<uint64_t>(),
+            0);
+  ASSERT_TRUE(metrics["gauges"].contains(session + ".queuedBytes"));
+  client.disconnect();
+}
+
+TEST(Server, SharedMemoryRing) {
+  auto logger = TestLogger();
+  if (!server::SharedMemoryRing::isSupported()) {
+    GTEST_SKIP() << "The shared memory is not supported on this platform";
+  }
+
+  server::SharedMemoryRing writer("/neurobio_test_ring", 4, 64);
+  server::SharedMemoryRing reader("/neurobio_test_ring");
+  ASSERT_EQ(reader.getSlotCount(), 4);
+  ASSERT_EQ(reader.getSlotSize(), 64);
+  ASSERT_EQ(reader.getToken(), writer.getToken());
+
+  // Nothing is published yet
+  uint64_t sequence = reader.getWriteSequence();
+  server::SharedMemoryMessage message;
+  ASSERT_FALSE(reader.read(sequence, message));
+
+  // The messages are read in order
+  ASSERT_TRUE(writer.publish(10, "first"));
+  ASSERT_TRUE(writer.publish(11, "second"));
+  ASSERT_TRUE(reader.read(sequence, message));
+  ASSERT_EQ(message.dataType, 10);
+  ASSERT_EQ(message.data, "first");
+  ASSERT_TRUE(reader.read(sequence, message));
+  ASSERT_EQ(message.dataType, 11);
+  ASSERT_EQ(message.data, "second");
+  ASSERT_FALSE(reader.read(sequence, message));
+
+  // The messages larger than a slot are refused, and only the writer publishes
+  ASSERT_FALSE(writer.publish(10, std::string(65, 'x')));
+  ASSERT_TRUE(writer.publish(10, std::string(64, 'x')));
+  ASSERT_FALSE(reader.publish(10, "reader"));
+  ASSERT_TRUE(reader.read(sequence, message));
+  ASSERT_EQ(message.data, std::string(64, 'x'));
+
+  // A reader that falls behind skips to the newest message
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(writer.publish(10, std::to_string(i)));
+  }
+  ASSERT_TRUE(reader.read(sequence, message));
+  ASSERT_EQ(message.data, "9");
+  ASSERT_EQ(sequence, writer.getWriteSequence());
+  ASSERT_FALSE(reader.read(sequence, message));
+
+  // A message viewed in place is invalidated once the writer overwrites it
+  server::SharedMemoryView view;
+  ASSERT_TRUE(writer.publish(12, "viewed"));
+  ASSERT_TRUE(reader.view(sequence, view));
+  ASSERT_EQ(view.dataType, 12);
+  ASSERT_EQ(view.data, "viewed");
+  ASSERT_TRUE(reader.isValid(view));
+  ASSERT_FALSE(reader.view(sequence, view));
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(writer.publish(10, std::to_string(i)));
+  }
+  ASSERT_FALSE(reader.isValid(view));
+}
+
+TEST(Server, SharedMemory) {
+  auto logger = TestLogger();
+  if (!server::SharedMemoryRing::isSupported()) {
+    GTEST_SKIP() << "The shared memory is not supported on this platform";
+  }
+
+  {
+    // The shared memory is disabled by default
+    server::TcpServerMock server(5000, 5001, 5002, 5003,
+                                 sufficientTimeoutPeriod);
+    server.startServer();
+    server::TcpClient client;
+    client.connect(0x10000001);
+    ASSERT_FALSE(client.useSharedMemory());
+    client.disconnect();
+  }
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setIsSharedMemoryEnabled(true);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  std::mutex mutex;
+  std::vector<server::LiveReception<std::map<std::string, data::TimeSeries>>>
+      receptions;
+  client.onNewLiveData.listen([&](const auto &reception) {
+    std::lock_guard lock(mutex);
+    receptions.push_back(reception);
+  });
+  client.connect(0x10000001);
+  ASSERT_TRUE(client.useSharedMemory());
+  client.addDelsysEmgDevice();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  // Nothing was sent through the live sockets
+  auto metrics = client.getMetrics();
+  std::string session = "TcpServer.sessions." + std::to_string(0x10000001);
+  ASSERT_EQ(metrics["counters"][session + ".sentBytes"].get<uint64_t>(), 0);
+  client.disconnect();
+
+  std::lock_guard lock(mutex);
+  ASSERT_GE(receptions.size(), 2);
+  const auto &reception = receptions.back();
+  ASSERT_GT(reception.byteCount, 0);
+  ASSERT_LE(reception.sentAt,
+            reception.receivedAt + std::chrono::milliseconds(1));
+  const auto &emg = reception.content.at("DelsysEmgDataCollector");
+  ASSERT_GT(emg.size(), 0);
+  ASSERT_EQ(emg[0].getData().size(), 16);
+}
+
+TEST(Server, MultiplexedSocket) {
+  auto logger = TestLogger();
+
+  asio::io_context context;
+  asio::ip::tcp::acceptor acceptor(
+      context, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), 5004));
+  auto serverSocket = std::make_shared<asio::ip::tcp::socket>(context);
+  auto clientSocket = std::make_shared<asio::ip::tcp::socket>(context);
+  clientSocket->connect(asio::ip::tcp::endpoint(
+      asio::ip::address_v4::loopback(), acceptor.local_endpoint().port()));
+  acceptor.accept(*serverSocket);
+  server::MultiplexedSocket writer(clientSocket);
+  server::MultiplexedSocket reader(serverSocket);
+
+  // A payload larger than a frame is cut, and the channels are interleaved
+  std::string large(3 * server::MAX_BYTES_IN_MULTIPLEXED_FRAME + 10, 'x');
+  for (size_t i = 0; i < large.size(); i++) {
+    large[i] = static_cast<char>(i % 251);
+  }
+  asio::error_code error;
+  ASSERT_EQ(writer.write(server::TcpServerChannel::LIVE_DATA,
+                         asio::buffer(large), error),
+            large.size());
+  ASSERT_EQ(writer.write(server::TcpServerChannel::COMMAND,
+                         asio::buffer(std::string("command")), error),
+            7);
+  ASSERT_FALSE(error);
+
+  // The command is read past the live data, which are kept for later
+  std::string command(7, '\0');
+  ASSERT_EQ(reader.read(server::TcpServerChannel::COMMAND,
+                        asio::buffer(command), error),
+            7);
+  ASSERT_EQ(command, "command");
+  std::string received(large.size(), '\0');
+  ASSERT_TRUE(reader.tryRead(server::TcpServerChannel::LIVE_DATA,
+                             asio::buffer(received)));
+  ASSERT_EQ(received, large);
+  ASSERT_FALSE(reader.tryRead(server::TcpServerChannel::LIVE_DATA,
+                              asio::buffer(received, 1)));
+
+  // Closing the socket fails the pending reads
+  writer.close();
+  ASSERT_EQ(reader.read(server::TcpServerChannel::MESSAGE,
+                        asio::buffer(command), error),
+            0);
+  ASSERT_TRUE(error);
+}
+
+TEST(Server, MultiplexedSocketLimits) {
+  auto logger = TestLogger();
+
+  asio::io_context context;
+  asio::ip::tcp::acceptor acceptor(
+      context, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), 5004));
+  auto connect = [&]() {
+    auto serverSocket = std::make_shared<asio::ip::tcp::socket>(context);
+    auto clientSocket = std::make_shared<asio::ip::tcp::socket>(context);
+    clientSocket->connect(asio::ip::tcp::endpoint(
+        asio::ip::address_v4::loopback(), acceptor.local_endpoint().port()));
+    acceptor.accept(*serverSocket);
+    return std::make_pair(clientSocket, serverSocket);
+  };
+  std::string command(7, '\0');
+  asio::error_code error;
+
+  // The frames of a channel that is not read are refused
+  {
+    auto [clientSocket, serverSocket] = connect();
+    server::MultiplexedSocket writer(clientSocket);
+    server::MultiplexedSocket reader(
+        serverSocket, {server::TcpServerChannel::COMMAND}, 0);
+    writer.write(server::TcpServerChannel::LIVE_DATA,
+                 asio::buffer(std::string("live")), error);
+    writer.write(server::TcpServerChannel::COMMAND,
+                 asio::buffer(std::string("command")), error);
+    ASSERT_FALSE(error);
+    ASSERT_EQ(reader.read(server::TcpServerChannel::COMMAND,
+                          asio::buffer(command), error),
+              0);
+    ASSERT_EQ(error, asio::error::invalid_argument);
+  }
+
+  // The bytes kept for a channel are capped
+  {
+    error = asio::error_code();
+    auto [clientSocket, serverSocket] = connect();
+    server::MultiplexedSocket writer(clientSocket);
+    server::MultiplexedSocket reader(
+        serverSocket,
+        {server::TcpServerChannel::COMMAND, server::TcpServerChannel::MESSAGE},
+        100);
+    writer.write(server::TcpServerChannel::MESSAGE,
+                 asio::buffer(std::string(101, 'x')), error);
+    writer.write(server::TcpServerChannel::COMMAND,
+                 asio::buffer(std::string("command")), error);
+    ASSERT_FALSE(error);
+    ASSERT_EQ(reader.read(server::TcpServerChannel::COMMAND,
+                          asio::buffer(command), error),
+              0);
+    ASSERT_EQ(error, asio::error::no_buffer_space);
+  }
+}
+
+TEST(Server, Multiplexed) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setMultiplexedPort(5004);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  client.setMultiplexedPort(5004);
+  std::mutex mutex;
+  std::vector<server::LiveReception<std::map<std::string, data::TimeSeries>>>
+      receptions;
+  client.onNewLiveData.listen([&](const auto &reception) {
+    std::lock_guard lock(mutex);
+    receptions.push_back(reception);
+  });
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_TRUE(server.isClientConnected(0x10000001));
+
+  // The commands, their data and the live data share the connexion
+  ASSERT_TRUE(client.addDelsysEmgDevice());
+  ASSERT_TRUE(client.startRecording());
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  ASSERT_TRUE(client.stopRecording());
+  auto trial = client.getLastTrialData();
+  ASSERT_GT(trial.at("DelsysEmgDataCollector").size(), 0);
+
+  // The extra data of a command are read from the message channel
+  client.removeAnalyzer("Unknown");
+  logger.giveTimeToUpdate();
+  ASSERT_TRUE(logger.contains("Analyzer with name Unknown does not exist"));
+
+  auto metrics = client.getMetrics();
+  std::string session = "TcpServer.sessions." + std::to_string(0x10000001);
+  ASSERT_GT(metrics["counters"][session + ".sentBytes"].get<uint64_t>(), 0);
+  client.disconnect();
+
+  std::lock_guard lock(mutex);
+  ASSERT_GE(receptions.size(), 2);
+  const auto &emg = receptions.back().content.at("DelsysEmgDataCollector");
+  ASSERT_GT(emg.size(), 0);
+  ASSERT_EQ(emg[0].getData().size(), 16);
+}
+
+TEST(Server, LiveSubscription) {
+  auto logger = TestLogger();
+
+  auto liveData = nlohmann::json::parse(R"({
+    "0": {"name": "DelsysEmgDataCollector", "data": {"starting_time": 10,
+      "data": [[0, [1.0, 2.0, 3.0]], [1, [4.0, 5.0, 6.0]], [2, [7.0, 8.0, 9.0]]]
+    }},
+    "0.EmgEnvelope": {"name": "DelsysEmgDataCollector.EmgEnvelope",
+      "data": {"starting_time": 10, "data": [[0, [0.5]]]}}
+  })");
+
+  // By default, everything is subscribed to
+  server::LiveSubscription everything;
+  ASSERT_TRUE(everything.getIsEveryStream());
+  ASSERT_TRUE(everything.getHasAnalyses());
+  ASSERT_EQ(everything.getKey(), "");
+  ASSERT_EQ(everything.filter(liveData), liveData);
+  ASSERT_TRUE(server::LiveSubscription(nlohmann::json::object())
+                  .getIsEveryStream());
+
+  // Only the subscribed channels of the subscribed streams are kept
+  server::LiveSubscription subscription(nlohmann::json::parse(R"({
+    "streams": {"DelsysEmgDataCollector": {"channels": [2, 0, 5],
+                                           "decimation": 2}},
+    "max_rate": 10,
+    "analyses": false
+  })"));
+  ASSERT_FALSE(subscription.getIsEveryStream());
+  ASSERT_FALSE(subscription.getHasAnalyses());
+  ASSERT_DOUBLE_EQ(subscription.getMaxRate(), 10.0);
+  auto filtered = subscription.filter(liveData);
+  ASSERT_EQ(filtered.size(), 1);
+  ASSERT_EQ(filtered["0"]["name"], "DelsysEmgDataCollector");
+  ASSERT_EQ(filtered["0"]["data"]["starting_time"], 10);
+  ASSERT_EQ(filtered["0"]["data"]["data"],
+            nlohmann::json::parse("[[0, [3.0, 1.0]], [2, [9.0, 7.0]]]"));
+
+  // The derived streams are subscribed to by their own name
+  server::LiveSubscription envelope(nlohmann::json::parse(
+      R"({"streams": {"DelsysEmgDataCollector.EmgEnvelope": {}}})"));
+  filtered = envelope.filter(liveData);
+  ASSERT_EQ(filtered.size(), 1);
+  ASSERT_EQ(filtered["0.EmgEnvelope"], liveData["0.EmgEnvelope"]);
+
+  // The same streams give the same key, whatever the rate or the analyses
+  server::LiveSubscription sameStreams(nlohmann::json::parse(R"({
+    "streams": {"DelsysEmgDataCollector": {"channels": [2, 0, 5],
+                                           "decimation": 2}}
+  })"));
+  ASSERT_EQ(sameStreams.getKey(), subscription.getKey());
+  ASSERT_NE(envelope.getKey(), subscription.getKey());
+  ASSERT_EQ(server::LiveSubscription(subscription.serialize()).getKey(),
+            subscription.getKey());
+
+  // The compressed data are not sent in the same packet as the json ones
+  server::LiveSubscription compressed(
+      nlohmann::json::parse(R"({"compressed_data": true})"));
+  ASSERT_TRUE(compressed.getIsCompressedData());
+  ASSERT_TRUE(compressed.getIsEveryStream());
+  ASSERT_NE(compressed.getKey(), everything.getKey());
+  ASSERT_EQ(server::LiveSubscription(compressed.serialize()).getKey(),
+            compressed.getKey());
+
+  // Invalid subscriptions are refused
+  ASSERT_THROW(server::LiveSubscription(nlohmann::json::parse(
+                   R"({"streams": {"Emg": {"decimation": 0}}})")),
+               std::invalid_argument);
+  ASSERT_THROW(
+      server::LiveSubscription(nlohmann::json::parse(R"({"max_rate": -1})")),
+      std::invalid_argument);
+  ASSERT_THROW(server::LiveSubscription(nlohmann::json::parse(
+                   R"({"streams": {"Emg": {"channels": 1}}})")),
+               std::invalid_argument);
+}
+
+TEST(Server, LiveStreamRate) {
+  using std::chrono::milliseconds;
+  server::LiveStreamRate rate(milliseconds(100), milliseconds(1000));
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(100));
+
+  // It backs off when sending takes more than half of the interval
+  rate.update(milliseconds(60));
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(200));
+  for (int i = 0; i < 10; i++) {
+    rate.update(milliseconds(1000));
+  }
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(1000));
+
+  // It stays in between, then tightens when the clients keep up
+  rate.update(milliseconds(300));
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(1000));
+  rate.update(milliseconds(0));
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(750));
+  for (int i = 0; i < 20; i++) {
+    rate.update(milliseconds(0));
+  }
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(100));
+
+  rate.update(milliseconds(100));
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(200));
+  rate.reset();
+  ASSERT_EQ(rate.getCurrentInterval(), milliseconds(100));
+
+  // The interval never goes below the shortest one
+  server::LiveStreamRate fixed(milliseconds(100), milliseconds(10));
+  ASSERT_EQ(fixed.getMaxInterval(), milliseconds(100));
+  fixed.update(milliseconds(1000));
+  ASSERT_EQ(fixed.getCurrentInterval(), milliseconds(100));
+}
+
+TEST(Server, LiveStreamRatePerClient) {
+  using std::chrono::milliseconds;
+  auto context = std::make_shared<asio::io_context>();
+  auto makeSession = [&context](uint32_t id) {
+    return std::make_shared<server::ClientSession>(
+        context, id, [](const auto &, const auto &) { return true; },
+        [](const auto &, const auto &) { return true; }, [](const auto &) {},
+        milliseconds(1000),
+        server::LiveStreamRate(milliseconds(100), milliseconds(1000)),
+        server::LiveStreamRate(milliseconds(25), milliseconds(250)));
+  };
+  auto slowSession = makeSession(1);
+  auto session = makeSession(2);
+
+  // Each client keeping up is sent every packet
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(slowSession->isLiveDue(server::TcpServerChannel::LIVE_DATA));
+    ASSERT_TRUE(session->isLiveDue(server::TcpServerChannel::LIVE_DATA));
+  }
+
+  // A client that does not keep up backs off on its own, on that channel only
+  slowSession->updateLiveRate(server::TcpServerChannel::LIVE_DATA,
+                              milliseconds(60));
+  ASSERT_TRUE(slowSession->isLiveDue(server::TcpServerChannel::LIVE_DATA));
+  ASSERT_FALSE(slowSession->isLiveDue(server::TcpServerChannel::LIVE_DATA));
+  ASSERT_TRUE(session->isLiveDue(server::TcpServerChannel::LIVE_DATA));
+  ASSERT_TRUE(
+      slowSession->isLiveDue(server::TcpServerChannel::LIVE_ANALYSES));
+  ASSERT_TRUE(
+      slowSession->isLiveDue(server::TcpServerChannel::LIVE_ANALYSES));
+
+  // And is sent every packet again once it keeps up
+  for (int i = 0; i < 3; i++) {
+    slowSession->updateLiveRate(server::TcpServerChannel::LIVE_DATA,
+                                milliseconds(0));
+  }
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(slowSession->isLiveDue(server::TcpServerChannel::LIVE_DATA));
+  }
+}
+
+TEST(Server, PredictionHistory) {
+  auto logger = TestLogger();
+
+  analyzer::Predictions predictions;
+  predictions.set("Left Foot",
+                  data::DataPoint(std::chrono::microseconds(1000), {1.0 / 3},
+                                  {{"current_phase", size_t(1)},
+                                   {"has_changed_phase", true}}));
+  predictions.set("Right Foot",
+                  data::DataPoint(std::chrono::microseconds(2000),
+                                  {2.0 / 3, 4.0 / 3}));
+
+  // The predictions are sent with their analyzer, in the order they were made
+  server::PredictionHistory history(3);
+  ASSERT_EQ(history.add(predictions), 2);
+  ASSERT_EQ(history.getLastSequence(), 2);
+  auto serialized = history.serialize(0);
+  std::vector<char> buffer(serialized.begin(), serialized.end());
+  auto livePredictions = server::PredictionHistory::deserialize(buffer);
+  ASSERT_EQ(livePredictions.startingTime.time_since_epoch(),
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    predictions.getStartingTime().time_since_epoch())));
+  ASSERT_FALSE(livePredictions.isTruncated);
+  ASSERT_EQ(livePredictions.predictions.size(), 2);
+  const auto &left = livePredictions.predictions[0];
+  ASSERT_EQ(left.sequence, 1);
+  ASSERT_EQ(left.analyzer, "Left Foot");
+  ASSERT_EQ(left.prediction.getTimeStamp().count(), 1000);
+  ASSERT_EQ(left.prediction.getData(), std::vector<double>({1.0 / 3}));
+  const auto &extraInfo = left.prediction.getExtraInfo();
+  ASSERT_EQ(std::get<size_t>(extraInfo.at("current_phase")), 1);
+  ASSERT_TRUE(std::get<bool>(extraInfo.at("has_changed_phase")));
+  const auto &right = livePredictions.predictions[1];
+  ASSERT_EQ(right.sequence, 2);
+  ASSERT_EQ(right.analyzer, "Right Foot");
+  ASSERT_EQ(right.prediction.getData(),
+            std::vector<double>({2.0 / 3, 4.0 / 3}));
+  ASSERT_TRUE(right.prediction.getExtraInfo().empty());
+
+  // The binary packet is smaller than the json of the same predictions
+  ASSERT_LT(serialized.size(), predictions.serialize().dump().size());
+
+  // A prediction that was not renewed is not added again
+  ASSERT_EQ(history.add(predictions), 0);
+  predictions["Left Foot"] =
+      data::DataPoint(std::chrono::microseconds(3000), {0.75});
+  ASSERT_EQ(history.add(predictions), 1);
+  serialized = history.serialize(2);
+  buffer.assign(serialized.begin(), serialized.end());
+  livePredictions = server::PredictionHistory::deserialize(buffer);
+  ASSERT_EQ(livePredictions.predictions.size(), 1);
+  ASSERT_EQ(livePredictions.predictions[0].sequence, 3);
+  ASSERT_EQ(livePredictions.predictions[0].analyzer, "Left Foot");
+  ASSERT_EQ(history.serialize(3).size(), 17);
+
+  // Only the last predictions of each analyzer are kept
+  for (int i = 0; i < 5; i++) {
+    predictions["Left Foot"] =
+        data::DataPoint(std::chrono::microseconds(4000 + i), {0.0});
+    history.add(predictions);
+  }
+  serialized = history.serialize(0);
+  buffer.assign(serialized.begin(), serialized.end());
+  livePredictions = server::PredictionHistory::deserialize(buffer);
+  ASSERT_TRUE(livePredictions.isTruncated);
+  ASSERT_EQ(livePredictions.predictions.size(), 4);
+  ASSERT_EQ(livePredictions.predictions[0].analyzer, "Right Foot");
+  ASSERT_EQ(livePredictions.predictions[1].sequence, 6);
+  ASSERT_EQ(livePredictions.predictions[3].sequence, 8);
+
+  // The packet is complete again once the dropped predictions were sent
+  serialized = history.serialize(5);
+  buffer.assign(serialized.begin(), serialized.end());
+  livePredictions = server::PredictionHistory::deserialize(buffer);
+  ASSERT_FALSE(livePredictions.isTruncated);
+  ASSERT_EQ(livePredictions.predictions.size(), 3);
+
+  // Truncated packets are refused
+  buffer.pop_back();
+  ASSERT_THROW(server::PredictionHistory::deserialize(buffer),
+               std::runtime_error);
+}
+
+TEST(Server, LiveLoopsPause) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setLiveDataRate(server::LiveStreamRate(
+      std::chrono::milliseconds(50), std::chrono::milliseconds(500)));
+  server.startServer();
+
+  // Without any client, the live loops do not wake up
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  ASSERT_TRUE(server.areLiveLoopsPaused());
+
+  server::TcpClient client;
+  std::mutex mutex;
+  size_t receptionCount = 0;
+  client.onNewLiveData.listen([&](const auto &) {
+    std::lock_guard lock(mutex);
+    receptionCount++;
+  });
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_FALSE(server.areLiveLoopsPaused());
+  ASSERT_TRUE(client.addDelsysEmgDevice());
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  {
+    std::lock_guard lock(mutex);
+    ASSERT_GT(receptionCount, 0);
+  }
+  client.disconnect();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  ASSERT_TRUE(server.areLiveLoopsPaused());
+}
+
+TEST(Server, Subscribe) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  std::mutex mutex;
+  std::vector<server::LiveReception<std::map<std::string, data::TimeSeries>>>
+      receptions;
+  client.onNewLiveData.listen([&](const auto &reception) {
+    std::lock_guard lock(mutex);
+    receptions.push_back(reception);
+  });
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_TRUE(client.addDelsysEmgDevice());
+
+  // Invalid subscriptions are refused
+  ASSERT_FALSE(client.subscribe(nlohmann::json::parse(R"({"max_rate": -1})")));
+
+  // Only two channels of the raw EMG
+  ASSERT_TRUE(client.subscribe(nlohmann::json::parse(R"({
+    "streams": {"DelsysEmgDataCollector": {"channels": [0, 3]}}
+  })")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  {
+    std::lock_guard lock(mutex);
+    receptions.clear();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  {
+    std::lock_guard lock(mutex);
+    ASSERT_GE(receptions.size(), 2);
+    const auto &content = receptions.back().content;
+    ASSERT_EQ(content.size(), 1);
+    const auto &emg = content.at("DelsysEmgDataCollector");
+    ASSERT_GT(emg.size(), 0);
+    ASSERT_EQ(emg[0].getData().size(), 2);
+  }
+
+  // At most 2 packets per second
+  ASSERT_TRUE(client.subscribe(nlohmann::json::parse(R"({"max_rate": 2})")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  {
+    std::lock_guard lock(mutex);
+    receptions.clear();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  {
+    std::lock_guard lock(mutex);
+    ASSERT_GE(receptions.size(), 1);
+    ASSERT_LE(receptions.size(), 3);
+    ASSERT_EQ(receptions.back().content.at("DelsysEmgDataCollector")[0]
+                  .getData()
+                  .size(),
+              16);
+  }
+
+  // The same data, compressed, take fewer bytes per sample
+  ASSERT_TRUE(client.subscribe(nlohmann::json::parse(R"({
+    "streams": {"DelsysEmgDataCollector": {"channels": [0, 3]}}
+  })")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  {
+    std::lock_guard lock(mutex);
+    receptions.clear();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  size_t jsonByteCount;
+  {
+    std::lock_guard lock(mutex);
+    ASSERT_GT(receptions.size(), 0);
+    const auto &reception = receptions.back();
+    jsonByteCount = reception.byteCount /
+                    reception.content.at("DelsysEmgDataCollector").size();
+  }
+  ASSERT_TRUE(client.subscribe(nlohmann::json::parse(R"({
+    "streams": {"DelsysEmgDataCollector": {"channels": [0, 3]}},
+    "compressed_data": true
+  })")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  {
+    std::lock_guard lock(mutex);
+    receptions.clear();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  {
+    std::lock_guard lock(mutex);
+    ASSERT_GE(receptions.size(), 2);
+    const auto &reception = receptions.back();
+    const auto &emg = reception.content.at("DelsysEmgDataCollector");
+    ASSERT_GT(emg.size(), 0);
+    ASSERT_EQ(emg[0].getData().size(), 2);
+    ASSERT_LT(reception.byteCount / emg.size(), jsonByteCount);
+  }
+  client.disconnect();
+}
+
+TEST(Server, BinaryAnalyses) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.startServer();
+
+  server::TcpClient client;
+  std::mutex mutex;
+  std::vector<server::LiveReception<server::LivePredictions>> receptions;
+  size_t analysesCount = 0;
+  client.onNewLivePredictions.listen([&](const auto &reception) {
+    std::lock_guard lock(mutex);
+    receptions.push_back(reception);
+  });
+  client.onNewLiveAnalyses.listen([&](const auto &reception) {
+    std::lock_guard lock(mutex);
+    if (reception.content.size() > 0) {
+      analysesCount++;
+    }
+  });
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_TRUE(client.addDelsysAnalogDevice());
+  ASSERT_TRUE(client.addAnalyzer(nlohmann::json::parse(R"({
+    "name" : "Left Foot",
+    "analyzer_type" : "cyclic_timed_events",
+    "time_reference_device" : "DelsysAnalogDataCollector",
+    "learning_rate" : 0.5,
+    "initial_phase_durations" : [400, 600],
+    "events" : [
+      {
+        "name" : "heel_strike",
+        "previous" : "toe_off",
+        "start_when" : [{"type": "threshold",
+          "device" : "DelsysAnalogDataCollector", "channel" : 0,
+          "comparator" : ">=", "value" : 0.2}]
+      },
+      {
+        "name" : "toe_off",
+        "previous" : "heel_strike",
+        "start_when" : [{"type": "threshold",
+          "device" : "DelsysAnalogDataCollector", "channel" : 0,
+          "comparator" : "<=", "value" : -0.2}]
+      }
+    ]
+  })")));
+
+  // At most 2 packets per second, each with all the predictions made since
+  // the previous one
+  ASSERT_TRUE(client.subscribe(
+      nlohmann::json::parse(R"({"max_rate": 2, "binary_analyses": true})")));
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  {
+    std::lock_guard lock(mutex);
+    receptions.clear();
+    analysesCount = 0;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  client.disconnect();
+
+  std::lock_guard lock(mutex);
+  ASSERT_GE(receptions.size(), 2);
+  ASSERT_LE(receptions.size(), 5);
+  ASSERT_EQ(analysesCount, receptions.size());
+  uint64_t lastSequence = 0;
+  for (const auto &reception : receptions) {
+    const auto &predictions = reception.content.predictions;
+    ASSERT_GT(predictions.size(), 0);
+    for (const auto &prediction : predictions) {
+      // No prediction is missed nor sent twice
+      if (lastSequence != 0) {
+        ASSERT_EQ(prediction.sequence, lastSequence + 1);
+      }
+      lastSequence = prediction.sequence;
+      ASSERT_EQ(prediction.analyzer, "Left Foot");
+      ASSERT_EQ(prediction.prediction.getData().size(), 1);
+      ASSERT_TRUE(
+          prediction.prediction.getExtraInfo().count("current_phase") > 0);
+    }
+  }
+  ASSERT_GT(receptions.back().content.predictions.size(), 1);
+}
+
+TEST(Server, Pipelined) {
+  auto logger = TestLogger();
+
+  // A slow device does not hold back the other commands
+  {
+    server::TcpServerMock server(5000, 5001, 5002, 5003,
+                                 sufficientTimeoutPeriod);
+    server.setDeviceConnexionDelay(std::chrono::milliseconds(1000));
+    server.startServer();
+
+    server::TcpClient client;
+    ASSERT_TRUE(client.connect(0x10000001));
+
+    bool isDelsysEmgAdded = false;
+    std::thread worker([&client, &isDelsysEmgAdded]() {
+      isDelsysEmgAdded = client.addDelsysEmgDevice();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto start = std::chrono::steady_clock::now();
+    auto states = client.getStates();
+    ASSERT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(500));
+    ASSERT_FALSE(states["connected_devices"].contains("DelsysEmgDevice"));
+
+    worker.join();
+    ASSERT_TRUE(isDelsysEmgAdded);
+    states = client.getStates();
+    ASSERT_TRUE(states["connected_devices"].contains("DelsysEmgDevice"));
+    client.disconnect();
+  }
+
+  // The clients of the previous version are still served, one command at a
+  // time
+  {
+    server::TcpServerMock server(5000, 5001, 5002, 5003,
+                                 sufficientTimeoutPeriod);
+    server.startServer();
+
+    server::TcpClient client;
+    client.setIsPipelined(false);
+    ASSERT_TRUE(client.connect(0x10000001));
+    ASSERT_TRUE(client.addDelsysAnalogDevice());
+    ASSERT_FALSE(client.addDelsysAnalogDevice());
+    auto states = client.getStates();
+    ASSERT_TRUE(states["connected_devices"].contains("DelsysAnalogDevice"));
+    ASSERT_TRUE(client.subscribe(nlohmann::json::parse(R"({"max_rate": 2})")));
+    client.disconnect();
+  }
+}
+
+TEST(Server, ThreadPool) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setThreadCount(4);
+  server.setDeviceConnexionDelay(std::chrono::milliseconds(1000));
+  server.startServer();
+
+  // A client waiting for a slow device does not hold back the other clients
+  server::TcpClient slowClient;
+  slowClient.setIsPipelined(false);
+  ASSERT_TRUE(slowClient.connect(0x10000001));
+  server::TcpClient client;
+  ASSERT_TRUE(client.connect(0x10000002));
+
+  bool isDelsysEmgAdded = false;
+  std::thread worker([&slowClient, &isDelsysEmgAdded]() {
+    isDelsysEmgAdded = slowClient.addDelsysEmgDevice();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto start = std::chrono::steady_clock::now();
+  auto states = client.getStates();
+  ASSERT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(500));
+  ASSERT_TRUE(states.contains("connected_devices"));
+  worker.join();
+  ASSERT_TRUE(isDelsysEmgAdded);
+
+  // Many clients can connect at once
+  std::atomic<int> connectedCount = 0;
+  std::vector<std::thread> workers;
+  for (uint32_t i = 0; i < 4; i++) {
+    workers.emplace_back([i, &connectedCount]() {
+      server::TcpClient otherClient;
+      if (otherClient.connect(0x10000010 + i) &&
+          otherClient.getStates().contains("connected_devices")) {
+        connectedCount++;
+      }
+      otherClient.disconnect();
+    });
+  }
+  for (auto &otherWorker : workers) {
+    otherWorker.join();
+  }
+  ASSERT_EQ(connectedCount, 4);
+
+  slowClient.disconnect();
+  client.disconnect();
+}
+
+TEST(Server, SlowDevicesDoNotHoldThePool) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setThreadCount(2);
+  server.setDeviceConnexionDelay(std::chrono::milliseconds(1000));
+  server.startServer();
+
+  // The clients that wait for the response to their commands on the devices
+  // do not hold a thread of the pool meanwhile, even when they are as many
+  // as the threads
+  server::TcpClient emgClient;
+  emgClient.setIsPipelined(false);
+  ASSERT_TRUE(emgClient.connect(0x10000001));
+  server::TcpClient analogClient;
+  analogClient.setIsPipelined(false);
+  ASSERT_TRUE(analogClient.connect(0x10000002));
+  server::TcpClient client;
+  ASSERT_TRUE(client.connect(0x10000003));
+
+  bool isDelsysEmgAdded = false;
+  bool isDelsysAnalogAdded = false;
+  std::thread emgWorker([&emgClient, &isDelsysEmgAdded]() {
+    isDelsysEmgAdded = emgClient.addDelsysEmgDevice();
+  });
+  std::thread analogWorker([&analogClient, &isDelsysAnalogAdded]() {
+    isDelsysAnalogAdded = analogClient.addDelsysAnalogDevice();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto start = std::chrono::steady_clock::now();
+  auto states = client.getStates();
+  ASSERT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(500));
+  ASSERT_TRUE(states.contains("connected_devices"));
+  emgWorker.join();
+  analogWorker.join();
+  ASSERT_TRUE(isDelsysEmgAdded);
+  ASSERT_TRUE(isDelsysAnalogAdded);
+
+  emgClient.disconnect();
+  analogClient.disconnect();
+  client.disconnect();
+}
+
+TEST(Server, DisconnectWhileStreaming) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setThreadCount(4);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  std::atomic<size_t> receptionCount = 0;
+  client.onNewLiveData.listen(
+      [&receptionCount](const auto &) { receptionCount++; });
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_TRUE(client.addDelsysEmgDevice());
+
+  // The clients leaving while the live loops write to them do not disturb
+  // the others
+  for (uint32_t round = 0; round < 5; round++) {
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < 4; i++) {
+      workers.emplace_back([round, i]() {
+        server::TcpClient otherClient;
+        if (otherClient.connect(0x10000010 + 4 * round + i)) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(50 * i));
+          otherClient.disconnect();
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  receptionCount = 0;
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  ASSERT_GE(receptionCount, 2);
+  ASSERT_TRUE(client.getStates()["connected_devices"].contains(
+      "DelsysEmgDevice"));
+  client.disconnect();
+}
+
+TEST(Server, ExtraDataTimeout) {
+  auto logger = TestLogger();
+
+  // A client that announces extra data but never sends them
+  class SilentClient : public server::TcpClient {
+  public:
+    using TcpClient::sendCommand;
+  };
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.startServer();
+
+  server::TcpClient client;
+  ASSERT_TRUE(client.connect(0x10000001));
+  SilentClient silentClient;
+  ASSERT_TRUE(silentClient.connect(0x10000002));
+
+  server.setTimeoutPeriod(failingTimeoutPeriod);
+  ASSERT_EQ(
+      silentClient.sendCommand(server::TcpServerCommand::ADD_ANALYZER)
+          .getMessage(),
+      server::TcpServerMessage::LISTENING_EXTRA_DATA);
+  std::this_thread::sleep_for(failingTimeoutPeriod + failingBufferPeriod);
+
+  // The silent client is dropped, the others are still served
+  logger.giveTimeToUpdate();
+  ASSERT_TRUE(logger.contains("Client session 268435458 did not send the "
+                              "extra data in time, disconnecting."));
+  ASSERT_FALSE(server.isClientConnected(0x10000002));
+  ASSERT_TRUE(client.getStates().contains("connected_devices"));
+  client.disconnect();
+}
+
+TEST(Server, States) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.startServer();
+
+  server::TcpClient client;
+  ASSERT_TRUE(client.connect(0x10000001));
+  server::TcpClient previousClient;
+  previousClient.setIsPipelined(false);
+  ASSERT_TRUE(previousClient.connect(0x10000002));
+
+  // The states are only known once received
+  ASSERT_TRUE(client.getCachedStates().empty());
+  auto states = client.getStates();
+  ASSERT_EQ(states["version"], 0);
+  ASSERT_TRUE(states["connected_devices"].is_null());
+  ASSERT_EQ(client.getCachedStates(), states);
+  ASSERT_EQ(previousClient.getStates(), states);
+
+  // Then the pipelined client is sent what changes (the changes of commands
+  // handled at the same time may come in a single version)
+  ASSERT_TRUE(client.addDelsysEmgDevice());
+  ASSERT_TRUE(client.startRecording());
+  logger.giveTimeToUpdate();
+  auto cachedStates = client.getCachedStates();
+  uint64_t version = cachedStates["version"];
+  ASSERT_GE(version, 1);
+  ASSERT_TRUE(
+      cachedStates["connected_devices"]["DelsysEmgDevice"]["is_recording"]);
+
+  // Which are the states the server would send
+  states = client.getStates();
+  ASSERT_EQ(states["version"], version);
+  ASSERT_EQ(client.getCachedStates(), states);
+
+  // A command that fails changes nothing
+  ASSERT_FALSE(client.addDelsysEmgDevice());
+  logger.giveTimeToUpdate();
+  ASSERT_EQ(client.getCachedStates()["version"], version);
+
+  // The clients of the previous version are only told the states changed
+  ASSERT_TRUE(previousClient.getCachedStates().empty());
+  ASSERT_EQ(previousClient.getStates()["version"], version);
+  ASSERT_FALSE(previousClient.getCachedStates().empty());
+
+  ASSERT_TRUE(client.stopRecording());
+  logger.giveTimeToUpdate();
+  ASSERT_EQ(client.getCachedStates()["version"], version + 1);
+  ASSERT_TRUE(previousClient.getCachedStates().empty());
+
+  previousClient.disconnect();
+  client.disconnect();
+}
+
+TEST(Server, StatesChangingWithoutCommand) {
+  auto logger = TestLogger();
+
+  // Gives the tests the devices of the server, as if they changed on their own
+  class TestServer : public server::TcpServerMock {
+  public:
+    using server::TcpServerMock::TcpServerMock;
+    devices::Devices &devices() { return m_Devices; }
+  };
+  TestServer server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.startServer();
+
+  server::TcpClient client;
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_TRUE(client.addDelsysEmgDevice());
+  auto states = client.getStates();
+  uint64_t version = states["version"];
+  ASSERT_TRUE(states["connected_devices"]["DelsysEmgDevice"]["is_connected"]);
+
+  // As long as nothing changes, the same version is served
+  ASSERT_EQ(client.getStates()["version"], version);
+
+  // A device that disconnects on its own is seen by the next GET_STATES, and
+  // the pipelined clients are sent the change as well
+  server.devices().disconnect();
+  states = client.getStates();
+  ASSERT_EQ(states["version"], version + 1);
+  ASSERT_FALSE(states["connected_devices"]["DelsysEmgDevice"]["is_connected"]);
+  logger.giveTimeToUpdate();
+  ASSERT_EQ(client.getCachedStates(), states);
+
+  client.disconnect();
+}
+
+TEST(Server, ResumeLiveData) {
+  auto logger = TestLogger();
+
+  server::TcpServerMock server(5000, 5001, 5002, 5003, sufficientTimeoutPeriod);
+  server.setMultiplexedPort(5004);
+  server.setSyntheticDevice("DelsysEmgDevice",
+                            devices::SyntheticDeviceConfiguration::delsysEmg());
+  server.startServer();
+
+  server::TcpClient client;
+  client.setMultiplexedPort(5004);
+  std::mutex mutex;
+  std::vector<server::LiveReception<std::map<std::string, data::TimeSeries>>>
+      receptions;
+  client.onNewLiveData.listen([&](const auto &reception) {
+    std::lock_guard lock(mutex);
+    receptions.push_back(reception);
+  });
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_TRUE(client.addDelsysEmgDevice());
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  client.disconnect();
+  {
+    std::lock_guard lock(mutex);
+    ASSERT_GT(receptions.size(), 0);
+    receptions.clear();
+  }
+
+  // The samples streamed while disconnected are sent back on resume
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  ASSERT_TRUE(client.connect(0x10000001));
+  ASSERT_TRUE(client.resumeLiveData());
+  logger.giveTimeToUpdate();
+  ASSERT_TRUE(logger.contains("Live data resumed"));
+  ASSERT_FALSE(logger.contains("are no longer available"));
+  client.disconnect();
+
+  std::lock_guard lock(mutex);
+  ASSERT_GT(receptions.size(), 0);
+  const auto &emg = receptions.front().content.at("DelsysEmgDataCollector");
+  ASSERT_GT(emg.size(), 0);
+  ASSERT_EQ(emg[0].getData().size(), 16);
+}
+
 TEST(Server, addAnalyzer) {
   auto logger = TestLogger();
 
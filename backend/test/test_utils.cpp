@@ -4,8 +4,11 @@
 #include "utils.h"
 
 #include "Utils/Logger.h"
+#include "Utils/Metrics.h"
 #include "Utils/NeurobioEvent.h"
 #include "Utils/RollingVector.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Tracer.h"
 
 using namespace NEUROBIO_NAMESPACE;
 
@@ -468,4 +471,202 @@ TEST(RollingVector, AllGetsWithNoLimit) {
     forLoopCount++;
   }
   ASSERT_TRUE(forLoopCount == 5);
-}
\ No newline at end of file
+}
+TEST(ThreadPool, ParallelFor) {
+  for (size_t threadCount : {0, 1, 4}) {
+    auto pool = utils::ThreadPool(threadCount);
+    ASSERT_EQ(pool.getThreadCount(), threadCount);
+
+    // Each task is run exactly once, in as many rounds as requested
+    for (size_t round = 0; round < 10; round++) {
+      std::vector<size_t> calls(100, 0);
+      pool.parallelFor(calls.size(), [&calls](size_t i) { calls[i]++; });
+      for (size_t i = 0; i < calls.size(); i++) {
+        ASSERT_EQ(calls[i], 1);
+      }
+    }
+
+    // Nothing to do is fine
+    pool.parallelFor(0, [](size_t) { FAIL(); });
+  }
+}
+
+TEST(ThreadPool, Exceptions) {
+  auto pool = utils::ThreadPool(4);
+
+  // All the tasks are run and the exception of the lowest index is rethrown
+  std::vector<size_t> calls(50, 0);
+  try {
+    pool.parallelFor(calls.size(), [&calls](size_t i) {
+      calls[i]++;
+      if (i % 10 == 7) {
+        throw std::runtime_error(std::to_string(i));
+      }
+    });
+    FAIL() << "An exception was expected";
+  } catch (const std::runtime_error &e) {
+    ASSERT_STREQ(e.what(), "7");
+  }
+  for (size_t i = 0; i < calls.size(); i++) {
+    ASSERT_EQ(calls[i], 1);
+  }
+
+  // The pool is still usable afterwards
+  std::vector<size_t> moreCalls(10, 0);
+  pool.parallelFor(moreCalls.size(),
+                   [&moreCalls](size_t i) { moreCalls[i]++; });
+  for (size_t i = 0; i < moreCalls.size(); i++) {
+    ASSERT_EQ(moreCalls[i], 1);
+  }
+}
+
+TEST(Metrics, Histogram) {
+  utils::Histogram histogram("us");
+  ASSERT_EQ(histogram.count(), 0);
+  ASSERT_EQ(histogram.valueAtQuantile(0.5), 0);
+
+  for (uint64_t value = 1; value <= 10000; value++) {
+    histogram.record(value);
+  }
+  ASSERT_EQ(histogram.count(), 10000);
+
+  // The percentiles are within 1/16 of the actual value, but never outside
+  // the recorded values
+  ASSERT_NEAR(histogram.valueAtQuantile(0.5), 5000, 5000 / 16);
+  ASSERT_NEAR(histogram.valueAtQuantile(0.99), 9900, 9900 / 16);
+  ASSERT_EQ(histogram.valueAtQuantile(0.0), 1);
+  ASSERT_EQ(histogram.valueAtQuantile(1.0), 10000);
+
+  // Small values are exact
+  utils::Histogram small("bytes");
+  small.record(3);
+  small.record(7);
+  ASSERT_EQ(small.valueAtQuantile(0.5), 3);
+  ASSERT_EQ(small.valueAtQuantile(1.0), 7);
+
+  // Any value can be recorded
+  utils::Histogram huge("ns");
+  huge.record(std::numeric_limits<uint64_t>::max());
+  huge.record(std::chrono::nanoseconds(-1));
+  ASSERT_EQ(huge.valueAtQuantile(1.0), std::numeric_limits<uint64_t>::max());
+  ASSERT_EQ(huge.valueAtQuantile(0.0), 0);
+
+  auto json = histogram.serialize();
+  ASSERT_EQ(json["unit"], "us");
+  ASSERT_EQ(json["count"], 10000);
+  ASSERT_EQ(json["min"], 1);
+  ASSERT_EQ(json["max"], 10000);
+  ASSERT_DOUBLE_EQ(json["mean"].get<double>(), 5000.5);
+  ASSERT_TRUE(json.contains("p999"));
+}
+
+TEST(Metrics, Registry) {
+  auto &metrics = utils::Metrics::getInstance();
+
+  // The same name gives the same metric
+  auto counter = metrics.counter("Test.Registry.counter");
+  ASSERT_EQ(counter, metrics.counter("Test.Registry.counter"));
+  counter->add();
+  counter->add(2);
+  metrics.gauge("Test.Registry.gauge")->set(5);
+  metrics.gauge("Test.Registry.gauge")->add(-2);
+  {
+    utils::HistogramScope scope(*metrics.histogram("Test.Registry.duration"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  auto json = metrics.serialize();
+  ASSERT_TRUE(json.contains("uptime"));
+  ASSERT_TRUE(json.contains("timestamp"));
+  ASSERT_EQ(json["counters"]["Test.Registry.counter"], 3);
+  ASSERT_EQ(json["gauges"]["Test.Registry.gauge"], 3);
+  const auto &duration = json["histograms"]["Test.Registry.duration"];
+  ASSERT_EQ(duration["unit"], "ns");
+  ASSERT_EQ(duration["count"], 1);
+  ASSERT_GE(duration["min"].get<uint64_t>(), 2000000);
+
+  // Removed metrics are not reported anymore, but stay valid
+  metrics.counter("Test.RegistryOther.counter");
+  metrics.remove("Test.Registry.");
+  counter->add();
+  json = metrics.serialize();
+  ASSERT_FALSE(json["counters"].contains("Test.Registry.counter"));
+  ASSERT_FALSE(json["gauges"].contains("Test.Registry.gauge"));
+  ASSERT_FALSE(json["histograms"].contains("Test.Registry.duration"));
+  ASSERT_TRUE(json["counters"].contains("Test.RegistryOther.counter"));
+  metrics.remove("Test.RegistryOther.");
+}
+
+static std::vector<nlohmann::json> findTraceEvents(const nlohmann::json &trace,
+                                                   const std::string &name) {
+  std::vector<nlohmann::json> events;
+  for (const auto &event : trace["traceEvents"]) {
+    if (event["name"] == name) {
+      events.push_back(event);
+    }
+  }
+  return events;
+}
+
+TEST(Tracer, Zones) {
+  auto &tracer = utils::Tracer::getInstance();
+  tracer.clear();
+
+  auto zone = [&tracer](const char *name) {
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    tracer.record(name, start, std::chrono::steady_clock::now());
+  };
+  zone("Main zone");
+  std::thread([&zone]() { zone("Thread zone"); }).join();
+
+  auto trace = tracer.serialize();
+  ASSERT_TRUE(trace.contains("displayTimeUnit"));
+  ASSERT_TRUE(trace["otherData"].contains("starting_time"));
+  auto mainEvents = findTraceEvents(trace, "Main zone");
+  auto threadEvents = findTraceEvents(trace, "Thread zone");
+  ASSERT_EQ(mainEvents.size(), 1);
+  ASSERT_EQ(threadEvents.size(), 1);
+  ASSERT_EQ(mainEvents[0]["ph"], "X");
+  ASSERT_GE(mainEvents[0]["dur"].get<double>(), 2000.0);
+  ASSERT_GE(threadEvents[0]["ts"].get<double>(),
+            mainEvents[0]["ts"].get<double>() +
+                mainEvents[0]["dur"].get<double>());
+  ASSERT_NE(mainEvents[0]["tid"], threadEvents[0]["tid"]);
+
+  // The exited threads are dropped once serialized
+  trace = tracer.serialize();
+  ASSERT_EQ(findTraceEvents(trace, "Main zone").size(), 1);
+  ASSERT_EQ(findTraceEvents(trace, "Thread zone").size(), 0);
+
+  // Only the last zones of each thread are kept
+  tracer.clear();
+  auto now = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < utils::Tracer::BufferSize + 10; i++) {
+    tracer.record("Many zones", now, now);
+  }
+  ASSERT_EQ(findTraceEvents(tracer.serialize(), "Many zones").size(),
+            utils::Tracer::BufferSize);
+  tracer.clear();
+}
+
+#ifdef ENABLE_TRACING
+TEST(Tracer, Scopes) {
+  auto &tracer = utils::Tracer::getInstance();
+  tracer.clear();
+  {
+    NEUROBIO_TRACE_SCOPE("Outer scope");
+    NEUROBIO_TRACE_SCOPE("Inner scope");
+  }
+  auto trace = tracer.serialize();
+  ASSERT_EQ(findTraceEvents(trace, "Outer scope").size(), 1);
+  ASSERT_EQ(findTraceEvents(trace, "Inner scope").size(), 1);
+
+  // Nothing is recorded while disabled
+  tracer.clear();
+  tracer.setIsEnabled(false);
+  { NEUROBIO_TRACE_SCOPE("Disabled scope"); }
+  tracer.setIsEnabled(true);
+  ASSERT_EQ(findTraceEvents(tracer.serialize(), "Disabled scope").size(), 0);
+}
+#endif // ENABLE_TRACING